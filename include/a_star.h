@@ -13,31 +13,127 @@ class gridPathFinder
 	private:
 		Eigen::Vector3d gridIndex2coord(Eigen::Vector3i index);
 		Eigen::Vector3i coord2gridIndex(Eigen::Vector3d pt);
-		GridNodePtr 	pos2gridNodePtr(Eigen::Vector3d pos);
 
-		double getDiagHeu(GridNodePtr node1, GridNodePtr node2);
-		double getManhHeu(GridNodePtr node1, GridNodePtr node2);
-		double getEuclHeu(GridNodePtr node1, GridNodePtr node2);
-		double getHeu(GridNodePtr node1, GridNodePtr node2);
+		// Nodes are identified by the linear index of their cell in the search window.
+		inline int gridIndex2id(const Eigen::Vector3i & index) const
+		{
+			return (index(0) * GLY_SIZE + index(1)) * GLZ_SIZE + index(2);
+		}
+		inline Eigen::Vector3i id2gridIndex(int id) const
+		{
+			return Eigen::Vector3i(id / (GLY_SIZE * GLZ_SIZE), (id / GLZ_SIZE) % GLY_SIZE, id % GLZ_SIZE);
+		}
+		void touchNode(int id, const Eigen::Vector3i & index);
+		bool isOccupied(const Eigen::Vector3i & index) const;
 
-		std::vector<GridNodePtr> retrievePath(GridNodePtr current);
+		double getDiagHeu(const Eigen::Vector3i & idx1, const Eigen::Vector3i & idx2);
+		double getManhHeu(const Eigen::Vector3i & idx1, const Eigen::Vector3i & idx2);
+		double getEuclHeu(const Eigen::Vector3i & idx1, const Eigen::Vector3i & idx2);
+		double getHeu(const Eigen::Vector3i & idx1, const Eigen::Vector3i & idx2);
+
+		std::vector<int> retrievePath(int current);
+
+		// Anytime Repairing A*: one weighted A* pass that stops at the deadline, and the rebuild of
+		// the open set (inconsistent nodes added back, keys for the new weight) between passes.
+		bool araImprovePath(int endId, const Eigen::Vector3i & endIdx, double eps, const ros::WallTime & deadline, int & num_iter);
+		void araRebuildOpenSet(const Eigen::Vector3i & endIdx, double eps);
+
+		// Jump Point Search. Cells outside the search window are blocked and cells outside the
+		// linked local map are free.
+		void initJpsTables();
+		void buildOccupancyBitmap();
+		inline int gridSize(int axis) const
+		{
+			return axis == 0 ? GLX_SIZE : (axis == 1 ? GLY_SIZE : GLZ_SIZE);
+		}
+		// Row of the bitmap running along axis through the cell whose other two coordinates,
+		// in the order axis + 1, axis + 2, are u and v.
+		inline const uint64_t * occupancyRow(int axis, int u, int v) const
+		{
+			return &occupancyRows[axis][(u * gridSize((axis + 2) % 3) + v) * rowWords[axis]];
+		}
+		inline bool jpsBlocked(const Eigen::Vector3i & index) const
+		{
+			if(    index(0) < 0 || index(0) >= GLX_SIZE
+				|| index(1) < 0 || index(1) >= GLY_SIZE
+				|| index(2) < 0 || index(2) >= GLZ_SIZE)
+				return true;
+
+			const uint64_t * row = occupancyRow(2, index(0), index(1));
+			return (row[index(2) >> 6] >> (index(2) & 63)) & 1;
+		}
+		unsigned int jpsForcedDirs(const Eigen::Vector3i & index, int dir) const;
+		bool jump(const Eigen::Vector3i & index, int dir, const Eigen::Vector3i & endIdx, Eigen::Vector3i & jumpIdx) const;
+		bool jumpStraight(const Eigen::Vector3i & index, int axis, int sign, const Eigen::Vector3i & endIdx, Eigen::Vector3i & jumpIdx) const;
+
+		// Open set: 4-ary min-heap of (fScore, id), heapPos keeps the position of each open
+		// node so that its key can be decreased in place.
+		void heapPush(int id, double f);
+		int  heapPop();
+		void heapDecrease(int id, double f);
+		void heapSiftUp(int pos);
+		void heapSiftDown(int pos);
 
 		double resolution, inv_resolution;
 		double gl_xl, gl_yl, gl_zl;
 		double tie_breaker = 1.0 + 1.0 / 10000;
 
-		std::vector<GridNodePtr> expandedNodes;
-		std::vector<GridNodePtr> gridPath;
+		std::vector<int> gridPath;
+		Eigen::Vector3d  startCoord;
 
 		int GLX_SIZE, GLY_SIZE, GLZ_SIZE;
 		int X_SIZE, Y_SIZE, Z_SIZE;
 
-		GridNodePtr *** GridNodeMap;
-		std::multimap<double, GridNodePtr> openSet;
+		// Per-node search state, one flat array per field. A node only holds valid data if its
+		// generation stamp is the current one, otherwise it is treated as free and unvisited.
+		std::vector<double>        gScore;
+		std::vector<int>           cameFrom;    // id of the parent node, -1 for the start
+		std::vector<signed char>   nodeState;   // 1--> open set, -1 --> closed set, 0 --> unvisited
+		std::vector<unsigned char> occupied;    // read from the linked map when the node is touched
+		std::vector<unsigned int>  nodeGeneration;
+		std::vector<int>           heapPos;
+		unsigned int generation = 1;
+
+		// Nodes stamped with the current generation, so that bookkeeping does not scan the grid.
+		std::vector<int> touchedNodes;
+
+		// Linked local map, not copied: the occupancy of a node is read from it the first time
+		// the node is touched. localOffset is the window index of its first cell.
+		sdf_tools::CollisionMapGrid * localMap = NULL;
+		Eigen::Vector3i localOffset;
+
+		std::vector<std::pair<double, int> > openSet;
+
+		// ARA*: closed nodes whose gScore decreased during the current pass, and the heuristic
+		// weights. Each search starts from araEpsInit, lowered by one step after every search
+		// that found the optimal path within half of its budget and reset after one that did not.
+		std::vector<int> inconsNodes;
+		double araEpsInit = 2.5, araEpsStep = 0.5;
+		double araEpsStart = 2.5;
+		double araEps = 0.0;
+
+		// The 26 neighbour directions, their id offsets and their costs.
+		Eigen::Vector3i neighborDir[26];
+		int             neighborOffset[26];
+		double          neighborCost[26];
+
+		// JPS pruning tables, per direction of arrival: the natural successor directions, the
+		// neighbours to probe, and for each forced candidate the cells that must all be blocked
+		// for the candidate to be forced (bitmasks over the 26 directions).
+		std::vector<int> jpsNatural[26];
+		std::vector<std::pair<int, unsigned int> > jpsForced[26];
+		std::vector<int> jpsProbe[26];
+
+		// Occupancy of the search window for JPS, one bit per cell, built on the first JPS search
+		// after linking. It is stored three times, with rows running along x, y and z, so that a
+		// straight jump tests 64 cells per word. The padding at the end of each row is blocked.
+		std::vector<uint64_t> occupancyRows[3];
+		int rowWords[3];
+		bool bitmapLinked = false;
 
 	public:
 		gridPathFinder( Eigen::Vector3i GL_size, Eigen::Vector3i LOC_size)
-		{	
+		{
 			// size of a big big global grid map
 			GLX_SIZE = GL_size(0);
 			GLY_SIZE = GL_size(1);
@@ -52,12 +148,19 @@ class gridPathFinder
 		~gridPathFinder(){};
 
 		void initGridNodeMap(double _resolution, Eigen::Vector3d global_xyz_l);
+		// Moves the searched grid to the box of size cells whose first corner is xyz_l, on the
+		// cells of the global map. Cells outside the box are blocked.
+		void setSearchWindow(Eigen::Vector3d xyz_l, Eigen::Vector3i size);
 		void linkLocalMap(sdf_tools::CollisionMapGrid * local_map, Eigen::Vector3d xyz_l);
 		void AstarSearch(Eigen::Vector3d start_pt, Eigen::Vector3d end_pt);
+		void JpsSearch(Eigen::Vector3d start_pt, Eigen::Vector3d end_pt);
+		void AraSearch(Eigen::Vector3d start_pt, Eigen::Vector3d end_pt, double time_budget);
+		void setAraInflation(double eps_init, double eps_step);
+		double getAraEpsilon() const { return araEps; };
 
 		void resetLocalMap();
 		void resetPath();
 
 		std::vector<Eigen::Vector3d> getPath();
-		std::vector<GridNodePtr> getVisitedNodes();
+		std::vector<Eigen::Vector3d> getVisitedNodes();
 };
\ No newline at end of file
@@ -13,8 +13,6 @@
 #define inf 1>>30
 
 struct Cube;
-struct GridNode;
-typedef GridNode* GridNodePtr;
 
 struct Cube
 {     
@@ -25,6 +23,10 @@ struct Cube
 
       double t; // time allocated to this cube
       std::vector< std::pair<double, double> > box;
+
+      // Half-spaces a.x <= b cutting the box down to a convex polyhedron, one row (a_x, a_y, a_z, b)
+      // per plane with a of unit length. Empty for an axis-aligned cube.
+      Eigen::MatrixXd hplane;
 /*
            P4------------P3 
            /|           /|              ^
@@ -44,6 +46,7 @@ struct Cube
             valid = true;
             t = 0.0;
             box.resize(3);
+            hplane = Eigen::MatrixXd::Zero(0, 4);
       }
 
       // create a inscribe cube of a ball using the center point and the radius of the ball
@@ -106,48 +109,10 @@ struct Cube
          valid = true;
          t = 0.0;
          box.resize(3);
+         hplane = Eigen::MatrixXd::Zero(0, 4);
       }
 
       ~Cube(){}
 };
 
-struct GridNode
-{     
-   int id;        // 1--> open set, -1 --> closed set
-   Eigen::Vector3d coord;
-   Eigen::Vector3i index;
-   
-   double gScore, fScore;
-   GridNodePtr cameFrom;
-   std::multimap<double, GridNodePtr>::iterator nodeMapIt;
-   double occupancy; 
-
-   std::vector<GridNodePtr> hisNodeList; // use a list to record nodes in its history
-
-   GridNode(Eigen::Vector3i _index)
-   {  
-      id = 0;
-      index = _index;
-      
-      gScore = inf;
-      fScore = inf;
-      cameFrom = NULL;
-   }
-
-   GridNode(Eigen::Vector3i _index, Eigen::Vector3d _coord)
-   {  
-      id = 0;
-      index = _index;
-      coord = _coord;
-
-      gScore = inf;
-      fScore = inf;
-      cameFrom = NULL;
-   }
-
-   GridNode(){};
-   
-   ~GridNode(){};
-};
-
 #endif
\ No newline at end of file
@@ -0,0 +1,55 @@
+#ifndef _POLYHEDRON_GENERATOR_H_
+#define _POLYHEDRON_GENERATOR_H_
+
+#include <vector>
+#include <Eigen/Eigen>
+#include <arc_utilities/voxel_grid.hpp>
+#include <sdf_tools/dynamic_spatial_hashed_collision_map.hpp>
+#include "data_type.h"
+
+class polyhedronGenerator
+{
+	private:
+		// Range of cells covering the box lo - hi.
+		void boxIndexRange(const Eigen::Vector3d & lo, const Eigen::Vector3d & hi, Eigen::Vector3i & idx_lo, Eigen::Vector3i & idx_hi) const;
+		bool isSegmentClear(const Eigen::Vector3d & p0, const Eigen::Vector3d & p1, double clearance) const;
+		bool detourStep(const Eigen::Vector3d & p0, const Eigen::Vector3d & p1, std::vector<Eigen::Vector3d> & detour) const;
+		void gatherObstacles(const Eigen::Vector3i & idx_lo, const Eigen::Vector3i & idx_hi, const Eigen::Vector3d & p0, const Eigen::Vector3d & p1);
+
+		const sdf_tools::DynamicSpatialHashedCollisionMapGrid * map = NULL;
+		double resolution;
+		double range = 1.0;
+		double maxLength = 3.0;
+
+		// Occupied cells around the current segment, sorted by distance to it. The centers are stored
+		// one array per axis, so that the half-space test runs over 4 cells per instruction with AVX2.
+		std::vector<double> obsX, obsY, obsZ;
+		std::vector<double> obsDist;
+		std::vector<unsigned char> obsRemoved;
+		std::vector<std::pair<double, int> > obsOrder;
+
+	public:
+		polyhedronGenerator(){};
+		~polyhedronGenerator(){};
+
+		void linkMap(const sdf_tools::DynamicSpatialHashedCollisionMapGrid * global_map);
+		void setParam(double poly_range, double max_length);
+
+		// Convex polyhedron around the segment p0 - p1: the box of the segment grown by the range, cut
+		// by the supporting plane of each obstacle cell that is still inside, nearest cell first. Fails
+		// if the segment touches an obstacle cell.
+		bool generatePolyhedron(const Eigen::Vector3d & p0, const Eigen::Vector3d & p1, Cube & poly);
+
+		// Convex polyhedron around a region of TaggedObjectCollisionMapGrid::ComputeConvexSegments, on a
+		// grid of axis-aligned cells of side cell_size whose cell (0, 0, 0) has its lowest corner at
+		// origin: the bounding box of the cells, cut by their supporting planes along the 12 edge and 8
+		// corner diagonals. The center is the seed of the region, its first cell. Fails if it is empty.
+		static bool segmentPolyhedron(const std::vector<VoxelGrid::GRID_INDEX> & segment, const Eigen::Vector3d & origin, double cell_size, Cube & poly);
+
+		// Covers the path with polyhedra around the longest straight segments that stay at least margin
+		// away from the obstacles (single steps of the path only need to be free). seeds receives where
+		// each polyhedron starts along the path, as a fractional index of the path points.
+		bool generateCorridor(const std::vector<Eigen::Vector3d> & path, double margin, std::vector<Cube> & corridor, std::vector<double> & seeds);
+};
+
+#endif
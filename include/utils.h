@@ -12,6 +12,8 @@
 #include "../third_party/fast_methods/fm/fmdata/fmcell.h"
 #include "../third_party/fast_methods/fm/fmm.hpp"
 #include "../third_party/fast_methods/fm/fmmstar.hpp"
+#include "../third_party/fast_methods/fm/dfmm.hpp"
+#include "../third_party/fast_methods/fm/hfmm.hpp"
 
 /*
 #include "../third_party/fast_methods/fm/ufmm.hpp"
@@ -6,86 +6,235 @@ using namespace sdf_tools;
 
 void gridPathFinder::initGridNodeMap(double _resolution, Vector3d global_xyz_l)
 {   
-    gl_xl = global_xyz_l(0);
-    gl_yl = global_xyz_l(1);
-    gl_zl = global_xyz_l(2);
-
     resolution = _resolution;
     inv_resolution = 1.0 / _resolution;    
 
-    GridNodeMap = new GridNodePtr ** [GLX_SIZE];
-    for(int i = 0; i < GLX_SIZE; i++){
-       GridNodeMap[i] = new GridNodePtr * [GLY_SIZE];
-       for(int j = 0; j < GLY_SIZE; j++){
-           GridNodeMap[i][j] = new GridNodePtr [GLZ_SIZE];
-           for( int k = 0; k < GLZ_SIZE;k++){
-                Vector3i tmpIdx(i,j,k);
-                Vector3d pos = gridIndex2coord(tmpIdx);
-                GridNodeMap[i][j][k] = new GridNode(tmpIdx, pos);
-           }
-       }
+    int n = 0;
+    for(int dx = -1; dx < 2; dx++)
+        for(int dy = -1; dy < 2; dy++)
+            for(int dz = -1; dz < 2; dz++)
+            {
+                if(dx == 0 && dy == 0 && dz ==0)
+                    continue; 
+
+                neighborDir[n]    = Vector3i(dx, dy, dz);
+                neighborCost[n]   = sqrt(dx * dx + dy * dy + dz * dz);
+                n ++;
+            }
+
+    initJpsTables();
+    setSearchWindow(global_xyz_l, Vector3i(GLX_SIZE, GLY_SIZE, GLZ_SIZE));
+}
+
+void gridPathFinder::setSearchWindow(Vector3d xyz_l, Vector3i size)
+{
+    gl_xl = xyz_l(0);
+    gl_yl = xyz_l(1);
+    gl_zl = xyz_l(2);
+
+    GLX_SIZE = size(0);
+    GLY_SIZE = size(1);
+    GLZ_SIZE = size(2);
+
+    for(int n = 0; n < 26; n++)
+        neighborOffset[n] = (neighborDir[n](0) * GLY_SIZE + neighborDir[n](1)) * GLZ_SIZE + neighborDir[n](2);
+
+    // Nodes are not allocated one by one: every field lives in a flat array indexed by the
+    // node id, and stale entries are recognised by their generation stamp. The arrays keep the
+    // size of the largest window, the ids of the previous window are dropped with its generation.
+    int num_nodes = GLX_SIZE * GLY_SIZE * GLZ_SIZE;
+    if(num_nodes > (int)nodeGeneration.size())
+    {
+        gScore.resize(num_nodes);
+        cameFrom.resize(num_nodes);
+        nodeState.resize(num_nodes);
+        occupied.resize(num_nodes);
+        heapPos.resize(num_nodes);
+        nodeGeneration.resize(num_nodes, 0);
     }
+
+    resetLocalMap();
 }
 
-void gridPathFinder::linkLocalMap(CollisionMapGrid * local_map, Vector3d xyz_l)
-{    
-    Vector3d coord; 
-    for(int64_t i = 0; i < X_SIZE; i++)
+// Index in neighborDir of a direction with components in {-1, 0, 1}.
+static inline int dirIndex(const Vector3i & dir)
+{
+    int n = (dir(0) + 1) * 9 + (dir(1) + 1) * 3 + (dir(2) + 1);
+    return n < 13 ? n : n - 1;
+}
+
+void gridPathFinder::initJpsTables()
+{
+    for(int k = 0; k < 26; k++)
     {
-        for(int64_t j = 0; j < Y_SIZE; j++)
-        {
-            for(int64_t k = 0; k < Z_SIZE; k++)
-            {   
-                coord(0) = xyz_l(0) + (double)(i + 0.5) * resolution;
-                coord(1) = xyz_l(1) + (double)(j + 0.5) * resolution;
-                coord(2) = xyz_l(2) + (double)(k + 0.5) * resolution;
+        const Vector3i & d = neighborDir[k];
+        jpsNatural[k].clear();
+        jpsForced[k].clear();
+        jpsProbe[k].clear();
 
-                Vector3i index = coord2gridIndex(coord);
+        unsigned int probe = 0;
+        for(int m = 0; m < 26; m++)
+        {
+            const Vector3i & e = neighborDir[m];
+
+            // Natural successors only move along the axes of the direction of arrival, the same way.
+            if(    (e(0) == 0 || e(0) == d(0))
+                && (e(1) == 0 || e(1) == d(1))
+                && (e(2) == 0 || e(2) == d(2)) ){
+                jpsNatural[k].push_back(m);
+                continue;
+            }
 
-                if( index(0) >= GLX_SIZE || index(1) >= GLY_SIZE || index(2) >= GLZ_SIZE 
-                 || index(0) <  0 || index(1) < 0 || index(2) <  0 )
+            // Neighbours of the parent are reached from the parent itself.
+            if((d + e).cwiseAbs().maxCoeff() <= 1)
+                continue;
+
+            // Any other neighbour is forced when every detour from the parent that beats going
+            // through this cell (shorter, or as short with a longer first move) is blocked.
+            double via = neighborCost[k] + neighborCost[m];
+            unsigned int detours = 0;
+            for(int j = 0; j < 26; j++)
+            {
+                Vector3i first  = d + neighborDir[j];
+                Vector3i second = e - neighborDir[j];
+                if(j == m || first.isZero() || first.cwiseAbs().maxCoeff() > 1 || second.cwiseAbs().maxCoeff() > 1)
                     continue;
 
-                GridNodePtr ptr = GridNodeMap[index(0)][index(1)][index(2)];
-                ptr->id = 0;
-                ptr->occupancy = local_map->Get(i, j, k ).first.occupancy;
+                double first_cost = first.cast<double>().norm();
+                double cost = first_cost + second.cast<double>().norm();
+                if(cost < via - 1e-6 || (cost < via + 1e-6 && first_cost > neighborCost[k] + 1e-6))
+                    detours |= 1u << j;
             }
+
+            jpsForced[k].push_back(make_pair(m, detours));
+            probe |= detours | (1u << m);
         }
+
+        for(int m = 0; m < 26; m++)
+            if((probe >> m) & 1)
+                jpsProbe[k].push_back(m);
     }
 }
 
-void gridPathFinder::resetLocalMap()
-{   
-    //ROS_WARN("expandedNodes size : %d", expandedNodes.size());
-    for(auto tmpPtr:expandedNodes)
+void gridPathFinder::touchNode(int id, const Vector3i & index)
+{
+    if(nodeGeneration[id] == generation)
+        return;
+
+    nodeGeneration[id] = generation;
+    nodeState[id] = 0;
+    gScore[id]    = INFINITY;
+    occupied[id]  = isOccupied(index);
+    touchedNodes.push_back(id);
+}
+
+bool gridPathFinder::isOccupied(const Vector3i & index) const
+{
+    if(localMap == NULL)
+        return false;
+
+    Vector3i local = index - localOffset;
+    if(    local(0) < 0 || local(0) >= X_SIZE
+        || local(1) < 0 || local(1) >= Y_SIZE
+        || local(2) < 0 || local(2) >= Z_SIZE)
+        return false;
+
+    return localMap->Get((int64_t)local(0), (int64_t)local(1), (int64_t)local(2)).first.occupancy > 0.5;
+}
+
+static const int HEAP_ARITY = 4;
+
+void gridPathFinder::heapPush(int id, double f)
+{
+    openSet.push_back(make_pair(f, id));
+    heapPos[id] = openSet.size() - 1;
+    heapSiftUp(openSet.size() - 1);
+}
+
+int gridPathFinder::heapPop()
+{
+    int id = openSet.front().second;
+    openSet.front() = openSet.back();
+    openSet.pop_back();
+    if(!openSet.empty())
     {
-        tmpPtr->occupancy = 0; // forget the occupancy
-        tmpPtr->id = 0;
-        tmpPtr->cameFrom = NULL;
-        tmpPtr->gScore = inf;
-        tmpPtr->fScore = inf;
+        heapPos[openSet.front().second] = 0;
+        heapSiftDown(0);
     }
+    return id;
+}
 
-    for(auto ptr:openSet)
-    {   
-        GridNodePtr tmpPtr = ptr.second;
-        tmpPtr->occupancy = 0; // forget the occupancy
-        tmpPtr->id = 0;
-        tmpPtr->cameFrom = NULL;
-        tmpPtr->gScore = inf;
-        tmpPtr->fScore = inf;
-    }
+void gridPathFinder::heapDecrease(int id, double f)
+{
+    openSet[heapPos[id]].first = f;
+    heapSiftUp(heapPos[id]);
+}
 
-    expandedNodes.clear();
-    //ROS_WARN("local map reset finish");
+void gridPathFinder::heapSiftUp(int pos)
+{
+    pair<double, int> item = openSet[pos];
+    while(pos > 0)
+    {
+        int parent = (pos - 1) / HEAP_ARITY;
+        if(openSet[parent].first <= item.first)
+            break;
+
+        openSet[pos] = openSet[parent];
+        heapPos[openSet[pos].second] = pos;
+        pos = parent;
+    }
+    openSet[pos] = item;
+    heapPos[item.second] = pos;
 }
 
-GridNodePtr gridPathFinder::pos2gridNodePtr(Vector3d pos)
+void gridPathFinder::heapSiftDown(int pos)
 {
-    Vector3i idx = coord2gridIndex(pos);
-    GridNodePtr grid_ptr = new GridNode(idx, pos);
+    pair<double, int> item = openSet[pos];
+    int size = openSet.size();
+    while(true)
+    {
+        int first = pos * HEAP_ARITY + 1;
+        if(first >= size)
+            break;
+
+        int last = min(first + HEAP_ARITY, size);
+        int child = first;
+        for(int c = first + 1; c < last; c++)
+            if(openSet[c].first < openSet[child].first)
+                child = c;
+
+        if(item.first <= openSet[child].first)
+            break;
+
+        openSet[pos] = openSet[child];
+        heapPos[openSet[pos].second] = pos;
+        pos = child;
+    }
+    openSet[pos] = item;
+    heapPos[item.second] = pos;
+}
 
-    return grid_ptr;
+void gridPathFinder::linkLocalMap(CollisionMapGrid * local_map, Vector3d xyz_l)
+{    
+    // Nothing is copied, the search looks up the local map through the offset of its origin.
+    localMap = local_map;
+    bitmapLinked = false;
+    localOffset << (int)floor((xyz_l(0) - gl_xl) * inv_resolution + 0.5),
+                   (int)floor((xyz_l(1) - gl_yl) * inv_resolution + 0.5),
+                   (int)floor((xyz_l(2) - gl_zl) * inv_resolution + 0.5);
+}
+
+void gridPathFinder::resetLocalMap()
+{   
+    // Forget the search state of every node and the linked map at once.
+    if(++generation == 0)
+    {
+        fill(nodeGeneration.begin(), nodeGeneration.end(), 0);
+        generation = 1;
+    }
+    touchedNodes.clear();
+    localMap = NULL;
+    bitmapLinked = false;
 }
 
 Vector3d gridPathFinder::gridIndex2coord(Vector3i index)
@@ -113,11 +262,11 @@ Vector3i gridPathFinder::coord2gridIndex(Vector3d pt)
     return idx;
 }
 
-double gridPathFinder::getDiagHeu(GridNodePtr node1, GridNodePtr node2)
+double gridPathFinder::getDiagHeu(const Vector3i & idx1, const Vector3i & idx2)
 {   
-    double dx = abs(node1->index(0) - node2->index(0));
-    double dy = abs(node1->index(1) - node2->index(1));
-    double dz = abs(node1->index(2) - node2->index(2));
+    double dx = abs(idx1(0) - idx2(0));
+    double dy = abs(idx1(1) - idx2(1));
+    double dz = abs(idx1(2) - idx2(2));
 
     double h;
     int diag = min(min(dx, dy), dz);
@@ -137,53 +286,60 @@ double gridPathFinder::getDiagHeu(GridNodePtr node1, GridNodePtr node2)
     return h;
 }
 
-double gridPathFinder::getManhHeu(GridNodePtr node1, GridNodePtr node2)
+double gridPathFinder::getManhHeu(const Vector3i & idx1, const Vector3i & idx2)
 {   
-    double dx = abs(node1->index(0) - node2->index(0));
-    double dy = abs(node1->index(1) - node2->index(1));
-    double dz = abs(node1->index(2) - node2->index(2));
+    double dx = abs(idx1(0) - idx2(0));
+    double dy = abs(idx1(1) - idx2(1));
+    double dz = abs(idx1(2) - idx2(2));
 
     return dx + dy + dz;
 }
 
-double gridPathFinder::getEuclHeu(GridNodePtr node1, GridNodePtr node2)
+double gridPathFinder::getEuclHeu(const Vector3i & idx1, const Vector3i & idx2)
 {   
-    return (node2->index - node1->index).norm();
+    return (idx2 - idx1).cast<double>().norm();
 }
 
-double gridPathFinder::getHeu(GridNodePtr node1, GridNodePtr node2)
+double gridPathFinder::getHeu(const Vector3i & idx1, const Vector3i & idx2)
 {
-    return tie_breaker * getDiagHeu(node1, node2);
-    //return tie_breaker * getEuclHeu(node1, node2);
+    return tie_breaker * getDiagHeu(idx1, idx2);
+    //return tie_breaker * getEuclHeu(idx1, idx2);
 }
 
-vector<GridNodePtr> gridPathFinder::retrievePath(GridNodePtr current)
+vector<int> gridPathFinder::retrievePath(int current)
 {   
-    vector<GridNodePtr> path;
+    vector<int> path;
     path.push_back(current);
 
-    while(current->cameFrom != NULL)
+    while(cameFrom[current] != -1)
     {
-        current = current -> cameFrom;
+        // A jump point search parent can be several cells away along a straight or diagonal
+        // line, the cells in between are added so that the path stays dense.
+        int parent = cameFrom[current];
+        Vector3i idx       = id2gridIndex(current);
+        Vector3i parentIdx = id2gridIndex(parent);
+        Vector3i step      = (parentIdx - idx).cwiseSign();
+        for(idx += step; idx != parentIdx; idx += step)
+            path.push_back(gridIndex2id(idx));
+
+        current = parent;
         path.push_back(current);
     }
 
     return path;
 }
 
-vector<GridNodePtr> gridPathFinder::getVisitedNodes()
+vector<Vector3d> gridPathFinder::getVisitedNodes()
 {   
-    vector<GridNodePtr> visited_nodes;
-    for(int i = 0; i < GLX_SIZE; i++)
-        for(int j = 0; j < GLY_SIZE; j++)
-            for(int k = 0; k < GLZ_SIZE; k++)
-            {   
-                if(GridNodeMap[i][j][k]->id != 0)
-                //if(GridNodeMap[i][j][k]->id == -1)
-                    visited_nodes.push_back(GridNodeMap[i][j][k]);
-            }
+    vector<Vector3d> visited_nodes;
+    for(auto id: touchedNodes)
+    {   
+        if(nodeState[id] != 0)
+        //if(nodeState[id] == -1)
+            visited_nodes.push_back(gridIndex2coord(id2gridIndex(id)));
+    }
 
-    ROS_WARN("visited_nodes size : %d", visited_nodes.size());
+    ROS_WARN("visited_nodes size : %d", (int)visited_nodes.size());
     return visited_nodes;
 }
 
@@ -195,19 +351,20 @@ vector<GridNodePtr> gridPathFinder::getVisitedNodes()
 void gridPathFinder::AstarSearch(Eigen::Vector3d start_pt, Eigen::Vector3d end_pt)
 {   
     ros::Time time_1 = ros::Time::now();    
-    GridNodePtr startPtr = pos2gridNodePtr(start_pt);
-    GridNodePtr endPtr   = pos2gridNodePtr(end_pt);
+    Vector3i startIdx = coord2gridIndex(start_pt);
+    Vector3i endIdx   = coord2gridIndex(end_pt);
+    int startId = gridIndex2id(startIdx);
+    int endId   = gridIndex2id(endIdx);
+    startCoord  = start_pt;
 
     openSet.clear();
+    gridPath.clear();
 
-    GridNodePtr neighborPtr = NULL;
-    GridNodePtr current = NULL;
-
-    startPtr -> gScore = 0;
-    startPtr -> fScore = getHeu(startPtr, endPtr);
-    startPtr -> id = 1; //put start node in open set
-    startPtr -> coord = start_pt;
-    openSet.insert( make_pair(startPtr -> fScore, startPtr) ); //put start in open set
+    touchNode(startId, startIdx);
+    gScore[startId]    = 0;
+    cameFrom[startId]  = -1;
+    nodeState[startId] = 1; //put start node in open set
+    heapPush(startId, getHeu(startIdx, endIdx)); //put start in open set
 
     double tentative_gScore;
 
@@ -215,90 +372,479 @@ void gridPathFinder::AstarSearch(Eigen::Vector3d start_pt, Eigen::Vector3d end_p
     while ( !openSet.empty() )
     {   
         num_iter ++;
-        current = openSet.begin() -> second;
+        int currentId = openSet.front().second;
 
-        if(current->index(0) == endPtr->index(0)
-        && current->index(1) == endPtr->index(1)
-        && current->index(2) == endPtr->index(2) )
+        if(currentId == endId)
         {
             ROS_WARN("[Astar]Reach goal..");
-            //cout << "goal coord: " << endl << current->real_coord << endl; 
             cout << "total number of iteration used in Astar: " << num_iter  << endl;
             ros::Time time_2 = ros::Time::now();
-            ROS_WARN("Time consume in A star path finding is %f", (time_2 - time_1).toSec() );
-            gridPath = retrievePath(current);
+            ROS_WARN("Time consume in A star path finding is %f, %.0f expansions per second", (time_2 - time_1).toSec(), num_iter / (time_2 - time_1).toSec() );
+            gridPath = retrievePath(currentId);
             return;
         }         
-        openSet.erase(openSet.begin());
-        current -> id = -1; //move current node from open set to closed set.
-        expandedNodes.push_back(current);
+        heapPop();
+        nodeState[currentId] = -1; //move current node from open set to closed set.
+        Vector3i currentIdx = id2gridIndex(currentId);
 
-        for(int dx = -1; dx < 2; dx++)
-            for(int dy = -1; dy < 2; dy++)
-                for(int dz = -1; dz < 2; dz++)
-                {
-                    if(dx == 0 && dy == 0 && dz ==0)
-                        continue; 
+        for(int n = 0; n < 26; n++)
+        {
+            Vector3i neighborIdx = currentIdx + neighborDir[n];
 
-                    Vector3i neighborIdx;
-                    neighborIdx(0) = (current -> index)(0) + dx;
-                    neighborIdx(1) = (current -> index)(1) + dy;
-                    neighborIdx(2) = (current -> index)(2) + dz;
+            if(    neighborIdx(0) < 0 || neighborIdx(0) >= GLX_SIZE
+                || neighborIdx(1) < 0 || neighborIdx(1) >= GLY_SIZE
+                || neighborIdx(2) < 0 || neighborIdx(2) >= GLZ_SIZE){
+                continue;
+            }
 
-                    if(    neighborIdx(0) < 0 || neighborIdx(0) >= GLX_SIZE
-                        || neighborIdx(1) < 0 || neighborIdx(1) >= GLY_SIZE
-                        || neighborIdx(2) < 0 || neighborIdx(2) >= GLZ_SIZE){
-                        continue;
-                    }
+            int neighborId = currentId + neighborOffset[n];
+            touchNode(neighborId, neighborIdx);
 
-                    neighborPtr = GridNodeMap[neighborIdx(0)][neighborIdx(1)][neighborIdx(2)];
+            if(occupied[neighborId]){
+                continue;
+            }
 
-/*                    if(minClearance() == false){
-                        continue;
-                    }*/
+            if(nodeState[neighborId] == -1){
+                continue; //in closed set.
+            }
 
-                    if(neighborPtr -> occupancy > 0.5){
-                        continue;
-                    }
+            tentative_gScore = gScore[currentId] + neighborCost[n]; 
 
-                    if(neighborPtr -> id == -1){
-                        continue; //in closed set.
-                    }
+            if(nodeState[neighborId] != 1){
+                //discover a new node
+                nodeState[neighborId] = 1;
+                cameFrom[neighborId]  = currentId;
+                gScore[neighborId]    = tentative_gScore;
+                heapPush(neighborId, tentative_gScore + getHeu(neighborIdx, endIdx)); //put neighbor in open set and record it.
+            }
+            else if(tentative_gScore <= gScore[neighborId]){ //in open set and need update
+                cameFrom[neighborId] = currentId;
+                gScore[neighborId]   = tentative_gScore;
+                heapDecrease(neighborId, tentative_gScore + getHeu(neighborIdx, endIdx));
+            }
+        }
+    }
 
-                    double static_cost = sqrt(dx * dx + dy * dy + dz * dz);
-                    
-                    tentative_gScore = current -> gScore + static_cost; 
-
-                    if(neighborPtr -> id != 1){
-                        //discover a new node
-                        neighborPtr -> id        = 1;
-                        neighborPtr -> cameFrom  = current;
-                        neighborPtr -> gScore    = tentative_gScore;
-                        neighborPtr -> fScore    = neighborPtr -> gScore + getHeu(neighborPtr, endPtr); 
-                        neighborPtr -> nodeMapIt = openSet.insert( make_pair(neighborPtr->fScore, neighborPtr) ); //put neighbor in open set and record it.
+    ros::Time time_2 = ros::Time::now();
+    ROS_WARN("Time consume in A star path finding is %f", (time_2 - time_1).toSec() );
+}
+
+void gridPathFinder::buildOccupancyBitmap()
+{
+    for(int axis = 0; axis < 3; axis++)
+    {
+        int length = gridSize(axis);
+        int rows   = GLX_SIZE * GLY_SIZE * GLZ_SIZE / length;
+        rowWords[axis] = (length + 63) / 64;
+        occupancyRows[axis].assign(rows * rowWords[axis], 0);
+
+        if(length % 64 != 0)
+            for(int r = 0; r < rows; r++)
+                occupancyRows[axis][(r + 1) * rowWords[axis] - 1] = ~uint64_t(0) << (length % 64);
+    }
+
+    if(localMap != NULL)
+        for(int i = 0; i < X_SIZE; i++)
+            for(int j = 0; j < Y_SIZE; j++)
+                for(int k = 0; k < Z_SIZE; k++)
+                {
+                    Vector3i index = Vector3i(i, j, k) + localOffset;
+                    if(    index(0) < 0 || index(0) >= GLX_SIZE
+                        || index(1) < 0 || index(1) >= GLY_SIZE
+                        || index(2) < 0 || index(2) >= GLZ_SIZE)
                         continue;
+
+                    if(localMap->Get((int64_t)i, (int64_t)j, (int64_t)k).first.occupancy < 0.5)
+                        continue;
+
+                    for(int axis = 0; axis < 3; axis++)
+                    {
+                        int u = (axis + 1) % 3, v = (axis + 2) % 3;
+                        uint64_t * row = &occupancyRows[axis][(index(u) * gridSize(v) + index(v)) * rowWords[axis]];
+                        row[index(axis) >> 6] |= uint64_t(1) << (index(axis) & 63);
                     }
-                    else if(tentative_gScore <= neighborPtr-> gScore){ //in open set and need update
-                        neighborPtr -> cameFrom = current;
-                        neighborPtr -> gScore = tentative_gScore;
-                        neighborPtr -> fScore = tentative_gScore + getHeu(neighborPtr, endPtr); 
-                        openSet.erase(neighborPtr -> nodeMapIt);
-                        neighborPtr -> nodeMapIt = openSet.insert( make_pair(neighborPtr->fScore, neighborPtr) ); //put neighbor in open set and record it.
-                    }
-                        
                 }
+
+    bitmapLinked = true;
+}
+
+unsigned int gridPathFinder::jpsForcedDirs(const Vector3i & index, int dir) const
+{
+    unsigned int blocked = 0;
+    for(auto m: jpsProbe[dir])
+        if(jpsBlocked(index + neighborDir[m]))
+            blocked |= 1u << m;
+
+    unsigned int forced = 0;
+    for(auto & f: jpsForced[dir])
+        if(!((blocked >> f.first) & 1) && (blocked & f.second) == f.second)
+            forced |= 1u << f.first;
+
+    return forced;
+}
+
+bool gridPathFinder::jump(const Vector3i & index, int dir, const Vector3i & endIdx, Vector3i & jumpIdx) const
+{
+    if(neighborCost[dir] == 1.0)
+    {
+        int axis = neighborDir[dir](0) != 0 ? 0 : (neighborDir[dir](1) != 0 ? 1 : 2);
+        return jumpStraight(index, axis, neighborDir[dir](axis), endIdx, jumpIdx);
+    }
+
+    Vector3i current = index;
+    while(true)
+    {
+        current += neighborDir[dir];
+        if(jpsBlocked(current))
+            return false;
+
+        if(current == endIdx || jpsForcedDirs(current, dir) != 0){
+            jumpIdx = current;
+            return true;
+        }
+
+        // Along a diagonal, stop where a scan along one of its components finds a jump point.
+        for(auto sub: jpsNatural[dir])
+        {
+            Vector3i subJumpIdx;
+            if(sub != dir && jump(current, sub, endIdx, subJumpIdx)){
+                jumpIdx = current;
+                return true;
+            }
+        }
+    }
+}
+
+// A straight jump stops at the first cell next to a blocked cell whose successor along the
+// jump is free, which forces the diagonal neighbour. Along a row of the bitmap that is a set
+// bit followed by a clear one, so 64 cells are tested at once in the 8 rows around the jump.
+bool gridPathFinder::jumpStraight(const Vector3i & index, int axis, int sign, const Vector3i & endIdx, Vector3i & jumpIdx) const
+{
+    int u = (axis + 1) % 3, v = (axis + 2) % 3;
+    int words = rowWords[axis];
+    int start = index(axis) + sign;
+    if(start < 0 || start >= gridSize(axis))
+        return false;
+
+    const uint64_t * own = occupancyRow(axis, index(u), index(v));
+    const uint64_t * ring[8];
+    int ringSize = 0;
+    for(int du = -1; du < 2; du++)
+        for(int dv = -1; dv < 2; dv++)
+        {
+            int ru = index(u) + du, rv = index(v) + dv;
+            if((du == 0 && dv == 0) || ru < 0 || ru >= gridSize(u) || rv < 0 || rv >= gridSize(v))
+                continue;
+            ring[ringSize++] = occupancyRow(axis, ru, rv);
+        }
+
+    bool goalOnLine = endIdx(u) == index(u) && endIdx(v) == index(v);
+
+    for(int w = start >> 6; w >= 0 && w < words; w += sign)
+    {
+        uint64_t range = ~uint64_t(0);
+        if(w == start >> 6)
+            range = sign > 0 ? range << (start & 63) : range >> (63 - (start & 63));
+
+        uint64_t forced = 0;
+        for(int r = 0; r < ringSize; r++)
+        {
+            // Occupancy of the next cell along the jump, beyond the grid counts as blocked.
+            uint64_t next;
+            if(sign > 0)
+                next = (ring[r][w] >> 1) | (w + 1 < words ? ring[r][w + 1] << 63 : uint64_t(1) << 63);
+            else
+                next = (ring[r][w] << 1) | (w > 0 ? ring[r][w - 1] >> 63 : uint64_t(1));
+            forced |= ring[r][w] & ~next;
+        }
+        if(goalOnLine && endIdx(axis) >> 6 == w)
+            forced |= uint64_t(1) << (endIdx(axis) & 63);
+
+        forced &= range;
+        uint64_t blocked = own[w] & range;
+        if((forced | blocked) == 0)
+            continue;
+
+        // The jump point must come before the first blocked cell.
+        int jump, stop;
+        if(sign > 0){
+            jump = forced  ? __builtin_ctzll(forced)  : 64;
+            stop = blocked ? __builtin_ctzll(blocked) : 64;
+            if(jump >= stop)
+                return false;
+        }
+        else{
+            jump = forced  ? 63 - __builtin_clzll(forced)  : -1;
+            stop = blocked ? 63 - __builtin_clzll(blocked) : -1;
+            if(jump <= stop)
+                return false;
+        }
+
+        jumpIdx = index;
+        jumpIdx(axis) = w * 64 + jump;
+        return true;
+    }
+
+    return false;
+}
+
+void gridPathFinder::JpsSearch(Eigen::Vector3d start_pt, Eigen::Vector3d end_pt)
+{   
+    ros::Time time_1 = ros::Time::now();    
+    if(!bitmapLinked)
+        buildOccupancyBitmap();
+
+    Vector3i startIdx = coord2gridIndex(start_pt);
+    Vector3i endIdx   = coord2gridIndex(end_pt);
+    int startId = gridIndex2id(startIdx);
+    int endId   = gridIndex2id(endIdx);
+    startCoord  = start_pt;
+
+    openSet.clear();
+    gridPath.clear();
+
+    touchNode(startId, startIdx);
+    gScore[startId]    = 0;
+    cameFrom[startId]  = -1;
+    nodeState[startId] = 1;
+    heapPush(startId, getHeu(startIdx, endIdx));
+
+    double tentative_gScore;
+
+    int num_iter = 0;
+    while ( !openSet.empty() )
+    {   
+        num_iter ++;
+        int currentId = openSet.front().second;
+
+        if(currentId == endId)
+        {
+            ROS_WARN("[JPS]Reach goal..");
+            cout << "total number of iteration used in JPS: " << num_iter  << endl;
+            ros::Time time_2 = ros::Time::now();
+            ROS_WARN("Time consume in JPS path finding is %f, %.0f expansions per second", (time_2 - time_1).toSec(), num_iter / (time_2 - time_1).toSec() );
+            gridPath = retrievePath(currentId);
+            return;
+        }         
+        heapPop();
+        nodeState[currentId] = -1;
+        Vector3i currentIdx = id2gridIndex(currentId);
+
+        // The start expands in every direction, jump points only in the natural and forced
+        // directions for the direction they were reached from.
+        unsigned int dirs = (1u << 26) - 1;
+        if(cameFrom[currentId] != -1)
+        {
+            int dir = dirIndex((currentIdx - id2gridIndex(cameFrom[currentId])).cwiseSign());
+            dirs = jpsForcedDirs(currentIdx, dir);
+            for(auto m: jpsNatural[dir])
+                dirs |= 1u << m;
+        }
+
+        for(int n = 0; n < 26; n++)
+        {
+            if(!((dirs >> n) & 1))
+                continue;
+
+            Vector3i jumpIdx;
+            if(!jump(currentIdx, n, endIdx, jumpIdx))
+                continue;
+
+            int jumpId = gridIndex2id(jumpIdx);
+            touchNode(jumpId, jumpIdx);
+
+            if(nodeState[jumpId] == -1){
+                continue; //in closed set.
+            }
+
+            tentative_gScore = gScore[currentId] + (jumpIdx - currentIdx).cwiseAbs().maxCoeff() * neighborCost[n];
+
+            if(nodeState[jumpId] != 1){
+                nodeState[jumpId] = 1;
+                cameFrom[jumpId]  = currentId;
+                gScore[jumpId]    = tentative_gScore;
+                heapPush(jumpId, tentative_gScore + getHeu(jumpIdx, endIdx));
+            }
+            else if(tentative_gScore <= gScore[jumpId]){
+                cameFrom[jumpId] = currentId;
+                gScore[jumpId]   = tentative_gScore;
+                heapDecrease(jumpId, tentative_gScore + getHeu(jumpIdx, endIdx));
+            }
+        }
     }
 
     ros::Time time_2 = ros::Time::now();
-    ROS_WARN("Time consume in A star path finding is %f", (time_2 - time_1).toSec() );
+    ROS_WARN("Time consume in JPS path finding is %f", (time_2 - time_1).toSec() );
+}
+
+void gridPathFinder::setAraInflation(double eps_init, double eps_step)
+{
+    araEpsInit  = max(eps_init, 1.0);
+    araEpsStep  = max(eps_step, 0.01);
+    araEpsStart = araEpsInit;
+}
+
+bool gridPathFinder::araImprovePath(int endId, const Vector3i & endIdx, double eps, const ros::WallTime & deadline, int & num_iter)
+{
+    while( !openSet.empty() && gScore[endId] > openSet.front().first )
+    {
+        // Reading the clock on every expansion would cost more than the expansion itself.
+        if( (++num_iter & 255) == 0 && ros::WallTime::now() > deadline )
+            return false;
+
+        int currentId = heapPop();
+        nodeState[currentId] = -1;
+        Vector3i currentIdx = id2gridIndex(currentId);
+
+        for(int n = 0; n < 26; n++)
+        {
+            Vector3i neighborIdx = currentIdx + neighborDir[n];
+
+            if(    neighborIdx(0) < 0 || neighborIdx(0) >= GLX_SIZE
+                || neighborIdx(1) < 0 || neighborIdx(1) >= GLY_SIZE
+                || neighborIdx(2) < 0 || neighborIdx(2) >= GLZ_SIZE){
+                continue;
+            }
+
+            int neighborId = currentId + neighborOffset[n];
+            touchNode(neighborId, neighborIdx);
+
+            if(occupied[neighborId]){
+                continue;
+            }
+
+            double tentative_gScore = gScore[currentId] + neighborCost[n];
+            if(tentative_gScore >= gScore[neighborId])
+                continue;
+
+            cameFrom[neighborId] = currentId;
+            gScore[neighborId]   = tentative_gScore;
+
+            if(nodeState[neighborId] == -1)
+                inconsNodes.push_back(neighborId); // closed in this pass, reopened in the next one
+            else if(nodeState[neighborId] == 1)
+                heapDecrease(neighborId, tentative_gScore + eps * getHeu(neighborIdx, endIdx));
+            else{
+                nodeState[neighborId] = 1;
+                heapPush(neighborId, tentative_gScore + eps * getHeu(neighborIdx, endIdx));
+            }
+        }
+    }
+
+    return true;
+}
+
+void gridPathFinder::araRebuildOpenSet(const Vector3i & endIdx, double eps)
+{
+    for(auto id: inconsNodes)
+        if(nodeState[id] != 1){
+            nodeState[id] = 1;
+            openSet.push_back(make_pair(0.0, id));
+        }
+    inconsNodes.clear();
+
+    for(int pos = 0; pos < (int)openSet.size(); pos++)
+    {
+        int id = openSet[pos].second;
+        openSet[pos].first = gScore[id] + eps * getHeu(id2gridIndex(id), endIdx);
+        heapPos[id] = pos;
+    }
+    for(int pos = ((int)openSet.size() - 2) / HEAP_ARITY; pos >= 0; pos--)
+        heapSiftDown(pos);
+
+    for(auto id: touchedNodes)
+        if(nodeState[id] == -1)
+            nodeState[id] = 0;
+}
+
+void gridPathFinder::AraSearch(Eigen::Vector3d start_pt, Eigen::Vector3d end_pt, double time_budget)
+{   
+    ros::WallTime time_1   = ros::WallTime::now();
+    ros::WallTime deadline = time_1 + ros::WallDuration(time_budget);
+
+    Vector3i startIdx = coord2gridIndex(start_pt);
+    Vector3i endIdx   = coord2gridIndex(end_pt);
+    int startId = gridIndex2id(startIdx);
+    int endId   = gridIndex2id(endIdx);
+    startCoord  = start_pt;
+
+    openSet.clear();
+    inconsNodes.clear();
+    gridPath.clear();
+
+    touchNode(endId, endIdx);
+    touchNode(startId, startIdx);
+    gScore[startId]    = 0;
+    cameFrom[startId]  = -1;
+    nodeState[startId] = 1;
+
+    double eps = araEpsStart;
+    heapPush(startId, eps * getHeu(startIdx, endIdx));
+
+    // A first pass started below araEpsInit only gets half of the budget to reach the target,
+    // then the search goes on from its tree with araEpsInit
+    ros::WallTime pass_deadline = (eps < araEpsInit) ? time_1 + ros::WallDuration(0.5 * time_budget) : deadline;
+
+    // Weighted A* passes with a decreasing weight until the optimal path is found or the
+    // deadline is hit, each pass reusing the search tree of the previous ones.
+    araEps = 0.0;
+    int num_iter = 0;
+    bool is_converged = false;
+    while( true )
+    {
+        if( !araImprovePath(endId, endIdx, eps, pass_deadline, num_iter) )
+        {
+            if( gridPath.empty() && pass_deadline < deadline )
+            {
+                eps = araEpsInit;
+                pass_deadline = deadline;
+                araRebuildOpenSet(endIdx, eps);
+                continue;
+            }
+            break;
+        }
+
+        if( gScore[endId] == INFINITY )
+            break;
+
+        gridPath      = retrievePath(endId);
+        araEps        = eps;
+        pass_deadline = deadline;
+
+        if(eps == 1.0)
+        {
+            is_converged = true;
+            break;
+        }
+
+        eps = max(1.0, eps - araEpsStep);
+        araRebuildOpenSet(endIdx, eps);
+    }
+
+    // Every replan starts from araEpsInit, one step lower for each previous search that found
+    // the optimal path within half of its budget
+    ros::WallTime time_2 = ros::WallTime::now();
+    if(!is_converged)
+        araEpsStart = araEpsInit;
+    else if((time_2 - time_1).toSec() < 0.5 * time_budget)
+        araEpsStart = max(1.0, araEpsStart - araEpsStep);
+
+    if(gridPath.empty())
+        ROS_WARN("[ARA*]No path found in %f s, %d expansions", (time_2 - time_1).toSec(), num_iter);
+    else
+        ROS_WARN("[ARA*]Path found in %f s with weight %.2f, %d expansions", (time_2 - time_1).toSec(), araEps, num_iter);
 }
 
 vector<Vector3d> gridPathFinder::getPath()
 {   
     vector<Vector3d> path;
 
-    for(auto ptr: gridPath)
-        path.push_back(ptr->coord);
+    for(auto id: gridPath)
+        path.push_back(gridIndex2coord(id2gridIndex(id)));
+
+    // The path starts at the exact start position, not at the center of its cell.
+    if(!path.empty())
+        path.back() = startCoord;
 
     reverse(path.begin(), path.end());
     return path;
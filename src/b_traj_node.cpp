@@ -11,6 +11,7 @@
 #include <ros/ros.h>
 #include <ros/console.h>
 #include <sensor_msgs/PointCloud2.h>
+#include <sensor_msgs/point_cloud2_iterator.h>
 #include <nav_msgs/Odometry.h>
 #include <nav_msgs/Path.h>
 #include <geometry_msgs/PoseStamped.h>
@@ -21,11 +22,18 @@
 #include <tf/transform_datatypes.h>
 #include <tf/transform_broadcaster.h>
 
+#include <sdf_tools/collision_map_delta.hpp>
+#include <sdf_tools/compact_distance_field.hpp>
+#include <sdf_tools/dynamic_spatial_hashed_collision_map.hpp>
+#include <sdf_tools/occupancy_log_odds_map.hpp>
+#include <sdf_tools/versioned_collision_map.hpp>
+
 #include "trajectory_generator.h"
 #include "bezier_base.h"
 #include "data_type.h"
 #include "utils.h"
 #include "a_star.h"
+#include "polyhedron_generator.h"
 #include "backward.hpp"
 
 #include "quadrotor_msgs/PositionCommand.h"
@@ -45,9 +53,25 @@ double _resolution, _inv_resolution;
 double _cloud_margin, _cube_margin, _check_horizon, _stop_horizon;
 double _x_size, _y_size, _z_size, _x_local_size, _y_local_size, _z_local_size;    
 double _MAX_Vel, _MAX_Acc;
-bool   _is_use_fm, _is_proj_cube, _is_limit_vel, _is_limit_acc;
+bool   _is_use_fm, _is_use_jps, _is_proj_cube, _is_limit_vel, _is_limit_acc;
 int    _step_length, _max_inflate_iter, _traj_order;
 double _minimize_order;
+string _fm_solver;
+int    _dfmm_cells;
+int    _hfm_factor;
+double _hfm_tube_width;
+double _time_budget, _ara_eps, _ara_eps_step;
+bool   _is_report_hfm;
+bool   _is_check_reach;
+bool   _is_use_poly;
+double _poly_range, _poly_max_length;
+double _edt_cutoff;
+bool   _is_use_delta;
+int    _map_chunk_size;
+bool   _is_use_log_odds;
+double _log_odds_hit, _log_odds_miss, _log_odds_min, _log_odds_max, _log_odds_occupied;
+double _max_ray_range;
+int    _ray_threads;
 
 // useful global variables
 nav_msgs::Odometry _odom;
@@ -58,11 +82,21 @@ bool _has_traj  = false;
 bool _is_emerg  = false;
 bool _is_init   = true;
 
-Vector3d _start_pt, _start_vel, _start_acc, _end_pt;
+// _target_pt is the target sent to the planner, _end_pt the end of the current plan: the target, or
+// the point where the way to it leaves the search window
+Vector3d _start_pt, _start_vel, _start_acc, _end_pt, _target_pt;
 double _init_x, _init_y, _init_z;
 Vector3d _map_origin;
 double _pt_max_x, _pt_min_x, _pt_max_y, _pt_min_y, _pt_max_z, _pt_min_z;
-int _max_x_id, _max_y_id, _max_z_id, _max_local_x_id, _max_local_y_id, _max_local_z_id;
+int _max_z_id, _max_local_x_id, _max_local_y_id, _max_local_z_id;
+// Search window, in cells of collision_map: the FM and A* grids and the corridor cover
+// [_win_lo_id, _win_hi_id), a box around the start and the target, at most map/x_size by map/y_size.
+// Its height is map/z_size.
+Vector3i _win_lo_id, _win_hi_id;
+double _win_margin;
+bool _is_win_moved = true;
+// set when a new target arrives, the end point is only recomputed then or when the window moves
+bool _is_end_new   = true;
 int _traj_id = 1;
 COLLISION_CELL _free_cell(0.0);
 COLLISION_CELL _obst_cell(1.0);
@@ -83,31 +117,69 @@ VectorXd _C, _Cv, _Ca, _Cj;
 quadrotor_msgs::PolynomialTrajectory _traj;
 ros::Time _start_time = ros::TIME_MAX;
 TrajectoryGenerator _trajectoryGenerator;
-CollisionMapGrid * collision_map       = new CollisionMapGrid();
+// the global map is written by the map callbacks and published to the planner, which reads the
+// last published version through collision_map while it replans
+VersionedCollisionMap * _map_versions = NULL;
+const DynamicSpatialHashedCollisionMapGrid * collision_map = NULL;
 CollisionMapGrid * collision_map_local = new CollisionMapGrid();
 gridPathFinder * path_finder           = new gridPathFinder();
+polyhedronGenerator * poly_generator   = new polyhedronGenerator();
+
+// fast marching grid, reused between replans, and the grid of DFMM, kept so that it can repair its
+// arrival-time field
+FMGrid3D * _grid_fmm         = NULL;
+FMGrid3D * _grid_dfmm        = NULL;
+DFMM<FMGrid3D> * _dfmm_solver = NULL;
+unsigned int _dfmm_init_idx  = 0;
+
+// distance field of collision_map_local for the FM* speed map, rebuilt into the same buffers on
+// every replan
+CompactDistanceField _edt;
+
+// connected components of collision_map_local that reach its boundary, computed once per local map
+vector<bool> _open_components;
+
+// occupancy streamed by the map server as chunked deltas, and the chunks the last delta changed
+CollisionMapDeltaDecoder _map_decoder;
+vector<int64_t> _changed_chunks;
+
+// occupancy probability of every cell the sensed clouds were ray cast through, and the chunks the
+// last cloud changed
+OccupancyLogOddsMap * _occupancy = NULL;
+vector<Vector3d> _cloud_points;
+vector<Vector3i> _changed_occupancy_chunks;
 
 void rcvWaypointsCallback(const nav_msgs::Path & wp);
 void rcvPointCloudCallBack(const sensor_msgs::PointCloud2 & pointcloud_map);
+void rayCastCloud(const sensor_msgs::PointCloud2 & cloud);
+void rcvMapDeltaCallBack(const sdf_tools::CollisionMapDelta & map_delta);
 void rcvOdometryCallbck(const nav_msgs::Odometry odom);
 
 void trajPlanning();
+void updateSearchWindow();
 bool checkExecTraj();
+void replanOnSnapshot(bool is_check_exec);
 bool checkCoordObs(Vector3d checkPt);
-vector<pcl::PointXYZ> pointInflate( pcl::PointXYZ pt);
+bool isGoalReachable(Vector3d start_pt, Vector3d end_pt);
+void inflatePoint(const Vector3d & pt, DynamicSpatialHashedCollisionMapGrid * global_map, pcl::PointCloud<pcl::PointXYZ> * cloud_inflation);
 
 void visPath(vector<Vector3d> path);
 void visCorridor(vector<Cube> corridor);
 void visGridPath( vector<Vector3d> grid_path);
-void visExpNode( vector<GridNodePtr> nodes);
+void visExpNode( vector<Vector3d> nodes);
 void visBezierTrajectory(MatrixXd polyCoeff, VectorXd time);
 
 pair<Cube, bool> inflateCube(Cube cube, Cube lstcube);
 Cube generateCube( Vector3d pt) ;
 bool isContains(Cube cube1, Cube cube2);
+bool isInsideCube(const Cube & cube, const Vector3d & pt);
 void corridorSimplify(vector<Cube> & cubicList);
+bool isLineFree(const Vector3d & p0, const Vector3d & p1);
+vector<int> pathCompaction(const vector<Vector3d> & path_coord);
+vector<Cube> cubeCorridorGeneration(const vector<Vector3d> & path_coord, const vector<double> & time);
 vector<Cube> corridorGeneration(vector<Vector3d> path_coord, vector<double> time);
 vector<Cube> corridorGeneration(vector<Vector3d> path_coord);
+bool polyCorridorGeneration(vector<Vector3d> path_coord, vector<Cube> & corridor, vector<double> & seeds);
 void sortPath(vector<Vector3d> & path_coord, vector<double> & time);
 void timeAllocation(vector<Cube> & corridor, vector<double> time);
 void timeAllocation(vector<Cube> & corridor);
@@ -152,32 +224,24 @@ void rcvWaypointsCallback(const nav_msgs::Path & wp)
         return;
 
     _is_init = false;
-    _end_pt << wp.poses[0].pose.position.x,
+    _target_pt << wp.poses[0].pose.position.x,
                wp.poses[0].pose.position.y,
                wp.poses[0].pose.position.z;
 
     _has_target = true;
+    _is_end_new = true;
     _is_emerg   = true;
 
     ROS_INFO("[Fast Marching Node] receive the way-points");
 
-    trajPlanning(); 
+    replanOnSnapshot(false);
 }
 
 Vector3d _local_origin;
-void rcvPointCloudCallBack(const sensor_msgs::PointCloud2 & pointcloud_map)
-{   
-    pcl::PointCloud<pcl::PointXYZ> cloud;
-    pcl::fromROSMsg(pointcloud_map, cloud);
-    
-    if((int)cloud.points.size() == 0)
-        return;
-
+void resetLocalMap()
+{
     delete collision_map_local;
 
-    ros::Time time_1 = ros::Time::now();
-    collision_map->RestMap();
-    
     double local_c_x = (int)((_start_pt(0) - _x_local_size/2.0)  * _inv_resolution + 0.5) * _resolution;
     double local_c_y = (int)((_start_pt(1) - _y_local_size/2.0)  * _inv_resolution + 0.5) * _resolution;
     double local_c_z = (int)((_start_pt(2) - _z_local_size/2.0)  * _inv_resolution + 0.5) * _resolution;
@@ -195,32 +259,39 @@ void rcvPointCloudCallBack(const sensor_msgs::PointCloud2 & pointcloud_map)
     double _z_buffer_size = _z_local_size + _buffer_size;
 
     collision_map_local = new CollisionMapGrid(origin_local_transform, "world", _resolution, _x_buffer_size, _y_buffer_size, _z_buffer_size, _free_cell);
+    _open_components.clear();
+}
 
-    vector<pcl::PointXYZ> inflatePts(20);
-    pcl::PointCloud<pcl::PointXYZ> cloud_inflation;
-    pcl::PointCloud<pcl::PointXYZ> cloud_local;
+bool isInLocalMap(const pcl::PointXYZ & pt)
+{
+    return fabs(pt.x - _start_pt(0)) <= _x_local_size / 2.0 && fabs(pt.y - _start_pt(1)) <= _y_local_size / 2.0 && fabs(pt.z - _start_pt(2)) <= _z_local_size / 2.0;
+}
 
-    for (int idx = 0; idx < (int)cloud.points.size(); idx++)
-    {   
-        auto mk = cloud.points[idx];
-        pcl::PointXYZ pt(mk.x, mk.y, mk.z);
+// Points of a sensed cloud are read from the message by blocks, and a block is cropped to the local
+// map at once: the test is branch free over arrays of coordinates, so that it is vectorized
+const int CROP_BLOCK_SIZE = 256;
 
-        if( fabs(pt.x - _start_pt(0)) > _x_local_size / 2.0 || fabs(pt.y - _start_pt(1)) > _y_local_size / 2.0 || fabs(pt.z - _start_pt(2)) > _z_local_size / 2.0 )
-            continue; 
-        
-        cloud_local.push_back(pt);
-        inflatePts = pointInflate(pt);
-        for(int i = 0; i < (int)inflatePts.size(); i++)
-        {   
-            pcl::PointXYZ inf_pt = inflatePts[i];
-            Vector3d addPt(inf_pt.x, inf_pt.y, inf_pt.z);
-            collision_map_local->Set3d(addPt, _obst_cell);
-            collision_map->Set3d(addPt, _obst_cell);
-            cloud_inflation.push_back(inf_pt);
-        }
-    }
-    _has_map = true;
+void cropToLocalMap(const double * xs, const double * ys, const double * zs, int count, uint8_t * is_inside)
+{
+    const double half_x = _x_local_size / 2.0, half_y = _y_local_size / 2.0, half_z = _z_local_size / 2.0;
+    const double start_x = _start_pt(0), start_y = _start_pt(1), start_z = _start_pt(2);
+    for(int i = 0; i < count; i++)
+        is_inside[i] = (fabs(xs[i] - start_x) <= half_x) & (fabs(ys[i] - start_y) <= half_y) & (fabs(zs[i] - start_z) <= half_z);
+}
 
+bool hasFloatXYZ(const sensor_msgs::PointCloud2 & cloud)
+{
+    int num_fields = 0;
+    for(int i = 0; i < (int)cloud.fields.size(); i++)
+        if( (cloud.fields[i].name == "x" || cloud.fields[i].name == "y" || cloud.fields[i].name == "z") && cloud.fields[i].datatype == sensor_msgs::PointField::FLOAT32 )
+            num_fields++;
+
+    return num_fields == 3;
+}
+
+// The visualization clouds are only filled and published while someone listens to them
+void pubMapVis(pcl::PointCloud<pcl::PointXYZ> & cloud_inflation, pcl::PointCloud<pcl::PointXYZ> & cloud_local)
+{
     cloud_inflation.width = cloud_inflation.points.size();
     cloud_inflation.height = 1;
     cloud_inflation.is_dense = true;
@@ -233,37 +304,239 @@ void rcvPointCloudCallBack(const sensor_msgs::PointCloud2 & pointcloud_map)
 
     sensor_msgs::PointCloud2 inflateMap, localMap;
     
-    pcl::toROSMsg(cloud_inflation, inflateMap);
-    pcl::toROSMsg(cloud_local, localMap);
-    _inf_map_vis_pub.publish(inflateMap);
-    _local_map_vis_pub.publish(localMap);
+    if(_inf_map_vis_pub.getNumSubscribers() > 0)
+    {
+        pcl::toROSMsg(cloud_inflation, inflateMap);
+        _inf_map_vis_pub.publish(inflateMap);
+    }
+    if(_local_map_vis_pub.getNumSubscribers() > 0)
+    {
+        pcl::toROSMsg(cloud_local, localMap);
+        _local_map_vis_pub.publish(localMap);
+    }
+}
+
+// The points are read straight from the message buffer, and each block is cropped to the local map
+// and inflated into the maps before the next one is read. The chunks the previous cloud wrote are
+// set back to the default value instead of being dropped, so that publishing the map only copies
+// the chunks these two clouds touched
+void rcvPointCloudCallBack(const sensor_msgs::PointCloud2 & pointcloud_map)
+{   
+    size_t num_points = (size_t)pointcloud_map.width * pointcloud_map.height;
+    if(num_points == 0)
+        return;
+
+    if( !hasFloatXYZ(pointcloud_map) || pointcloud_map.data.size() < num_points * pointcloud_map.point_step )
+    {
+        ROS_ERROR("[b_traj_node] point cloud has no float32 x, y and z fields, or is shorter than its size");
+        return;
+    }
+
+    if(_is_use_log_odds)
+    {
+        rayCastCloud(pointcloud_map);
+        return;
+    }
+
+    ros::Time time_1 = ros::Time::now();
+    DynamicSpatialHashedCollisionMapGrid & global_map = _map_versions->GetWritable();
+    global_map.ResetCellChunks();
+    resetLocalMap();
+
+    pcl::PointCloud<pcl::PointXYZ> cloud_inflation;
+    pcl::PointCloud<pcl::PointXYZ> cloud_local;
+    bool is_vis_local   = _local_map_vis_pub.getNumSubscribers() > 0;
+    bool is_vis_inflate = _inf_map_vis_pub.getNumSubscribers() > 0;
+
+    sensor_msgs::PointCloud2ConstIterator<float> iter_x(pointcloud_map, "x");
+    sensor_msgs::PointCloud2ConstIterator<float> iter_y(pointcloud_map, "y");
+    sensor_msgs::PointCloud2ConstIterator<float> iter_z(pointcloud_map, "z");
+    double xs[CROP_BLOCK_SIZE], ys[CROP_BLOCK_SIZE], zs[CROP_BLOCK_SIZE];
+    uint8_t is_inside[CROP_BLOCK_SIZE];
+
+    for (size_t first = 0; first < num_points; first += CROP_BLOCK_SIZE)
+    {   
+        int count = (int)min((size_t)CROP_BLOCK_SIZE, num_points - first);
+        for(int i = 0; i < count; i++, ++iter_x, ++iter_y, ++iter_z)
+        {
+            xs[i] = *iter_x;
+            ys[i] = *iter_y;
+            zs[i] = *iter_z;
+        }
+
+        cropToLocalMap(xs, ys, zs, count, is_inside);
+        for(int i = 0; i < count; i++)
+        {
+            if( !is_inside[i] )
+                continue; 
+
+            if(is_vis_local)
+                cloud_local.push_back(pcl::PointXYZ(xs[i], ys[i], zs[i]));
+            inflatePoint(Vector3d(xs[i], ys[i], zs[i]), &global_map, is_vis_inflate ? &cloud_inflation : NULL);
+        }
+    }
+    _map_versions->Publish();
+    _has_map = true;
+
+    pubMapVis(cloud_inflation, cloud_local);
 
     ros::Time time_3 = ros::Time::now();
     //ROS_WARN("Time in receving the map is %f", (time_3 - time_1).toSec());
 
-    if( checkExecTraj() == true )
-        trajPlanning(); 
+    replanOnSnapshot(true);
 }
 
-vector<pcl::PointXYZ> pointInflate( pcl::PointXYZ pt)
+// Each cloud is ray cast from the robot into the occupancy map, which keeps the obstacles sensed
+// before and clears those the rays now go through: the global map is re-inflated around the chunks
+// whose occupancy changed, and the local map is rebuilt from the occupied cells around the start point
+void rayCastCloud(const sensor_msgs::PointCloud2 & cloud)
 {
+    if( !_has_odom )
+        return;
+
+    // points without a return are left out, they would cast rays to nowhere
+    _cloud_points.clear();
+    sensor_msgs::PointCloud2ConstIterator<float> iter_x(cloud, "x");
+    sensor_msgs::PointCloud2ConstIterator<float> iter_y(cloud, "y");
+    sensor_msgs::PointCloud2ConstIterator<float> iter_z(cloud, "z");
+    for (size_t idx = 0; idx < (size_t)cloud.width * cloud.height; idx++, ++iter_x, ++iter_y, ++iter_z)
+        if( std::isfinite(*iter_x) && std::isfinite(*iter_y) && std::isfinite(*iter_z) )
+            _cloud_points.push_back(Vector3d(*iter_x, *iter_y, *iter_z));
+
+    _occupancy->InsertPointCloud(_start_pt, _cloud_points, _max_ray_range, _changed_occupancy_chunks);
+
     int num   = int(_cloud_margin * _inv_resolution);
     int num_z = max(1, num / 2);
-    vector<pcl::PointXYZ> infPts(20);
-    pcl::PointXYZ pt_inf;
+    if( !_occupancy->DilateChunksInto(_changed_occupancy_chunks, num, num_z, _map_versions->GetWritable(), _obst_cell, _free_cell) )
+    {
+        ROS_ERROR("[b_traj_node] occupancy map does not match the origin and resolution of the map");
+        return;
+    }
+    _map_versions->Publish();
+
+    resetLocalMap();
+
+    Vector3d local_half_size(_x_local_size / 2.0, _y_local_size / 2.0, _z_local_size / 2.0);
+    _occupancy->GetOccupiedCells(_start_pt - local_half_size, _start_pt + local_half_size, _cloud_points);
+
+    pcl::PointCloud<pcl::PointXYZ> cloud_inflation;
+    pcl::PointCloud<pcl::PointXYZ> cloud_local;
+    bool is_vis_local   = _local_map_vis_pub.getNumSubscribers() > 0;
+    bool is_vis_inflate = _inf_map_vis_pub.getNumSubscribers() > 0;
+
+    for (int idx = 0; idx < (int)_cloud_points.size(); idx++)
+    {
+        pcl::PointXYZ pt(_cloud_points[idx](0), _cloud_points[idx](1), _cloud_points[idx](2));
+        if( !isInLocalMap(pt) )
+            continue;
+
+        if(is_vis_local)
+            cloud_local.push_back(pt);
+        inflatePoint(Vector3d(pt.x, pt.y, pt.z), NULL, is_vis_inflate ? &cloud_inflation : NULL);
+    }
+    _has_map = true;
+
+    pubMapVis(cloud_inflation, cloud_local);
+
+    replanOnSnapshot(true);
+}
+
+// The delta only carries the chunks whose occupancy changed: the global map is kept as the
+// inflation of the whole streamed occupancy by re-inflating around those chunks, and the local map
+// is rebuilt from the occupied cells around the start point
+void rcvMapDeltaCallBack(const sdf_tools::CollisionMapDelta & map_delta)
+{
+    if( !_map_decoder.Apply(map_delta, _changed_chunks) )
+    {
+        ROS_WARN("[b_traj_node] map delta %lu dropped, waiting for the next keyframe", (unsigned long)map_delta.sequence);
+        return;
+    }
+
+    int num   = int(_cloud_margin * _inv_resolution);
+    int num_z = max(1, num / 2);
+    if( !_map_decoder.DilateChunksInto(_changed_chunks, num, num_z, _map_versions->GetWritable(), _obst_cell, _free_cell) )
+    {
+        ROS_ERROR("[b_traj_node] map delta does not match the origin and resolution of the map");
+        return;
+    }
+    _map_versions->Publish();
+
+    resetLocalMap();
+
+    const ChunkedOccupancy & occupancy = _map_decoder.GetOccupancy();
+    const Vector3d & occ_origin = occupancy.GetOrigin();
+    int64_t lo[3], hi[3];
+    for(int i = 0; i < 3; i++)
+    {
+        double half_size = (i == 0) ? _x_local_size / 2.0 : (i == 1) ? _y_local_size / 2.0 : _z_local_size / 2.0;
+        lo[i] = max((int64_t)0, (int64_t)floor((_start_pt(i) - half_size - occ_origin(i)) * _inv_resolution));
+        hi[i] = min(occupancy.GetNumCells(i), (int64_t)ceil((_start_pt(i) + half_size - occ_origin(i)) * _inv_resolution) + 1);
+    }
+
+    pcl::PointCloud<pcl::PointXYZ> cloud_inflation;
+    pcl::PointCloud<pcl::PointXYZ> cloud_local;
+    bool is_vis_local   = _local_map_vis_pub.getNumSubscribers() > 0;
+    bool is_vis_inflate = _inf_map_vis_pub.getNumSubscribers() > 0;
+
+    for(int64_t i = lo[0]; i < hi[0]; i++)
+        for(int64_t j = lo[1]; j < hi[1]; j++)
+            for(int64_t k = lo[2]; k < hi[2]; k++)
+            {
+                if( !occupancy.IsOccupied(i, j, k) )
+                    continue;
+
+                pcl::PointXYZ pt((i + 0.5) * _resolution + occ_origin(0), (j + 0.5) * _resolution + occ_origin(1), (k + 0.5) * _resolution + occ_origin(2));
+                if( !isInLocalMap(pt) )
+                    continue;
+
+                if(is_vis_local)
+                    cloud_local.push_back(pt);
+                inflatePoint(Vector3d(pt.x, pt.y, pt.z), NULL, is_vis_inflate ? &cloud_inflation : NULL);
+            }
+    _has_map = true;
+
+    pubMapVis(cloud_inflation, cloud_local);
+
+    replanOnSnapshot(true);
+}
+
+// The planner reads a version of the global map pinned for the whole replan, so that the map
+// callbacks can go on writing the map, and publish newer versions, meanwhile. Publish only fails
+// while readers hold all the older versions, and the changes then go out with the next one.
+void replanOnSnapshot(bool is_check_exec)
+{
+    VersionedCollisionMap::Snapshot snapshot = _map_versions->Pin();
+    collision_map = &snapshot.GetMap();
+    poly_generator->linkMap(collision_map);
+
+    if( !is_check_exec || checkExecTraj() == true )
+        trajPlanning();
+
+    collision_map = NULL;
+}
+
+// Marks the inflation box around pt in the local map, and in the global map and the visualization
+// cloud when they are given
+void inflatePoint(const Vector3d & pt, DynamicSpatialHashedCollisionMapGrid * global_map, pcl::PointCloud<pcl::PointXYZ> * cloud_inflation)
+{
+    int num   = int(_cloud_margin * _inv_resolution);
+    int num_z = max(1, num / 2);
+    Vector3d pt_inf;
 
     for(int x = -num ; x <= num; x ++ )
         for(int y = -num ; y <= num; y ++ )
             for(int z = -num_z ; z <= num_z; z ++ )
             {
-                pt_inf.x = pt.x + x * _resolution;
-                pt_inf.y = pt.y + y * _resolution;
-                pt_inf.z = pt.z + z * _resolution;
-
-                infPts.push_back( pt_inf );
+                pt_inf << pt(0) + x * _resolution, 
+                          pt(1) + y * _resolution, 
+                          pt(2) + z * _resolution;
+
+                collision_map_local->Set3d(pt_inf, _obst_cell);
+                if(global_map != NULL)
+                    global_map->Set3d(pt_inf, _obst_cell);
+                if(cloud_inflation != NULL)
+                    cloud_inflation->push_back(pcl::PointXYZ(pt_inf(0), pt_inf(1), pt_inf(2)));
             }
-
-    return infPts;
 }
 
 bool checkExecTraj()
@@ -373,6 +646,58 @@ bool checkCoordObs(Vector3d checkPt)
     return false;
 }
 
+/* 
+  Reachability oracle for the fast marching planner, whose wave only crosses faces between free cells.
+  Everything outside the local map is free, so the goal can be reached if it lies in the free component
+  of the start, or if both components reach the boundary of the local map (the goal being outside counts).
+  The components are labeled once per local map, every query after that is a few lookups.
+*/
+bool isGoalReachable(Vector3d start_pt, Vector3d end_pt)
+{
+    if(_open_components.empty())
+    {
+        ros::Time time_1 = ros::Time::now();
+        uint32_t num_components = collision_map_local->UpdateConnectedComponents();
+        _open_components.assign(num_components + 1, false);
+
+        int64_t size_x = collision_map_local->GetNumXCells();
+        int64_t size_y = collision_map_local->GetNumYCells();
+        int64_t size_z = collision_map_local->GetNumZCells();
+        for(int64_t i = 0; i < size_x; i++)
+            for(int64_t j = 0; j < size_y; j++)
+            {
+                // all cells of the x and y faces, only the two ends of the z rows otherwise
+                int64_t step = (i == 0 || j == 0 || i == size_x - 1 || j == size_y - 1) ? 1 : max(size_z - 1, (int64_t)1);
+                for(int64_t k = 0; k < size_z; k += step)
+                    _open_components[collision_map_local->Get(i, j, k).first.component] = true;
+            }
+
+        ros::Time time_2 = ros::Time::now();
+        ROS_WARN("[Fast Marching Node] %d connected components labeled in %f s", (int)num_components, (time_2 - time_1).toSec());
+    }
+
+    Vector3i start_idx = collision_map_local->LocationToGridIndex(start_pt);
+    if(!collision_map_local->Inside(start_idx))
+        return true;
+
+    // the planner frees the cell of the drone, if it is occupied the oracle cannot tell
+    COLLISION_CELL start_cell = collision_map_local->Get((int64_t)start_idx(0), (int64_t)start_idx(1), (int64_t)start_idx(2)).first;
+    if(start_cell.occupancy > 0.5)
+        return true;
+
+    bool start_open = _open_components[start_cell.component];
+
+    Vector3i end_idx = collision_map_local->LocationToGridIndex(end_pt);
+    if(!collision_map_local->Inside(end_idx))
+        return start_open;
+
+    COLLISION_CELL end_cell = collision_map_local->Get((int64_t)end_idx(0), (int64_t)end_idx(1), (int64_t)end_idx(2)).first;
+    if(end_cell.occupancy > 0.5)
+        return false;
+
+    return end_cell.component == start_cell.component || (start_open && _open_components[end_cell.component]);
+}
+
 pair<Cube, bool> inflateCube(Cube cube, Cube lstcube)
 {   
     Cube cubeMax = cube;
@@ -422,8 +747,8 @@ pair<Cube, bool> inflateCube(Cube cube, Cube lstcube)
     while(iter < _max_inflate_iter)
     {   
         collide  = false; 
-        int y_lo = max(0, vertex_idx(0, 1) - _step_length);
-        int y_up = min(_max_y_id, vertex_idx(1, 1) + _step_length);
+        int y_lo = max(_win_lo_id(1), vertex_idx(0, 1) - _step_length);
+        int y_up = min(_win_hi_id(1), vertex_idx(1, 1) + _step_length);
 
         for(id_y = vertex_idx(0, 1); id_y >= y_lo; id_y-- )
         {   
@@ -494,8 +819,8 @@ pair<Cube, bool> inflateCube(Cube cube, Cube lstcube)
 
         // X + now is the front side : (p1 -- p2 -- p6 -- p5) face
         // ############################################################################################################
-        int x_lo = max(0, vertex_idx(3, 0) - _step_length);
-        int x_up = min(_max_x_id, vertex_idx(0, 0) + _step_length);
+        int x_lo = max(_win_lo_id(0), vertex_idx(3, 0) - _step_length);
+        int x_up = min(_win_hi_id(0), vertex_idx(0, 0) + _step_length);
 
         collide = false;
         for(id_x = vertex_idx(0, 0); id_x <= x_up; id_x++ )
@@ -568,8 +893,8 @@ pair<Cube, bool> inflateCube(Cube cube, Cube lstcube)
         // Z+ now is the above side : (p1 -- p2 -- p3 -- p4) face
         // ############################################################################################################
         collide = false;
-        int z_lo = max(0, vertex_idx(4, 2) - _step_length);
-        int z_up = min(_max_z_id, vertex_idx(0, 2) + _step_length);
+        int z_lo = max(_win_lo_id(2), vertex_idx(4, 2) - _step_length);
+        int z_up = min(_win_hi_id(2), vertex_idx(0, 2) + _step_length);
         for(id_z = vertex_idx(0, 2); id_z <= z_up; id_z++ )
         {   
             if( collide == true) 
@@ -644,9 +969,9 @@ pair<Cube, bool> inflateCube(Cube cube, Cube lstcube)
         MatrixXd vertex_coord(8, 3);
         for(int i = 0; i < 8; i++)
         {   
-            int index_x = max(min(vertex_idx(i, 0), _max_x_id - 1), 0);
-            int index_y = max(min(vertex_idx(i, 1), _max_y_id - 1), 0);
-            int index_z = max(min(vertex_idx(i, 2), _max_z_id - 1), 0);
+            int index_x = max(min(vertex_idx(i, 0), _win_hi_id(0) - 1), _win_lo_id(0));
+            int index_y = max(min(vertex_idx(i, 1), _win_hi_id(1) - 1), _win_lo_id(1));
+            int index_z = max(min(vertex_idx(i, 2), _win_hi_id(2) - 1), _win_lo_id(2));
 
             Vector3i index(index_x, index_y, index_z);
             Vector3d pos = collision_map->GridIndexToLocation(index);
@@ -737,55 +1062,297 @@ void corridorSimplify(vector<Cube> & cubicList)
     cubicList = cubicSimplifyList;
 }
 
-vector<Cube> corridorGeneration(vector<Vector3d> path_coord, vector<double> time)
-{   
+bool isInsideCube(const Cube & cube, const Vector3d & pt)
+{
+    for(int i = 0; i < 3; i++)
+        if( pt(i) < cube.box[i].first || pt(i) > cube.box[i].second )
+            return false;
+
+    return true;
+}
+
+bool isCellFree(const Vector3i & idx)
+{
+    return collision_map->Get( (int64_t)idx(0), (int64_t)idx(1), (int64_t)idx(2) ).first.occupancy <= 0.5;
+}
+
+// 3D DDA over the cells of collision_map crossed by the segment p0 - p1. Where the segment goes
+// through an edge or a corner of a cell, all the cells around it are checked.
+bool isLineFree(const Vector3d & p0, const Vector3d & p1)
+{
+    Vector3i idx     = collision_map->LocationToGridIndex(p0);
+    Vector3i end_idx = collision_map->LocationToGridIndex(p1);
+    if(!isCellFree(idx) || !isCellFree(end_idx))
+        return false;
+
+    Vector3d d      = p1 - p0;
+    Vector3d corner = collision_map->GridIndexToLocation(idx) - Vector3d::Constant(_resolution / 2.0);
+    Vector3i step;
+    Vector3d t_max, t_delta;
+    for(int i = 0; i < 3; i++)
+    {
+        if(d(i) > 0.0)
+        {
+            step(i)    = 1;
+            t_max(i)   = (corner(i) + _resolution - p0(i)) / d(i);
+            t_delta(i) = _resolution / d(i);
+        }
+        else if(d(i) < 0.0)
+        {
+            step(i)    = -1;
+            t_max(i)   = (corner(i) - p0(i)) / d(i);
+            t_delta(i) = - _resolution / d(i);
+        }
+        else
+        {
+            step(i)    = 0;
+            t_max(i)   = INFINITY;
+            t_delta(i) = INFINITY;
+        }
+    }
+
+    int num_steps = (end_idx - idx).cwiseAbs().sum();
+    for(int k = 0; k < num_steps && idx != end_idx; k++)
+    {
+        double t_min = t_max.minCoeff();
+        if(t_min > 1.0)
+            break;
+
+        int mask = 0;
+        for(int i = 0; i < 3; i++)
+            if(t_max(i) <= t_min + 1e-9)
+                mask |= 1 << i;
+
+        for(int sub = mask; sub > 0; sub = (sub - 1) & mask)
+        {
+            Vector3i cell = idx;
+            for(int i = 0; i < 3; i++)
+                if((sub >> i) & 1)
+                    cell(i) += step(i);
+
+            if(!isCellFree(cell))
+                return false;
+        }
+
+        for(int i = 0; i < 3; i++)
+        {
+            if((mask >> i) & 1)
+            {
+                idx(i)   += step(i);
+                t_max(i) += t_delta(i);
+            }
+        }
+    }
+
+    return true;
+}
+
+// Keeps the points where the path has to turn: from each kept point, the farthest one in line of sight.
+vector<int> pathCompaction(const vector<Vector3d> & path_coord)
+{
+    vector<int> waypoints;
+    int num = path_coord.size();
+    if(num == 0)
+        return waypoints;
+
+    waypoints.push_back(0);
+    int i = 0;
+    while(i < num - 1)
+    {
+        int j = i + 1;
+        while(j + 1 < num && isLineFree(path_coord[i], path_coord[j + 1]))
+            j++;
+
+        waypoints.push_back(j);
+        i = j;
+    }
+
+    return waypoints;
+}
+
+vector<Cube> cubeCorridorGeneration(const vector<Vector3d> & path_coord, const vector<double> & time)
+{
     vector<Cube> cubeList;
-    Vector3d pt;
+    vector<int> waypoints = pathCompaction(path_coord);
 
+    // Cubes are seeded along the straight lines between the waypoints, one resolution apart, except at
+    // points the last cube already covers. A step that only touches obstacles at an edge or a corner is
+    // not a line of sight, it is seeded at its ends only.
     Cube lstcube;
-
-    for (int i = 0; i < (int)path_coord.size(); i += 1)
+    bool has_cube = false;
+    for(int w = 0; w < (int)waypoints.size(); w++)
     {
-        pt = path_coord[i];
+        int i0 = waypoints[w];
+        int i1 = (w + 1 < (int)waypoints.size()) ? waypoints[w + 1] : i0;
 
-        Cube cube = generateCube(pt);
-        auto result = inflateCube(cube, lstcube);
+        Vector3d p0 = path_coord[i0];
+        Vector3d p1 = path_coord[i1];
+        int num_steps = 1;
+        if(i1 > i0 && isLineFree(p0, p1))
+            num_steps = max(1, (int)ceil((p1 - p0).norm() / _resolution));
 
-        if(result.second == false)
-            continue;
+        for(int k = 0; k < num_steps; k++)
+        {
+            double s = (double)k / num_steps;
+            Vector3d pt = p0 + s * (p1 - p0);
+            if(has_cube && isInsideCube(lstcube, pt))
+                continue;
 
-        cube = result.first;
-        
-        lstcube = cube;
-        cube.t = time[i];
-        cubeList.push_back(cube);
+            Cube cube = generateCube(pt);
+            auto result = inflateCube(cube, lstcube);
+
+            if(result.second == false)
+                continue;
+
+            cube = result.first;
+
+            lstcube  = cube;
+            has_cube = true;
+            cube.t   = (1.0 - s) * time[i0] + s * time[i1];
+            cubeList.push_back(cube);
+        }
     }
     return cubeList;
 }
 
+bool polyCorridorGeneration(vector<Vector3d> path_coord, vector<Cube> & corridor, vector<double> & seeds)
+{
+    if(path_coord.empty())
+        return false;
+
+    if((path_coord.back() - _end_pt).norm() > 1e-6)
+        path_coord.push_back(_end_pt);
+
+    if(!poly_generator->generateCorridor(path_coord, _cube_margin, corridor, seeds))
+    {
+        ROS_WARN("[Planning Node] Polyhedral corridor failed, use the cubes instead");
+        return false;
+    }
+
+    return true;
+}
+
+vector<Cube> corridorGeneration(vector<Vector3d> path_coord, vector<double> time)
+{   
+    vector<Cube> cubeList;
+
+    vector<double> seeds;
+    if(_is_use_poly && polyCorridorGeneration(path_coord, cubeList, seeds))
+    {
+        // Polyhedra may start in between two path points, the time to the target is 0 at _end_pt
+        for(int i = 0; i < (int)cubeList.size(); i++)
+        {
+            int k = (int)seeds[i];
+            double w = seeds[i] - k;
+            double t_next = (k + 1 < (int)time.size()) ? time[k + 1] : 0.0;
+            cubeList[i].t = (1.0 - w) * time[k] + w * t_next;
+        }
+        return cubeList;
+    }
+
+    return cubeCorridorGeneration(path_coord, time);
+}
+
 vector<Cube> corridorGeneration(vector<Vector3d> path_coord)
 {   
     vector<Cube> cubeList;
-    Vector3d pt;
 
-    Cube lstcube;
+    vector<double> seeds;
+    if(_is_use_poly && polyCorridorGeneration(path_coord, cubeList, seeds))
+        return cubeList;
 
-    for (int i = 0; i < (int)path_coord.size(); i += 1)
+    return cubeCorridorGeneration(path_coord, vector<double>(path_coord.size(), 0.0));
+}
+
+/*
+  The global map is unbounded, so the search grids only cover a window around the start and the target,
+  with a margin of half the local map and its buffer. The window is kept while the start and the target
+  stay half a margin away from its sides, so that DFMM can repair its field over the same grid.
+  The window is at most map/x_size by map/y_size (and at least three margins), so that the grids do not
+  grow with the distance to the target. Along an axis where the target does not fit, the window starts a
+  margin behind the start and is moved once the start is half a margin further. The plan then ends where
+  the segment to the target leaves the window shrunk by half a margin. That end point is only recomputed
+  when the window moves or a new target arrives.
+*/
+void updateSearchWindow()
+{
+    Vector2d max_size(max(_x_size, 3.0 * _win_margin), max(_y_size, 3.0 * _win_margin));
+
+    bool is_inside = true;
+    for(int i = 0; i < 2; i++)
     {
-        pt = path_coord[i];
+        double win_lo = _map_origin(i) + _win_lo_id(i) * _resolution;
+        double win_hi = _map_origin(i) + _win_hi_id(i) * _resolution;
+        double lo, hi;
+        if( fabs(_target_pt(i) - _start_pt(i)) + 2.0 * _win_margin <= max_size(i) )
+        {
+            lo = min(_start_pt(i), _target_pt(i)) - _win_margin / 2.0;
+            hi = max(_start_pt(i), _target_pt(i)) + _win_margin / 2.0;
+        }
+        else if( _target_pt(i) > _start_pt(i) )
+        {
+            lo = _start_pt(i) - _win_margin / 2.0;
+            hi = _start_pt(i) - 1.5 * _win_margin + max_size(i);
+        }
+        else
+        {
+            lo = _start_pt(i) + 1.5 * _win_margin - max_size(i);
+            hi = _start_pt(i) + _win_margin / 2.0;
+        }
+        if( lo < win_lo || hi > win_hi )
+            is_inside = false;
+    }
 
-        Cube cube = generateCube(pt);
-        auto result = inflateCube(cube, lstcube);
+    _is_win_moved = !is_inside;
+    if(!is_inside)
+    {
+        for(int i = 0; i < 2; i++)
+        {
+            double lo, hi;
+            if( fabs(_target_pt(i) - _start_pt(i)) + 2.0 * _win_margin <= max_size(i) )
+            {
+                lo = min(_start_pt(i), _target_pt(i)) - _win_margin;
+                hi = max(_start_pt(i), _target_pt(i)) + _win_margin;
+            }
+            else if( _target_pt(i) > _start_pt(i) )
+            {
+                lo = _start_pt(i) - _win_margin;
+                hi = lo + max_size(i);
+            }
+            else
+            {
+                hi = _start_pt(i) + _win_margin;
+                lo = hi - max_size(i);
+            }
+            _win_lo_id(i) = (int)floor((lo - _map_origin(i)) * _inv_resolution);
+            _win_hi_id(i) = (int)ceil ((hi - _map_origin(i)) * _inv_resolution);
+        }
+        _win_lo_id(2) = 0;
+        _win_hi_id(2) = _max_z_id;
 
-        if(result.second == false)
-            continue;
+        _pt_min_x = _map_origin(0) + _win_lo_id(0) * _resolution;
+        _pt_max_x = _map_origin(0) + _win_hi_id(0) * _resolution;
+        _pt_min_y = _map_origin(1) + _win_lo_id(1) * _resolution;
+        _pt_max_y = _map_origin(1) + _win_hi_id(1) * _resolution;
+    }
 
-        cube = result.first;
-        
-        lstcube = cube;
-        cubeList.push_back(cube);
+    // The end point is kept with the window, so that the wave of DFMM starts from the same cell
+    if(!_is_win_moved && !_is_end_new)
+        return;
+    _is_end_new = false;
+
+    // The start is at least half a margin inside, so the segment to the target leaves the shrunk window once
+    double s = 1.0;
+    Vector2d inner_lo(_pt_min_x + _win_margin / 2.0, _pt_min_y + _win_margin / 2.0);
+    Vector2d inner_hi(_pt_max_x - _win_margin / 2.0, _pt_max_y - _win_margin / 2.0);
+    for(int i = 0; i < 2; i++)
+    {
+        if( _target_pt(i) > inner_hi(i) )
+            s = min(s, (inner_hi(i) - _start_pt(i)) / (_target_pt(i) - _start_pt(i)));
+        else if( _target_pt(i) < inner_lo(i) )
+            s = min(s, (inner_lo(i) - _start_pt(i)) / (_target_pt(i) - _start_pt(i)));
     }
-    return cubeList;
+    _end_pt = _start_pt + s * (_target_pt - _start_pt);
 }
 
 double velMapping(double d, double max_v)
@@ -809,12 +1376,26 @@ void trajPlanning()
     if( _has_target == false || _has_map == false || _has_odom == false) 
         return;
 
+    updateSearchWindow();
+    Vector3i win_size   = _win_hi_id - _win_lo_id;
+    Vector3d win_origin = _map_origin + _win_lo_id.cast<double>() * _resolution;
+
     vector<Cube> corridor;
     if(_is_use_fm)
     {
+        if(_is_check_reach && !isGoalReachable(_start_pt, _end_pt))
+        {
+            ROS_WARN("[Fast Marching Node] Target is not reachable from the current position");
+            _traj.action = quadrotor_msgs::PolynomialTrajectory::ACTION_WARN_IMPOSSIBLE;
+            _traj_pub.publish(_traj);
+            _has_traj = false;
+
+            return;
+        }
+
+        // velMapping is flat beyond 1 m, so a field truncated there (edt_cutoff is at least 1 m) gives the same speed map
         ros::Time time_1 = ros::Time::now();
-        float oob_value = INFINITY;
-        auto EDT = collision_map_local->ExtractDistanceField(oob_value);
+        _edt.Build(*collision_map_local, _edt_cutoff);
         ros::Time time_2 = ros::Time::now();
         ROS_WARN("time in generate EDT is %f", (time_2 - time_1).toSec());
 
@@ -825,12 +1406,52 @@ void trajPlanning()
         vector<int64_t> pt_idx;
         double flow_vel;
 
-        unsigned int size_x = (unsigned int)(_max_x_id);
-        unsigned int size_y = (unsigned int)(_max_y_id);
-        unsigned int size_z = (unsigned int)(_max_z_id);
+        unsigned int size_x = (unsigned int)(win_size(0));
+        unsigned int size_y = (unsigned int)(win_size(1));
+        unsigned int size_z = (unsigned int)(win_size(2));
 
         Coord3D dimsize {size_x, size_y, size_z};
-        FMGrid3D grid_fmm(dimsize);
+        if(_grid_fmm != NULL && _grid_fmm->getDimSizes() != dimsize)
+        {
+            delete _grid_fmm;
+            _grid_fmm = NULL;
+        }
+        if(_grid_fmm == NULL)
+            _grid_fmm = new FMGrid3D(dimsize);
+        FMGrid3D & grid_fmm = *_grid_fmm;
+
+        Vector3d startIdx3d = (_start_pt - win_origin) * _inv_resolution; 
+        Vector3d endIdx3d   = (_end_pt   - win_origin) * _inv_resolution;
+
+        Coord3D goal_point = {(unsigned int)startIdx3d[0], (unsigned int)startIdx3d[1], (unsigned int)startIdx3d[2]};
+        Coord3D init_point = {(unsigned int)endIdx3d[0],   (unsigned int)endIdx3d[1],   (unsigned int)endIdx3d[2]}; 
+
+        unsigned int startIdx;
+        vector<unsigned int> startIndices;
+        grid_fmm.coord2idx(init_point, startIdx);
+        
+        startIndices.push_back(startIdx);
+        
+        unsigned int goalIdx;
+        grid_fmm.coord2idx(goal_point, goalIdx);
+
+        // The cached field is only valid while the wave is initialized from the same target, in the same window
+        bool is_dfmm   = (_fm_solver == "dfmm");
+        bool is_repair = is_dfmm && _dfmm_solver != NULL && !_is_win_moved && _dfmm_init_idx == startIdx && _grid_dfmm->getDimSizes() == dimsize;
+        vector<unsigned int> changed;
+
+        if(is_dfmm && !is_repair)
+        {
+            delete _dfmm_solver;
+            _dfmm_solver = NULL;
+            if(_grid_dfmm != NULL && _grid_dfmm->getDimSizes() != dimsize)
+            {
+                delete _grid_dfmm;
+                _grid_dfmm = NULL;
+            }
+            if(_grid_dfmm == NULL)
+                _grid_dfmm = new FMGrid3D(dimsize);
+        }
 
         for(unsigned int k = 0; k < size_z; k++)
         {
@@ -839,15 +1460,15 @@ void trajPlanning()
                 for(unsigned int i = 0; i < size_x; i++)
                 {
                     idx = k * size_y * size_x + j * size_x + i;
-                    pt << (i + 0.5) * _resolution + _map_origin(0), 
-                          (j + 0.5) * _resolution + _map_origin(1), 
-                          (k + 0.5) * _resolution + _map_origin(2);
+                    pt << (i + 0.5) * _resolution + win_origin(0), 
+                          (j + 0.5) * _resolution + win_origin(1), 
+                          (k + 0.5) * _resolution + win_origin(2);
 
                     Vector3i index = collision_map_local->LocationToGridIndex(pt);
 
                     if(collision_map_local->Inside(index))
                     {
-                        double d = sqrt(EDT.GetImmutable(index).first.distance_square) * _resolution;
+                        double d = _edt.GetDistance(index(0), index(1), index(2));
                         flow_vel = velMapping(d, max_vel);
                     }
                     else
@@ -856,6 +1477,15 @@ void trajPlanning()
                     if( k == 0 || k == (size_z - 1) || j == 0 || j == (size_y - 1) || i == 0 || i == (size_x - 1) )
                         flow_vel = 0.0;
 
+                    if( idx == goalIdx )
+                        flow_vel = max_vel;
+
+                    if( is_repair && (*_grid_dfmm)[idx].getVelocity() != flow_vel )
+                        changed.push_back(idx);
+
+                    if( is_dfmm )
+                        (*_grid_dfmm)[idx].setOccupancy(flow_vel);
+
                     grid_fmm[idx].setOccupancy(flow_vel);
                     if (grid_fmm[idx].isOccupied())
                         obs.push_back(idx);
@@ -863,34 +1493,67 @@ void trajPlanning()
             }
         }
         
+        if(is_dfmm)
+        {
+            _grid_dfmm->setOccupiedCells(obs);
+            _grid_dfmm->setLeafSize(_resolution);
+        }
         grid_fmm.setOccupiedCells(std::move(obs));
         grid_fmm.setLeafSize(_resolution);
 
-        Vector3d startIdx3d = (_start_pt - _map_origin) * _inv_resolution; 
-        Vector3d endIdx3d   = (_end_pt   - _map_origin) * _inv_resolution;
-
-        Coord3D goal_point = {(unsigned int)startIdx3d[0], (unsigned int)startIdx3d[1], (unsigned int)startIdx3d[2]};
-        Coord3D init_point = {(unsigned int)endIdx3d[0],   (unsigned int)endIdx3d[1],   (unsigned int)endIdx3d[2]}; 
+        // DFMM freezes at most planning/dfmm_cells cells per replan, and its path is only taken once
+        // its field reaches the robot. Until then, and after the window moved or the target changed,
+        // the path comes from FMM* on grid_fmm
+        bool is_cached = false;
+        if(is_dfmm)
+        {
+            if(is_repair)
+            {
+                ROS_WARN("[Fast Marching Node] Repairing cached arrival field, %d cells changed", (int)changed.size());
+                _dfmm_solver->setChangedCells(changed);
+                _dfmm_solver->setGoalPoint(goalIdx);
+            }
+            else
+            {
+                _dfmm_solver = new DFMM<FMGrid3D>("DFMM_Dist");
+                _dfmm_solver->setCellBudget(_dfmm_cells);
+                _dfmm_solver->setEnvironment(_grid_dfmm);
+                _dfmm_solver->setInitialAndGoalPoints(startIndices, goalIdx);
+                _dfmm_init_idx = startIdx;
+            }
 
-        unsigned int startIdx;
-        vector<unsigned int> startIndices;
-        grid_fmm.coord2idx(init_point, startIdx);
-        
-        startIndices.push_back(startIdx);
-        
-        unsigned int goalIdx;
-        grid_fmm.coord2idx(goal_point, goalIdx);
-        grid_fmm[goalIdx].setOccupancy(max_vel);     
+            ros::Time time_bef_dfmm = ros::Time::now();
+            if(_dfmm_solver->compute(max_vel) == -1)
+            {
+                delete _dfmm_solver;
+                _dfmm_solver = NULL;
+            }
+            else
+                is_cached = _dfmm_solver->isGoalReached();
+            ros::Time time_aft_dfmm = ros::Time::now();
+            ROS_WARN("[Fast Marching Node] Time in DFMM computing is %f, %s", (time_aft_dfmm - time_bef_dfmm).toSec(), 
+                is_cached ? "path from the cached field" : "field not at the robot yet, path from FMM*");
+        }
 
-        Solver<FMGrid3D>* fm_solver = new FMMStar<FMGrid3D>("FMM*_Dist", TIME); // LSM, FMM
+        FMGrid3D & grid_path = is_cached ? *_grid_dfmm : grid_fmm;
+        Solver<FMGrid3D>* fm_solver = NULL;
+        if(!is_cached)
+        {
+            if(_fm_solver == "hfmm")
+                fm_solver = new HFMM<FMGrid3D>("HFMM_Dist", _hfm_factor, _hfm_tube_width);
+            else
+                fm_solver = new FMMStar<FMGrid3D>("FMM*_Dist", TIME); // LSM, FMM
     
-        fm_solver->setEnvironment(&grid_fmm);
-        fm_solver->setInitialAndGoalPoints(startIndices, goalIdx);
+            fm_solver->setEnvironment(&grid_fmm);
+            fm_solver->setInitialAndGoalPoints(startIndices, goalIdx);
+        }
 
         ros::Time time_bef_fm = ros::Time::now();
-        if(fm_solver->compute(max_vel) == -1)
+        if(fm_solver != NULL && fm_solver->compute(max_vel) == -1)
         {
             ROS_WARN("[Fast Marching Node] No path can be found");
+            delete fm_solver;
+
             _traj.action = quadrotor_msgs::PolynomialTrajectory::ACTION_WARN_IMPOSSIBLE;
             _traj_pub.publish(_traj);
             _has_traj = false;
@@ -903,11 +1566,18 @@ void trajPlanning()
         Path3D path3D;
         vector<double> path_vels, time;
         GradientDescent< FMGrid3D > grad3D;
-        grid_fmm.coord2idx(goal_point, goalIdx);
+        grid_path.coord2idx(goal_point, goalIdx);
 
-        if(grad3D.gradient_descent(grid_fmm, goalIdx, path3D, path_vels, time) == -1)
+        if(grad3D.gradient_descent(grid_path, goalIdx, path3D, path_vels, time) == -1)
         {
             ROS_WARN("[Fast Marching Node] FMM failed, valid path not exists");
+            delete fm_solver;
+            if(is_cached)
+            {
+                delete _dfmm_solver;
+                _dfmm_solver = NULL;
+            }
+
             if(_has_traj && _is_emerg)
             {
                 _traj.action = quadrotor_msgs::PolynomialTrajectory::ACTION_WARN_IMPOSSIBLE;
@@ -917,17 +1587,41 @@ void trajPlanning()
             return;
         }
 
+        if(_fm_solver == "hfmm")
+        {
+            HFMM<FMGrid3D>* hfmm_solver = fm_solver->as< HFMM<FMGrid3D> >();
+            ROS_WARN("[Fast Marching Node] HFMM coarse stage %f ms, fine stage %f ms%s", 
+                hfmm_solver->getCoarseTime(), hfmm_solver->getFineTime(), hfmm_solver->usedFallback() ? ", fell back to full resolution" : "");
+
+            if(_is_report_hfm)
+            {   // solve again at full resolution to compare, the path has already been extracted
+                double hfmm_cost = time.front();
+                grid_fmm.coord2idx(goal_point, goalIdx);
+                Solver<FMGrid3D>* ref_solver = new FMMStar<FMGrid3D>("FMM*_Ref", TIME);
+                ref_solver->setEnvironment(&grid_fmm);
+                ref_solver->setInitialAndGoalPoints(startIndices, goalIdx);
+
+                ros::Time time_bef_ref = ros::Time::now();
+                ref_solver->compute(max_vel);
+                ros::Time time_aft_ref = ros::Time::now();
+
+                double ref_cost = grid_fmm[goalIdx].getArrivalTime();
+                double hfmm_time = (time_aft_fm - time_bef_fm).toSec();
+                double ref_time  = (time_aft_ref - time_bef_ref).toSec();
+                ROS_WARN("[Fast Marching Node] HFMM vs FMM*: time %f s / %f s (speedup %.2f), path cost %f / %f (%+.2f%%)", 
+                    hfmm_time, ref_time, ref_time / hfmm_time, hfmm_cost, ref_cost, 100.0 * (hfmm_cost - ref_cost) / ref_cost);
+                delete ref_solver;
+            }
+        }
+
         vector<Vector3d> path_coord;
         path_coord.push_back(_start_pt);
 
-        double coord_x, coord_y, coord_z;
         for( int i = 0; i < (int)path3D.size(); i++)
         {
-            coord_x = max(min( (path3D[i][0]+0.5) * _resolution + _map_origin(0), _x_size), -_x_size);
-            coord_y = max(min( (path3D[i][1]+0.5) * _resolution + _map_origin(1), _y_size), -_y_size);
-            coord_z = max(min( (path3D[i][2]+0.5) * _resolution, _z_size), 0.0);
-
-            Vector3d pt(coord_x, coord_y, coord_z);
+            Vector3d pt( (path3D[i][0]+0.5) * _resolution + win_origin(0), 
+                         (path3D[i][1]+0.5) * _resolution + win_origin(1), 
+                         (path3D[i][2]+0.5) * _resolution + win_origin(2) );
             path_coord.push_back(pt);
         }
         visPath(path_coord);
@@ -945,15 +1639,34 @@ void trajPlanning()
     }
     else
     {   
+        path_finder->setSearchWindow(win_origin, win_size);
         path_finder->linkLocalMap(collision_map_local, _local_origin);
-        path_finder->AstarSearch(_start_pt, _end_pt);
+        if(_time_budget > 0.0)
+            path_finder->AraSearch(_start_pt, _end_pt, _time_budget);
+        else if(_is_use_jps)
+            path_finder->JpsSearch(_start_pt, _end_pt);
+        else
+            path_finder->AstarSearch(_start_pt, _end_pt);
         vector<Vector3d> gridPath = path_finder->getPath();
-        vector<GridNodePtr> searchedNodes = path_finder->getVisitedNodes();
+        vector<Vector3d> searchedNodes = path_finder->getVisitedNodes();
         path_finder->resetLocalMap();
         
         visGridPath(gridPath);
         visExpNode(searchedNodes);
 
+        // ARA* returns no path when the deadline is hit before its first pass reaches the target
+        if(gridPath.empty())
+        {
+            ROS_WARN("[A star] No path can be found");
+            if(_has_traj && _is_emerg)
+            {
+                _traj.action = quadrotor_msgs::PolynomialTrajectory::ACTION_WARN_IMPOSSIBLE;
+                _traj_pub.publish(_traj);
+                _has_traj = false;
+            } 
+            return;
+        }
+
         ros::Time time_bef_corridor = ros::Time::now();    
         corridor = corridorGeneration(gridPath);
         ros::Time time_aft_corridor = ros::Time::now();
@@ -1165,7 +1878,6 @@ int main(int argc, char** argv)
     ros::init(argc, argv, "b_traj_node");
     ros::NodeHandle nh("~");
 
-    _map_sub  = nh.subscribe( "map",       1, rcvPointCloudCallBack );
     _odom_sub = nh.subscribe( "odometry",  1, rcvOdometryCallbck);
     _pts_sub  = nh.subscribe( "waypoints", 1, rcvWaypointsCallback );
 
@@ -1183,6 +1895,16 @@ int main(int argc, char** argv)
 
     nh.param("map/margin",     _cloud_margin, 0.25);
     nh.param("map/resolution", _resolution, 0.2);
+    nh.param("map/is_use_delta", _is_use_delta, false);
+    nh.param("map/chunk_size",   _map_chunk_size, 8);
+    nh.param("map/is_use_log_odds",   _is_use_log_odds,   false);
+    nh.param("map/log_odds_hit",      _log_odds_hit,      0.85);
+    nh.param("map/log_odds_miss",     _log_odds_miss,    -0.4);
+    nh.param("map/log_odds_min",      _log_odds_min,     -2.0);
+    nh.param("map/log_odds_max",      _log_odds_max,      3.5);
+    nh.param("map/log_odds_occupied", _log_odds_occupied, 0.0);
+    nh.param("map/max_ray_range",     _max_ray_range,     12.0);
+    nh.param("map/ray_threads",       _ray_threads,       4);
     
     nh.param("map/x_size",       _x_size, 50.0);
     nh.param("map/y_size",       _y_size, 50.0);
@@ -1206,6 +1928,26 @@ int main(int argc, char** argv)
     nh.param("planning/is_limit_vel",  _is_limit_vel,  false);
     nh.param("planning/is_limit_acc",  _is_limit_acc,  false);
     nh.param("planning/is_use_fm",     _is_use_fm,  true);
+    nh.param("planning/is_use_jps",    _is_use_jps, false);
+    nh.param("planning/fm_solver",     _fm_solver,  string("fmmstar"));
+    nh.param("planning/dfmm_cells",    _dfmm_cells,      50000);
+    nh.param("planning/hfm_factor",    _hfm_factor,      4);
+    nh.param("planning/hfm_tube_width",_hfm_tube_width,  1.0);
+    nh.param("planning/is_report_hfm", _is_report_hfm,   false);
+    nh.param("planning/is_check_reach",_is_check_reach,  true);
+    nh.param("planning/time_budget",   _time_budget,     0.0);
+    nh.param("planning/ara_eps",       _ara_eps,         2.5);
+    nh.param("planning/ara_eps_step",  _ara_eps_step,    0.5);
+    nh.param("planning/is_use_poly",   _is_use_poly,     false);
+    nh.param("planning/poly_range",    _poly_range,      1.0);
+    nh.param("planning/poly_max_length", _poly_max_length, 3.0);
+    nh.param("planning/edt_cutoff",    _edt_cutoff,      1.0);
+    // velMapping saturates at 1 m, a field truncated closer would slow the speed map around obstacles
+    if(_edt_cutoff > 0.0 && _edt_cutoff < 1.0)
+    {
+        ROS_WARN("[b_traj_node] planning/edt_cutoff %f is below the 1 m where the speed saturates, using 1 m", _edt_cutoff);
+        _edt_cutoff = 1.0;
+    }
 
     nh.param("optimization/min_order",  _minimize_order, 3.0);
     nh.param("optimization/poly_order", _traj_order,    10);
@@ -1224,32 +1966,45 @@ int main(int argc, char** argv)
     _Ca  = _bernstein.getC_a()[_traj_order];
     _Cj  = _bernstein.getC_j()[_traj_order];
 
+    // map/x_size and y_size only place the origin of the global map indices, the x and y bounds are
+    // those of the search window
     _map_origin << -_x_size/2.0, -_y_size/2.0, 0.0;
-    _pt_max_x = + _x_size / 2.0;
-    _pt_min_x = - _x_size / 2.0;
-    _pt_max_y = + _y_size / 2.0;
-    _pt_min_y = - _y_size / 2.0; 
     _pt_max_z = + _z_size;
     _pt_min_z = 0.0;
 
     _inv_resolution = 1.0 / _resolution;
-    _max_x_id = (int)(_x_size * _inv_resolution);
-    _max_y_id = (int)(_y_size * _inv_resolution);
     _max_z_id = (int)(_z_size * _inv_resolution);
     _max_local_x_id = (int)(_x_local_size * _inv_resolution);
     _max_local_y_id = (int)(_y_local_size * _inv_resolution);
     _max_local_z_id = (int)(_z_local_size * _inv_resolution);
+    _win_lo_id << 0, 0, 0;
+    _win_hi_id << 0, 0, _max_z_id;
+    _win_margin = max(_x_local_size, _y_local_size) / 2.0 + _MAX_Vel;
 
-    Vector3i GLSIZE(_max_x_id, _max_y_id, _max_z_id);
+    Vector3i GLSIZE(0, 0, _max_z_id);
     Vector3i LOSIZE(_max_local_x_id, _max_local_y_id, _max_local_z_id);
 
     path_finder = new gridPathFinder(GLSIZE, LOSIZE);
     path_finder->initGridNodeMap(_resolution, _map_origin);
+    path_finder->setAraInflation(_ara_eps, _ara_eps_step);
 
     Translation3d origin_translation( _map_origin(0), _map_origin(1), 0.0);
     Quaterniond origin_rotation(1.0, 0.0, 0.0, 0.0);
     Affine3d origin_transform = origin_translation * origin_rotation;
-    collision_map = new CollisionMapGrid(origin_transform, "world", _resolution, _x_size, _y_size, _z_size, _free_cell);
+    // the global map allocates chunks only where obstacles are set, so it is not bounded by map/x_size,
+    // y_size and z_size, the search grids cover a window around the start and the target.
+    // A chunk spans the whole height of the map, so that no z cells are padded
+    DynamicSpatialHashedCollisionMapGrid global_map(origin_transform, "world", _resolution, _map_chunk_size, _map_chunk_size, max(_max_z_id, 1), _free_cell);
+    _map_versions = new VersionedCollisionMap(global_map);
+    if(_is_use_log_odds && !_is_use_delta)
+        _occupancy = new OccupancyLogOddsMap(origin_transform, _resolution, _map_chunk_size, _log_odds_hit, _log_odds_miss, _log_odds_min, _log_odds_max, _log_odds_occupied, _ray_threads);
+    poly_generator->setParam(_poly_range, _poly_max_length);
+
+    // deltas are applied in place, each one following the previous, so none may be dropped
+    if(_is_use_delta)
+        _map_sub = nh.subscribe( "map_delta", 10, rcvMapDeltaCallBack );
+    else
+        _map_sub = nh.subscribe( "map",       1, rcvPointCloudCallBack );
 
     ros::Rate rate(100);
     bool status = ros::ok();
@@ -1558,7 +2313,7 @@ void visGridPath( vector<Vector3d> grid_path )
     _grid_path_vis_pub.publish(grid_vis);
 }
 
-void visExpNode( vector<GridNodePtr> nodes )
+void visExpNode( vector<Vector3d> nodes )
 {   
     visualization_msgs::Marker node_vis; 
     node_vis.header.frame_id = "world";
@@ -1584,7 +2339,7 @@ void visExpNode( vector<GridNodePtr> nodes )
     geometry_msgs::Point pt;
     for(int i = 0; i < int(nodes.size()); i++)
     {
-        Vector3d coord = nodes[i]->coord;
+        Vector3d coord = nodes[i];
         pt.x = coord(0);
         pt.y = coord(1);
         pt.z = coord(2);
@@ -0,0 +1,393 @@
+#include "polyhedron_generator.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+using namespace std;
+using namespace Eigen;
+
+// Squared distance between the segment p0 + t * d, t in [0, 1], and the cube of half size h centered at c.
+// t_min receives the parameter of the closest point of the segment.
+static double segmentBoxDistance(const Vector3d & p0, const Vector3d & d, const Vector3d & c, double h, double & t_min)
+{
+    // Outside of the box the distance along each axis is linear in t, so the squared distance is a
+    // quadratic between two consecutive times at which the segment crosses a face plane.
+    double knots[8];
+    int num = 0;
+    knots[num++] = 0.0;
+    knots[num++] = 1.0;
+    for(int i = 0; i < 3; i++)
+    {
+        if(d(i) == 0.0)
+            continue;
+
+        for(int s = -1; s <= 1; s += 2)
+        {
+            double t = (c(i) + s * h - p0(i)) / d(i);
+            if(t > 0.0 && t < 1.0)
+                knots[num++] = t;
+        }
+    }
+    sort(knots, knots + num);
+
+    double best = INFINITY;
+    t_min = 0.0;
+    for(int k = 0; k + 1 < num; k++)
+    {
+        double t_mid = 0.5 * (knots[k] + knots[k + 1]);
+        double qa = 0.0, qb = 0.0;
+        for(int i = 0; i < 3; i++)
+        {
+            double x = p0(i) + t_mid * d(i);
+            double bound;
+            if(x > c(i) + h)
+                bound = c(i) + h;
+            else if(x < c(i) - h)
+                bound = c(i) - h;
+            else
+                continue;
+
+            qa += d(i) * d(i);
+            qb += 2.0 * (p0(i) - bound) * d(i);
+        }
+
+        double t = knots[k];
+        if(qa > 0.0)
+            t = min(max(-qb / (2.0 * qa), knots[k]), knots[k + 1]);
+
+        Vector3d q = p0 + t * d;
+        double dist = (q - q.cwiseMax(c - Vector3d::Constant(h)).cwiseMin(c + Vector3d::Constant(h))).squaredNorm();
+        if(dist < best)
+        {
+            best  = dist;
+            t_min = t;
+        }
+    }
+    return best;
+}
+
+// Flags the cells in [begin, end) whose center x satisfies n.x >= thr.
+static void markOutside(const double * x, const double * y, const double * z, unsigned char * removed, int begin, int end, const Vector3d & n, double thr)
+{
+    int i = begin;
+#ifdef __AVX2__
+    const __m256d nx = _mm256_set1_pd(n(0));
+    const __m256d ny = _mm256_set1_pd(n(1));
+    const __m256d nz = _mm256_set1_pd(n(2));
+    const __m256d th = _mm256_set1_pd(thr);
+    for(; i + 4 <= end; i += 4)
+    {
+        __m256d dot = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(nx, _mm256_loadu_pd(x + i)),
+                                                  _mm256_mul_pd(ny, _mm256_loadu_pd(y + i))),
+                                                  _mm256_mul_pd(nz, _mm256_loadu_pd(z + i)));
+        int mask = _mm256_movemask_pd(_mm256_cmp_pd(dot, th, _CMP_GE_OQ));
+        removed[i    ] |=  mask       & 1;
+        removed[i + 1] |= (mask >> 1) & 1;
+        removed[i + 2] |= (mask >> 2) & 1;
+        removed[i + 3] |= (mask >> 3) & 1;
+    }
+#endif
+    for(; i < end; i++)
+        removed[i] |= (n(0) * x[i] + n(1) * y[i] + n(2) * z[i] >= thr);
+}
+
+// Resets poly to the box lo - hi, with the same vertex order as generateCube().
+static void setBoxVertex(const Vector3d & lo, const Vector3d & hi, Cube & poly)
+{
+    poly = Cube();
+    poly.vertex.row(0) = Vector3d(hi(0), lo(1), hi(2));
+    poly.vertex.row(1) = Vector3d(hi(0), hi(1), hi(2));
+    poly.vertex.row(2) = Vector3d(lo(0), hi(1), hi(2));
+    poly.vertex.row(3) = Vector3d(lo(0), lo(1), hi(2));
+    poly.vertex.row(4) = Vector3d(hi(0), lo(1), lo(2));
+    poly.vertex.row(5) = Vector3d(hi(0), hi(1), lo(2));
+    poly.vertex.row(6) = Vector3d(lo(0), hi(1), lo(2));
+    poly.vertex.row(7) = Vector3d(lo(0), lo(1), lo(2));
+    poly.setBox();
+}
+
+// Largest value of n.x over the box lo - hi.
+static double boxSupport(const Vector3d & lo, const Vector3d & hi, const Vector3d & n)
+{
+    double sup = 0.0;
+    for(int i = 0; i < 3; i++)
+        sup += n(i) * (n(i) > 0.0 ? hi(i) : lo(i));
+    return sup;
+}
+
+void polyhedronGenerator::linkMap(const sdf_tools::DynamicSpatialHashedCollisionMapGrid * global_map)
+{
+    map = global_map;
+    resolution = map->GetResolution();
+}
+
+void polyhedronGenerator::setParam(double poly_range, double max_length)
+{
+    range     = poly_range;
+    maxLength = max_length;
+}
+
+void polyhedronGenerator::boxIndexRange(const Vector3d & lo, const Vector3d & hi, Vector3i & idx_lo, Vector3i & idx_hi) const
+{
+    idx_lo = map->LocationToGridIndex(lo);
+    idx_hi = map->LocationToGridIndex(hi);
+}
+
+bool polyhedronGenerator::isSegmentClear(const Vector3d & p0, const Vector3d & p1, double clearance) const
+{
+    Vector3i idx_lo, idx_hi;
+    boxIndexRange(p0.cwiseMin(p1) - Vector3d::Constant(clearance), p0.cwiseMax(p1) + Vector3d::Constant(clearance), idx_lo, idx_hi);
+
+    Vector3d d = p1 - p0;
+    double clearance_sq = clearance * clearance;
+    double t;
+    for(int x = idx_lo(0); x <= idx_hi(0); x++)
+        for(int y = idx_lo(1); y <= idx_hi(1); y++)
+            for(int z = idx_lo(2); z <= idx_hi(2); z++)
+            {
+                if(map->Get((int64_t)x, (int64_t)y, (int64_t)z).first.occupancy <= 0.5)
+                    continue;
+
+                Vector3d center = map->GridIndexToLocation(Vector3i(x, y, z));
+                if(segmentBoxDistance(p0, d, center, resolution / 2.0, t) < clearance_sq)
+                    return false;
+            }
+
+    return true;
+}
+
+void polyhedronGenerator::gatherObstacles(const Vector3i & idx_lo, const Vector3i & idx_hi, const Vector3d & p0, const Vector3d & p1)
+{
+    Vector3d d = p1 - p0;
+    double t;
+    obsOrder.clear();
+    for(int x = idx_lo(0); x <= idx_hi(0); x++)
+        for(int y = idx_lo(1); y <= idx_hi(1); y++)
+            for(int z = idx_lo(2); z <= idx_hi(2); z++)
+            {
+                if(map->Get((int64_t)x, (int64_t)y, (int64_t)z).first.occupancy <= 0.5)
+                    continue;
+
+                Vector3d center = map->GridIndexToLocation(Vector3i(x, y, z));
+                int cell = ((x - idx_lo(0)) * (idx_hi(1) - idx_lo(1) + 1) + (y - idx_lo(1))) * (idx_hi(2) - idx_lo(2) + 1) + (z - idx_lo(2));
+                obsOrder.push_back(make_pair(segmentBoxDistance(p0, d, center, resolution / 2.0, t), cell));
+            }
+    sort(obsOrder.begin(), obsOrder.end());
+
+    int num = obsOrder.size();
+    int size_y = idx_hi(1) - idx_lo(1) + 1;
+    int size_z = idx_hi(2) - idx_lo(2) + 1;
+    obsX.resize(num);
+    obsY.resize(num);
+    obsZ.resize(num);
+    obsDist.resize(num);
+    obsRemoved.assign(num, 0);
+    for(int k = 0; k < num; k++)
+    {
+        int cell = obsOrder[k].second;
+        Vector3i index(idx_lo(0) + cell / (size_y * size_z), idx_lo(1) + (cell / size_z) % size_y, idx_lo(2) + cell % size_z);
+        Vector3d center = map->GridIndexToLocation(index);
+        obsX[k]    = center(0);
+        obsY[k]    = center(1);
+        obsZ[k]    = center(2);
+        obsDist[k] = obsOrder[k].first;
+    }
+}
+
+bool polyhedronGenerator::generatePolyhedron(const Vector3d & p0, const Vector3d & p1, Cube & poly)
+{
+    Vector3i idx_lo, idx_hi;
+    boxIndexRange(p0.cwiseMin(p1) - Vector3d::Constant(range), p0.cwiseMax(p1) + Vector3d::Constant(range), idx_lo, idx_hi);
+    gatherObstacles(idx_lo, idx_hi, p0, p1);
+
+    double half = resolution / 2.0;
+    Vector3d lo = map->GridIndexToLocation(idx_lo) - Vector3d::Constant(half);
+    Vector3d hi = map->GridIndexToLocation(idx_hi) + Vector3d::Constant(half);
+
+    setBoxVertex(lo, hi, poly);
+    poly.center = p0;
+
+    Vector3d d = p1 - p0;
+    vector<Vector4d, aligned_allocator<Vector4d> > planes;
+    int num = obsX.size();
+    for(int k = 0; k < num; k++)
+    {
+        if(obsRemoved[k])
+            continue;
+
+        if(obsDist[k] < 1e-12)
+            return false;
+
+        // The closest points q of the segment and o of the cell give the plane that separates them,
+        // moved to the face, edge or corner of the cell it touches.
+        Vector3d c(obsX[k], obsY[k], obsZ[k]);
+        double t;
+        segmentBoxDistance(p0, d, c, half, t);
+        Vector3d q = p0 + t * d;
+        Vector3d o = q.cwiseMax(c - Vector3d::Constant(half)).cwiseMin(c + Vector3d::Constant(half));
+        Vector3d n = (o - q).normalized();
+        double b = n.dot(c) - half * n.cwiseAbs().sum();
+
+        // Planes that do not cut the box are left out of the QP
+        if(boxSupport(lo, hi, n) > b)
+            planes.push_back(Vector4d(n(0), n(1), n(2), b));
+
+        // Every cell whose center is beyond the one of this cell lies entirely outside of the plane
+        markOutside(obsX.data(), obsY.data(), obsZ.data(), obsRemoved.data(), k + 1, num, n, n.dot(c));
+    }
+
+    poly.hplane.resize(planes.size(), 4);
+    for(int i = 0; i < (int)planes.size(); i++)
+        poly.hplane.row(i) = planes[i];
+
+    return true;
+}
+
+bool polyhedronGenerator::segmentPolyhedron(const vector<VoxelGrid::GRID_INDEX> & segment, const Vector3d & origin, double cell_size, Cube & poly)
+{
+    if(segment.empty())
+        return false;
+
+    double half = cell_size / 2.0;
+    vector<Vector3d> centers(segment.size());
+    Vector3d lo = Vector3d::Constant(numeric_limits<double>::infinity());
+    Vector3d hi = -lo;
+    for(int k = 0; k < (int)segment.size(); k++)
+    {
+        centers[k] = origin + (Vector3d(segment[k].x, segment[k].y, segment[k].z) + Vector3d::Constant(0.5)) * cell_size;
+        lo = lo.cwiseMin(centers[k]);
+        hi = hi.cwiseMax(centers[k]);
+    }
+    lo -= Vector3d::Constant(half);
+    hi += Vector3d::Constant(half);
+
+    setBoxVertex(lo, hi, poly);
+    poly.center = centers[0];
+
+    // Supporting planes of the cells along the 12 edge and 8 corner diagonals, those that cut the box
+    vector<Vector4d, aligned_allocator<Vector4d> > planes;
+    for(int dx = -1; dx <= 1; dx++)
+        for(int dy = -1; dy <= 1; dy++)
+            for(int dz = -1; dz <= 1; dz++)
+            {
+                if(abs(dx) + abs(dy) + abs(dz) < 2)
+                    continue;
+
+                Vector3d n = Vector3d(dx, dy, dz).normalized();
+                double b = -numeric_limits<double>::infinity();
+                for(int k = 0; k < (int)centers.size(); k++)
+                    b = max(b, n.dot(centers[k]));
+                b += half * n.cwiseAbs().sum();
+
+                if(boxSupport(lo, hi, n) > b + 1e-9)
+                    planes.push_back(Vector4d(n(0), n(1), n(2), b));
+            }
+
+    poly.hplane.resize(planes.size(), 4);
+    for(int i = 0; i < (int)planes.size(); i++)
+        poly.hplane.row(i) = planes[i];
+
+    return true;
+}
+
+bool polyhedronGenerator::detourStep(const Vector3d & p0, const Vector3d & p1, vector<Vector3d> & detour) const
+{
+    Vector3i idx0 = map->LocationToGridIndex(p0);
+    Vector3i idx1 = map->LocationToGridIndex(p1);
+    Vector3i diff = idx1 - idx0;
+    if(diff.cwiseAbs().maxCoeff() > 1)
+        return false;
+
+    // Try the orders of the axes until all the cells in between are free
+    int axes[3] = {0, 1, 2};
+    do
+    {
+        Vector3i index = idx0;
+        bool blocked = false;
+        detour.clear();
+        for(int i = 0; i < 3 && !blocked; i++)
+        {
+            int axis = axes[i];
+            if(diff(axis) == 0)
+                continue;
+
+            index(axis) += diff(axis);
+            if(index == idx1)
+                break;
+
+            if(map->Get((int64_t)index(0), (int64_t)index(1), (int64_t)index(2)).first.occupancy > 0.5)
+                blocked = true;
+            else
+                detour.push_back(map->GridIndexToLocation(index));
+        }
+
+        if(!blocked && !detour.empty())
+            return true;
+    }
+    while(next_permutation(axes, axes + 3));
+
+    return false;
+}
+
+bool polyhedronGenerator::generateCorridor(const vector<Vector3d> & path, double margin, vector<Cube> & corridor, vector<double> & seeds)
+{
+    corridor.clear();
+    seeds.clear();
+
+    int num = path.size();
+    if(num < 2)
+        return false;
+
+    // A diagonal step of the path may cut an edge or a corner of an obstacle cell, which no plane can
+    // separate from it. It is replaced by moves along one axis at a time through free cells.
+    vector<Vector3d> pts;
+    vector<double> pos;
+    vector<Vector3d> detour;
+    pts.push_back(path[0]);
+    pos.push_back(0.0);
+    for(int i = 0; i < num - 1; i++)
+    {
+        if(!isSegmentClear(path[i], path[i + 1], 1e-6))
+        {
+            if(!detourStep(path[i], path[i + 1], detour))
+                return false;
+
+            for(int k = 0; k < (int)detour.size(); k++)
+            {
+                pts.push_back(detour[k]);
+                pos.push_back(i + (k + 1.0) / (detour.size() + 1.0));
+            }
+        }
+        pts.push_back(path[i + 1]);
+        pos.push_back(i + 1.0);
+    }
+
+    // Joints between two polyhedra lie on the path, so the segments keep the margin of the QP to
+    // the obstacles. A single step can not be shortened, it only has to be off the obstacles.
+    num = pts.size();
+    double clearance = max(margin, 1e-6);
+    int i = 0;
+    while(i < num - 1)
+    {
+        if(!isSegmentClear(pts[i], pts[i + 1], 1e-6))
+            return false;
+
+        int j = i + 1;
+        while(j + 1 < num && (pts[j + 1] - pts[i]).norm() <= maxLength && isSegmentClear(pts[i], pts[j + 1], clearance))
+            j++;
+
+        Cube poly;
+        if(!generatePolyhedron(pts[i], pts[j], poly))
+            return false;
+
+        corridor.push_back(poly);
+        seeds.push_back(pos[i]);
+        i = j;
+    }
+
+    return true;
+}
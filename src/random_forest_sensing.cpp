@@ -13,6 +13,7 @@
 #include <Eigen/Eigen>
 #include <math.h>
 #include <random>
+#include <sdf_tools/collision_map_delta.hpp>
 
 using namespace std;
 
@@ -29,6 +30,7 @@ uniform_real_distribution<double>  rand_h;
 
 ros::Publisher _local_map_pub;
 ros::Publisher _all_map_pub;
+ros::Publisher _map_delta_pub;
 ros::Subscriber _odom_sub;
 
 vector<double> _state;
@@ -41,6 +43,12 @@ double _z_limit, _sensing_range, _resolution, _sense_rate, _init_x, _init_y;
 bool _map_ok = false;
 bool _has_odom = false;
 
+// occupancy changes of the sensed points, streamed as chunked deltas
+bool _is_pub_delta;
+int _chunk_size, _keyframe_period;
+int _delta_frames = 0;
+sdf_tools::CollisionMapDeltaEncoder _delta_encoder;
+
 sensor_msgs::PointCloud2 localMap_pcd;
 sensor_msgs::PointCloud2 globalMap_pcd;
 pcl::PointCloud<pcl::PointXYZ> cloudMap;
@@ -109,6 +117,23 @@ void rcvOdometryCallbck(const nav_msgs::Odometry odom)
       };
 }
 
+void pubMapDelta()
+{
+      _delta_encoder.BeginFrame();
+      for (size_t i = 0; i < pointIdxRadiusSearch.size (); ++i)
+      {
+         pcl::PointXYZ pt = cloudMap.points[pointIdxRadiusSearch[i]];
+         _delta_encoder.MarkOccupied(Eigen::Vector3d(pt.x, pt.y, pt.z));
+      }
+
+      // a keyframe now and then lets a planner that joins late, or missed a delta, catch up
+      sdf_tools::CollisionMapDelta delta = _delta_encoder.EndFrame(_delta_frames % _keyframe_period == 0);
+      _delta_frames ++;
+
+      delta.header.frame_id = "world";
+      _map_delta_pub.publish(delta);
+}
+
 int i = 0;
 void pubSensedPoints()
 {     
@@ -134,7 +159,13 @@ void pubSensedPoints()
       if(isnan(searchPoint.x) || isnan(searchPoint.y) || isnan(searchPoint.z))
          return;
 
-      if ( kdtreeLocalMap.radiusSearch (searchPoint, _sensing_range, pointIdxRadiusSearch, pointRadiusSquaredDistance) > 0 )
+      int pointNum = kdtreeLocalMap.radiusSearch (searchPoint, _sensing_range, pointIdxRadiusSearch, pointRadiusSquaredDistance);
+
+      // an empty frame is sent too, it frees what the previous one occupied
+      if(_is_pub_delta)
+         pubMapDelta();
+
+      if ( pointNum > 0 )
       {
          for (size_t i = 0; i < pointIdxRadiusSearch.size (); ++i)
          {  
@@ -164,6 +195,7 @@ int main (int argc, char** argv) {
 
       _local_map_pub = n.advertise<sensor_msgs::PointCloud2>("random_forest", 1);                      
       _all_map_pub   = n.advertise<sensor_msgs::PointCloud2>("all_map", 1);                      
+      _map_delta_pub = n.advertise<sdf_tools::CollisionMapDelta>("map_delta", 10);
       
       _odom_sub = n.subscribe( "odometry", 50, rcvOdometryCallbck );
 
@@ -182,7 +214,11 @@ int main (int argc, char** argv) {
       n.param("ObstacleShape/upper_hei", _h_h,   7.0);
       
       n.param("sensing/radius", _sensing_range, 10.0);
-      n.param("sensing/radius", _sense_rate, 10.0);
+      n.param("sensing/rate",   _sense_rate, 10.0);
+
+      n.param("sensing/is_pub_delta",    _is_pub_delta,    false);
+      n.param("sensing/chunk_size",      _chunk_size,      16);
+      n.param("sensing/keyframe_period", _keyframe_period, 50);
       
       _x_l = - _x_size / 2.0;
       _x_h = + _x_size / 2.0;
@@ -195,6 +231,16 @@ int main (int argc, char** argv) {
 
       RandomMapGenerate();
 
+      if(_is_pub_delta)
+      {
+         _keyframe_period = max(_keyframe_period, 1);
+         if( !_delta_encoder.Initialize(Eigen::Vector3d(_x_l, _y_l, 0.0), _resolution, _x_size, _y_size, _z_size, _chunk_size) )
+         {
+            ROS_ERROR("[Map server] Invalid map delta chunk size %d", _chunk_size);
+            _is_pub_delta = false;
+         }
+      }
+
       ros::Rate loop_rate(_sense_rate);
       
       while (ros::ok())
@@ -48,7 +48,12 @@ int TrajectoryGenerator::BezierPloyCoeffGeneration(
     if( !ENFORCE_ACC )
         acc_con_num = 0;
 
-    int high_order_con_num = vel_con_num + acc_con_num; 
+    // The half-spaces of a polyhedral segment bound each of its control points
+    int poly_con_num = 0;
+    for(int k = 0; k < segment_num; k++)
+        poly_con_num += corridor[k].hplane.rows() * n_poly;
+
+    int high_order_con_num = vel_con_num + acc_con_num + poly_con_num; 
     //int high_order_con_num = 0; //3 * traj_order * segment_num;
 
     int con_num   = equ_con_num + high_order_con_num;
@@ -80,6 +85,26 @@ int TrajectoryGenerator::BezierPloyCoeffGeneration(
         }
     }
 
+    /***  Stack the bounding value for the half-spaces of the polyhedral segments  ***/
+    for(int k = 0; k < segment_num; k++)
+    {
+        double scale_k = corridor[k].t;
+        for(int p = 0; p < corridor[k].hplane.rows(); p++)
+        {
+            double up_bound;
+            if(k > 0)
+                up_bound = (corridor[k].hplane(p, 3) - margin) / scale_k;
+            else
+                up_bound = (corridor[k].hplane(p, 3)) / scale_k;
+
+            for(int j = 0; j < n_poly; j++)
+            {
+                pair<MSKboundkeye, pair<double, double> > cb_ie = make_pair( MSK_BK_UP, make_pair( - MSK_INFINITY, up_bound ) );
+                con_bdk.push_back(cb_ie);
+            }
+        }
+    }
+
     //ROS_WARN("[Bezier Trajectory] equality bound %d", equ_con_num);
     for(int i = 0; i < equ_con_num; i ++ ){ 
         double beq_i;
@@ -233,6 +258,29 @@ int TrajectoryGenerator::BezierPloyCoeffGeneration(
             }
         }
     }
+
+    // The half-space constraints, a.x <= b on every control point of a polyhedral segment
+    for(int k = 0; k < segment_num; k ++ )
+    {
+        for(int p = 0; p < corridor[k].hplane.rows(); p++)
+        {
+            for(int j = 0; j < n_poly; j++)
+            {
+                int nzi = 3;
+                MSKint32t asub[nzi];
+                double aval[nzi];
+
+                for(int i = 0; i < 3; i++)
+                {
+                    aval[i] = corridor[k].hplane(p, i);
+                    asub[i] = k * s1CtrlP_num + i * s1d1CtrlP_num + j;
+                }
+
+                r = MSK_putarow(task, row_idx, nzi, asub, aval);    
+                row_idx ++;
+            }
+        }
+    }
     /*   Start position  */
     {
         // position :
@@ -37,6 +37,7 @@
 #include "../fmm/fsm.hpp"
 #include "../fmm/lsm.hpp"
 #include "../fmm/ddqm.hpp"
+#include "../fmm/bfmm.hpp"
 
 /// \todo the getter functions do not check if the types are admissible.
 /// \todo does not have support for multiple starts or goals.
@@ -61,7 +62,7 @@ class BenchmarkCFG {
         {
             static const std::vector<std::string> knownSolvers = {
                 "fmm", "fmmstar", "fmmfib", "fmmfibstar", "sfmm", "sfmmstar",
-                "gmm", "fim", "ufmm", "fsm", "lsm", "ddqm" // Add solver here.
+                "gmm", "fim", "ufmm", "fsm", "lsm", "ddqm", "bfmm" // Add solver here.
             };
 
             std::fstream cfg(filename);
@@ -169,6 +170,8 @@ class BenchmarkCFG {
                         solver = new LSM<grid_t>();
                     else if (name == "ddqm")
                         solver = new DDQM<grid_t>();
+                    else if (name == "bfmm")
+                        solver = new BFMM<grid_t>();
                     // Add solver here.
 
                     else
@@ -257,6 +260,17 @@ class BenchmarkCFG {
                     else if (name == "ddqm") {
                         solver = new LSM<grid_t>(p[0].c_str());
                     }
+                    // BFMM
+                    else if (name == "bfmm") {
+                        if (p.size() == 1)
+                            solver = new BFMM<grid_t>(p[0].c_str());
+                        else if (p.size() == 2) {
+                            if (p[1] == "TIME")
+                                solver = new BFMM<grid_t>(p[0].c_str(), TIME);
+                            else if (p[1] == "DISTANCE")
+                                solver = new BFMM<grid_t>(p[0].c_str(), DISTANCE);
+                        }
+                    }
                     // Add solver here.
 
                     else
@@ -0,0 +1,276 @@
+/* Replanning benchmark of DFMM, set up as the planner runs it. The wave starts at the target, in one
+   corner of a 3D grid with columns of obstacles (trees), and the goal point is the robot, which
+   starts in the opposite corner and moves a few cells towards the target between replans. Before
+   every replan, columns are removed and as many are added within the sensor range of the robot.
+   As in the planner, velocities ramp up to the maximum within 1 m of the obstacles, so a change
+   modifies the cells around the column too.
+
+   On every replan the cached DFMM field is repaired and compared with two fresh solves of the
+   modified grid, both stopped once the goal is frozen:
+
+   - FMM without heuristic. Every cell it freezes has to have the same arrival time in the
+     repaired field, up to a relative difference of 1e-5: the times of FMM depend slightly on
+     the order of the updates. The program fails otherwise.
+   - FMM* with the TIME heuristic, which is the default solver of the planner. Its time and its
+     arrival time at the goal are reported next to the repair.
+
+   With a cell budget, every compute() of DFMM freezes at most that many cells, and it is called
+   again until the goal is reached, as the planner does over successive replans. The longest call
+   is reported next to the total.
+
+   Usage: ./dfmmbenchmark [replans] [grid side] [obstacle density] [columns changed per replan] [cell budget] */
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <array>
+#include <algorithm>
+#include <random>
+#include <chrono>
+#include <string>
+#include <cmath>
+#include <limits>
+
+#include <fast_methods/ndgridmap/ndgridmap.hpp>
+#include <fast_methods/fm/fmdata/fmcell.h>
+#include <fast_methods/fm/fmm.hpp>
+#include <fast_methods/fm/fmmstar.hpp>
+#include <fast_methods/fm/dfmm.hpp>
+
+typedef nDGridMap<FMCell, 3> FMGrid3D;
+typedef std::array<unsigned int, 3> Column; // x, y, radius in cells
+
+const double max_vel  = 1.5;
+const double leafsize = 0.2;
+
+double elapsedMs
+(const std::chrono::steady_clock::time_point & start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+/** \brief Speed at distance d (m) from the closest obstacle, as velMapping() in the planner. */
+double velMapping
+(double d) {
+    double vel;
+    if (d <= 0.25)
+        vel = 2.0 * d * d;
+    else if (d <= 0.75)
+        vel = 1.5 * d - 0.25;
+    else if (d <= 1.0)
+        vel = - 2.0 * (d - 1.0) * (d - 1.0) + 1;
+    else
+        vel = 1.0;
+    return vel * max_vel;
+}
+
+/** \brief Velocities of the grid: the columns and the border of the grid are obstacles, the speed
+    ramps up with the horizontal distance to the closest column. */
+void computeVelocities
+(const std::array<unsigned int, 3> & dims, const std::vector<Column> & columns, const std::vector<unsigned int> & free_cells, std::vector<double> & vel) {
+    const int ramp = int(std::ceil(1.0 / leafsize));
+    std::vector<double> dist(dims[0] * dims[1], std::numeric_limits<double>::infinity());
+    for (const Column & c : columns)
+        for (int y = int(c[1]) - int(c[2]) - ramp; y <= int(c[1] + c[2]) + ramp; ++y)
+            for (int x = int(c[0]) - int(c[2]) - ramp; x <= int(c[0] + c[2]) + ramp; ++x) {
+                if (x < 0 || y < 0 || x >= int(dims[0]) || y >= int(dims[1]))
+                    continue;
+                const int dx = std::max(0, std::abs(x - int(c[0])) - int(c[2]));
+                const int dy = std::max(0, std::abs(y - int(c[1])) - int(c[2]));
+                double & d = dist[x + y * dims[0]];
+                d = std::min(d, leafsize * std::sqrt(double(dx * dx + dy * dy)));
+            }
+
+    vel.resize(dims[0] * dims[1] * dims[2]);
+    for (unsigned int z = 0; z < dims[2]; ++z)
+        for (unsigned int y = 0; y < dims[1]; ++y)
+            for (unsigned int x = 0; x < dims[0]; ++x) {
+                const unsigned int i = x + y * dims[0] + z * dims[0] * dims[1];
+                if (x == 0 || y == 0 || z == 0 || x == dims[0] - 1 || y == dims[1] - 1 || z == dims[2] - 1)
+                    vel[i] = 0;
+                else
+                    vel[i] = velMapping(dist[x + y * dims[0]]);
+            }
+    for (unsigned int i : free_cells)
+        vel[i] = max_vel;
+}
+
+double mean
+(const std::vector<double> & v) {
+    double sum = 0;
+    for (double x : v)
+        sum += x;
+    return v.empty() ? 0 : sum / v.size();
+}
+
+double median
+(std::vector<double> v) {
+    if (v.empty())
+        return 0;
+    std::nth_element(v.begin(), v.begin() + v.size() / 2, v.end());
+    return v[v.size() / 2];
+}
+
+void setVelocities
+(FMGrid3D & grid, const std::vector<double> & vel) {
+    std::vector<unsigned int> obs;
+    for (unsigned int i = 0; i < grid.size(); ++i) {
+        grid[i].setOccupancy(vel[i]);
+        if (grid[i].isOccupied())
+            obs.push_back(i);
+    }
+    grid.setOccupiedCells(std::move(obs));
+}
+
+/** \brief Runs DFMM until the goal is reached. Returns the total time spent, the time of the longest
+    call in longest and the number of calls in calls. */
+double solveDynamic
+(DFMM<FMGrid3D> & dfmm, double & longest, unsigned int & calls) {
+    double total = 0;
+    longest = 0;
+    calls = 0;
+    do {
+        auto start = std::chrono::steady_clock::now();
+        dfmm.compute(max_vel);
+        const double t = elapsedMs(start);
+        total += t;
+        longest = std::max(longest, t);
+        ++calls;
+    } while (!dfmm.isGoalReached() && calls < 100000);
+    return total;
+}
+
+/** \brief Solves the grid from scratch and returns the time spent. */
+double solveFresh
+(FMGrid3D & grid, const std::vector<double> & vel, Solver<FMGrid3D> & solver, unsigned int init, unsigned int goal) {
+    setVelocities(grid, vel);
+    solver.setEnvironment(&grid);
+    solver.setInitialAndGoalPoints(std::vector<unsigned int>(1, init), goal);
+    auto start = std::chrono::steady_clock::now();
+    solver.compute(max_vel);
+    return elapsedMs(start);
+}
+
+int main(int argc, const char ** argv) {
+    const unsigned int replans = argc > 1 ? std::stoul(argv[1]) : 10;
+    const unsigned int side = argc > 2 ? std::stoul(argv[2]) : 250;
+    const double density = argc > 3 ? std::stod(argv[3]) : 0.02;
+    const unsigned int churn = argc > 4 ? std::stoul(argv[4]) : 1;
+    const unsigned int budget = argc > 5 ? std::stoul(argv[5]) : 0;
+
+    const std::array<unsigned int, 3> dims = {side, side, 25};
+    const unsigned int plane = dims[0] * dims[1];
+    const unsigned int z = 12, step = 3, sensor_range = 25;
+    std::mt19937 gen(0);
+    std::uniform_int_distribution<unsigned int> rand_xy(8, side - 9), rand_r(1, 3);
+
+    const unsigned int init = 5 + 5 * dims[0] + z * plane;
+    unsigned int robot_x = side - 6, robot_y = side - 6;
+    auto robot = [&]() { return robot_x + robot_y * dims[0] + z * plane; };
+
+    // The target and the robot are kept out of the columns, as the planner forces the speed of the robot cell.
+    auto isClear = [&](const Column & c) {
+        const unsigned int margin = c[2] + 6;
+        auto near = [&](unsigned int x, unsigned int y) {
+            return x + margin >= c[0] && x <= c[0] + margin && y + margin >= c[1] && y <= c[1] + margin;
+        };
+        return !near(5, 5) && !near(robot_x, robot_y);
+    };
+
+    std::vector<Column> columns;
+    while (columns.size() < density * plane / 10) {
+        Column c = {rand_xy(gen), rand_xy(gen), rand_r(gen)};
+        if (isClear(c))
+            columns.push_back(c);
+    }
+
+    std::vector<double> vel, new_vel;
+    computeVelocities(dims, columns, {init, robot()}, vel);
+
+    FMGrid3D grid(dims, leafsize), fresh_grid(dims, leafsize), star_grid(dims, leafsize);
+    setVelocities(grid, vel);
+
+    DFMM<FMGrid3D> dfmm("DFMM");
+    dfmm.setEnvironment(&grid);
+    dfmm.setInitialAndGoalPoints(std::vector<unsigned int>(1, init), robot());
+    dfmm.setCellBudget(budget);
+    double t_longest;
+    unsigned int calls;
+    const double t_first = solveDynamic(dfmm, t_longest, calls);
+
+    std::cout << dims[0] << " x " << dims[1] << " x " << dims[2] << " cells, " << columns.size() << " columns, first DFMM solve "
+              << std::fixed << std::setprecision(2) << t_first << " ms in " << calls << " calls, longest " << t_longest << " ms\n";
+
+    std::vector<double> repair_times, fmm_times, star_times;
+    double max_rel_error = 0;
+    unsigned int mismatches = 0;
+    for (unsigned int r = 0; r < replans; ++r) {
+        // The robot moves towards the target and senses columns appear and disappear.
+        robot_x -= std::min(step, robot_x - 6);
+        robot_y -= std::min(step, robot_y - 6);
+
+        for (unsigned int n = 0; n < churn; ++n) {
+            std::vector<unsigned int> in_range;
+            for (unsigned int k = 0; k < columns.size(); ++k)
+                if (std::abs(int(columns[k][0]) - int(robot_x)) <= int(sensor_range) && std::abs(int(columns[k][1]) - int(robot_y)) <= int(sensor_range))
+                    in_range.push_back(k);
+            if (!in_range.empty())
+                columns.erase(columns.begin() + in_range[gen() % in_range.size()]);
+
+            std::uniform_int_distribution<int> rand_offset(-int(sensor_range), int(sensor_range));
+            for (unsigned int tries = 0; tries < 100; ++tries) {
+                const int x = int(robot_x) + rand_offset(gen), y = int(robot_y) + rand_offset(gen);
+                const Column c = {(unsigned int)x, (unsigned int)y, rand_r(gen)};
+                if (x >= 8 && y >= 8 && x <= int(side) - 9 && y <= int(side) - 9 && isClear(c)) {
+                    columns.push_back(c);
+                    break;
+                }
+            }
+        }
+
+        computeVelocities(dims, columns, {init, robot()}, new_vel);
+        std::vector<unsigned int> changed;
+        for (unsigned int i = 0; i < vel.size(); ++i)
+            if (new_vel[i] != vel[i])
+                changed.push_back(i);
+        vel.swap(new_vel);
+
+        setVelocities(grid, vel);
+        dfmm.setChangedCells(changed);
+        dfmm.setGoalPoint(robot());
+        const double t_repair = solveDynamic(dfmm, t_longest, calls);
+        repair_times.push_back(t_repair);
+
+        FMM<FMGrid3D> fmm("FMM");
+        const double t_fmm = solveFresh(fresh_grid, vel, fmm, init, robot());
+        fmm_times.push_back(t_fmm);
+
+        FMMStar<FMGrid3D> fmm_star("FMM*", TIME);
+        const double t_star = solveFresh(star_grid, vel, fmm_star, init, robot());
+        star_times.push_back(t_star);
+
+        unsigned int wrong = 0;
+        for (unsigned int i = 0; i < grid.size(); ++i) {
+            if (fresh_grid[i].getState() != FMState::FROZEN)
+                continue;
+            const double a = grid[i].getArrivalTime(), b = fresh_grid[i].getArrivalTime();
+            const double rel_error = std::abs(a - b) / std::max(b, 1.0);
+            if (std::isinf(a) || rel_error > 1e-5)
+                ++wrong;
+            else
+                max_rel_error = std::max(max_rel_error, rel_error);
+        }
+        mismatches += wrong;
+
+        std::cout << std::fixed << std::setprecision(2)
+                  << "\treplan " << r << ": " << changed.size() << " cells changed, repair " << t_repair << " ms in " << calls << " calls, FMM " << t_fmm
+                  << " ms, FMM* " << t_star << " ms, goal time: repaired " << std::setprecision(4) << grid[robot()].getArrivalTime()
+                  << ", FMM " << fresh_grid[robot()].getArrivalTime() << ", FMM* " << star_grid[robot()].getArrivalTime()
+                  << ", cells with a different time: " << wrong << '\n';
+    }
+    std::cout << std::fixed << std::setprecision(2) << "\tper replan, mean / median: repair " << mean(repair_times) << " / " << median(repair_times)
+              << " ms, FMM " << mean(fmm_times) << " / " << median(fmm_times) << " ms, FMM* " << mean(star_times) << " / " << median(star_times)
+              << " ms, max relative difference " << std::scientific << max_rel_error << '\n';
+
+    std::cout << (mismatches == 0 ? "Repaired fields match fresh solves" : "Repaired fields DIFFER from fresh solves") << std::endl;
+    return mismatches == 0 ? 0 : 1;
+}
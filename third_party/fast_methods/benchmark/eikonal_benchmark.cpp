@@ -0,0 +1,128 @@
+/* Microbenchmark of the 3D Eikonal update: updates per second of the generic solver
+   (std::vector + std::sort, as EikonalSolver does for any number of dimensions), the
+   fixed-size EikonalKernels::solve3D() and the batched EikonalKernels::solve3DBatch().
+
+   Usage: ./eikonalbenchmark [number of updates] [repetitions] */
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <algorithm>
+#include <random>
+#include <chrono>
+#include <string>
+#include <cmath>
+#include <limits>
+
+#include <fast_methods/fm/eikonalkernels.hpp>
+
+/** \brief Same computation as EikonalSolver::solveEikonal() and solveEikonalNDims(). */
+double solveGeneric
+(const double * T, double hf, std::vector<double> & Tvalues) {
+    Tvalues.clear();
+    for (unsigned int dim = 0; dim < 3; ++dim)
+        if (!std::isinf(T[dim]))
+            Tvalues.push_back(T[dim]);
+
+    const unsigned int a = Tvalues.size();
+    if (a == 0)
+        return std::numeric_limits<double>::infinity();
+
+    std::sort(Tvalues.begin(), Tvalues.end());
+    double updatedT = 0;
+    for (unsigned i = 1; i <= a; ++i) {
+        if (i == 1)
+            updatedT = Tvalues[0] + hf;
+        else {
+            double sumT = 0, sumTT = 0;
+            for (unsigned k = 0; k < i; ++k) {
+                sumT += Tvalues[k];
+                sumTT += Tvalues[k]*Tvalues[k];
+            }
+            const double qa = i, qb = -2*sumT, qc = sumTT - hf*hf;
+            const double quad_term = qb*qb - 4*qa*qc;
+            updatedT = quad_term < 0 ? std::numeric_limits<double>::infinity() : (-qb + std::sqrt(quad_term))/(2*qa);
+        }
+        if (i == a || (updatedT - Tvalues[i]) < utils::COMP_MARGIN)
+            break;
+    }
+    return updatedT;
+}
+
+template <class F> double timeIt
+(F f, unsigned int reps) {
+    auto start = std::chrono::steady_clock::now();
+    for (unsigned int r = 0; r < reps; ++r)
+        f();
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double>(end - start).count();
+}
+
+int main(int argc, const char ** argv) {
+    const unsigned int n = argc > 1 ? std::stoul(argv[1]) : 1 << 20;
+    const unsigned int reps = argc > 2 ? std::stoul(argv[2]) : 20;
+
+    // Neighbor times around a smooth front: close to each other so that the 1D, 2D and
+    // 3D solutions are all exercised, with some missing (infinite) neighbors.
+    std::mt19937 gen(0);
+    std::uniform_real_distribution<double> base(0, 100), noise(-1, 1), leaf(0.1, 0.3);
+    std::bernoulli_distribution missing(0.2);
+    std::vector<double> ta(n), tb(n), tc(n), hf(n);
+    for (unsigned int i = 0; i < n; ++i) {
+        const double t = base(gen);
+        hf[i] = leaf(gen);
+        ta[i] = t;
+        tb[i] = missing(gen) ? std::numeric_limits<double>::infinity() : t + noise(gen)*hf[i];
+        tc[i] = missing(gen) ? std::numeric_limits<double>::infinity() : t + noise(gen)*hf[i];
+    }
+
+    std::vector<double> ref(n), scalar(n), batch(n), Tvalues;
+    Tvalues.reserve(3);
+
+    const double t_generic = timeIt([&]() {
+        for (unsigned int i = 0; i < n; ++i) {
+            const double T[3] = {ta[i], tb[i], tc[i]};
+            ref[i] = solveGeneric(T, hf[i], Tvalues);
+        }
+    }, reps);
+
+    const double t_scalar = timeIt([&]() {
+        for (unsigned int i = 0; i < n; ++i)
+            scalar[i] = EikonalKernels::solve3D(ta[i], tb[i], tc[i], hf[i]);
+    }, reps);
+
+    // Batches of 6, as the neighbors of a cell in FMM, and of the whole array.
+    const double t_batch6 = timeIt([&]() {
+        for (unsigned int i = 0; i < n; i += 6)
+            EikonalKernels::solve3DBatch(&ta[i], &tb[i], &tc[i], &hf[i], &batch[i], std::min(6u, n - i));
+    }, reps);
+
+    const double t_batch = timeIt([&]() {
+        EikonalKernels::solve3DBatch(ta.data(), tb.data(), tc.data(), hf.data(), batch.data(), n);
+    }, reps);
+
+    double max_err = 0;
+    for (unsigned int i = 0; i < n; ++i) {
+        if (std::isinf(ref[i]) != std::isinf(scalar[i]) || std::isinf(ref[i]) != std::isinf(batch[i]))
+            max_err = std::numeric_limits<double>::infinity();
+        else if (!std::isinf(ref[i]))
+            max_err = std::max(max_err, std::max(std::abs(ref[i] - scalar[i]), std::abs(ref[i] - batch[i])));
+    }
+
+#ifdef __AVX2__
+    const std::string simd = "AVX2";
+#else
+    const std::string simd = "scalar fallback";
+#endif
+
+    const double updates = double(n) * reps;
+    std::cout << std::fixed << std::setprecision(1)
+              << "Eikonal 3D updates: " << n << " x " << reps << " runs, batch kernel: " << simd << '\n'
+              << "\tgeneric (vector + sort): " << updates / t_generic * 1e-6 << " Mupdates/s\n"
+              << "\tsolve3D:                 " << updates / t_scalar  * 1e-6 << " Mupdates/s\n"
+              << "\tsolve3DBatch (6):        " << updates / t_batch6  * 1e-6 << " Mupdates/s\n"
+              << "\tsolve3DBatch (all):      " << updates / t_batch   * 1e-6 << " Mupdates/s\n"
+              << std::scientific << std::setprecision(2)
+              << "\tmax difference with generic: " << max_err << '\n';
+    return 0;
+}
@@ -94,6 +94,12 @@ template <class cell_t = FMCell> class FMDaryHeap {
             return heap_.empty();
         }
 
+        /** \brief Returns the element with lowest value without removing it from the heap. */
+        const cell_t * top
+        () const {
+            return heap_.top();
+        }
+
     protected:
         /** \brief The actual heap for cell_t. */
         d_ary_heap_t heap_;  /*!< The actual heap for cell_t. */
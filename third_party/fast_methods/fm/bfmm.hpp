@@ -0,0 +1,438 @@
+/*! \class BFMM
+    \brief Bidirectional Fast Marching Method for start-goal queries.
+
+    It uses as a main container the nDGridMap class. The nDGridMap type T
+    has to be an FMCell or something inherited from it.
+
+    Two waves are propagated at the same time: the forward wave grows from the initial
+    points and stores its arrival times in the grid as FMM does, the backward wave grows
+    from the goal point and stores its arrival times in an internal vector. Both narrow
+    bands are FMDaryHeap, and each iteration advances the wave whose next cell has the
+    lowest key. Every cell reached by both waves is a meeting candidate of cost C = Tf + Tb,
+    and the propagation stops once the sum of the lowest keys of both bands is no lower than
+    the best C found, as in bidirectional Dijkstra. For long queries in open space, each wave
+    only covers about half of the distance.
+
+    Once the waves meet with total cost C, the backward field is descended from the meeting
+    cell down to the goal and C - Tb is written in the grid along that descent. Hence,
+    GradientDescent::gradient_descent() from the goal point follows the stitched path
+    through the meeting cell and then the forward field down to the initial points. The
+    rest of the cells frozen only by the backward wave are left with infinite value.
+
+    If heuristics are enabled, both waves use the same heuristic, half the difference of
+    the distances to the goal and to the initial point: the forward wave adds it to its
+    keys and the backward wave subtracts it. The sum of the two keys of a cell is then its
+    cost C, so the stop rule above still holds, and each wave is guided towards the other
+    one. This heuristic is half as strong as the one of FMM*, so BFMM freezes more cells
+    than FMM* but stops at a bounded cost instead of at the first time the goal is frozen.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef BFMM_HPP_
+#define BFMM_HPP_
+
+#include <iostream>
+#include <cmath>
+#include <algorithm>
+#include <array>
+#include <vector>
+
+#include <fast_methods/fm/fmm.hpp>
+
+#include <fast_methods/ndgridmap/fmcell.h>
+#include <fast_methods/datastructures/fmdaryheap.hpp>
+
+#include <fast_methods/ndgridmap/ndgridmap.hpp>
+#include <fast_methods/console/console.h>
+
+/** \brief Backward wave state of a cell, with the interface FMDaryHeap requires. */
+struct BackwardCell {
+    BackwardCell() : time(std::numeric_limits<double>::infinity()), hValue(0), index(0), frozen(false) {}
+
+    inline unsigned int getIndex() const    {return index;}
+    inline double getTotalValue() const     {return time + hValue;}
+
+    double          time;
+    double          hValue;
+    unsigned int    index;
+    bool            frozen;
+};
+
+template < class grid_t, class heap_t = FMDaryHeap<FMCell> >  class BFMM : public EikonalSolver<grid_t> {
+
+    /** \brief Shorthand for coordinates. */
+    typedef std::array<unsigned int, grid_t::getNDims()> Coord;
+
+    public:
+        BFMM(HeurStrategy h = NOHEUR) : EikonalSolver<grid_t>("BFMM"), heurStrategy_(h), max_v_(1.0), meet_idx_(-1), meet_cost_(0), frozen_(0) {}
+
+        BFMM(const char * name, HeurStrategy h = NOHEUR) : EikonalSolver<grid_t>(name), heurStrategy_(h), max_v_(1.0), meet_idx_(-1), meet_cost_(0), frozen_(0) {}
+
+        virtual ~BFMM() { clear(); }
+
+        /** \brief Executes EikonalSolver setup and allocates the backward wave. */
+        virtual int setup
+        () {
+            int ret = EikonalSolver<grid_t>::setup();
+            if (ret == -1)
+                return ret;
+
+            if (int(goal_idx_) == -1) {
+                console::error("BFMM: a goal point is required.");
+                return -1;
+            }
+
+            narrow_band_.setMaxSize(grid_->size());
+            back_band_.setMaxSize(grid_->size());
+            back_cells_.assign(grid_->size(), BackwardCell());
+            for (unsigned int i = 0; i < back_cells_.size(); ++i)
+                back_cells_[i].index = i;
+
+            to_goal_.setTarget(grid_, goal_idx_);
+            to_init_.setTarget(grid_, init_points_[0]);
+            return ret;
+        }
+
+        /** \brief Propagates both waves until they meet and stitches the path field. */
+        virtual int computeInternal(double max_v)
+        {
+            if (!setup_)
+                if(setup() == -1)
+                    return -1;
+
+            max_v_     = max_v;
+            meet_idx_  = -1;
+            meet_cost_ = std::numeric_limits<double>::infinity();
+            frozen_    = 0;
+
+            for (unsigned int &i: init_points_)
+            {
+                grid_->getCell(i).setArrivalTime(0);
+                grid_->getCell(i).setHeuristicTime(heuristic(i));
+                narrow_band_.push( &(grid_->getCell(i)) );
+            }
+
+            back_cells_[goal_idx_].time = 0;
+            back_cells_[goal_idx_].hValue = -heuristic(goal_idx_);
+            back_band_.push( &back_cells_[goal_idx_] );
+            updateMeeting(goal_idx_);
+
+            while (true)
+            {
+                const double forward_key  = narrow_band_.empty() ? std::numeric_limits<double>::infinity() : narrow_band_.top()->getTotalValue();
+                const double backward_key = back_band_.empty() ? std::numeric_limits<double>::infinity() : back_band_.top()->getTotalValue();
+                if (forward_key + backward_key >= meet_cost_)
+                    break;
+
+                if (forward_key <= backward_key)
+                    forwardStep();
+                else
+                    backwardStep();
+            }
+
+            if (int(meet_idx_) != -1)
+                stitch();
+
+            return 1;
+        }
+
+        /** \brief Returns heuristics flag. */
+        HeurStrategy getHeuristics
+        () const {
+            return heurStrategy_;
+        }
+
+        /** \brief Returns the index of the cell where the waves met, -1 if they did not. */
+        unsigned int getMeetingPoint
+        () const {
+            return meet_idx_;
+        }
+
+        /** \brief Returns the number of cells frozen by both waves in the last run. */
+        size_t getFrozenCells
+        () const {
+            return frozen_;
+        }
+
+        /** \brief Returns the cost of the path through the meeting point, infinite if the waves did not meet. */
+        double getMeetingCost
+        () const {
+            return meet_cost_;
+        }
+
+        virtual void clear
+        () {
+            narrow_band_.clear();
+            back_band_.clear();
+            back_cells_.clear();
+        }
+
+        virtual void reset
+        () {
+            EikonalSolver<grid_t>::reset();
+            narrow_band_.clear();
+            back_band_.clear();
+        }
+
+        virtual void printRunInfo
+        () const {
+            console::info("Bidirectional Fast Marching Method");
+            std::cout << '\t' << name_ << '\n'
+                      << '\t' << "Heuristic type: " << heurStrategy_ << '\n'
+                      << '\t' << "Frozen cells: " << frozen_ << '\n'
+                      << '\t' << "Elapsed time: " << time_ << " ms\n";
+        }
+
+    protected:
+        /** \brief Freezes the top cell of the forward narrow band and updates its neighbors. */
+        void forwardStep
+        () {
+            const unsigned int idxMin = narrow_band_.popMinIdx();
+            grid_->getCell(idxMin).setState(FMState::FROZEN);
+            ++frozen_;
+
+            unsigned int n_cands = 0;
+            unsigned int n_neighs = grid_->getNeighbors(idxMin, neighbors_);
+            for (unsigned int s = 0; s < n_neighs; ++s)
+            {
+                const unsigned int j = neighbors_[s];
+                if (grid_->getCell(j).getState() == FMState::FROZEN || grid_->getCell(j).isOccupied())
+                    continue;
+                candidates_[n_cands++] = j;
+            }
+            solveEikonalBatch(candidates_.data(), n_cands, candidate_times_.data());
+
+            for (unsigned int s = 0; s < n_cands; ++s)
+            {
+                const unsigned int j = candidates_[s];
+                const double new_arrival_time = candidate_times_[s];
+                if (grid_->getCell(j).getState() == FMState::NARROW)
+                {
+                    if (utils::isTimeBetterThan(new_arrival_time, grid_->getCell(j).getArrivalTime()))
+                    {
+                        grid_->getCell(j).setArrivalTime(new_arrival_time);
+                        narrow_band_.increase( &(grid_->getCell(j)) );
+                        updateMeeting(j);
+                    }
+                }
+                else
+                {
+                    grid_->getCell(j).setState(FMState::NARROW);
+                    grid_->getCell(j).setArrivalTime(new_arrival_time);
+                    grid_->getCell(j).setHeuristicTime(heuristic(j));
+                    narrow_band_.push( &(grid_->getCell(j)) );
+                    updateMeeting(j);
+                }
+            }
+        }
+
+        /** \brief Freezes the top cell of the backward narrow band and updates its neighbors. */
+        void backwardStep
+        () {
+            const unsigned int idxMin = back_band_.popMinIdx();
+            back_cells_[idxMin].frozen = true;
+            ++frozen_;
+
+            unsigned int n_neighs = grid_->getNeighbors(idxMin, neighbors_);
+            for (unsigned int s = 0; s < n_neighs; ++s)
+            {
+                const unsigned int j = neighbors_[s];
+                BackwardCell & c = back_cells_[j];
+                if (c.frozen || grid_->getCell(j).isOccupied())
+                    continue;
+
+                const double new_arrival_time = solveBackward(j);
+                if (std::isinf(c.time))
+                {
+                    c.time = new_arrival_time;
+                    c.hValue = -heuristic(j);
+                    back_band_.push(&c);
+                    updateMeeting(j);
+                }
+                else if (utils::isTimeBetterThan(new_arrival_time, c.time))
+                {
+                    c.time = new_arrival_time;
+                    back_band_.increase(&c);
+                    updateMeeting(j);
+                }
+            }
+        }
+
+        /** \brief Keeps the best cell reached by both waves. */
+        void updateMeeting
+        (unsigned int idx) {
+            const double cost = grid_->getCell(idx).getArrivalTime() + back_cells_[idx].time;
+            if (cost < meet_cost_) {
+                meet_cost_ = cost;
+                meet_idx_ = idx;
+            }
+        }
+
+        /** \brief Solves the Eikonal equation for cell idx using the backward arrival times. */
+        double solveBackward
+        (unsigned int idx) {
+            Coord coord;
+            grid_->idx2coord(idx, coord);
+
+            Tvalues_.clear();
+            unsigned int stride = 1;
+            for (unsigned int dim = 0; dim < grid_t::getNDims(); ++dim) {
+                double minTInDim = std::numeric_limits<double>::infinity();
+                if (coord[dim] > 0)
+                    minTInDim = back_cells_[idx - stride].time;
+                if (coord[dim] + 1 < grid_->getDimSizes()[dim])
+                    minTInDim = std::min(minTInDim, back_cells_[idx + stride].time);
+                if (!std::isinf(minTInDim) && minTInDim < back_cells_[idx].time)
+                    Tvalues_.push_back(minTInDim);
+                stride *= grid_->getDimSizes()[dim];
+            }
+
+            const unsigned int a = Tvalues_.size();
+            if (a == 0)
+                return std::numeric_limits<double>::infinity();
+
+            std::sort(Tvalues_.begin(), Tvalues_.end());
+            double updatedT;
+            for (unsigned i = 1; i <= a; ++i) {
+                updatedT = solveEikonalNDims(idx, i);
+                if (i == a || (updatedT - Tvalues_[i]) < utils::COMP_MARGIN)
+                    break;
+            }
+            return updatedT;
+        }
+
+        /** \brief Descends the backward field from the meeting cell to the goal, writing the
+            arrival time through the meeting cell along the way. The descent uses the same
+            neighborhood and steepest slope criterion as GradientDescent. */
+        void stitch
+        () {
+            const double total = meet_cost_;
+            const Coord & dims = grid_->getDimSizes();
+
+            unsigned int idx = meet_idx_;
+            for (size_t it = 0; back_cells_[idx].time > 0 && it < grid_->size(); ++it)
+            {
+                Coord coord;
+                grid_->idx2coord(idx, coord);
+
+                // Visit the 3^n - 1 surrounding cells.
+                std::array<int, grid_t::getNDims()> offset;
+                offset.fill(-1);
+                unsigned int best = idx;
+                double best_slope = 0;
+                bool done = false;
+                while (!done)
+                {
+                    bool inside = true, center = true;
+                    int nidx = idx, stride = 1;
+                    double dist2 = 0;
+                    for (unsigned int d = 0; d < grid_t::getNDims(); ++d) {
+                        const int c = int(coord[d]) + offset[d];
+                        inside &= c >= 0 && c < int(dims[d]);
+                        center &= offset[d] == 0;
+                        nidx += offset[d] * stride;
+                        dist2 += offset[d] * offset[d];
+                        stride *= dims[d];
+                    }
+
+                    if (inside && !center && back_cells_[nidx].frozen) {
+                        const double slope = (back_cells_[idx].time - back_cells_[nidx].time) / std::sqrt(dist2);
+                        if (slope > best_slope) {
+                            best_slope = slope;
+                            best = nidx;
+                        }
+                    }
+
+                    // Next offset, odometer-like.
+                    done = true;
+                    for (unsigned int d = 0; d < grid_t::getNDims(); ++d) {
+                        if (offset[d] < 1) {
+                            ++offset[d];
+                            done = false;
+                            break;
+                        }
+                        offset[d] = -1;
+                    }
+                }
+
+                if (best == idx)
+                    break;
+
+                // Cells frozen by the forward wave may be on the backward descent with a higher
+                // time, they are lowered so that the stitched field keeps decreasing.
+                idx = best;
+                if (grid_->getCell(idx).getArrivalTime() > total - back_cells_[idx].time) {
+                    grid_->getCell(idx).setArrivalTime(total - back_cells_[idx].time);
+                    grid_->getCell(idx).setState(FMState::FROZEN);
+                }
+            }
+        }
+
+        /** \brief Heuristic of the forward wave at cell idx, half the difference of its distances
+            to the goal and to the initial point, 0 if heuristics are disabled. The backward wave
+            uses its opposite. */
+        double heuristic
+        (unsigned int idx) {
+            return 0.5 * (to_goal_.getValue(idx, heurStrategy_, max_v_) - to_init_.getValue(idx, heurStrategy_, max_v_));
+        }
+
+        using EikonalSolver<grid_t>::grid_;
+        using EikonalSolver<grid_t>::init_points_;
+        using EikonalSolver<grid_t>::goal_idx_;
+        using EikonalSolver<grid_t>::setup_;
+        using EikonalSolver<grid_t>::name_;
+        using EikonalSolver<grid_t>::time_;
+        using EikonalSolver<grid_t>::solveEikonalBatch;
+        using EikonalSolver<grid_t>::solveEikonalNDims;
+        using EikonalSolver<grid_t>::Tvalues_;
+        using EikonalSolver<grid_t>::neighbors_;
+
+    private:
+        /** \brief Forward narrow band. */
+        heap_t                                          narrow_band_;
+
+        /** \brief Backward narrow band. */
+        FMDaryHeap<BackwardCell>                        back_band_;
+
+        /** \brief Arrival times, heuristics and frozen flags of the backward wave. */
+        std::vector<BackwardCell>                       back_cells_;
+
+        /** \brief Neighbors of the current forward cell to be updated. */
+        std::array <unsigned int, 2*grid_t::getNDims()> candidates_;
+
+        /** \brief Arrival times computed for candidates_. */
+        std::array <double, 2*grid_t::getNDims()>       candidate_times_;
+
+        /** \brief Flag to activate heuristics and corresponding strategy. */
+        HeurStrategy                                    heurStrategy_;
+
+        /** \brief Velocity used to turn heuristic distances into times. */
+        double                                          max_v_;
+
+        /** \brief Cell where both waves met. */
+        unsigned int                                    meet_idx_;
+
+        /** \brief Cost of the path through meet_idx_. */
+        double                                          meet_cost_;
+
+        /** \brief Cells frozen by both waves in the last run. */
+        size_t                                          frozen_;
+
+        /** \brief Distances to the goal, where the backward wave starts. */
+        HeuristicDistance<grid_t>                       to_goal_;
+
+        /** \brief Distances to the initial point, where the forward wave starts. */
+        HeuristicDistance<grid_t>                       to_init_;
+};
+
+#endif /* BFMM_HPP_*/
@@ -0,0 +1,487 @@
+/*! \class DFMM
+    \brief Dynamic Fast Marching Method: FMM whose arrival-time field is kept between
+    calls to compute() and repaired incrementally when velocities change.
+
+    It uses as a main container the nDGridMap class. The nDGridMap type T
+    has to be an FMCell or something inherited from it. Only FMDaryHeap is supported
+    as heap, since cells have to be moved up and down in the narrow band.
+
+    The field is propagated without heuristic, so every cell is frozen in the order of its
+    arrival time and its value does not depend on the goal point. The first call to compute()
+    runs FMM until the goal is frozen. Afterwards, the grid velocities can be modified and the
+    modified cells registered with setChangedCells(). The next compute() then repairs the field
+    in the spirit of LPA* and D* Lite:
+
+    - Raise: cells whose arrival time grew (slower or occupied cells) are invalidated together
+      with the cells whose time was solved from them, that is, the neighbors for which an
+      invalidated cell is the upwind value in its dimension. Their valid neighbors seed the
+      wave again.
+    - Lower: cells whose arrival time decreased are put back into the narrow band. Cells popped
+      with a lowered time may reopen their frozen neighbors, other cells do not need to.
+
+    Cells frozen after the goal (for instance, by a run towards an earlier, farther goal) are
+    not needed while the goal stays closer. The raise step stops at the goal time and only
+    records the lowest time it left out of date. If the wave or the goal gets there later,
+    every time from there on is discarded and propagated again.
+
+    The goal point (the start of the path) can be moved with setGoalPoint(), the propagation
+    then resumes until the new goal is frozen. Hence, replanning towards the same initial point
+    costs time proportional to the size of the change and of the goal displacement instead of
+    a full propagation.
+
+    With setCellBudget(), every compute() freezes at most that many cells and the next one
+    resumes where it stopped, so the full propagation of the first solve can be spread over
+    several calls. isGoalReached() tells whether the field at the goal is final.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef DFMM_HPP_
+#define DFMM_HPP_
+
+#include <iostream>
+#include <cmath>
+#include <algorithm>
+#include <array>
+#include <vector>
+
+#include <fast_methods/fm/fmm.hpp>
+
+#include <fast_methods/ndgridmap/fmcell.h>
+#include <fast_methods/datastructures/fmdaryheap.hpp>
+
+#include <fast_methods/ndgridmap/ndgridmap.hpp>
+#include <fast_methods/console/console.h>
+
+template < class grid_t, class heap_t = FMDaryHeap<FMCell> >  class DFMM : public EikonalSolver<grid_t> {
+
+    public:
+        DFMM() : EikonalSolver<grid_t>("DFMM"), stale_time_(std::numeric_limits<double>::infinity()), cell_budget_(0) {}
+
+        DFMM(const char * name) : EikonalSolver<grid_t>(name), stale_time_(std::numeric_limits<double>::infinity()), cell_budget_(0) {}
+
+        virtual ~DFMM() { clear(); }
+
+        /** \brief Executes EikonalSolver setup and sets maximum size for the narrow band. */
+        virtual int setup
+        () {
+            int ret = EikonalSolver<grid_t>::setup();
+            narrow_band_.setMaxSize(grid_->size());
+            marks_.assign(grid_->size(), false);
+            lowered_.assign(grid_->size(), false);
+            return ret;
+        }
+
+        /** \brief Moves the goal point keeping the arrival times computed so far. */
+        void setGoalPoint
+        (unsigned int goal_idx) {
+            goal_idx_ = goal_idx;
+        }
+
+        /** \brief Registers cells whose velocity has been modified in the grid since the last
+            compute(). They are repaired in the next compute(). */
+        void setChangedCells
+        (const std::vector<unsigned int> & changed) {
+            changed_.insert(changed_.end(), changed.begin(), changed.end());
+        }
+
+        /** \brief Sets the maximum number of cells frozen by each compute(), 0 for no limit. */
+        void setCellBudget
+        (unsigned int cells) {
+            cell_budget_ = cells;
+        }
+
+        /** \brief Returns true if an arrival-time field is available to be repaired. */
+        bool isComputed
+        () const {
+            return setup_;
+        }
+
+        /** \brief Returns true if the goal is frozen with an exact time that no cell in the
+            narrow band can improve, and no change is waiting to be repaired. The path can
+            then be extracted from the field. */
+        bool isGoalReached
+        () const {
+            if (!setup_ || !changed_.empty() || int(goal_idx_) == -1 || grid_->getCell(goal_idx_).getState() != FMState::FROZEN)
+                return false;
+
+            const double goal_time = grid_->getCell(goal_idx_).getArrivalTime();
+            return goal_time < stale_time_ && (narrow_band_.empty() || narrow_band_.top()->getArrivalTime() >= goal_time);
+        }
+
+        /** \brief Computes the field from scratch the first time and repairs it afterwards.
+            max_v is not used, the field has no heuristic. */
+        virtual int computeInternal(double)
+        {
+            if (!setup_)
+            {
+                if(setup() == -1)
+                    return -1;
+
+                changed_.clear();
+                for (unsigned int &i: init_points_)
+                {
+                    grid_->getCell(i).setArrivalTime(0);
+                    narrow_band_.push( &(grid_->getCell(i)) );
+                }
+            }
+            else
+                repair();
+
+            propagate();
+            return 1;
+        }
+
+        virtual void clear
+        () {
+            narrow_band_.clear();
+            changed_.clear();
+            stale_time_ = std::numeric_limits<double>::infinity();
+            marks_.clear();
+            lowered_.clear();
+        }
+
+        virtual void reset
+        () {
+            EikonalSolver<grid_t>::reset();
+            narrow_band_.clear();
+            changed_.clear();
+            stale_time_ = std::numeric_limits<double>::infinity();
+        }
+
+        virtual void printRunInfo
+        () const {
+            console::info("Dynamic Fast Marching Method");
+            std::cout << '\t' << name_ << '\n'
+                      << '\t' << "Elapsed time: " << time_ << " ms\n";
+        }
+
+    protected:
+        /** \brief Main FMM loop. Runs until the goal is frozen and no cell in the narrow band
+            can improve it, until the narrow band is empty or until cell_budget_ cells have been
+            popped. The field is trimmed at stale_time_ once the wave or the goal reaches it. */
+        void propagate
+        () {
+            unsigned int j = 0;
+            unsigned int n_neighs = 0;
+            unsigned int idxMin = 0;
+            unsigned int n_popped = 0;
+
+            while (!narrow_band_.empty() || !std::isinf(stale_time_))
+            {
+                if (cell_budget_ > 0 && n_popped == cell_budget_)
+                    break;
+
+                const double top = narrow_band_.empty() ? std::numeric_limits<double>::infinity() : narrow_band_.top()->getArrivalTime();
+                const bool goal_frozen = int(goal_idx_) != -1 && grid_->getCell(goal_idx_).getState() == FMState::FROZEN;
+                const double goal_time = goal_frozen ? grid_->getCell(goal_idx_).getArrivalTime() : std::numeric_limits<double>::infinity();
+                if (goal_frozen && goal_time < stale_time_ && top >= goal_time)
+                    break;
+
+                if (top >= stale_time_ || (goal_frozen && goal_time >= stale_time_))
+                {
+                    trim();
+                    continue;
+                }
+
+                idxMin = narrow_band_.popMinIdx();
+                ++n_popped;
+
+                // Invalidated cells which could not be reached again.
+                if (std::isinf(grid_->getCell(idxMin).getArrivalTime()))
+                {
+                    grid_->getCell(idxMin).setState(FMState::OPEN);
+                    lowered_[idxMin] = false;
+                    continue;
+                }
+
+                // Only a cell whose time went down can improve cells frozen before it.
+                const bool reopen = lowered_[idxMin];
+                lowered_[idxMin] = false;
+
+                n_neighs = grid_->getNeighbors(idxMin, neighbors_);
+                grid_->getCell(idxMin).setState(FMState::FROZEN);
+
+                // As in FMM, the open and narrow neighbors are solved all at once.
+                unsigned int n_cands = 0;
+                for (unsigned int s = 0; s < n_neighs; ++s)
+                {
+                    j = neighbors_[s];
+
+                    if (grid_->getCell(j).isOccupied())
+                        continue;
+
+                    if (grid_->getCell(j).getState() == FMState::FROZEN)
+                    {
+                        if (reopen)
+                            lower(j);
+                        continue;
+                    }
+                    candidates_[n_cands++] = j;
+                }
+                solveEikonalBatch(candidates_.data(), n_cands, candidate_times_.data());
+
+                for (unsigned int s = 0; s < n_cands; ++s)
+                {
+                    j = candidates_[s];
+                    double new_arrival_time = candidate_times_[s];
+                    if (grid_->getCell(j).getState() == FMState::NARROW)
+                    {
+                        if (utils::isTimeBetterThan(new_arrival_time, grid_->getCell(j).getArrivalTime()))
+                        {
+                            grid_->getCell(j).setArrivalTime(new_arrival_time);
+                            narrow_band_.increase( &(grid_->getCell(j)) );
+                        }
+                    }
+                    else
+                    {
+                        grid_->getCell(j).setState(FMState::NARROW);
+                        grid_->getCell(j).setArrivalTime(new_arrival_time);
+                        narrow_band_.push( &(grid_->getCell(j)) );
+                    }
+                }
+            }
+        }
+
+        /** \brief Repairs the field around the cells registered with setChangedCells(). */
+        void repair
+        () {
+            if (changed_.empty())
+                return;
+
+            // Classify the changes before modifying anything: the new arrival time is obtained
+            // from the upwind neighbors with the new velocity.
+            std::vector<unsigned int> raised, lowered;
+            for (unsigned int c : changed_)
+            {
+                const double t = grid_->getCell(c).getArrivalTime();
+                if (t == 0)
+                    continue; // Initial points do not depend on their velocity.
+
+                const double new_t = grid_->getCell(c).isOccupied() ?
+                                     std::numeric_limits<double>::infinity() : solveEikonal(c);
+                if (utils::isTimeBetterThan(t, new_t))
+                    raised.push_back(c);
+                else if (utils::isTimeBetterThan(new_t, t))
+                    lowered.push_back(c);
+            }
+            changed_.clear();
+
+            // Cells frozen after the goal are not needed unless the goal moves away, the region
+            // beyond it is only repaired if propagate() gets there.
+            double cut = std::numeric_limits<double>::infinity();
+            if (int(goal_idx_) != -1 && grid_->getCell(goal_idx_).getState() == FMState::FROZEN &&
+                grid_->getCell(goal_idx_).getArrivalTime() < stale_time_)
+                cut = grid_->getCell(goal_idx_).getArrivalTime();
+            invalidate(raised, cut);
+
+            // Lower: improved cells go back to the narrow band.
+            for (unsigned int c : lowered)
+                lower(c);
+        }
+
+        /** \brief Invalidates the roots and every cell whose arrival time was solved from an invalid
+            cell, then seeds them again from their valid neighbors. Cells with a time above cut are
+            left as they are, stale_time_ is lowered to their time instead. The cells solved from
+            them have higher times, and a time solved from any of them is not lower than the times
+            it was solved from, so every time below stale_time_ stays exact. */
+        void invalidate
+        (const std::vector<unsigned int> & roots, double cut) {
+            std::vector<unsigned int> invalid;
+            for (unsigned int c : roots)
+            {
+                if (marks_[c])
+                    continue;
+                if (grid_->getCell(c).getArrivalTime() > cut)
+                {
+                    stale_time_ = std::min(stale_time_, grid_->getCell(c).getArrivalTime());
+                    continue;
+                }
+
+                marks_[c] = true;
+                size_t first = invalid.size();
+                invalid.push_back(c);
+                for (size_t k = first; k < invalid.size(); ++k)
+                {
+                    const unsigned int i = invalid[k];
+                    unsigned int n_neighs = grid_->getNeighbors(i, neighbors_);
+                    for (unsigned int s = 0; s < n_neighs; ++s)
+                    {
+                        const unsigned int j = neighbors_[s];
+                        if (marks_[j] || !isUpwind(i, j))
+                            continue;
+
+                        if (grid_->getCell(j).getArrivalTime() > cut)
+                            stale_time_ = std::min(stale_time_, grid_->getCell(j).getArrivalTime());
+                        else
+                        {
+                            marks_[j] = true;
+                            invalid.push_back(j);
+                        }
+                    }
+                }
+            }
+
+            // A cell may get a lower time than before if other changes improved it, so every
+            // invalidated cell may lower its frozen neighbors once popped.
+            for (unsigned int i : invalid)
+            {
+                lowered_[i] = true;
+                grid_->getCell(i).setArrivalTime(std::numeric_limits<double>::infinity());
+                if (grid_->getCell(i).getState() == FMState::NARROW)
+                    narrow_band_.update( &(grid_->getCell(i)) );
+                else
+                    grid_->getCell(i).setState(FMState::OPEN);
+            }
+
+            // Seed the invalidated region from its valid boundary.
+            for (unsigned int i : invalid)
+            {
+                marks_[i] = false;
+                if (grid_->getCell(i).isOccupied())
+                    continue;
+
+                double new_arrival_time = solveEikonal(i);
+                if (std::isinf(new_arrival_time))
+                    continue;
+
+                grid_->getCell(i).setArrivalTime(new_arrival_time);
+                if (grid_->getCell(i).getState() == FMState::NARROW)
+                    narrow_band_.increase( &(grid_->getCell(i)) );
+                else
+                {
+                    grid_->getCell(i).setState(FMState::NARROW);
+                    narrow_band_.push( &(grid_->getCell(i)) );
+                }
+            }
+        }
+
+        /** \brief Discards every time not below stale_time_ and seeds the discarded cells again
+            from the cells left. Needs a pass over the whole grid, so the repairs only trim when
+            the goal needs times that high. */
+        void trim
+        () {
+            const double limit = stale_time_;
+            stale_time_ = std::numeric_limits<double>::infinity();
+
+            narrow_band_.clear();
+            narrow_band_.setMaxSize(grid_->size());
+            std::vector<unsigned int> trimmed;
+            for (unsigned int i = 0; i < grid_->size(); ++i)
+            {
+                if (grid_->getCell(i).getState() == FMState::OPEN)
+                    continue;
+
+                if (grid_->getCell(i).getArrivalTime() >= limit)
+                {
+                    lowered_[i] = false;
+                    grid_->getCell(i).setArrivalTime(std::numeric_limits<double>::infinity());
+                    grid_->getCell(i).setState(FMState::OPEN);
+                    trimmed.push_back(i);
+                }
+                else if (grid_->getCell(i).getState() == FMState::NARROW)
+                    narrow_band_.push( &(grid_->getCell(i)) );
+            }
+
+            for (unsigned int i : trimmed)
+            {
+                if (grid_->getCell(i).isOccupied())
+                    continue;
+
+                double new_arrival_time = solveEikonal(i);
+                if (std::isinf(new_arrival_time))
+                    continue;
+
+                grid_->getCell(i).setArrivalTime(new_arrival_time);
+                grid_->getCell(i).setState(FMState::NARROW);
+                narrow_band_.push( &(grid_->getCell(i)) );
+            }
+        }
+
+        /** \brief Returns true if the arrival time of cell j was solved from cell i, that is,
+            i is below j and it is the lowest neighbor of j in its dimension. Read before the
+            invalidated cells are reset, ties count as upwind. */
+        bool isUpwind
+        (unsigned int i, unsigned int j) {
+            const double ti = grid_->getCell(i).getArrivalTime();
+            const double tj = grid_->getCell(j).getArrivalTime();
+            if (std::isinf(tj) || !(ti < tj))
+                return false;
+
+            // Neighbors differ by the stride of their dimension, the opposite one lies as far on the other side of j.
+            const unsigned int stride = (i > j) ? i - j : j - i;
+            unsigned int dim_stride = 1, d = 0;
+            while (dim_stride != stride)
+                dim_stride *= grid_->getDimSizes()[d++];
+
+            const unsigned int c = (j / stride) % grid_->getDimSizes()[d];
+            const bool inside = (i < j) ? c + 1 < grid_->getDimSizes()[d] : c > 0;
+            return !inside || ti <= grid_->getCell(2 * j - i).getArrivalTime();
+        }
+
+        /** \brief Recomputes the arrival time of a non-open cell and puts it back into the
+            narrow band if it improved. */
+        void lower
+        (unsigned int idx) {
+            double new_arrival_time = solveEikonal(idx);
+            if (!utils::isTimeBetterThan(new_arrival_time, grid_->getCell(idx).getArrivalTime()))
+                return;
+
+            lowered_[idx] = true;
+            grid_->getCell(idx).setArrivalTime(new_arrival_time);
+            if (grid_->getCell(idx).getState() == FMState::NARROW)
+                narrow_band_.increase( &(grid_->getCell(idx)) );
+            else
+            {
+                grid_->getCell(idx).setState(FMState::NARROW);
+                narrow_band_.push( &(grid_->getCell(idx)) );
+            }
+        }
+
+        using EikonalSolver<grid_t>::grid_;
+        using EikonalSolver<grid_t>::init_points_;
+        using EikonalSolver<grid_t>::goal_idx_;
+        using EikonalSolver<grid_t>::setup_;
+        using EikonalSolver<grid_t>::name_;
+        using EikonalSolver<grid_t>::time_;
+        using EikonalSolver<grid_t>::solveEikonal;
+        using EikonalSolver<grid_t>::solveEikonalBatch;
+        using EikonalSolver<grid_t>::neighbors_;
+
+    private:
+        /** \brief Instance of the heap used. */
+        heap_t                                          narrow_band_;
+
+        /** \brief Neighbors of the current cell to be updated. */
+        std::array <unsigned int, 2*grid_t::getNDims()> candidates_;
+
+        /** \brief Arrival times computed for candidates_. */
+        std::array <double, 2*grid_t::getNDims()>       candidate_times_;
+
+        /** \brief Cells modified since the last run. */
+        std::vector<unsigned int>                       changed_;
+
+        /** \brief Auxiliar flags used to collect the invalidated region, always left false. */
+        std::vector<bool>                               marks_;
+
+        /** \brief Lowest time that may be out of date, every time below it is exact. */
+        double                                          stale_time_;
+
+        /** \brief Flags of the narrow band cells whose time went down, which may lower their
+            frozen neighbors when popped. */
+        std::vector<bool>                               lowered_;
+
+        /** \brief Maximum number of cells popped by each compute(), 0 for no limit. */
+        unsigned int                                    cell_budget_;
+};
+
+#endif /* DFMM_HPP_*/
@@ -0,0 +1,138 @@
+/*! \class EikonalKernels
+    \brief Fixed-size solvers of the discretized 3D Eikonal equation, used by EikonalSolver
+    as a fast path for 3D grids.
+
+    Given the minimum arrival time of the neighbors in each dimension (infinity if there is
+    no valid neighbor) and h/f (leaf size over velocity of the cell), the update is:
+
+    - Sort the three times with a 3-element sorting network: ta <= tb <= tc.
+    - T = ta + h/f if it is not greater than tb.
+    - Otherwise, T = (ta + tb + sqrt(2(h/f)^2 - (ta-tb)^2)) / 2 if it is not greater than tc.
+    - Otherwise, T = (S + sqrt(S^2 - 3(SS - (h/f)^2))) / 3, with S and SS the sum of the times
+      and of their squares.
+
+    which are the closed forms of the quadratics EikonalSolver::solveEikonalNDims() solves.
+    No container, sort call nor loop is involved.
+
+    solve3DBatch() solves several independent updates at once. If compiled with AVX2 support
+    (-mavx2 or -march=native) four updates are computed per instruction, otherwise it falls
+    back to solve3D(). Both give the same results.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef EIKONALKERNELS_HPP_
+#define EIKONALKERNELS_HPP_
+
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+#include <fast_methods/utils/utils.h>
+
+class EikonalKernels {
+    public:
+        /** \brief Solves the 3D Eikonal update for the minimum neighbor times in each
+            dimension ta, tb, tc (in any order) and hf = leafsize / velocity. */
+        static inline double solve3D
+        (double ta, double tb, double tc, double hf) {
+            // Sorting network.
+            sort2(ta, tb);
+            sort2(tb, tc);
+            sort2(ta, tb);
+
+            if (std::isinf(ta))
+                return std::numeric_limits<double>::infinity();
+
+            const double t1 = ta + hf;
+            if (t1 - tb < utils::COMP_MARGIN)
+                return t1;
+
+            const double d = ta - tb;
+            const double t2 = 0.5 * (ta + tb + std::sqrt(2*hf*hf - d*d));
+            if (t2 - tc < utils::COMP_MARGIN)
+                return t2;
+
+            const double s = ta + tb + tc;
+            const double ss = ta*ta + tb*tb + tc*tc;
+            const double quad_term = s*s - 3*(ss - hf*hf);
+            if (quad_term < 0)
+                return std::numeric_limits<double>::infinity();
+            return (s + std::sqrt(quad_term)) / 3;
+        }
+
+        /** \brief Solves n independent 3D Eikonal updates: out[i] = solve3D(ta[i], tb[i], tc[i], hf[i]). */
+        static inline void solve3DBatch
+        (const double * ta, const double * tb, const double * tc, const double * hf, double * out, unsigned int n) {
+            unsigned int i = 0;
+#ifdef __AVX2__
+            const __m256d inf    = _mm256_set1_pd(std::numeric_limits<double>::infinity());
+            const __m256d zero   = _mm256_setzero_pd();
+            const __m256d half   = _mm256_set1_pd(0.5);
+            const __m256d two    = _mm256_set1_pd(2.0);
+            const __m256d three  = _mm256_set1_pd(3.0);
+            const __m256d margin = _mm256_set1_pd(utils::COMP_MARGIN);
+            for (; i + 4 <= n; i += 4) {
+                __m256d a = _mm256_loadu_pd(ta + i);
+                __m256d b = _mm256_loadu_pd(tb + i);
+                __m256d c = _mm256_loadu_pd(tc + i);
+                const __m256d h = _mm256_loadu_pd(hf + i);
+
+                __m256d lo = _mm256_min_pd(a, b);
+                b = _mm256_max_pd(a, b);
+                a = lo;
+                lo = _mm256_min_pd(b, c);
+                c = _mm256_max_pd(b, c);
+                b = lo;
+                lo = _mm256_min_pd(a, b);
+                b = _mm256_max_pd(a, b);
+                a = lo;
+
+                // Candidates for 1, 2 and 3 dimensions. NaNs in unused lanes are discarded below.
+                const __m256d hh = _mm256_mul_pd(h, h);
+                const __m256d t1 = _mm256_add_pd(a, h);
+
+                const __m256d d = _mm256_sub_pd(a, b);
+                __m256d t2 = _mm256_sub_pd(_mm256_mul_pd(two, hh), _mm256_mul_pd(d, d));
+                t2 = _mm256_mul_pd(half, _mm256_add_pd(_mm256_add_pd(a, b), _mm256_sqrt_pd(t2)));
+
+                const __m256d s = _mm256_add_pd(_mm256_add_pd(a, b), c);
+                const __m256d ss = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(a, a), _mm256_mul_pd(b, b)), _mm256_mul_pd(c, c));
+                const __m256d quad_term = _mm256_sub_pd(_mm256_mul_pd(s, s), _mm256_mul_pd(three, _mm256_sub_pd(ss, hh)));
+                __m256d t3 = _mm256_div_pd(_mm256_add_pd(s, _mm256_sqrt_pd(quad_term)), three);
+                t3 = _mm256_blendv_pd(t3, inf, _mm256_cmp_pd(quad_term, zero, _CMP_LT_OQ));
+
+                __m256d t = _mm256_blendv_pd(t3, t2, _mm256_cmp_pd(_mm256_sub_pd(t2, c), margin, _CMP_LT_OQ));
+                t = _mm256_blendv_pd(t, t1, _mm256_cmp_pd(_mm256_sub_pd(t1, b), margin, _CMP_LT_OQ));
+                t = _mm256_blendv_pd(t, inf, _mm256_cmp_pd(a, inf, _CMP_EQ_OQ));
+                _mm256_storeu_pd(out + i, t);
+            }
+#endif
+            for (; i < n; ++i)
+                out[i] = solve3D(ta[i], tb[i], tc[i], hf[i]);
+        }
+
+    private:
+        /** \brief Compare-exchange element of the sorting network. */
+        static inline void sort2
+        (double & a, double & b) {
+            const double lo = std::min(a, b);
+            b = std::max(a, b);
+            a = lo;
+        }
+};
+
+#endif /* EIKONALKERNELS_HPP_ */
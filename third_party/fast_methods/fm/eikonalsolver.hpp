@@ -34,6 +34,7 @@
 #include <boost/concept_check.hpp>
 
 #include <fast_methods/fm/solver.hpp>
+#include <fast_methods/fm/eikonalkernels.hpp>
 #include <fast_methods/console/console.h>
 
 template <class grid_t>
@@ -47,6 +48,13 @@ class EikonalSolver : public Solver<grid_t>{
             the estimated travel time to goal with current velocity. */
         virtual double solveEikonal(const int & idx) 
         {   
+            // Fixed-size path for 3D grids.
+            if (grid_t::getNDims() == 3) {
+                std::array<double, 3> T;
+                getMinValuesInDims(idx, T);
+                return EikonalKernels::solve3D(T[0], T[1], T[2], grid_->getLeafSize() / grid_->getCell(idx).getVelocity());
+            }
+
             unsigned int a = grid_t::getNDims(); // a parameter of the Eikonal equation.
             Tvalues_.clear();
 
@@ -74,7 +82,44 @@ class EikonalSolver : public Solver<grid_t>{
             return updatedT;
         }
 
+        /** \brief Solves the Eikonal equation for the n cells in idxs, storing the results in times.
+            The updates must be independent, i.e., no cell in idxs is a neighbor of another one,
+            as it happens with the neighbors of a cell. In 3D they are solved at once with
+            EikonalKernels::solve3DBatch() (without calling solveEikonal()), n <= 2*ndims. */
+        void solveEikonalBatch
+        (const unsigned int * idxs, unsigned int n, double * times) {
+            if (grid_t::getNDims() != 3) {
+                for (unsigned int i = 0; i < n; ++i)
+                    times[i] = solveEikonal(idxs[i]);
+                return;
+            }
+
+            std::array<double, 2*grid_t::getNDims()> ta, tb, tc, hf;
+            std::array<double, 3> T;
+            for (unsigned int i = 0; i < n; ++i) {
+                getMinValuesInDims(idxs[i], T);
+                ta[i] = T[0];
+                tb[i] = T[1];
+                tc[i] = T[2];
+                hf[i] = grid_->getLeafSize() / grid_->getCell(idxs[i]).getVelocity();
+            }
+            EikonalKernels::solve3DBatch(ta.data(), tb.data(), tc.data(), hf.data(), times, n);
+        }
+
     protected:
+        /** \brief Stores in T the minimum arrival time of the neighbors of cell idx in each of
+            the first 3 dimensions, or infinity if it would not improve the cell. */
+        void getMinValuesInDims
+        (unsigned int idx, std::array<double, 3> & T) {
+            const double t = grid_->getCell(idx).getArrivalTime();
+            T.fill(std::numeric_limits<double>::infinity());
+            for (unsigned int dim = 0; dim < std::min<size_t>(3, grid_t::getNDims()); ++dim) {
+                const double minTInDim = grid_->getMinValueInDim(idx, dim);
+                if (minTInDim < t)
+                    T[dim] = minTInDim;
+            }
+        }
+
         /** \brief Solves the Eikonal equation assuming that Tvalues_
             is sorted. */
         double solveEikonalNDims
@@ -61,16 +61,116 @@
 /** \brief Heuristic strategy to be used. TIME = DISTANCE/local velocity. */
 enum HeurStrategy {NOHEUR = 0, TIME, DISTANCE};
 
+/** \brief Euclidean distances between the cells of a grid and a target cell, the heuristic of
+    the FM solvers. They are computed on demand, only for the cells the waves reach, and kept
+    for later runs towards the same target coordinate if the cache is enabled. */
+template <class grid_t> class HeuristicDistance {
+
+    /** \brief Shorthand for coordinates. */
+    typedef std::array<unsigned int, grid_t::getNDims()> Coord;
+
+    public:
+        HeuristicDistance() : grid_(NULL), cache_(false) {}
+
+        /** \brief Sets the grid and the target cell. Cached distances to another target are dropped. */
+        void setTarget
+        (grid_t * grid, unsigned int idx) {
+            grid_ = grid;
+            grid_->idx2coord(idx, coord_);
+            if (!distances_.empty() && (coord_ != distances_coord_ || distances_.size() != grid_->size()))
+                distances_.clear();
+        }
+
+        /** \brief Keeps the distances computed so that later runs towards the same target
+            coordinate reuse them. Disabled by default: distances are cheaper to compute than
+            the memory of a whole-grid cache when the target changes between runs. */
+        void setCache
+        (bool cache) {
+            cache_ = cache;
+            if (!cache_)
+                distances_.clear();
+        }
+
+        /** \brief Computes the distance of every cell, enabling the cache. */
+        void precompute
+        () {
+            cache_ = true;
+            distances_coord_ = coord_;
+            distances_.resize(grid_->size());
+            for (size_t i = 0; i < grid_->size(); ++i)
+                distances_[i] = computeDistance(i);
+        }
+
+        /** \brief Returns the distance between cell idx and the target, slightly inflated. It is
+            stored if the cache is enabled. */
+        double getDistance
+        (unsigned int idx) {
+            if (!cache_)
+                return computeDistance(idx);
+
+            if (distances_.size() != grid_->size())
+            {
+                distances_.assign(grid_->size(), -1);
+                distances_coord_ = coord_;
+            }
+            if (distances_[idx] < 0)
+                distances_[idx] = computeDistance(idx);
+            return distances_[idx];
+        }
+
+        /** \brief Returns the heuristic value of cell idx for strategy h: the distance to the
+            target, the time to cover it at max_v, or 0 without heuristic. */
+        double getValue
+        (unsigned int idx, HeurStrategy h, double max_v) {
+            if (h == NOHEUR)
+                return 0;
+            const double dist = getDistance(idx);
+            return h == TIME ? dist / max_v : dist;
+        }
+
+        void clear
+        () {
+            distances_.clear();
+        }
+
+    private:
+        double computeDistance
+        (unsigned int idx) const {
+            Coord coords;
+            grid_->idx2coord(idx, coords);
+
+            double dist = 0;
+            for (size_t j = 0; j < coords.size(); ++j)
+                dist += ((int)coords[j] - (int)coord_[j]) * ((int)coords[j] - (int)coord_[j]);
+            return 1.00001 * std::sqrt(dist) * grid_->getLeafSize();
+        }
+
+        /** \brief Grid the distances are computed on. */
+        grid_t *                                        grid_;
+
+        /** \brief Target coord. */
+        Coord                                           coord_;
+
+        /** \brief Target coord distances_ was computed for. */
+        Coord                                           distances_coord_;
+
+        /** \brief Cached distances, negative if not computed yet. */
+        std::vector<double>                             distances_;
+
+        /** \brief Flag to keep the distances in distances_. */
+        bool                                            cache_;
+};
+
 template < class grid_t, class heap_t = FMDaryHeap<FMCell> >  class FMM : public EikonalSolver<grid_t> {
 
     public:
-        FMM(HeurStrategy h = NOHEUR) : EikonalSolver<grid_t>("FMM"), heurStrategy_(h), precomputed_(false) {
+        FMM(HeurStrategy h = NOHEUR) : EikonalSolver<grid_t>("FMM"), heurStrategy_(h), mask_(NULL) {
             /// \todo automate the naming depending on the heap.
             //if (static_cast<FMFibHeap>(heap_t))
              //   name_ = "FMMFib";
         }
 
-        FMM(const char * name, HeurStrategy h = NOHEUR) : EikonalSolver<grid_t>(name), heurStrategy_(h), precomputed_(false) {}
+        FMM(const char * name, HeurStrategy h = NOHEUR) : EikonalSolver<grid_t>(name), heurStrategy_(h), mask_(NULL) {}
 
         virtual ~FMM() { clear(); }
 
@@ -105,12 +205,8 @@ template < class grid_t, class heap_t = FMDaryHeap<FMCell> >  class FMM : public
             { // For each initial point
                 grid_->getCell(i).setArrivalTime(0);
                 // Include heuristics if necessary.
-                if (heurStrategy_ == TIME)
-                {   
-                    grid_->getCell(i).setHeuristicTime( getPrecomputedDistance(i) / max_v);//grid_->getCell(i).getVelocity() );
-                }
-                else if (heurStrategy_ == DISTANCE)
-                    grid_->getCell(i).setHeuristicTime( getPrecomputedDistance(i) );
+                if (heurStrategy_ != NOHEUR)
+                    grid_->getCell(i).setHeuristicTime( heuristic_.getValue(i, heurStrategy_, max_v) );
                 narrow_band_.push( &(grid_->getCell(i)) );
             }
 
@@ -124,38 +220,43 @@ template < class grid_t, class heap_t = FMDaryHeap<FMCell> >  class FMM : public
 
                 n_neighs = grid_->getNeighbors(idxMin, neighbors_);
                 grid_->getCell(idxMin).setState(FMState::FROZEN);
+
+                // The neighbors of a cell are not neighbors of each other, so their updates
+                // are independent and can be solved all at once.
+                unsigned int n_cands = 0;
                 for (unsigned int s = 0; s < n_neighs; ++s) 
                 {
                     j = neighbors_[s];
-
-                    if ((grid_->getCell(j).getState() == FMState::FROZEN) || grid_->getCell(j).isOccupied())
+                    if ((grid_->getCell(j).getState() == FMState::FROZEN) || grid_->getCell(j).isOccupied() || (mask_ && !(*mask_)[j]))
                         continue;
-                    else 
-                    {
-                        double new_arrival_time = solveEikonal(j);
+                    candidates_[n_cands++] = j;
+                }
+                solveEikonalBatch(candidates_.data(), n_cands, candidate_times_.data());
 
-                        // Include heuristics if necessary.
-                        if (heurStrategy_ == TIME)
-                            grid_->getCell(j).setHeuristicTime( getPrecomputedDistance(j) / max_v);//grid_->getCell(j).getVelocity() );
-                        else if (heurStrategy_ == DISTANCE)
-                            grid_->getCell(j).setHeuristicTime( getPrecomputedDistance(j) );
+                for (unsigned int s = 0; s < n_cands; ++s) 
+                {
+                    j = candidates_[s];
+                    double new_arrival_time = candidate_times_[s];
 
-                        // Updating narrow band if necessary.
-                        if (grid_->getCell(j).getState() == FMState::NARROW) 
-                        {
-                            if (utils::isTimeBetterThan(new_arrival_time, grid_->getCell(j).getArrivalTime())) 
-                            {
-                                grid_->getCell(j).setArrivalTime(new_arrival_time);
-                                narrow_band_.increase( &(grid_->getCell(j)) );
-                            }
-                        }
-                        else 
+                    // Include heuristics if necessary.
+                    if (heurStrategy_ != NOHEUR)
+                        grid_->getCell(j).setHeuristicTime( heuristic_.getValue(j, heurStrategy_, max_v) );
+
+                    // Updating narrow band if necessary.
+                    if (grid_->getCell(j).getState() == FMState::NARROW) 
+                    {
+                        if (utils::isTimeBetterThan(new_arrival_time, grid_->getCell(j).getArrivalTime())) 
                         {
-                            grid_->getCell(j).setState(FMState::NARROW);
                             grid_->getCell(j).setArrivalTime(new_arrival_time);
-                            narrow_band_.push( &(grid_->getCell(j)) );
-                        } // neighbors_ open.
-                    } // neighbors_ not frozen.
+                            narrow_band_.increase( &(grid_->getCell(j)) );
+                        }
+                    }
+                    else 
+                    {
+                        grid_->getCell(j).setState(FMState::NARROW);
+                        grid_->getCell(j).setArrivalTime(new_arrival_time);
+                        narrow_band_.push( &(grid_->getCell(j)) );
+                    } // neighbors_ open.
                 } // For each neighbor.
 
                 if (idxMin == goal_idx_)
@@ -166,31 +267,41 @@ template < class grid_t, class heap_t = FMDaryHeap<FMCell> >  class FMM : public
             return 1;
         }
 
-        /** \brief Set heuristics flag. True is activated. It will precompute distances
-            if not done already. */
+        /** \brief Set heuristics flag. True is activated. Distances to the goal are computed
+            on demand, see getPrecomputedDistance(). */
         void setHeuristics(HeurStrategy h) 
         {
             if (h && int(goal_idx_)!=-1) 
             {
                 heurStrategy_ = h;
-                grid_->idx2coord(goal_idx_, heur_coord_);
-                //grid_->idx2coord(goal_idx_, heur_coord_);
-                if (!precomputed_)
-                    precomputeDistances();
+                heuristic_.setTarget(grid_, goal_idx_);
             }
         }
 
+        /** \brief Keeps the heuristic distances computed so that later runs towards the same goal
+            coordinate reuse them, see HeuristicDistance::setCache(). */
+        void setDistanceCache
+        (bool cache) {
+            heuristic_.setCache(cache);
+        }
+
         /** \brief Returns heuristics flag. */
         HeurStrategy getHeuristics
         () const {
             return heurStrategy_;
         }
 
+        /** \brief Restricts the wave propagation to the cells flagged in mask, which must have
+            the size of the grid and outlive the solver run. NULL propagates over the whole grid. */
+        void setMask
+        (const std::vector<bool> * mask) {
+            mask_ = mask;
+        }
+
         virtual void clear
         () {
             narrow_band_.clear();
-            distances_.clear();
-            precomputed_ = false;
+            heuristic_.clear();
         }
 
         virtual void reset
@@ -199,36 +310,19 @@ template < class grid_t, class heap_t = FMDaryHeap<FMCell> >  class FMM : public
             narrow_band_.clear();
         }
 
-        /** \brief Computes euclidean distance between goal and rest of cells. */
+        /** \brief Computes euclidean distance between goal and rest of cells, enabling the
+            distance cache. Not required, distances are computed on demand otherwise. */
         virtual void precomputeDistances() 
         {   
-            distances_.reserve(grid_->size());
-            std::array <unsigned int, grid_t::getNDims()> coords;
-            double dist = 0;
-
-            for (size_t i = 0; i < grid_->size(); ++i)
-            {
-                dist = 0;
-                grid_->idx2coord(i, coords);
-
-                for (size_t j = 0; j < coords.size(); ++j)
-                    dist += ((int)coords[j] - (int)heur_coord_[j]) * ((int)coords[j] - (int)heur_coord_[j]);
-
-                distances_[i] = 1.00001 * std::sqrt(dist) * grid_->getLeafSize();
-                
-                /*for (size_t j = 0; j < coords.size(); ++j)
-                    dist += fabs((int)coords[j] - (int)heur_coord_[j]);
-                distances_[i] = 1.00001 * grid_->getLeafSize();*/
-                
-            }
-            precomputed_ = true;
+            heuristic_.setTarget(grid_, goal_idx_);
+            heuristic_.precompute();
         }
 
-        /** \brief Extracts the euclidean distance calculated from precomputeDistances
-            function distance between two positions. */
+        /** \brief Returns the euclidean distance between cell idx and the goal. It is computed
+            only for the cells the wave reaches, and stored if the distance cache is enabled. */
         virtual double getPrecomputedDistance(const unsigned int idx) 
         {
-            return distances_[idx];
+            return heuristic_.getDistance(idx);
         }
 
         virtual void printRunInfo
@@ -249,23 +343,27 @@ template < class grid_t, class heap_t = FMDaryHeap<FMCell> >  class FMM : public
         using EikonalSolver<grid_t>::name_;
         using EikonalSolver<grid_t>::time_;
         using EikonalSolver<grid_t>::solveEikonal;
+        using EikonalSolver<grid_t>::solveEikonalBatch;
         using EikonalSolver<grid_t>::neighbors_;
 
     private:
         /** \brief Instance of the heap used. */
         heap_t                                          narrow_band_;
 
+        /** \brief Neighbors of the current cell to be updated. */
+        std::array <unsigned int, 2*grid_t::getNDims()> candidates_;
+
+        /** \brief Arrival times computed for candidates_. */
+        std::array <double, 2*grid_t::getNDims()>       candidate_times_;
+
         /** \brief Flag to activate heuristics and corresponding strategy. */
         HeurStrategy                                    heurStrategy_;
 
-        /** \brief Stores the precomputed heuristic distances. */
-        std::vector<double>                             distances_;
-        
-        /** \brief Flag to indicate if distances_ is already computed. */
-        bool                                            precomputed_;
+        /** \brief Distances to the goal (actually the initial point of the path). */
+        HeuristicDistance<grid_t>                       heuristic_;
 
-        /** \brief Goal coord, goal of the second wave propagation (actually the initial point of the path). */
-        std::array <unsigned int, grid_t::getNDims()>   heur_coord_;
+        /** \brief Cells the wave is allowed to reach, NULL if not restricted. */
+        const std::vector<bool> *                       mask_;
 };
 
 #endif /* FMM_HPP_*/
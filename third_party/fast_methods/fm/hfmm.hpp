@@ -0,0 +1,343 @@
+/*! \class HFMM
+    \brief Hierarchical (coarse-to-fine) FMM*.
+
+    It uses as a main container the nDGridMap class. The nDGridMap type T
+    has to be an FMCell or something inherited from it.
+
+    The grid is first downsampled by an integer factor, each coarse cell taking the mean
+    velocity of the cells it covers, and FMM* is solved on the coarse grid. The coarse path
+    is extracted by gradient descent and dilated into a tube of the given width. Finally,
+    FMM* is run on the original grid with the wave restricted to the tube. If the refined
+    wave cannot reach the goal inside the tube (for instance, a passage narrower than a
+    coarse cell), the whole grid is solved again at full resolution.
+
+    The result is a regular arrival-time field on the original grid, valid inside the tube,
+    so the path can be extracted with GradientDescent as usual.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef HFMM_HPP_
+#define HFMM_HPP_
+
+#include <iostream>
+#include <cmath>
+#include <algorithm>
+#include <array>
+#include <vector>
+#include <chrono>
+
+#include <fast_methods/fm/fmmstar.hpp>
+#include <fast_methods/gradientdescent/gradientdescent.hpp>
+
+#include <fast_methods/ndgridmap/fmcell.h>
+#include <fast_methods/ndgridmap/ndgridmap.hpp>
+#include <fast_methods/console/console.h>
+
+template < class grid_t >  class HFMM : public EikonalSolver<grid_t> {
+
+    /** \brief Shorthand for coordinates. */
+    typedef std::array<unsigned int, grid_t::getNDims()> Coord;
+
+    /** \brief Shorthand for the path extracted by GradientDescent. */
+    typedef std::vector< std::array<double, grid_t::getNDims()> > Path;
+
+    public:
+        /** \param factor downsampling factor of the coarse grid.
+            \param tube_width width of the refinement tube, in the same units as the leaf size. */
+        HFMM(unsigned int factor = 4, double tube_width = 2.0) : EikonalSolver<grid_t>("HFMM"),
+            factor_(std::max(factor, 2u)), tube_width_(tube_width), fallback_(false), coarse_time_(0), fine_time_(0) {}
+
+        HFMM(const char * name, unsigned int factor = 4, double tube_width = 2.0) : EikonalSolver<grid_t>(name),
+            factor_(std::max(factor, 2u)), tube_width_(tube_width), fallback_(false), coarse_time_(0), fine_time_(0) {}
+
+        virtual ~HFMM() { clear(); }
+
+        /** \brief Solves the coarse problem, builds the tube and refines inside it. */
+        virtual int computeInternal(double max_v)
+        {
+            if (int(goal_idx_) == -1)
+            {
+                console::error("HFMM: a goal point is required to extract the coarse path.");
+                return -1;
+            }
+
+            fallback_ = false;
+
+            std::chrono::time_point<std::chrono::steady_clock> t0 = std::chrono::steady_clock::now();
+            const bool coarse_ok = computeTube(max_v);
+            std::chrono::time_point<std::chrono::steady_clock> t1 = std::chrono::steady_clock::now();
+            coarse_time_ = std::chrono::duration_cast<std::chrono::microseconds>(t1-t0).count() / 1000.0;
+
+            FMMStar<grid_t> fine("HFMM_fine", TIME);
+            fine.setEnvironment(grid_);
+            fine.setInitialAndGoalPoints(init_points_, goal_idx_);
+            fine.setMask(coarse_ok ? &tube_ : NULL);
+            if (fine.compute(max_v) == -1)
+                return -1;
+
+            if (coarse_ok && grid_->getCell(goal_idx_).getState() != FMState::FROZEN)
+            {
+                fallback_ = true;
+                fine.reset();
+                fine.setMask(NULL);
+                if (fine.compute(max_v) == -1)
+                    return -1;
+            }
+
+            std::chrono::time_point<std::chrono::steady_clock> t2 = std::chrono::steady_clock::now();
+            fine_time_ = std::chrono::duration_cast<std::chrono::microseconds>(t2-t1).count() / 1000.0;
+
+            setup_ = true;
+            return 1;
+        }
+
+        /** \brief Sets the downsampling factor of the coarse grid. */
+        void setFactor
+        (unsigned int factor) {
+            factor_ = std::max(factor, 2u);
+        }
+
+        /** \brief Sets the width of the refinement tube, in the same units as the leaf size. */
+        void setTubeWidth
+        (double tube_width) {
+            tube_width_ = tube_width;
+        }
+
+        /** \brief Returns true if the last run had to solve the whole grid at full resolution. */
+        bool usedFallback
+        () const {
+            return fallback_;
+        }
+
+        /** \brief Returns the time (ms) spent in the coarse stage of the last run. */
+        double getCoarseTime
+        () const {
+            return coarse_time_;
+        }
+
+        /** \brief Returns the time (ms) spent in the refinement stage of the last run. */
+        double getFineTime
+        () const {
+            return fine_time_;
+        }
+
+        virtual void clear
+        () {
+            tube_.clear();
+        }
+
+        virtual void printRunInfo
+        () const {
+            console::info("Hierarchical Fast Marching Method");
+            std::cout << '\t' << name_ << '\n'
+                      << '\t' << "Factor: " << factor_ << '\n'
+                      << '\t' << "Tube width: " << tube_width_ << '\n'
+                      << '\t' << "Coarse time: " << coarse_time_ << " ms\n"
+                      << '\t' << "Fine time: " << fine_time_ << " ms\n"
+                      << '\t' << "Fallback: " << (fallback_ ? "yes" : "no") << '\n'
+                      << '\t' << "Elapsed time: " << time_ << " ms\n";
+        }
+
+    protected:
+        /** \brief Solves the coarse grid and flags in tube_ the cells of the original grid around
+            the coarse path. Returns false if no coarse path is available. */
+        bool computeTube
+        (double max_v) {
+            const Coord dimsize = grid_->getDimSizes();
+            Coord cdimsize;
+            for (size_t i = 0; i < cdimsize.size(); ++i)
+                cdimsize[i] = (dimsize[i] + factor_ - 1) / factor_;
+
+            grid_t coarse(cdimsize, grid_->getLeafSize() * factor_);
+
+            // Mean velocity of the cells covered by each coarse cell, row by row. Coarse cells
+            // touching an obstacle are blocked: thin walls are not averaged out and any coarse
+            // path is guaranteed to contain a free path at full resolution.
+            std::vector<double> sum(coarse.size(), 0.0);
+            std::vector<unsigned int> occupied(coarse.size(), 0);
+            Coord cstride;
+            cstride[0] = 1;
+            for (size_t i = 1; i < cstride.size(); ++i)
+                cstride[i] = cstride[i-1] * cdimsize[i-1];
+
+            Coord c, cc, lo, hi;
+            lo.fill(0);
+            hi[0] = 0;
+            for (size_t i = 1; i < hi.size(); ++i)
+                hi[i] = dimsize[i] - 1;
+            c = lo;
+            unsigned int idx = 0;
+            do {
+                unsigned int cidx = 0;
+                for (size_t i = 1; i < c.size(); ++i)
+                    cidx += (c[i] / factor_) * cstride[i];
+
+                for (unsigned int x = 0, k = 0; x < dimsize[0]; ++x, ++idx)
+                {
+                    sum[cidx] += grid_->getCell(idx).getVelocity();
+                    occupied[cidx] += grid_->getCell(idx).isOccupied();
+                    if (++k == factor_)
+                    {
+                        k = 0;
+                        ++cidx;
+                    }
+                }
+            } while (nextCoord(c, lo, hi));
+
+            // Coarse initial and goal points.
+            std::vector<unsigned int> cinit;
+            for (unsigned int i : init_points_)
+            {
+                unsigned int cidx;
+                grid_->idx2coord(i, c);
+                toCoarse(c, cc);
+                coarse.coord2idx(cc, cidx);
+                cinit.push_back(cidx);
+            }
+            unsigned int cgoal;
+            grid_->idx2coord(goal_idx_, c);
+            toCoarse(c, cc);
+            coarse.coord2idx(cc, cgoal);
+
+            for (unsigned int i = 0; i < coarse.size(); ++i)
+                coarse[i].setVelocity(occupied[i] ? 0.0 : sum[i] / blockSize(i, coarse, dimsize));
+
+            // The cells containing the initial and goal points are never blocked.
+            cinit.push_back(cgoal);
+            for (unsigned int i : cinit)
+                if (coarse[i].isOccupied())
+                    coarse[i].setVelocity(sum[i] / blockSize(i, coarse, dimsize));
+            cinit.pop_back();
+
+            std::vector<unsigned int> obs;
+            for (unsigned int i = 0; i < coarse.size(); ++i)
+                if (coarse[i].isOccupied())
+                    obs.push_back(i);
+            coarse.setOccupiedCells(std::move(obs));
+
+            // Start and goal in the same coarse cell, nothing to save.
+            if (std::find(cinit.begin(), cinit.end(), cgoal) != cinit.end())
+                return false;
+
+            FMMStar<grid_t> solver("HFMM_coarse", TIME);
+            solver.setEnvironment(&coarse);
+            solver.setInitialAndGoalPoints(cinit, cgoal);
+            if (solver.compute(max_v) == -1 || std::isinf(coarse[cgoal].getArrivalTime()))
+                return false;
+
+            Path path;
+            std::vector<double> path_vels, path_times;
+            if (GradientDescent<grid_t>::gradient_descent(coarse, cgoal, path, path_vels, path_times) == -1)
+                return false;
+
+            // Dilate the coarse path and flag the fine cells covered by the tube.
+            const int r = std::max(0, (int)std::ceil(0.5 * tube_width_ / coarse.getLeafSize()));
+            std::vector<bool> ctube(coarse.size(), false);
+            for (const std::array<double, grid_t::getNDims()> & p : path)
+            {
+                for (size_t i = 0; i < cc.size(); ++i)
+                {
+                    const int ci = (int)std::round(p[i]);
+                    lo[i] = std::max(0, ci - r);
+                    hi[i] = std::min((int)cdimsize[i] - 1, ci + r);
+                }
+                cc = lo;
+                do {
+                    unsigned int cidx;
+                    coarse.coord2idx(cc, cidx);
+                    ctube[cidx] = true;
+                } while (nextCoord(cc, lo, hi));
+            }
+
+            tube_.assign(grid_->size(), false);
+            for (unsigned int cidx = 0; cidx < coarse.size(); ++cidx)
+            {
+                if (!ctube[cidx])
+                    continue;
+
+                coarse.idx2coord(cidx, cc);
+                for (size_t i = 0; i < cc.size(); ++i)
+                {
+                    lo[i] = cc[i] * factor_;
+                    hi[i] = std::min(lo[i] + factor_, dimsize[i]) - 1;
+                }
+                c = lo;
+                do {
+                    grid_->coord2idx(c, idx);
+                    tube_[idx] = true;
+                } while (nextCoord(c, lo, hi));
+            }
+
+            return true;
+        }
+
+        /** \brief Number of cells of the original grid covered by coarse cell cidx. Cells at the
+            upper borders may cover less than factor_ cells per dimension. */
+        unsigned int blockSize
+        (unsigned int cidx, grid_t & coarse, const Coord & dimsize) const {
+            Coord cc;
+            coarse.idx2coord(cidx, cc);
+            unsigned int count = 1;
+            for (size_t k = 0; k < cc.size(); ++k)
+                count *= std::min(factor_, dimsize[k] - cc[k] * factor_);
+            return count;
+        }
+
+        /** \brief Coarse coordinates of the fine cell c. */
+        void toCoarse
+        (const Coord & c, Coord & cc) const {
+            for (size_t i = 0; i < c.size(); ++i)
+                cc[i] = c[i] / factor_;
+        }
+
+        /** \brief Advances c to the next coordinate of the box [lo, hi], first dimension first.
+            Returns false once the whole box has been visited. */
+        static bool nextCoord
+        (Coord & c, const Coord & lo, const Coord & hi) {
+            for (size_t i = 0; i < c.size(); ++i)
+            {
+                if (c[i] < hi[i])
+                {
+                    ++c[i];
+                    return true;
+                }
+                c[i] = lo[i];
+            }
+            return false;
+        }
+
+        using EikonalSolver<grid_t>::grid_;
+        using EikonalSolver<grid_t>::init_points_;
+        using EikonalSolver<grid_t>::goal_idx_;
+        using EikonalSolver<grid_t>::setup_;
+        using EikonalSolver<grid_t>::name_;
+        using EikonalSolver<grid_t>::time_;
+
+    private:
+        /** \brief Downsampling factor of the coarse grid. */
+        unsigned int                factor_;
+
+        /** \brief Width of the refinement tube around the coarse path. */
+        double                      tube_width_;
+
+        /** \brief Cells of the original grid inside the refinement tube. */
+        std::vector<bool>           tube_;
+
+        /** \brief True if the last run fell back to the whole grid. */
+        bool                        fallback_;
+
+        /** \brief Time (ms) spent in each stage of the last run. */
+        double                      coarse_time_, fine_time_;
+};
+
+#endif /* HFMM_HPP_*/
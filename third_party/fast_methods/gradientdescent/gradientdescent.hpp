@@ -68,7 +68,7 @@ template <class grid_t> class GradientDescent {
           Point current_point;
           Coord dimsize = grid.getDimSizes();
 
-          std::array<unsigned int, ndims_-1> d_; //  Same as nDGridMap class auxiliar array d_.
+          std::array<unsigned int, ndims_> d_; //  Same as nDGridMap class auxiliar array d_.
           //cout<<"check d_[]"<<endl;
           d_[0] = dimsize[0];
           //cout<<d_[0]<<endl;
@@ -162,7 +162,7 @@ template <class grid_t> class GradientDescent {
           Point current_point;
           Coord dimsize = grid.getDimSizes();
 
-          std::array<unsigned int, ndims_-1> d_; //  Same as nDGridMap class auxiliar array d_.
+          std::array<unsigned int, ndims_> d_; //  Same as nDGridMap class auxiliar array d_.
           d_[0] = dimsize[0];
           
           for (size_t i = 1; i < ndims_; ++i)
@@ -364,7 +364,7 @@ template <class grid_t> class GradientDescent {
           Point current_point;
           Coord dimsize = grid.getDimSizes();
 
-          std::array<unsigned int, ndims_-1> d_; //  Same as nDGridMap class auxiliar array d_.
+          std::array<unsigned int, ndims_> d_; //  Same as nDGridMap class auxiliar array d_.
           d_[0] = dimsize[0];
           
           for (size_t i = 1; i < ndims_; ++i)
@@ -5,6 +5,8 @@
 #include <Eigen/Geometry>
 #include <Eigen/Cholesky>
 #include <type_traits>
+#include <algorithm>
+#include <stdexcept>
 #include <random>
 #include <array>
 #include <map>
@@ -1210,6 +1212,12 @@ namespace arc_helpers
     template<typename T, typename Allocator=std::allocator<T>>
     inline std::pair<std::vector<T, Allocator>, uint64_t> DeserializeVector(const std::vector<uint8_t>& buffer, const uint64_t current, const std::function<std::pair<T, uint64_t>(const std::vector<uint8_t>&, const uint64_t)>& item_deserializer);
 
+    template<typename T, typename Allocator=std::allocator<T>>
+    inline uint64_t SerializeTriviallyCopyableVector(const std::vector<T, Allocator>& vec_to_serialize, std::vector<uint8_t>& buffer);
+
+    template<typename T, typename Allocator=std::allocator<T>>
+    inline std::pair<std::vector<T, Allocator>, uint64_t> DeserializeTriviallyCopyableVector(const std::vector<uint8_t>& buffer, const uint64_t current);
+
     template<typename Key, typename T, typename Compare = std::less<Key>, typename Allocator = std::allocator<std::pair<const Key, T>>>
     inline uint64_t SerializeMap(const std::map<Key, T, Compare, Allocator>& map_to_serialize, std::vector<uint8_t>& buffer, const std::function<uint64_t(const Key&, std::vector<uint8_t>&)>& key_serializer, const std::function<uint64_t(const T&, std::vector<uint8_t>&)>& value_serializer);
 
@@ -1231,11 +1239,9 @@ namespace arc_helpers
     inline uint64_t SerializeFixedSizePOD(const T& item_to_serialize, std::vector<uint8_t>& buffer)
     {
         const uint64_t start_buffer_size = buffer.size();
-        // Fixed-size serialization via memcpy
-        std::vector<uint8_t> temp_buffer(sizeof(item_to_serialize), 0x00);
-        memcpy(&temp_buffer[0], &item_to_serialize, sizeof(item_to_serialize));
-        // Move to buffer
-        buffer.insert(buffer.end(), temp_buffer.begin(), temp_buffer.end());
+        // Fixed-size serialization via memcpy, straight into the buffer
+        buffer.resize(start_buffer_size + sizeof(item_to_serialize));
+        memcpy(&buffer[start_buffer_size], &item_to_serialize, sizeof(item_to_serialize));
         // Figure out how many bytes were written
         const uint64_t end_buffer_size = buffer.size();
         const uint64_t bytes_written = end_buffer_size - start_buffer_size;
@@ -1296,6 +1302,133 @@ namespace arc_helpers
         return std::make_pair(deserialized, bytes_read);
     }
 
+    // Written ahead of the items of a trivially copyable block. A reader with the other byte order
+    // reads it reversed and knows that it has to swap the bytes of the items.
+    const uint32_t SERIALIZATION_BYTE_ORDER_MARKER = 0x01020304u;
+
+    // Size of the scalar words that make up a T, the unit in which its bytes are swapped. Scalars
+    // are one word. Structs made of same-size scalars specialize this, other types can't be swapped.
+    template<typename T>
+    struct ByteSwapWordSize
+    {
+        static const size_t value = std::is_arithmetic<T>::value ? sizeof(T) : 0u;
+    };
+
+    inline bool IsBigEndianHost()
+    {
+        const uint32_t marker = SERIALIZATION_BYTE_ORDER_MARKER;
+        uint8_t first_byte = 0x00;
+        memcpy(&first_byte, &marker, 1);
+        return (first_byte == 0x01);
+    }
+
+    // Reverses the bytes of every word_size-byte word in [data, data + num_bytes)
+    inline void SwapBytesInWords(uint8_t* data, const uint64_t num_bytes, const size_t word_size)
+    {
+        for (uint64_t word_start = 0; word_start + word_size <= num_bytes; word_start += word_size)
+        {
+            std::reverse(data + word_start, data + word_start + word_size);
+        }
+    }
+
+    template<typename T>
+    inline void SwapItemBytes(T* items, const uint64_t num_items)
+    {
+        static_assert(std::is_trivially_copyable<T>::value, "Type must be trivially copyable");
+        const size_t word_size = ByteSwapWordSize<T>::value;
+        if (word_size == 0u || (sizeof(T) % word_size) != 0u)
+        {
+            throw std::invalid_argument("Items are in the other byte order and their type has no ByteSwapWordSize");
+        }
+        SwapBytesInWords(reinterpret_cast<uint8_t*>(items), num_items * sizeof(T), word_size);
+    }
+
+    inline uint64_t SerializeByteOrderMarker(std::vector<uint8_t>& buffer)
+    {
+        return SerializeFixedSizePOD<uint32_t>(SERIALIZATION_BYTE_ORDER_MARKER, buffer);
+    }
+
+    // Returns whether the data after the marker has to be byte-swapped, and the bytes read
+    inline std::pair<bool, uint64_t> DeserializeByteOrderMarker(const std::vector<uint8_t>& buffer, const uint64_t current)
+    {
+        const std::pair<uint32_t, uint64_t> deserialized_marker = DeserializeFixedSizePOD<uint32_t>(buffer, current);
+        if (deserialized_marker.first == SERIALIZATION_BYTE_ORDER_MARKER)
+        {
+            return std::make_pair(false, deserialized_marker.second);
+        }
+        uint32_t swapped_marker = deserialized_marker.first;
+        SwapItemBytes<uint32_t>(&swapped_marker, 1u);
+        if (swapped_marker == SERIALIZATION_BYTE_ORDER_MARKER)
+        {
+            return std::make_pair(true, deserialized_marker.second);
+        }
+        throw std::invalid_argument("Invalid byte order marker");
+    }
+
+    template<typename T>
+    inline std::pair<T, uint64_t> DeserializeFixedSizePODInByteOrder(const std::vector<uint8_t>& buffer, const uint64_t current, const bool swap_bytes)
+    {
+        std::pair<T, uint64_t> deserialized = DeserializeFixedSizePOD<T>(buffer, current);
+        if (swap_bytes)
+        {
+            SwapItemBytes<T>(&deserialized.first, 1u);
+        }
+        return deserialized;
+    }
+
+    // Serializes the items with a single copy of the whole block: a byte order marker, a uint64_t
+    // size header, then the items in host byte order. Not compatible with SerializeVector.
+    template<typename T, typename Allocator>
+    inline uint64_t SerializeTriviallyCopyableVector(const std::vector<T, Allocator>& vec_to_serialize, std::vector<uint8_t>& buffer)
+    {
+        static_assert(std::is_trivially_copyable<T>::value, "Type must be trivially copyable");
+        const uint64_t start_buffer_size = buffer.size();
+        // First, write the byte order marker and a uint64_t size header
+        SerializeByteOrderMarker(buffer);
+        const uint64_t size = (uint64_t)vec_to_serialize.size();
+        SerializeFixedSizePOD<uint64_t>(size, buffer);
+        // Copy the contained items as one block
+        const uint8_t* data = reinterpret_cast<const uint8_t*>(vec_to_serialize.data());
+        buffer.insert(buffer.end(), data, data + size * sizeof(T));
+        // Figure out how many bytes were written
+        const uint64_t end_buffer_size = buffer.size();
+        const uint64_t bytes_written = end_buffer_size - start_buffer_size;
+        return bytes_written;
+    }
+
+    // Items written with the other byte order are swapped word by word, see ByteSwapWordSize
+    template<typename T, typename Allocator>
+    inline std::pair<std::vector<T, Allocator>, uint64_t> DeserializeTriviallyCopyableVector(const std::vector<uint8_t>& buffer, const uint64_t current)
+    {
+        static_assert(std::is_trivially_copyable<T>::value, "Type must be trivially copyable");
+        // First, try to load the header
+        assert(current < buffer.size());
+        uint64_t current_position = current;
+        // Load the header
+        const std::pair<bool, uint64_t> deserialized_byte_order = DeserializeByteOrderMarker(buffer, current_position);
+        const bool swap_bytes = deserialized_byte_order.first;
+        current_position += deserialized_byte_order.second;
+        const std::pair<uint64_t, uint64_t> deserialized_size = DeserializeFixedSizePODInByteOrder<uint64_t>(buffer, current_position, swap_bytes);
+        const uint64_t size = deserialized_size.first;
+        current_position += deserialized_size.second;
+        // Copy the items out as one block
+        const uint64_t data_bytes = size * sizeof(T);
+        assert(size <= (buffer.size() - current_position) / sizeof(T));
+        std::vector<T, Allocator> deserialized(size);
+        if (data_bytes > 0)
+        {
+            memcpy(deserialized.data(), &buffer[current_position], data_bytes);
+            if (swap_bytes)
+            {
+                SwapItemBytes<T>(deserialized.data(), size);
+            }
+        }
+        current_position += data_bytes;
+        // Figure out how many bytes were read
+        const uint64_t bytes_read = current_position - current;
+        return std::make_pair(std::move(deserialized), bytes_read);
+    }
+
     template<typename T, typename Allocator>
     inline uint64_t SerializeVector(const std::vector<T, Allocator>& vec_to_serialize, std::vector<uint8_t>& buffer, const std::function<uint64_t(const T&, std::vector<uint8_t>&)>& item_serializer)
     {
@@ -1337,7 +1470,7 @@ namespace arc_helpers
         deserialized.shrink_to_fit();
         // Figure out how many bytes were read
         const uint64_t bytes_read = current_position - current;
-        return std::make_pair(deserialized, bytes_read);
+        return std::make_pair(std::move(deserialized), bytes_read);
     }
 
     template<typename Key, typename T, typename Compare, typename Allocator>
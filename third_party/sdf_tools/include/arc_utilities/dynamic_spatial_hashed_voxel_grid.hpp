@@ -41,6 +41,8 @@ namespace VoxelGrid
         }
     };
 
+    // A chunk of the grid: either one value for the whole chunk, or cells stored in a block of the
+    // grid's cell pool. The chunk does not own its cells, the grid does.
     template<typename T, typename Allocator=std::allocator<T>>
     class DynamicSpatialHashedVoxelGridChunk
     {
@@ -48,7 +50,9 @@ namespace VoxelGrid
 
         CHUNK_REGION region_;
         T initial_value_;
-        std::vector<T, Allocator> data_;
+        T chunk_value_;
+        T* data_;
+        int64_t cell_block_;
         double cell_x_size_;
         double cell_y_size_;
         double cell_z_size_;
@@ -193,7 +197,9 @@ namespace VoxelGrid
 
         EIGEN_MAKE_ALIGNED_OPERATOR_NEW
 
-        DynamicSpatialHashedVoxelGridChunk(const CHUNK_REGION& region, const double cell_x_size, const double cell_y_size, const double cell_z_size, const int64_t num_x_cells, const int64_t num_y_cells, const int64_t num_z_cells, const T& initial_value)
+        // Cells are taken from data, which must hold num_x_cells * num_y_cells * num_z_cells values
+        // that stay valid as long as the chunk; cell_block identifies them to the pool
+        DynamicSpatialHashedVoxelGridChunk(const CHUNK_REGION& region, const double cell_x_size, const double cell_y_size, const double cell_z_size, const int64_t num_x_cells, const int64_t num_y_cells, const int64_t num_z_cells, const T& initial_value, T* data, const int64_t cell_block)
         {
             SafetyCheckSizes(cell_x_size, cell_y_size, cell_z_size, num_x_cells, num_y_cells, num_z_cells);
             cell_x_size_ = fabs(cell_x_size);
@@ -211,7 +217,9 @@ namespace VoxelGrid
             stride1_ = num_y_cells_ * num_z_cells_;
             stride2_ = num_z_cells_;
             initial_value_ = initial_value;
-            data_.resize(num_x_cells_ * num_y_cells_ * num_z_cells_, initial_value);
+            chunk_value_ = initial_value;
+            data_ = data;
+            cell_block_ = cell_block;
         }
 
         DynamicSpatialHashedVoxelGridChunk(const CHUNK_REGION& region, const double chunk_x_size, const double chunk_y_size, const double chunk_z_size, const T& initial_value)
@@ -230,13 +238,17 @@ namespace VoxelGrid
             stride2_ = num_z_cells_;
             region_ = region;
             initial_value_ = initial_value;
-            data_.resize(1, initial_value);
+            chunk_value_ = initial_value;
+            data_ = &chunk_value_;
+            cell_block_ = -1;
             cell_initialized_ = false;
             chunk_initialized_ = true;
         }
 
         DynamicSpatialHashedVoxelGridChunk()
         {
+            data_ = NULL;
+            cell_block_ = -1;
             cell_x_size_ = 0.0;
             cell_y_size_ = 0.0;
             cell_z_size_ = 0.0;
@@ -252,6 +264,52 @@ namespace VoxelGrid
             chunk_initialized_ = false;
         }
 
+        // A chunk-initialized chunk points at its own value, so it must be re-pointed when copied
+        DynamicSpatialHashedVoxelGridChunk(const DynamicSpatialHashedVoxelGridChunk& other)
+        {
+            *this = other;
+        }
+
+        DynamicSpatialHashedVoxelGridChunk& operator=(const DynamicSpatialHashedVoxelGridChunk& other)
+        {
+            region_ = other.region_;
+            initial_value_ = other.initial_value_;
+            chunk_value_ = other.chunk_value_;
+            data_ = other.chunk_initialized_ ? &chunk_value_ : other.data_;
+            cell_block_ = other.cell_block_;
+            cell_x_size_ = other.cell_x_size_;
+            cell_y_size_ = other.cell_y_size_;
+            cell_z_size_ = other.cell_z_size_;
+            chunk_x_size_ = other.chunk_x_size_;
+            chunk_y_size_ = other.chunk_y_size_;
+            chunk_z_size_ = other.chunk_z_size_;
+            num_x_cells_ = other.num_x_cells_;
+            num_y_cells_ = other.num_y_cells_;
+            num_z_cells_ = other.num_z_cells_;
+            stride1_ = other.stride1_;
+            stride2_ = other.stride2_;
+            chunk_initialized_ = other.chunk_initialized_;
+            cell_initialized_ = other.cell_initialized_;
+            return *this;
+        }
+
+        // Used by the grid when it copies its cell pool
+        inline void RebindCells(T* data)
+        {
+            assert(cell_initialized_);
+            data_ = data;
+        }
+
+        inline int64_t GetCellBlock() const
+        {
+            return cell_block_;
+        }
+
+        inline const CHUNK_REGION& GetRegion() const
+        {
+            return region_;
+        }
+
         bool IsCellInitialized() const
         {
             return cell_initialized_;
@@ -279,9 +337,7 @@ namespace VoxelGrid
             assert(chunk_initialized_ || cell_initialized_);
             if (IndexInBounds(x_index, y_index, z_index))
             {
-                int64_t data_index = GetDataIndex(x_index, y_index, z_index);
-                assert(data_index >= 0 && data_index < (int64_t)data_.size());
-                return std::pair<const T&, bool>(data_[data_index], true);
+                return std::pair<const T&, bool>(data_[GetDataIndex(x_index, y_index, z_index)], true);
             }
             else
             {
@@ -294,9 +350,7 @@ namespace VoxelGrid
             assert(chunk_initialized_ || cell_initialized_);
             if (IndexInBounds(x_index, y_index, z_index))
             {
-                int64_t data_index = GetDataIndex(x_index, y_index, z_index);
-                assert(data_index >= 0 && data_index < (int64_t)data_.size());
-                return std::pair<T&, bool>(data_[data_index], true);
+                return std::pair<T&, bool>(data_[GetDataIndex(x_index, y_index, z_index)], true);
             }
             else
             {
@@ -304,13 +358,23 @@ namespace VoxelGrid
             }
         }
 
+        // Unchecked cell access for the grid, data_index being x * stride1 + y * stride2 + z
+        inline const T& GetImmutableByDataIndex(const int64_t data_index) const
+        {
+            return data_[data_index];
+        }
+
+        inline T& GetMutableByDataIndex(const int64_t data_index)
+        {
+            return data_[data_index];
+        }
+
         inline std::pair<T&, bool> GetCellMutable(const Eigen::Vector3d& location)
         {
             assert(cell_initialized_);
             int64_t data_index = GetLocationDataIndex(location);
             if (data_index >= 0)
             {
-                assert(data_index < data_.size());
                 return std::pair<T&, bool>(data_[data_index], true);
             }
             else
@@ -325,7 +389,6 @@ namespace VoxelGrid
             int64_t data_index = GetLocationDataIndex(location);
             if (data_index >= 0)
             {
-                assert(data_index < (int64_t)data_.size());
                 return std::pair<const T&, bool>(data_[data_index], true);
             }
             else
@@ -337,15 +400,13 @@ namespace VoxelGrid
         inline T& GetChunkMutable()
         {
             assert(chunk_initialized_);
-            assert(data_.size() == 1);
-            return data_[0];
+            return chunk_value_;
         }
 
         inline const T& GetChunkImmutable() const
         {
             assert(chunk_initialized_);
-            assert(data_.size() == 1);
-            return data_[0];
+            return chunk_value_;
         }
 
         inline bool SetCellValue(const Eigen::Vector3d& location, const T& value)
@@ -354,23 +415,6 @@ namespace VoxelGrid
             int64_t data_index = GetLocationDataIndex(location);
             if (data_index >= 0)
             {
-                assert(data_index < (int64_t)data_.size());
-                data_[data_index] = value;
-                return true;
-            }
-            else
-            {
-                return false;
-            }
-        }
-
-        inline bool SetCellValue(const Eigen::Vector3d& location, T&& value)
-        {
-            assert(cell_initialized_);
-            int64_t data_index = GetLocationDataIndex(location);
-            if (data_index >= 0)
-            {
-                assert(data_index < data_.size());
                 data_[data_index] = value;
                 return true;
             }
@@ -383,16 +427,7 @@ namespace VoxelGrid
         inline bool SetChunkValue(const T& value)
         {
             assert(chunk_initialized_);
-            assert(data_.size() == 1);
-            data_[0] = value;
-            return true;
-        }
-
-        inline bool SetChunkValue(T&& value)
-        {
-            assert(chunk_initialized_);
-            assert(data_.size() == 1);
-            data_[0] = value;
+            chunk_value_ = value;
             return true;
         }
 
@@ -453,26 +488,59 @@ namespace VoxelGrid
 
     enum SET_STATUS {NOT_SET, SET_CHUNK, SET_CELL};
 
+    // Grid of chunks allocated on demand, so that it covers any region and its memory grows with
+    // the region actually written. Chunks are found through an open-addressing table keyed by
+    // their integer coordinates, and their cells are fixed-size blocks handed out from slabs of
+    // the cell pool, which are reused when a chunk is collapsed to one value or the grid cleared.
+    // References returned by GetMutable stay valid until the next chunk is added.
     template<typename T, typename Allocator=std::allocator<T>>
     class DynamicSpatialHashedVoxelGrid
     {
     protected:
 
+        // Slot of the chunk table: coordinates of the chunk, its index in chunks_ (-1 if the slot is
+        // empty), its cells (NULL if the chunk holds one value), so that a lookup only reads the
+        // table and the cell, and the epoch of its last change
+        struct CHUNK_SLOT
+        {
+            int64_t x;
+            int64_t y;
+            int64_t z;
+            int64_t chunk;
+            T* cells;
+            uint64_t modified;
+        };
+
         Eigen::Affine3d origin_transform_;
         Eigen::Affine3d inverse_origin_transform_;
         T default_value_;
-        std::unordered_map<CHUNK_REGION, DynamicSpatialHashedVoxelGridChunk<T, Allocator>> chunks_;
+        std::vector<DynamicSpatialHashedVoxelGridChunk<T, Allocator>> chunks_;
+        std::vector<CHUNK_SLOT> chunk_table_;
+        uint64_t chunk_table_mask_;
+        std::vector<std::vector<T, Allocator>> cell_slabs_;
+        std::vector<int64_t> free_cell_blocks_;
+        int64_t num_cell_blocks_;
+        int64_t cell_blocks_per_slab_;
         double chunk_x_size_;
         double chunk_y_size_;
         double chunk_z_size_;
         double cell_x_size_;
         double cell_y_size_;
         double cell_z_size_;
+        double inv_cell_x_size_;
+        double inv_cell_y_size_;
+        double inv_cell_z_size_;
         int64_t chunk_num_x_cells_;
         int64_t chunk_num_y_cells_;
         int64_t chunk_num_z_cells_;
+        int64_t chunk_num_cells_;
         int64_t chunk_stride1_;
         int64_t chunk_stride2_;
+        int chunk_x_shift_;
+        int chunk_y_shift_;
+        int chunk_z_shift_;
+        uint64_t epoch_;
+        uint64_t reset_epoch_;
         bool initialized_;
 
         inline void SafetyCheckSizes(const double cell_x_size, const double cell_y_size, const double cell_z_size, const int64_t chunk_num_x_cells,const int64_t chunk_num_y_cells, const int64_t chunk_num_z_cells) const
@@ -533,16 +601,278 @@ namespace VoxelGrid
             cell_x_size_ = fabs(cell_x_size);
             cell_y_size_ = fabs(cell_y_size);
             cell_z_size_ = fabs(cell_z_size);
+            inv_cell_x_size_ = 1.0 / cell_x_size_;
+            inv_cell_y_size_ = 1.0 / cell_y_size_;
+            inv_cell_z_size_ = 1.0 / cell_z_size_;
             chunk_num_x_cells_ = chunk_num_x_cells;
             chunk_num_y_cells_ = chunk_num_y_cells;
             chunk_num_z_cells_ = chunk_num_z_cells;
+            chunk_num_cells_ = chunk_num_x_cells_ * chunk_num_y_cells_ * chunk_num_z_cells_;
             chunk_x_size_ = cell_x_size_ * (double)chunk_num_x_cells_;
             chunk_y_size_ = cell_y_size_ * (double)chunk_num_y_cells_;
             chunk_z_size_ = cell_z_size_ * (double)chunk_num_z_cells_;
             default_value_ = default_value;
             chunk_stride1_ = chunk_num_y_cells_ * chunk_num_z_cells_;
             chunk_stride2_ = chunk_num_z_cells_;
+            chunk_x_shift_ = PowerOfTwoShift(chunk_num_x_cells_);
+            chunk_y_shift_ = PowerOfTwoShift(chunk_num_y_cells_);
+            chunk_z_shift_ = PowerOfTwoShift(chunk_num_z_cells_);
+            // Slabs of about 1 MB
+            cell_blocks_per_slab_ = std::max((int64_t)1, (int64_t)(1048576 / (chunk_num_cells_ * (int64_t)sizeof(T))));
             chunks_.clear();
+            cell_slabs_.clear();
+            free_cell_blocks_.clear();
+            num_cell_blocks_ = 0;
+            chunk_table_.assign(64, CHUNK_SLOT{0, 0, 0, -1, NULL, 0});
+            chunk_table_mask_ = 63;
+            epoch_ = 1;
+            reset_epoch_ = 1;
+        }
+
+        static inline uint64_t HashChunk(const int64_t x, const int64_t y, const int64_t z)
+        {
+            uint64_t hash = ((uint64_t)x * 0x9E3779B97F4A7C15ull) ^ ((uint64_t)y * 0xC2B2AE3D27D4EB4Full) ^ ((uint64_t)z * 0x165667B19E3779F9ull);
+            return hash ^ (hash >> 29);
+        }
+
+        // log2 of a power of two, -1 for anything else
+        static inline int PowerOfTwoShift(const int64_t value)
+        {
+            for (int shift = 0; shift < 62; shift++)
+            {
+                if (((int64_t)1 << shift) == value)
+                {
+                    return shift;
+                }
+            }
+            return -1;
+        }
+
+        // Floor division, by a shift when the chunk side is a power of two
+        static inline int64_t FloorDivide(const int64_t value, const int64_t divisor, const int shift)
+        {
+            if (shift >= 0)
+            {
+                return value >> shift;
+            }
+            const int64_t quotient = value / divisor;
+            return ((value % divisor) != 0 && value < 0) ? quotient - 1 : quotient;
+        }
+
+        inline void GetChunkCoordinates(const int64_t x_index, const int64_t y_index, const int64_t z_index, int64_t& x_chunk, int64_t& y_chunk, int64_t& z_chunk) const
+        {
+            x_chunk = FloorDivide(x_index, chunk_num_x_cells_, chunk_x_shift_);
+            y_chunk = FloorDivide(y_index, chunk_num_y_cells_, chunk_y_shift_);
+            z_chunk = FloorDivide(z_index, chunk_num_z_cells_, chunk_z_shift_);
+        }
+
+        inline const CHUNK_SLOT* FindSlot(const int64_t x, const int64_t y, const int64_t z) const
+        {
+            uint64_t slot = HashChunk(x, y, z) & chunk_table_mask_;
+            while (true)
+            {
+                const CHUNK_SLOT& current = chunk_table_[slot];
+                if (current.chunk < 0)
+                {
+                    return NULL;
+                }
+                else if (current.x == x && current.y == y && current.z == z)
+                {
+                    return &current;
+                }
+                slot = (slot + 1) & chunk_table_mask_;
+            }
+        }
+
+        inline CHUNK_SLOT* FindSlot(const int64_t x, const int64_t y, const int64_t z)
+        {
+            return const_cast<CHUNK_SLOT*>(static_cast<const DynamicSpatialHashedVoxelGrid*>(this)->FindSlot(x, y, z));
+        }
+
+        inline CHUNK_SLOT* InsertSlot(std::vector<CHUNK_SLOT>& table, const uint64_t mask, const CHUNK_SLOT& new_slot) const
+        {
+            uint64_t slot = HashChunk(new_slot.x, new_slot.y, new_slot.z) & mask;
+            while (table[slot].chunk >= 0)
+            {
+                slot = (slot + 1) & mask;
+            }
+            table[slot] = new_slot;
+            return &table[slot];
+        }
+
+        // Adds a chunk, keeping the table at most half full
+        inline CHUNK_SLOT* InsertChunk(const int64_t x, const int64_t y, const int64_t z, const DynamicSpatialHashedVoxelGridChunk<T, Allocator>& chunk)
+        {
+            if ((chunks_.size() + 1) * 2 > chunk_table_.size())
+            {
+                std::vector<CHUNK_SLOT> new_table(chunk_table_.size() * 2, CHUNK_SLOT{0, 0, 0, -1, NULL, 0});
+                const uint64_t new_mask = new_table.size() - 1;
+                for (size_t idx = 0; idx < chunk_table_.size(); idx++)
+                {
+                    if (chunk_table_[idx].chunk >= 0)
+                    {
+                        InsertSlot(new_table, new_mask, chunk_table_[idx]);
+                    }
+                }
+                chunk_table_.swap(new_table);
+                chunk_table_mask_ = new_mask;
+            }
+            const int64_t chunk_index = (int64_t)chunks_.size();
+            chunks_.push_back(chunk);
+            T* cells = chunk.IsCellInitialized() ? GetCellBlockData(chunk.GetCellBlock()) : NULL;
+            return InsertSlot(chunk_table_, chunk_table_mask_, CHUNK_SLOT{x, y, z, chunk_index, cells, epoch_});
+        }
+
+        inline T* GetCellBlockData(const int64_t cell_block)
+        {
+            return &cell_slabs_[cell_block / cell_blocks_per_slab_][(cell_block % cell_blocks_per_slab_) * chunk_num_cells_];
+        }
+
+        inline int64_t AllocateCellBlock(const T& initial_value)
+        {
+            int64_t cell_block = 0;
+            if (free_cell_blocks_.size() > 0)
+            {
+                cell_block = free_cell_blocks_.back();
+                free_cell_blocks_.pop_back();
+            }
+            else
+            {
+                if (num_cell_blocks_ == (int64_t)cell_slabs_.size() * cell_blocks_per_slab_)
+                {
+                    cell_slabs_.push_back(std::vector<T, Allocator>(cell_blocks_per_slab_ * chunk_num_cells_, default_value_));
+                }
+                cell_block = num_cell_blocks_;
+                num_cell_blocks_++;
+            }
+            T* data = GetCellBlockData(cell_block);
+            std::fill(data, data + chunk_num_cells_, initial_value);
+            return cell_block;
+        }
+
+        inline DynamicSpatialHashedVoxelGridChunk<T, Allocator> MakeCellChunk(const int64_t x, const int64_t y, const int64_t z, const T& initial_value)
+        {
+            const int64_t cell_block = AllocateCellBlock(initial_value);
+            return DynamicSpatialHashedVoxelGridChunk<T, Allocator>(GetChunkRegion(x, y, z), cell_x_size_, cell_y_size_, cell_z_size_, chunk_num_x_cells_, chunk_num_y_cells_, chunk_num_z_cells_, default_value_, GetCellBlockData(cell_block), cell_block);
+        }
+
+        inline CHUNK_REGION GetChunkRegion(const int64_t x, const int64_t y, const int64_t z) const
+        {
+            return CHUNK_REGION((double)x * chunk_x_size_, (double)y * chunk_y_size_, (double)z * chunk_z_size_);
+        }
+
+        inline void GridLocationToGridIndex(const Eigen::Vector3d& grid_location, int64_t& x_index, int64_t& y_index, int64_t& z_index) const
+        {
+            x_index = (int64_t)std::floor(grid_location.x() * inv_cell_x_size_);
+            y_index = (int64_t)std::floor(grid_location.y() * inv_cell_y_size_);
+            z_index = (int64_t)std::floor(grid_location.z() * inv_cell_z_size_);
+        }
+
+        // Slot of the chunk holding a cell, NULL if there is none, and the index of the cell in the chunk
+        inline const CHUNK_SLOT* FindCell(const int64_t x_index, const int64_t y_index, const int64_t z_index, int64_t& data_index) const
+        {
+            int64_t x_chunk = 0;
+            int64_t y_chunk = 0;
+            int64_t z_chunk = 0;
+            GetChunkCoordinates(x_index, y_index, z_index, x_chunk, y_chunk, z_chunk);
+            const int64_t x_cell = x_index - x_chunk * chunk_num_x_cells_;
+            const int64_t y_cell = y_index - y_chunk * chunk_num_y_cells_;
+            const int64_t z_cell = z_index - z_chunk * chunk_num_z_cells_;
+            data_index = (x_cell * chunk_stride1_) + (y_cell * chunk_stride2_) + z_cell;
+            return FindSlot(x_chunk, y_chunk, z_chunk);
+        }
+
+        inline CHUNK_SLOT* FindCell(const int64_t x_index, const int64_t y_index, const int64_t z_index, int64_t& data_index)
+        {
+            return const_cast<CHUNK_SLOT*>(static_cast<const DynamicSpatialHashedVoxelGrid*>(this)->FindCell(x_index, y_index, z_index, data_index));
+        }
+
+        // Slot of a chunk holding cells, adding the chunk or splitting its value into cells if needed
+        inline CHUNK_SLOT* GetCellChunkSlot(const int64_t x_chunk, const int64_t y_chunk, const int64_t z_chunk)
+        {
+            CHUNK_SLOT* slot = FindSlot(x_chunk, y_chunk, z_chunk);
+            if (slot == NULL)
+            {
+                // Make a new chunk
+                slot = InsertChunk(x_chunk, y_chunk, z_chunk, MakeCellChunk(x_chunk, y_chunk, z_chunk, default_value_));
+            }
+            else if (slot->cells == NULL)
+            {
+                // Split the chunk into cells holding its value
+                chunks_[slot->chunk] = MakeCellChunk(x_chunk, y_chunk, z_chunk, chunks_[slot->chunk].GetChunkImmutable());
+                slot->cells = GetCellBlockData(chunks_[slot->chunk].GetCellBlock());
+            }
+            slot->modified = epoch_;
+            return slot;
+        }
+
+        inline CHUNK_SLOT* SetChunkSlotValue(const int64_t x_chunk, const int64_t y_chunk, const int64_t z_chunk, const T& value)
+        {
+            const DynamicSpatialHashedVoxelGridChunk<T, Allocator> new_chunk(GetChunkRegion(x_chunk, y_chunk, z_chunk), chunk_x_size_, chunk_y_size_, chunk_z_size_, value);
+            CHUNK_SLOT* slot = FindSlot(x_chunk, y_chunk, z_chunk);
+            if (slot == NULL)
+            {
+                return InsertChunk(x_chunk, y_chunk, z_chunk, new_chunk);
+            }
+            // The cells of the chunk go back to the pool
+            if (slot->cells != NULL)
+            {
+                free_cell_blocks_.push_back(chunks_[slot->chunk].GetCellBlock());
+                slot->cells = NULL;
+            }
+            chunks_[slot->chunk] = new_chunk;
+            slot->modified = epoch_;
+            return slot;
+        }
+
+        inline void CopyFrom(const DynamicSpatialHashedVoxelGrid& other)
+        {
+            origin_transform_ = other.origin_transform_;
+            inverse_origin_transform_ = other.inverse_origin_transform_;
+            default_value_ = other.default_value_;
+            chunks_ = other.chunks_;
+            chunk_table_ = other.chunk_table_;
+            chunk_table_mask_ = other.chunk_table_mask_;
+            cell_slabs_ = other.cell_slabs_;
+            free_cell_blocks_ = other.free_cell_blocks_;
+            num_cell_blocks_ = other.num_cell_blocks_;
+            cell_blocks_per_slab_ = other.cell_blocks_per_slab_;
+            chunk_x_size_ = other.chunk_x_size_;
+            chunk_y_size_ = other.chunk_y_size_;
+            chunk_z_size_ = other.chunk_z_size_;
+            cell_x_size_ = other.cell_x_size_;
+            cell_y_size_ = other.cell_y_size_;
+            cell_z_size_ = other.cell_z_size_;
+            inv_cell_x_size_ = other.inv_cell_x_size_;
+            inv_cell_y_size_ = other.inv_cell_y_size_;
+            inv_cell_z_size_ = other.inv_cell_z_size_;
+            chunk_num_x_cells_ = other.chunk_num_x_cells_;
+            chunk_num_y_cells_ = other.chunk_num_y_cells_;
+            chunk_num_z_cells_ = other.chunk_num_z_cells_;
+            chunk_num_cells_ = other.chunk_num_cells_;
+            chunk_stride1_ = other.chunk_stride1_;
+            chunk_stride2_ = other.chunk_stride2_;
+            chunk_x_shift_ = other.chunk_x_shift_;
+            chunk_y_shift_ = other.chunk_y_shift_;
+            chunk_z_shift_ = other.chunk_z_shift_;
+            epoch_ = other.epoch_;
+            reset_epoch_ = other.reset_epoch_;
+            initialized_ = other.initialized_;
+            // The copied chunks and slots still point into the other grid's pool
+            for (size_t idx = 0; idx < chunks_.size(); idx++)
+            {
+                if (chunks_[idx].IsCellInitialized())
+                {
+                    chunks_[idx].RebindCells(GetCellBlockData(chunks_[idx].GetCellBlock()));
+                }
+            }
+            for (size_t idx = 0; idx < chunk_table_.size(); idx++)
+            {
+                if (chunk_table_[idx].cells != NULL)
+                {
+                    chunk_table_[idx].cells = GetCellBlockData(chunks_[chunk_table_[idx].chunk].GetCellBlock());
+                }
+            }
         }
 
     public:
@@ -576,17 +906,49 @@ namespace VoxelGrid
             cell_x_size_ = 0.0;
             cell_y_size_ = 0.0;
             cell_z_size_ = 0.0;
+            inv_cell_x_size_ = 0.0;
+            inv_cell_y_size_ = 0.0;
+            inv_cell_z_size_ = 0.0;
             chunk_num_x_cells_ = 0;
             chunk_num_y_cells_ = 0;
             chunk_num_z_cells_ = 0;
+            chunk_num_cells_ = 0;
             chunk_x_size_ = cell_x_size_ * (double)chunk_num_x_cells_;
             chunk_y_size_ = cell_y_size_ * (double)chunk_num_y_cells_;
             chunk_z_size_ = cell_z_size_ * (double)chunk_num_z_cells_;
             chunk_stride1_ = chunk_num_y_cells_ * chunk_num_z_cells_;
             chunk_stride2_ = chunk_num_z_cells_;
+            chunk_x_shift_ = -1;
+            chunk_y_shift_ = -1;
+            chunk_z_shift_ = -1;
+            num_cell_blocks_ = 0;
+            cell_blocks_per_slab_ = 1;
+            chunk_table_.assign(64, CHUNK_SLOT{0, 0, 0, -1, NULL, 0});
+            chunk_table_mask_ = 63;
+            epoch_ = 1;
+            reset_epoch_ = 1;
             initialized_ = true;
         }
 
+        DynamicSpatialHashedVoxelGrid(const DynamicSpatialHashedVoxelGrid& other)
+        {
+            CopyFrom(other);
+        }
+
+        DynamicSpatialHashedVoxelGrid& operator=(const DynamicSpatialHashedVoxelGrid& other)
+        {
+            if (this != &other)
+            {
+                CopyFrom(other);
+            }
+            return *this;
+        }
+
+        // Moving keeps the buffers of the pool, so the chunks can keep pointing into them
+        DynamicSpatialHashedVoxelGrid(DynamicSpatialHashedVoxelGrid&& other) = default;
+
+        DynamicSpatialHashedVoxelGrid& operator=(DynamicSpatialHashedVoxelGrid&& other) = default;
+
         inline void Initialize(const Eigen::Affine3d& origin_transform, const double cell_x_size, const double cell_y_size, const double cell_z_size, const int64_t chunk_num_x_cells, const int64_t chunk_num_y_cells, const int64_t chunk_num_z_cells, const T& default_value)
         {
             SafetyCheckSizes(cell_x_size, cell_y_size, cell_z_size, chunk_num_x_cells, chunk_num_y_cells, chunk_num_z_cells);
@@ -610,40 +972,108 @@ namespace VoxelGrid
             return initialized_;
         }
 
-        inline std::pair<const T&, FOUND_STATUS> GetImmutable(const double x, const double y, const double z) const
+        // Drops every chunk, keeping the table and the pool for the chunks added next
+        inline void ClearChunks()
         {
-            Eigen::Vector3d location(x, y, z);
-            return GetImmutable(location);
+            for (size_t idx = 0; idx < chunks_.size(); idx++)
+            {
+                if (chunks_[idx].IsCellInitialized())
+                {
+                    free_cell_blocks_.push_back(chunks_[idx].GetCellBlock());
+                }
+            }
+            chunks_.clear();
+            std::fill(chunk_table_.begin(), chunk_table_.end(), CHUNK_SLOT{0, 0, 0, -1, NULL, 0});
+            reset_epoch_ = epoch_;
         }
 
-        inline std::pair<T&, FOUND_STATUS> GetMutable(const double x, const double y, const double z)
+        // Sets every chunk holding cells back to the default value, stamped with the current epoch.
+        // Chunks holding one value are left as they are. Unlike ClearChunks, a copy brought up to date
+        // by UpdateFrom then only copies the chunks reset or changed since, not the whole grid
+        inline void ResetCellChunks()
         {
-            Eigen::Vector3d location(x, y, z);
-            return GetMutable(location);
+            for (size_t idx = 0; idx < chunk_table_.size(); idx++)
+            {
+                const CHUNK_SLOT& slot = chunk_table_[idx];
+                if (slot.chunk >= 0 && slot.cells != NULL)
+                {
+                    SetChunkSlotValue(slot.x, slot.y, slot.z, default_value_);
+                }
+            }
         }
 
-        inline SET_STATUS SetCellValue(const double x, const double y, const double z, const T& value)
+        // Changes are stamped with the current epoch, so that a copy of the grid can be brought up to
+        // date from it by UpdateFrom
+        inline uint64_t GetEpoch() const
+        {
+            return epoch_;
+        }
+
+        inline uint64_t AdvanceEpoch()
+        {
+            epoch_++;
+            return epoch_;
+        }
+
+        // Makes this grid, a copy of source as it was at the end of epoch since (or anything, if since
+        // is 0), equal to source by copying the chunks changed after that epoch. The whole grid is
+        // copied if source was cleared or reinitialized since.
+        inline void UpdateFrom(const DynamicSpatialHashedVoxelGrid& source, const uint64_t since)
+        {
+            if (this == &source)
+            {
+                return;
+            }
+            if (since == 0 || source.reset_epoch_ > since || !initialized_)
+            {
+                CopyFrom(source);
+                return;
+            }
+            for (size_t idx = 0; idx < source.chunk_table_.size(); idx++)
+            {
+                const CHUNK_SLOT& source_slot = source.chunk_table_[idx];
+                if (source_slot.chunk < 0 || source_slot.modified <= since)
+                {
+                    continue;
+                }
+                CHUNK_SLOT* slot = NULL;
+                if (source_slot.cells != NULL)
+                {
+                    slot = GetCellChunkSlot(source_slot.x, source_slot.y, source_slot.z);
+                    std::copy(source_slot.cells, source_slot.cells + chunk_num_cells_, slot->cells);
+                }
+                else
+                {
+                    slot = SetChunkSlotValue(source_slot.x, source_slot.y, source_slot.z, source.chunks_[source_slot.chunk].GetChunkImmutable());
+                }
+                slot->modified = source_slot.modified;
+            }
+            epoch_ = source.epoch_;
+            reset_epoch_ = source.reset_epoch_;
+        }
+
+        inline std::pair<const T&, FOUND_STATUS> GetImmutable(const double x, const double y, const double z) const
         {
             Eigen::Vector3d location(x, y, z);
-            return SetCellValue(location, value);
+            return GetImmutable(location);
         }
 
-        inline SET_STATUS SetCellValue(const double x, const double y, const double z, T&& value)
+        inline std::pair<T&, FOUND_STATUS> GetMutable(const double x, const double y, const double z)
         {
             Eigen::Vector3d location(x, y, z);
-            return SetCellValue(location, value);
+            return GetMutable(location);
         }
 
-        inline SET_STATUS SetChunkValue(const double x, const double y, const double z, const T& value)
+        inline SET_STATUS SetCellValue(const double x, const double y, const double z, const T& value)
         {
             Eigen::Vector3d location(x, y, z);
             return SetCellValue(location, value);
         }
 
-        inline SET_STATUS SetChunkValue(const double x, const double y, const double z, T&& value)
+        inline SET_STATUS SetChunkValue(const double x, const double y, const double z, const T& value)
         {
             Eigen::Vector3d location(x, y, z);
-            return SetCellValue(location, value);
+            return SetChunkValue(location, value);
         }
 
         inline CHUNK_REGION GetContainingChunkRegion(const Eigen::Vector3d& grid_location) const
@@ -656,305 +1086,119 @@ namespace VoxelGrid
             int64_t x_chunk_num = (int64_t)floor(raw_x_chunk_num);
             int64_t y_chunk_num = (int64_t)floor(raw_y_chunk_num);
             int64_t z_chunk_num = (int64_t)floor(raw_z_chunk_num);
-            double region_base_x = (double)x_chunk_num * chunk_x_size_;
-            double region_base_y = (double)y_chunk_num * chunk_y_size_;
-            double region_base_z = (double)z_chunk_num * chunk_z_size_;
-            CHUNK_REGION region(region_base_x, region_base_y, region_base_z);
-            return region;
+            return GetChunkRegion(x_chunk_num, y_chunk_num, z_chunk_num);
         }
 
-        inline std::pair<const T&, FOUND_STATUS> GetImmutable(const Eigen::Vector3d& location) const
+        // Index of the cell holding a location, counted from the origin of the grid in any direction
+        inline void LocationToGridIndex(const Eigen::Vector3d& location, int64_t& x_index, int64_t& y_index, int64_t& z_index) const
         {
             assert(initialized_);
-            Eigen::Vector3d grid_location = inverse_origin_transform_ * location;
-            CHUNK_REGION region = GetContainingChunkRegion(grid_location);
-            auto found_chunk_itr = chunks_.find(region);
-            if (found_chunk_itr != chunks_.end())
-            {
-                const DynamicSpatialHashedVoxelGridChunk<T>& chunk = found_chunk_itr->second;
-                if (chunk.IsCellInitialized())
-                {
-                    // Get the data
-                    std::pair<const T&, bool> found_in_cell = chunk.GetCellImmutable(grid_location);
-                    if (found_in_cell.second)
-                    {
-                        return std::pair<const T&, FOUND_STATUS>(found_in_cell.first, FOUND_IN_CELL);
-                    }
-                    else
-                    {
-                        return std::pair<const T&, FOUND_STATUS>(default_value_, NOT_FOUND);
-                    }
-                }
-                else if (chunk.IsChunkInitialized())
-                {
-                    return std::pair<const T&, FOUND_STATUS>(chunk.GetChunkImmutable(), FOUND_IN_CHUNK);
-                }
-                else
-                {
-                    return std::pair<const T&, FOUND_STATUS>(default_value_, NOT_FOUND);
-                }
-            }
-            else
-            {
-                return std::pair<const T&, FOUND_STATUS>(default_value_, NOT_FOUND);
-            }
+            GridLocationToGridIndex(inverse_origin_transform_ * location, x_index, y_index, z_index);
         }
 
-        inline std::pair<T&, FOUND_STATUS> GetMutable(const Eigen::Vector3d& location)
+        // Center of a cell
+        inline Eigen::Vector3d GridIndexToLocation(const int64_t x_index, const int64_t y_index, const int64_t z_index) const
         {
             assert(initialized_);
-            Eigen::Vector3d grid_location = inverse_origin_transform_ * location;
-            CHUNK_REGION region = GetContainingChunkRegion(grid_location);
-            auto found_chunk_itr = chunks_.find(region);
-            if (found_chunk_itr != chunks_.end())
-            {
-                DynamicSpatialHashedVoxelGridChunk<T>& chunk = found_chunk_itr->second;
-                if (chunk.IsCellInitialized())
-                {
-                    // Get the data
-                    std::pair<T&, bool> found_in_cell = chunk.GetCellMutable(grid_location);
-                    if (found_in_cell.second)
-                    {
-                        return std::pair<T&, FOUND_STATUS>(found_in_cell.first, FOUND_IN_CELL);
-                    }
-                    else
-                    {
-                        return std::pair<T&, FOUND_STATUS>(default_value_, NOT_FOUND);
-                    }
-                }
-                else if (chunk.IsChunkInitialized())
-                {
-                    return std::pair<T&, FOUND_STATUS>(chunk.GetChunkMutable(), FOUND_IN_CHUNK);
-                }
-                else
-                {
-                    return std::pair<T&, FOUND_STATUS>(default_value_, NOT_FOUND);
-                }
-            }
-            else
-            {
-                return std::pair<T&, FOUND_STATUS>(default_value_, NOT_FOUND);
-            }
+            const Eigen::Vector3d grid_location(cell_x_size_ * ((double)x_index + 0.5), cell_y_size_ * ((double)y_index + 0.5), cell_z_size_ * ((double)z_index + 0.5));
+            return origin_transform_ * grid_location;
         }
 
-        inline SET_STATUS SetCellValue(const Eigen::Vector3d& location, const T& value)
+        inline std::pair<const T&, FOUND_STATUS> GetImmutableByIndex(const int64_t x_index, const int64_t y_index, const int64_t z_index) const
         {
             assert(initialized_);
-            Eigen::Vector3d grid_location = inverse_origin_transform_ * location;
-            CHUNK_REGION region = GetContainingChunkRegion(grid_location);
-            auto found_chunk_itr = chunks_.find(region);
-            if (found_chunk_itr != chunks_.end())
+            int64_t data_index = 0;
+            const CHUNK_SLOT* slot = FindCell(x_index, y_index, z_index, data_index);
+            if (slot == NULL)
             {
-                DynamicSpatialHashedVoxelGridChunk<T>& chunk = found_chunk_itr->second;
-                if (chunk.IsCellInitialized())
-                {
-                    if (chunk.SetCellValue(grid_location, value))
-                    {
-                        return SET_CELL;
-                    }
-                    else
-                    {
-                        return NOT_SET;
-                    }
-                }
-                else if (chunk.IsChunkInitialized())
-                {
-                    T current_chunk_value = chunk.GetChunkMutable();
-                    // Make a new chunk
-                    DynamicSpatialHashedVoxelGridChunk<T, Allocator> new_chunk(region, cell_x_size_, cell_y_size_, cell_z_size_, chunk_num_x_cells_, chunk_num_y_cells_, chunk_num_z_cells_, current_chunk_value);
-                    if (new_chunk.SetCellValue(grid_location, value))
-                    {
-                        chunks_[region] = new_chunk;
-                        return SET_CELL;
-                    }
-                    else
-                    {
-                        return NOT_SET;
-                    }
-                }
-                else
-                {
-                    // Make a new chunk
-                    DynamicSpatialHashedVoxelGridChunk<T, Allocator> new_chunk(region, cell_x_size_, cell_y_size_, cell_z_size_, chunk_num_x_cells_, chunk_num_y_cells_, chunk_num_z_cells_, default_value_);
-                    if (new_chunk.SetCellValue(grid_location, value))
-                    {
-                        chunks_[region] = new_chunk;
-                        return SET_CELL;
-                    }
-                    else
-                    {
-                        return NOT_SET;
-                    }
-                }
+                return std::pair<const T&, FOUND_STATUS>(default_value_, NOT_FOUND);
+            }
+            else if (slot->cells != NULL)
+            {
+                return std::pair<const T&, FOUND_STATUS>(slot->cells[data_index], FOUND_IN_CELL);
             }
             else
             {
-                // Make a new chunk
-                DynamicSpatialHashedVoxelGridChunk<T, Allocator> new_chunk(region, cell_x_size_, cell_y_size_, cell_z_size_, chunk_num_x_cells_, chunk_num_y_cells_, chunk_num_z_cells_, default_value_);
-                if (new_chunk.SetCellValue(grid_location, value))
-                {
-                    chunks_[region] = new_chunk;
-                    return SET_CELL;
-                }
-                else
-                {
-                    return NOT_SET;
-                }
+                return std::pair<const T&, FOUND_STATUS>(chunks_[slot->chunk].GetChunkImmutable(), FOUND_IN_CHUNK);
             }
         }
 
-        inline SET_STATUS SetCellValue(const Eigen::Vector3d& location, T&& value)
+        inline std::pair<T&, FOUND_STATUS> GetMutableByIndex(const int64_t x_index, const int64_t y_index, const int64_t z_index)
         {
             assert(initialized_);
-            Eigen::Vector3d grid_location = inverse_origin_transform_ * location;
-            CHUNK_REGION region = GetContainingChunkRegion(grid_location);
-            auto found_chunk_itr = chunks_.find(region);
-            if (found_chunk_itr != chunks_.end())
+            int64_t data_index = 0;
+            CHUNK_SLOT* slot = FindCell(x_index, y_index, z_index, data_index);
+            if (slot == NULL)
             {
-                DynamicSpatialHashedVoxelGridChunk<T, Allocator>& chunk = found_chunk_itr->second;
-                if (chunk.IsCellInitialized())
-                {
-                    if (chunk.SetCellValue(grid_location, value))
-                    {
-                        return SET_CELL;
-                    }
-                    else
-                    {
-                        return NOT_SET;
-                    }
-                }
-                else if (chunk.IsChunkInitialized())
-                {
-                    T current_chunk_value = chunk.GetChunkMutable();
-                    // Make a new chunk
-                    DynamicSpatialHashedVoxelGridChunk<T, Allocator> new_chunk(region, cell_x_size_, cell_y_size_, cell_z_size_, chunk_num_x_cells_, chunk_num_y_cells_, chunk_num_z_cells_, current_chunk_value);
-                    if (new_chunk.SetCellValue(grid_location, value))
-                    {
-                        chunks_[region] = new_chunk;
-                        return SET_CELL;
-                    }
-                    else
-                    {
-                        return NOT_SET;
-                    }
-                }
-                else
-                {
-                    // Make a new chunk
-                    DynamicSpatialHashedVoxelGridChunk<T, Allocator> new_chunk(region, cell_x_size_, cell_y_size_, cell_z_size_, chunk_num_x_cells_, chunk_num_y_cells_, chunk_num_z_cells_, default_value_);
-                    if (new_chunk.SetCellValue(grid_location, value))
-                    {
-                        chunks_[region] = new_chunk;
-                        return SET_CELL;
-                    }
-                    else
-                    {
-                        return NOT_SET;
-                    }
-                }
+                return std::pair<T&, FOUND_STATUS>(default_value_, NOT_FOUND);
+            }
+            // The caller may change the value
+            slot->modified = epoch_;
+            if (slot->cells != NULL)
+            {
+                return std::pair<T&, FOUND_STATUS>(slot->cells[data_index], FOUND_IN_CELL);
             }
             else
             {
-                // Make a new chunk
-                DynamicSpatialHashedVoxelGridChunk<T, Allocator> new_chunk(region, cell_x_size_, cell_y_size_, cell_z_size_, chunk_num_x_cells_, chunk_num_y_cells_, chunk_num_z_cells_, default_value_);
-                if (new_chunk.SetCellValue(grid_location, value))
-                {
-                    chunks_[region] = new_chunk;
-                    return SET_CELL;
-                }
-                else
-                {
-                    return NOT_SET;
-                }
+                return std::pair<T&, FOUND_STATUS>(chunks_[slot->chunk].GetChunkMutable(), FOUND_IN_CHUNK);
             }
         }
 
-        inline SET_STATUS SetChunkValue(const Eigen::Vector3d& location, const T& value)
+        inline SET_STATUS SetCellValueByIndex(const int64_t x_index, const int64_t y_index, const int64_t z_index, const T& value)
         {
             assert(initialized_);
-            Eigen::Vector3d grid_location = inverse_origin_transform_ * location;
-            CHUNK_REGION region = GetContainingChunkRegion(grid_location);
-            auto found_chunk_itr = chunks_.find(region);
-            if (found_chunk_itr != chunks_.end())
-            {
-                DynamicSpatialHashedVoxelGridChunk<T, Allocator>& chunk = found_chunk_itr->second;
-                if (chunk.IsCellInitialized())
-                {
-                    // Make a new chunk
-                    DynamicSpatialHashedVoxelGridChunk<T, Allocator> new_chunk(region, chunk_x_size_, chunk_y_size_, chunk_z_size_, value);
-                    chunks_[region] = new_chunk;
-                    return SET_CHUNK;
-                }
-                else if (chunk.IsChunkInitialized())
-                {
-                    if (chunk.SetChunkValue(value))
-                    {
-                        return SET_CHUNK;
-                    }
-                    else
-                    {
-                        return NOT_SET;
-                    }
-                }
-                else
-                {
-                    // Make a new chunk
-                    DynamicSpatialHashedVoxelGridChunk<T, Allocator> new_chunk(region, chunk_x_size_, chunk_y_size_, chunk_z_size_, value);
-                    chunks_[region] = new_chunk;
-                    return SET_CHUNK;
-                }
-            }
-            else
-            {
-                // Make a new chunk
-                DynamicSpatialHashedVoxelGridChunk<T, Allocator> new_chunk(region, chunk_x_size_, chunk_y_size_, chunk_z_size_, value);
-                chunks_[region] = new_chunk;
-                return SET_CHUNK;
-            }
+            int64_t x_chunk = 0;
+            int64_t y_chunk = 0;
+            int64_t z_chunk = 0;
+            GetChunkCoordinates(x_index, y_index, z_index, x_chunk, y_chunk, z_chunk);
+            CHUNK_SLOT* slot = GetCellChunkSlot(x_chunk, y_chunk, z_chunk);
+            const int64_t x_cell = x_index - x_chunk * chunk_num_x_cells_;
+            const int64_t y_cell = y_index - y_chunk * chunk_num_y_cells_;
+            const int64_t z_cell = z_index - z_chunk * chunk_num_z_cells_;
+            slot->cells[(x_cell * chunk_stride1_) + (y_cell * chunk_stride2_) + z_cell] = value;
+            return SET_CELL;
+        }
+
+        inline std::pair<const T&, FOUND_STATUS> GetImmutable(const Eigen::Vector3d& location) const
+        {
+            int64_t x_index = 0;
+            int64_t y_index = 0;
+            int64_t z_index = 0;
+            LocationToGridIndex(location, x_index, y_index, z_index);
+            return GetImmutableByIndex(x_index, y_index, z_index);
         }
 
-        inline SET_STATUS SetChunkValue(const Eigen::Vector3d& location, T&& value)
+        inline std::pair<T&, FOUND_STATUS> GetMutable(const Eigen::Vector3d& location)
+        {
+            int64_t x_index = 0;
+            int64_t y_index = 0;
+            int64_t z_index = 0;
+            LocationToGridIndex(location, x_index, y_index, z_index);
+            return GetMutableByIndex(x_index, y_index, z_index);
+        }
+
+        inline SET_STATUS SetCellValue(const Eigen::Vector3d& location, const T& value)
+        {
+            int64_t x_index = 0;
+            int64_t y_index = 0;
+            int64_t z_index = 0;
+            LocationToGridIndex(location, x_index, y_index, z_index);
+            return SetCellValueByIndex(x_index, y_index, z_index, value);
+        }
+
+        inline SET_STATUS SetChunkValue(const Eigen::Vector3d& location, const T& value)
         {
             assert(initialized_);
-            Eigen::Vector3d grid_location = inverse_origin_transform_ * location;
-            CHUNK_REGION region = GetContainingChunkRegion(grid_location);
-            auto found_chunk_itr = chunks_.find(region);
-            if (found_chunk_itr != chunks_.end())
-            {
-                DynamicSpatialHashedVoxelGridChunk<T, Allocator>& chunk = found_chunk_itr->second;
-                if (chunk.IsCellInitialized())
-                {
-                    // Make a new chunk
-                    DynamicSpatialHashedVoxelGridChunk<T, Allocator> new_chunk(region, chunk_x_size_, chunk_y_size_, chunk_z_size_, value);
-                    chunks_[region] = new_chunk;
-                    return SET_CHUNK;
-                }
-                else if (chunk.IsChunkInitialized())
-                {
-                    if (chunk.SetChunkValue(value))
-                    {
-                        return SET_CHUNK;
-                    }
-                    else
-                    {
-                        return NOT_SET;
-                    }
-                }
-                else
-                {
-                    // Make a new chunk
-                    DynamicSpatialHashedVoxelGridChunk<T, Allocator> new_chunk(region, chunk_x_size_, chunk_y_size_, chunk_z_size_, value);
-                    chunks_[region] = new_chunk;
-                    return SET_CHUNK;
-                }
-            }
-            else
-            {
-                // Make a new chunk
-                DynamicSpatialHashedVoxelGridChunk<T, Allocator> new_chunk(region, chunk_x_size_, chunk_y_size_, chunk_z_size_, value);
-                chunks_[region] = new_chunk;
-                return SET_CHUNK;
-            }
+            int64_t x_index = 0;
+            int64_t y_index = 0;
+            int64_t z_index = 0;
+            LocationToGridIndex(location, x_index, y_index, z_index);
+            int64_t x_chunk = 0;
+            int64_t y_chunk = 0;
+            int64_t z_chunk = 0;
+            GetChunkCoordinates(x_index, y_index, z_index, x_chunk, y_chunk, z_chunk);
+            SetChunkSlotValue(x_chunk, y_chunk, z_chunk, value);
+            return SET_CHUNK;
         }
 
         inline std::vector<double> GetCellSizes() const
@@ -980,6 +1224,7 @@ namespace VoxelGrid
         inline void SetDefaultValue(const T& default_value)
         {
             default_value_ = default_value;
+            reset_epoch_ = epoch_;
         }
 
         inline Eigen::Affine3d GetOriginTransform() const
@@ -987,7 +1232,18 @@ namespace VoxelGrid
             return origin_transform_;
         }
 
-        inline const std::unordered_map<CHUNK_REGION, DynamicSpatialHashedVoxelGridChunk<T>>& GetInternalChunks() const
+        inline size_t GetNumChunks() const
+        {
+            return chunks_.size();
+        }
+
+        // Bytes held by the chunks, the chunk table and the cell pool
+        inline size_t GetMemoryUsage() const
+        {
+            return chunks_.capacity() * sizeof(DynamicSpatialHashedVoxelGridChunk<T, Allocator>) + chunk_table_.capacity() * sizeof(CHUNK_SLOT) + cell_slabs_.size() * cell_blocks_per_slab_ * chunk_num_cells_ * sizeof(T) + free_cell_blocks_.capacity() * sizeof(int64_t);
+        }
+
+        inline const std::vector<DynamicSpatialHashedVoxelGridChunk<T, Allocator>>& GetInternalChunks() const
         {
             return chunks_;
         }
@@ -0,0 +1,144 @@
+#include <stdlib.h>
+#include <stdint.h>
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <stdexcept>
+
+#ifndef SIMPLE_KMEANS_CLUSTERING_HPP
+#define SIMPLE_KMEANS_CLUSTERING_HPP
+
+namespace simple_kmeans_clustering
+{
+    class SimpleKMeansClustering
+    {
+    private:
+
+        SimpleKMeansClustering() {}
+
+        template<typename Datatype, typename Allocator=std::allocator<Datatype>>
+        static uint32_t GetClosestCluster(const Datatype& datapoint, const std::function<double(const Datatype&, const Datatype&)>& distance_fn, const std::vector<Datatype, Allocator>& cluster_centers)
+        {
+            int64_t best_label = -1;
+            double best_distance = std::numeric_limits<double>::infinity();
+            for (size_t cluster = 0; cluster < cluster_centers.size(); cluster++)
+            {
+                const double distance = distance_fn(cluster_centers[cluster], datapoint);
+                if (best_label < 0 || distance < best_distance)
+                {
+                    best_distance = distance;
+                    best_label = (int64_t)cluster;
+                }
+            }
+            return (uint32_t)best_label;
+        }
+
+        template<typename Datatype, typename Allocator=std::allocator<Datatype>>
+        static std::vector<Datatype, Allocator> ComputeClusterCenters(const std::vector<Datatype, Allocator>& data, const std::vector<uint32_t>& cluster_labels, const std::function<Datatype(const std::vector<Datatype, Allocator>&)>& average_fn, const std::vector<Datatype, Allocator>& previous_centers)
+        {
+            std::vector<std::vector<Datatype, Allocator>> cluster_members(previous_centers.size());
+            for (size_t idx = 0; idx < data.size(); idx++)
+            {
+                cluster_members[cluster_labels[idx]].push_back(data[idx]);
+            }
+            // A cluster that lost all its members keeps its previous center
+            std::vector<Datatype, Allocator> cluster_centers = previous_centers;
+            for (size_t cluster = 0; cluster < cluster_members.size(); cluster++)
+            {
+                if (cluster_members[cluster].size() > 0)
+                {
+                    cluster_centers[cluster] = average_fn(cluster_members[cluster]);
+                }
+            }
+            return cluster_centers;
+        }
+
+        // Farthest point seeding: each new center is the datapoint farthest from the centers so far
+        template<typename Datatype, typename Allocator=std::allocator<Datatype>>
+        static std::vector<Datatype, Allocator> GetFarthestPointCenters(const std::vector<Datatype, Allocator>& data, const std::function<double(const Datatype&, const Datatype&)>& distance_fn, const uint32_t num_clusters)
+        {
+            std::vector<Datatype, Allocator> cluster_centers;
+            cluster_centers.reserve(num_clusters);
+            cluster_centers.push_back(data[0]);
+            std::vector<double> closest_distances(data.size(), std::numeric_limits<double>::infinity());
+            while (cluster_centers.size() < num_clusters)
+            {
+                size_t farthest_idx = 0;
+                double farthest_distance = -1.0;
+                for (size_t idx = 0; idx < data.size(); idx++)
+                {
+                    closest_distances[idx] = std::min(closest_distances[idx], distance_fn(cluster_centers.back(), data[idx]));
+                    if (closest_distances[idx] > farthest_distance)
+                    {
+                        farthest_distance = closest_distances[idx];
+                        farthest_idx = idx;
+                    }
+                }
+                cluster_centers.push_back(data[farthest_idx]);
+            }
+            return cluster_centers;
+        }
+
+    public:
+
+        // Lloyd's algorithm, run until the labels stop changing. Initial centers are evenly spaced
+        // datapoints, or the farthest point seeding if do_preliminary_clustering is set.
+        template<typename Datatype, typename Allocator=std::allocator<Datatype>>
+        static std::vector<uint32_t> Cluster(const std::vector<Datatype, Allocator>& data, const std::function<double(const Datatype&, const Datatype&)>& distance_fn, const std::function<Datatype(const std::vector<Datatype, Allocator>&)>& average_fn, const uint32_t num_clusters, const bool do_preliminary_clustering=false)
+        {
+            if (num_clusters == 0)
+            {
+                throw std::invalid_argument("num_clusters must be positive");
+            }
+            if (data.size() == 0)
+            {
+                return std::vector<uint32_t>();
+            }
+            if (num_clusters >= data.size())
+            {
+                std::vector<uint32_t> cluster_labels(data.size());
+                for (size_t idx = 0; idx < data.size(); idx++)
+                {
+                    cluster_labels[idx] = (uint32_t)idx;
+                }
+                return cluster_labels;
+            }
+            std::vector<Datatype, Allocator> cluster_centers;
+            if (do_preliminary_clustering)
+            {
+                cluster_centers = GetFarthestPointCenters(data, distance_fn, num_clusters);
+            }
+            else
+            {
+                for (uint32_t cluster = 0; cluster < num_clusters; cluster++)
+                {
+                    cluster_centers.push_back(data[(cluster * data.size()) / num_clusters]);
+                }
+            }
+            std::vector<uint32_t> cluster_labels(data.size(), 0u);
+            for (size_t idx = 0; idx < data.size(); idx++)
+            {
+                cluster_labels[idx] = GetClosestCluster(data[idx], distance_fn, cluster_centers);
+            }
+            bool converged = false;
+            while (!converged)
+            {
+                cluster_centers = ComputeClusterCenters(data, cluster_labels, average_fn, cluster_centers);
+                converged = true;
+                for (size_t idx = 0; idx < data.size(); idx++)
+                {
+                    const uint32_t new_label = GetClosestCluster(data[idx], distance_fn, cluster_centers);
+                    if (new_label != cluster_labels[idx])
+                    {
+                        cluster_labels[idx] = new_label;
+                        converged = false;
+                    }
+                }
+            }
+            return cluster_labels;
+        }
+    };
+}
+
+#endif // SIMPLE_KMEANS_CLUSTERING_HPP
@@ -220,6 +220,113 @@ namespace VoxelGrid
             SetContents(default_value_);
         }
 
+        inline uint64_t SerializeTransforms(std::vector<uint8_t>& buffer) const
+        {
+            const uint64_t start_buffer_size = buffer.size();
+            // Serialize the initialized
+            arc_helpers::SerializeFixedSizePOD<uint8_t>((uint8_t)initialized_, buffer);
+            // Serialize the transforms
+            EigenHelpers::Serialize<Eigen::Affine3d>(origin_transform_, buffer);
+            EigenHelpers::Serialize<Eigen::Affine3d>(inverse_origin_transform_, buffer);
+            return buffer.size() - start_buffer_size;
+        }
+
+        inline uint64_t SerializeSizes(std::vector<uint8_t>& buffer) const
+        {
+            const uint64_t start_buffer_size = buffer.size();
+            // Serialize the cell sizes
+            arc_helpers::SerializeFixedSizePOD<double>(cell_x_size_, buffer);
+            arc_helpers::SerializeFixedSizePOD<double>(cell_y_size_, buffer);
+            arc_helpers::SerializeFixedSizePOD<double>(cell_z_size_, buffer);
+            arc_helpers::SerializeFixedSizePOD<double>(inv_cell_x_size_, buffer);
+            arc_helpers::SerializeFixedSizePOD<double>(inv_cell_y_size_, buffer);
+            arc_helpers::SerializeFixedSizePOD<double>(inv_cell_z_size_, buffer);
+            // Serialize the grid sizes
+            arc_helpers::SerializeFixedSizePOD<double>(x_size_, buffer);
+            arc_helpers::SerializeFixedSizePOD<double>(y_size_, buffer);
+            arc_helpers::SerializeFixedSizePOD<double>(z_size_, buffer);
+            // Serialize the control/bounds values
+            arc_helpers::SerializeFixedSizePOD<int64_t>(stride1_, buffer);
+            arc_helpers::SerializeFixedSizePOD<int64_t>(stride2_, buffer);
+            arc_helpers::SerializeFixedSizePOD<int64_t>(num_x_cells_, buffer);
+            arc_helpers::SerializeFixedSizePOD<int64_t>(num_y_cells_, buffer);
+            arc_helpers::SerializeFixedSizePOD<int64_t>(num_z_cells_, buffer);
+            return buffer.size() - start_buffer_size;
+        }
+
+        inline uint64_t DeserializeTransforms(const std::vector<uint8_t>& buffer, const uint64_t current, const bool swap_bytes)
+        {
+            uint64_t current_position = current;
+            // Deserialize the initialized
+            const std::pair<uint8_t, uint64_t> initialized_deserialized = arc_helpers::DeserializeFixedSizePOD<uint8_t>(buffer, current_position);
+            initialized_ = (bool)initialized_deserialized.first;
+            current_position += initialized_deserialized.second;
+            // Deserialize the transforms
+            const std::pair<Eigen::Affine3d, uint64_t> origin_transform_deserialized = EigenHelpers::Deserialize<Eigen::Affine3d>(buffer, current_position);
+            origin_transform_ = origin_transform_deserialized.first;
+            current_position += origin_transform_deserialized.second;
+            const std::pair<Eigen::Affine3d, uint64_t> inverse_origin_transform_deserialized = EigenHelpers::Deserialize<Eigen::Affine3d>(buffer, current_position);
+            inverse_origin_transform_ = inverse_origin_transform_deserialized.first;
+            current_position += inverse_origin_transform_deserialized.second;
+            if (swap_bytes)
+            {
+                arc_helpers::SwapItemBytes<double>(origin_transform_.matrix().data(), 16u);
+                arc_helpers::SwapItemBytes<double>(inverse_origin_transform_.matrix().data(), 16u);
+            }
+            return current_position - current;
+        }
+
+        inline uint64_t DeserializeSizes(const std::vector<uint8_t>& buffer, const uint64_t current, const bool swap_bytes)
+        {
+            uint64_t current_position = current;
+            // Deserialize the cell sizes
+            const std::pair<double, uint64_t> cell_x_size_deserialized = arc_helpers::DeserializeFixedSizePODInByteOrder<double>(buffer, current_position, swap_bytes);
+            cell_x_size_ = cell_x_size_deserialized.first;
+            current_position += cell_x_size_deserialized.second;
+            const std::pair<double, uint64_t> cell_y_size_deserialized = arc_helpers::DeserializeFixedSizePODInByteOrder<double>(buffer, current_position, swap_bytes);
+            cell_y_size_ = cell_y_size_deserialized.first;
+            current_position += cell_y_size_deserialized.second;
+            const std::pair<double, uint64_t> cell_z_size_deserialized = arc_helpers::DeserializeFixedSizePODInByteOrder<double>(buffer, current_position, swap_bytes);
+            cell_z_size_ = cell_z_size_deserialized.first;
+            current_position += cell_z_size_deserialized.second;
+            const std::pair<double, uint64_t> inv_cell_x_size_deserialized = arc_helpers::DeserializeFixedSizePODInByteOrder<double>(buffer, current_position, swap_bytes);
+            inv_cell_x_size_ = inv_cell_x_size_deserialized.first;
+            current_position += inv_cell_x_size_deserialized.second;
+            const std::pair<double, uint64_t> inv_cell_y_size_deserialized = arc_helpers::DeserializeFixedSizePODInByteOrder<double>(buffer, current_position, swap_bytes);
+            inv_cell_y_size_ = inv_cell_y_size_deserialized.first;
+            current_position += inv_cell_y_size_deserialized.second;
+            const std::pair<double, uint64_t> inv_cell_z_size_deserialized = arc_helpers::DeserializeFixedSizePODInByteOrder<double>(buffer, current_position, swap_bytes);
+            inv_cell_z_size_ = inv_cell_z_size_deserialized.first;
+            current_position += inv_cell_z_size_deserialized.second;
+            // Deserialize the grid sizes
+            const std::pair<double, uint64_t> x_size_deserialized = arc_helpers::DeserializeFixedSizePODInByteOrder<double>(buffer, current_position, swap_bytes);
+            x_size_ = x_size_deserialized.first;
+            current_position += x_size_deserialized.second;
+            const std::pair<double, uint64_t> y_size_deserialized = arc_helpers::DeserializeFixedSizePODInByteOrder<double>(buffer, current_position, swap_bytes);
+            y_size_ = y_size_deserialized.first;
+            current_position += y_size_deserialized.second;
+            const std::pair<double, uint64_t> z_size_deserialized = arc_helpers::DeserializeFixedSizePODInByteOrder<double>(buffer, current_position, swap_bytes);
+            z_size_ = z_size_deserialized.first;
+            current_position += z_size_deserialized.second;
+            // Deserialize the control/bounds values
+            const std::pair<int64_t, uint64_t> stride1_deserialized = arc_helpers::DeserializeFixedSizePODInByteOrder<int64_t>(buffer, current_position, swap_bytes);
+            stride1_ = stride1_deserialized.first;
+            current_position += stride1_deserialized.second;
+            const std::pair<int64_t, uint64_t> stride2_deserialized = arc_helpers::DeserializeFixedSizePODInByteOrder<int64_t>(buffer, current_position, swap_bytes);
+            stride2_ = stride2_deserialized.first;
+            current_position += stride2_deserialized.second;
+            const std::pair<int64_t, uint64_t> num_x_cells_deserialized = arc_helpers::DeserializeFixedSizePODInByteOrder<int64_t>(buffer, current_position, swap_bytes);
+            num_x_cells_ = num_x_cells_deserialized.first;
+            current_position += num_x_cells_deserialized.second;
+            const std::pair<int64_t, uint64_t> num_y_cells_deserialized = arc_helpers::DeserializeFixedSizePODInByteOrder<int64_t>(buffer, current_position, swap_bytes);
+            num_y_cells_ = num_y_cells_deserialized.first;
+            current_position += num_y_cells_deserialized.second;
+            const std::pair<int64_t, uint64_t> num_z_cells_deserialized = arc_helpers::DeserializeFixedSizePODInByteOrder<int64_t>(buffer, current_position, swap_bytes);
+            num_z_cells_ = num_z_cells_deserialized.first;
+            current_position += num_z_cells_deserialized.second;
+            return current_position - current;
+        }
+
     public:
 
         EIGEN_MAKE_ALIGNED_OPERATOR_NEW
@@ -233,7 +340,20 @@ namespace VoxelGrid
         {
             VoxelGrid<T, Allocator> temp_grid;
             const uint64_t bytes_read = temp_grid.DeserializeSelf(buffer, current, value_deserializer);
-            return std::make_pair(temp_grid, bytes_read);
+            return std::make_pair(std::move(temp_grid), bytes_read);
+        }
+
+        // Serialization of trivially copyable cells without a value serializer, see SerializeSelf
+        inline static uint64_t Serialize(const VoxelGrid<T, Allocator>& grid, std::vector<uint8_t>& buffer)
+        {
+            return grid.SerializeSelf(buffer);
+        }
+
+        inline static std::pair<VoxelGrid<T, Allocator>, uint64_t> Deserialize(const std::vector<uint8_t>& buffer, const uint64_t current)
+        {
+            VoxelGrid<T, Allocator> temp_grid;
+            const uint64_t bytes_read = temp_grid.DeserializeSelf(buffer, current);
+            return std::make_pair(std::move(temp_grid), bytes_read);
         }
 
         VoxelGrid(const Eigen::Affine3d& origin_transform, const double cell_size, const double x_size, const double y_size, double const z_size, const T& default_value)
@@ -385,30 +505,12 @@ namespace VoxelGrid
         inline uint64_t SerializeSelf(std::vector<uint8_t>& buffer, const std::function<uint64_t(const T&, std::vector<uint8_t>&)>& value_serializer) const
         {
             const uint64_t start_buffer_size = buffer.size();
-            // Serialize the initialized
-            arc_helpers::SerializeFixedSizePOD<uint8_t>((uint8_t)initialized_, buffer);
-            // Serialize the transforms
-            EigenHelpers::Serialize<Eigen::Affine3d>(origin_transform_, buffer);
-            EigenHelpers::Serialize<Eigen::Affine3d>(inverse_origin_transform_, buffer);
+            // Serialize the initialized and the transforms
+            SerializeTransforms(buffer);
             // Serialize the data
             arc_helpers::SerializeVector<T, Allocator>(data_, buffer, value_serializer);
-            // Serialize the cell sizes
-            arc_helpers::SerializeFixedSizePOD<double>(cell_x_size_, buffer);
-            arc_helpers::SerializeFixedSizePOD<double>(cell_y_size_, buffer);
-            arc_helpers::SerializeFixedSizePOD<double>(cell_z_size_, buffer);
-            arc_helpers::SerializeFixedSizePOD<double>(inv_cell_x_size_, buffer);
-            arc_helpers::SerializeFixedSizePOD<double>(inv_cell_y_size_, buffer);
-            arc_helpers::SerializeFixedSizePOD<double>(inv_cell_z_size_, buffer);
-            // Serialize the grid sizes
-            arc_helpers::SerializeFixedSizePOD<double>(x_size_, buffer);
-            arc_helpers::SerializeFixedSizePOD<double>(y_size_, buffer);
-            arc_helpers::SerializeFixedSizePOD<double>(z_size_, buffer);
-            // Serialize the control/bounds values
-            arc_helpers::SerializeFixedSizePOD<int64_t>(stride1_, buffer);
-            arc_helpers::SerializeFixedSizePOD<int64_t>(stride2_, buffer);
-            arc_helpers::SerializeFixedSizePOD<int64_t>(num_x_cells_, buffer);
-            arc_helpers::SerializeFixedSizePOD<int64_t>(num_y_cells_, buffer);
-            arc_helpers::SerializeFixedSizePOD<int64_t>(num_z_cells_, buffer);
+            // Serialize the cell sizes, grid sizes and control/bounds values
+            SerializeSizes(buffer);
             // Serialize the default value
             value_serializer(default_value_, buffer);
             // Serialize the OOB value
@@ -419,69 +521,40 @@ namespace VoxelGrid
             return bytes_written;
         }
 
+        // Trivially copyable cells are copied as one block. The buffer starts with a byte order
+        // marker, so it can be loaded on a host with the other byte order.
+        inline uint64_t SerializeSelf(std::vector<uint8_t>& buffer) const
+        {
+            static_assert(std::is_trivially_copyable<T>::value, "Cells must be trivially copyable, provide a value serializer otherwise");
+            const uint64_t start_buffer_size = buffer.size();
+            // Serialize the byte order
+            arc_helpers::SerializeByteOrderMarker(buffer);
+            // Serialize the initialized and the transforms
+            SerializeTransforms(buffer);
+            // Serialize the data
+            arc_helpers::SerializeTriviallyCopyableVector<T, Allocator>(data_, buffer);
+            // Serialize the cell sizes, grid sizes and control/bounds values
+            SerializeSizes(buffer);
+            // Serialize the default and OOB values
+            arc_helpers::SerializeFixedSizePOD<T>(default_value_, buffer);
+            arc_helpers::SerializeFixedSizePOD<T>(oob_value_, buffer);
+            // Figure out how many bytes were written
+            const uint64_t end_buffer_size = buffer.size();
+            const uint64_t bytes_written = end_buffer_size - start_buffer_size;
+            return bytes_written;
+        }
+
         inline uint64_t DeserializeSelf(const std::vector<uint8_t>& buffer, const uint64_t current, const std::function<std::pair<T, uint64_t>(const std::vector<uint8_t>&, const uint64_t)>& value_deserializer)
         {
             uint64_t current_position = current;
-            // Deserialize the initialized
-            const std::pair<uint8_t, uint64_t> initialized_deserialized = arc_helpers::DeserializeFixedSizePOD<uint8_t>(buffer, current_position);
-            initialized_ = (bool)initialized_deserialized.first;
-            current_position += initialized_deserialized.second;
-            // Deserialize the transforms
-            const std::pair<Eigen::Affine3d, uint64_t> origin_transform_deserialized = EigenHelpers::Deserialize<Eigen::Affine3d>(buffer, current_position);
-            origin_transform_ = origin_transform_deserialized.first;
-            current_position += origin_transform_deserialized.second;
-            const std::pair<Eigen::Affine3d, uint64_t> inverse_origin_transform_deserialized = EigenHelpers::Deserialize<Eigen::Affine3d>(buffer, current_position);
-            inverse_origin_transform_ = inverse_origin_transform_deserialized.first;
-            current_position += inverse_origin_transform_deserialized.second;
+            // Deserialize the initialized and the transforms
+            current_position += DeserializeTransforms(buffer, current_position, false);
             // Deserialize the data
-            const std::pair<std::vector<T, Allocator>, uint64_t> data_deserialized = arc_helpers::DeserializeVector<T, Allocator>(buffer, current_position, value_deserializer);
-            data_ = data_deserialized.first;
+            std::pair<std::vector<T, Allocator>, uint64_t> data_deserialized = arc_helpers::DeserializeVector<T, Allocator>(buffer, current_position, value_deserializer);
+            data_ = std::move(data_deserialized.first);
             current_position += data_deserialized.second;
-            // Deserialize the cell sizes
-            const std::pair<double, uint64_t> cell_x_size_deserialized = arc_helpers::DeserializeFixedSizePOD<double>(buffer, current_position);
-            cell_x_size_ = cell_x_size_deserialized.first;
-            current_position += cell_x_size_deserialized.second;
-            const std::pair<double, uint64_t> cell_y_size_deserialized = arc_helpers::DeserializeFixedSizePOD<double>(buffer, current_position);
-            cell_y_size_ = cell_y_size_deserialized.first;
-            current_position += cell_y_size_deserialized.second;
-            const std::pair<double, uint64_t> cell_z_size_deserialized = arc_helpers::DeserializeFixedSizePOD<double>(buffer, current_position);
-            cell_z_size_ = cell_z_size_deserialized.first;
-            current_position += cell_z_size_deserialized.second;
-            const std::pair<double, uint64_t> inv_cell_x_size_deserialized = arc_helpers::DeserializeFixedSizePOD<double>(buffer, current_position);
-            inv_cell_x_size_ = inv_cell_x_size_deserialized.first;
-            current_position += inv_cell_x_size_deserialized.second;
-            const std::pair<double, uint64_t> inv_cell_y_size_deserialized = arc_helpers::DeserializeFixedSizePOD<double>(buffer, current_position);
-            inv_cell_y_size_ = inv_cell_y_size_deserialized.first;
-            current_position += inv_cell_y_size_deserialized.second;
-            const std::pair<double, uint64_t> inv_cell_z_size_deserialized = arc_helpers::DeserializeFixedSizePOD<double>(buffer, current_position);
-            inv_cell_z_size_ = inv_cell_z_size_deserialized.first;
-            current_position += inv_cell_z_size_deserialized.second;
-            // Deserialize the grid sizes
-            const std::pair<double, uint64_t> x_size_deserialized = arc_helpers::DeserializeFixedSizePOD<double>(buffer, current_position);
-            x_size_ = x_size_deserialized.first;
-            current_position += x_size_deserialized.second;
-            const std::pair<double, uint64_t> y_size_deserialized = arc_helpers::DeserializeFixedSizePOD<double>(buffer, current_position);
-            y_size_ = y_size_deserialized.first;
-            current_position += y_size_deserialized.second;
-            const std::pair<double, uint64_t> z_size_deserialized = arc_helpers::DeserializeFixedSizePOD<double>(buffer, current_position);
-            z_size_ = z_size_deserialized.first;
-            current_position += z_size_deserialized.second;
-            // Deserialize the control/bounds values
-            const std::pair<int64_t, uint64_t> stride1_deserialized = arc_helpers::DeserializeFixedSizePOD<int64_t>(buffer, current_position);
-            stride1_ = stride1_deserialized.first;
-            current_position += stride1_deserialized.second;
-            const std::pair<int64_t, uint64_t> stride2_deserialized = arc_helpers::DeserializeFixedSizePOD<int64_t>(buffer, current_position);
-            stride2_ = stride2_deserialized.first;
-            current_position += stride2_deserialized.second;
-            const std::pair<int64_t, uint64_t> num_x_cells_deserialized = arc_helpers::DeserializeFixedSizePOD<int64_t>(buffer, current_position);
-            num_x_cells_ = num_x_cells_deserialized.first;
-            current_position += num_x_cells_deserialized.second;
-            const std::pair<int64_t, uint64_t> num_y_cells_deserialized = arc_helpers::DeserializeFixedSizePOD<int64_t>(buffer, current_position);
-            num_y_cells_ = num_y_cells_deserialized.first;
-            current_position += num_y_cells_deserialized.second;
-            const std::pair<int64_t, uint64_t> num_z_cells_deserialized = arc_helpers::DeserializeFixedSizePOD<int64_t>(buffer, current_position);
-            num_z_cells_ = num_z_cells_deserialized.first;
-            current_position += num_z_cells_deserialized.second;
+            // Deserialize the cell sizes, grid sizes and control/bounds values
+            current_position += DeserializeSizes(buffer, current_position, false);
             // Deserialize the default value
             const std::pair<T, uint64_t> default_value_deserialized = value_deserializer(buffer, current_position);
             default_value_ = default_value_deserialized.first;
@@ -495,6 +568,34 @@ namespace VoxelGrid
             return bytes_read;
         }
 
+        inline uint64_t DeserializeSelf(const std::vector<uint8_t>& buffer, const uint64_t current)
+        {
+            static_assert(std::is_trivially_copyable<T>::value, "Cells must be trivially copyable, provide a value deserializer otherwise");
+            uint64_t current_position = current;
+            // Deserialize the byte order
+            const std::pair<bool, uint64_t> byte_order_deserialized = arc_helpers::DeserializeByteOrderMarker(buffer, current_position);
+            const bool swap_bytes = byte_order_deserialized.first;
+            current_position += byte_order_deserialized.second;
+            // Deserialize the initialized and the transforms
+            current_position += DeserializeTransforms(buffer, current_position, swap_bytes);
+            // Deserialize the data
+            std::pair<std::vector<T, Allocator>, uint64_t> data_deserialized = arc_helpers::DeserializeTriviallyCopyableVector<T, Allocator>(buffer, current_position);
+            data_ = std::move(data_deserialized.first);
+            current_position += data_deserialized.second;
+            // Deserialize the cell sizes, grid sizes and control/bounds values
+            current_position += DeserializeSizes(buffer, current_position, swap_bytes);
+            // Deserialize the default and OOB values
+            const std::pair<T, uint64_t> default_value_deserialized = arc_helpers::DeserializeFixedSizePODInByteOrder<T>(buffer, current_position, swap_bytes);
+            default_value_ = default_value_deserialized.first;
+            current_position += default_value_deserialized.second;
+            const std::pair<T, uint64_t> oob_value_deserialized = arc_helpers::DeserializeFixedSizePODInByteOrder<T>(buffer, current_position, swap_bytes);
+            oob_value_ = oob_value_deserialized.first;
+            current_position += oob_value_deserialized.second;
+            // Figure out how many bytes were read
+            const uint64_t bytes_read = current_position - current;
+            return bytes_read;
+        }
+
         inline bool IsInitialized() const
         {
             return initialized_;
@@ -791,6 +892,21 @@ namespace VoxelGrid
             return std::vector<double>{cell_x_size_, cell_y_size_, cell_z_size_};
         }
 
+        inline double GetCellXSize() const
+        {
+            return cell_x_size_;
+        }
+
+        inline double GetCellYSize() const
+        {
+            return cell_y_size_;
+        }
+
+        inline double GetCellZSize() const
+        {
+            return cell_z_size_;
+        }
+
         inline T GetDefaultValue() const
         {
             return default_value_;
@@ -874,6 +990,17 @@ namespace VoxelGrid
             }
         }
 
+        // Same as LocationToGridIndex3d without allocating, returns false outside the grid
+        inline bool LocationToGridIndex3d(const Eigen::Vector3d& location, int64_t& x_index, int64_t& y_index, int64_t& z_index) const
+        {
+            assert(initialized_);
+            const Eigen::Vector3d point_in_grid_frame = inverse_origin_transform_ * location;
+            x_index = (int64_t)(point_in_grid_frame.x() * inv_cell_x_size_);
+            y_index = (int64_t)(point_in_grid_frame.y() * inv_cell_y_size_);
+            z_index = (int64_t)(point_in_grid_frame.z() * inv_cell_z_size_);
+            return IndexInBounds(x_index, y_index, z_index);
+        }
+
         inline std::vector<int64_t> LocationToGridIndex4d(const Eigen::Vector4d& location) const
         {
             assert(initialized_);
@@ -925,6 +1052,11 @@ namespace VoxelGrid
             return data_;
         }
 
+        inline std::vector<T>& GetMutableRawData()
+        {
+            return data_;
+        }
+
         inline std::vector<T> CopyRawData() const
         {
             return data_;
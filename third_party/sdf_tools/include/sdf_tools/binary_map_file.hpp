@@ -0,0 +1,193 @@
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <string>
+#include <utility>
+#include <Eigen/Geometry>
+
+#ifndef BINARY_MAP_FILE_HPP
+#define BINARY_MAP_FILE_HPP
+
+namespace sdf_tools
+{
+    // On-disk layout shared by CollisionMapGrid and SignedDistanceField: a fixed header followed
+    // by the raw cell array, exactly as it is stored in the VoxelGrid (x-major, then y, then z).
+    // The array starts on a page boundary, so once the file is mapped it can be used in place.
+    const char BINARY_MAP_MAGIC[8] = {'S', 'D', 'F', 'T', 'M', 'A', 'P', '\0'};
+    const uint32_t BINARY_MAP_VERSION = 1;
+    // Written in host order, reads back differently on a host of the other endianness
+    const uint32_t BINARY_MAP_BYTE_ORDER = 0x01020304u;
+    const uint64_t BINARY_MAP_DATA_ALIGNMENT = 4096;
+
+    enum BINARY_MAP_CONTENTS : uint32_t
+    {
+        BINARY_MAP_COLLISION_MAP = 1,
+        BINARY_MAP_SIGNED_DISTANCE_FIELD = 2
+    };
+
+    struct BinaryMapHeader
+    {
+        char magic[8];
+        uint32_t byte_order;
+        uint32_t version;
+        uint32_t contents;
+        uint32_t cell_bytes;
+        uint64_t data_offset;
+        uint64_t data_bytes;
+        int64_t num_x_cells;
+        int64_t num_y_cells;
+        int64_t num_z_cells;
+        double cell_size;
+        double origin_translation[3];
+        double origin_rotation[4]; // x, y, z, w
+        // Default and out-of-bounds cells, stored as raw bytes of the cell type
+        uint8_t default_value[16];
+        uint8_t oob_value[16];
+        uint32_t number_of_components;
+        uint8_t initialized;
+        uint8_t locked;
+        uint8_t components_valid;
+        uint8_t reserved_flags;
+        char frame[64];
+        uint8_t reserved[24];
+    };
+
+    static_assert(sizeof(BinaryMapHeader) == 256, "BinaryMapHeader must keep its on-disk size");
+
+    inline BinaryMapHeader MakeBinaryMapHeader(const BINARY_MAP_CONTENTS contents, const uint32_t cell_bytes, const int64_t num_x_cells, const int64_t num_y_cells, const int64_t num_z_cells, const double cell_size, const Eigen::Affine3d& origin_transform, const std::string& frame)
+    {
+        BinaryMapHeader header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, BINARY_MAP_MAGIC, sizeof(header.magic));
+        header.byte_order = BINARY_MAP_BYTE_ORDER;
+        header.version = BINARY_MAP_VERSION;
+        header.contents = contents;
+        header.cell_bytes = cell_bytes;
+        header.data_offset = BINARY_MAP_DATA_ALIGNMENT;
+        header.data_bytes = (uint64_t)(num_x_cells * num_y_cells * num_z_cells) * cell_bytes;
+        header.num_x_cells = num_x_cells;
+        header.num_y_cells = num_y_cells;
+        header.num_z_cells = num_z_cells;
+        header.cell_size = cell_size;
+        header.origin_translation[0] = origin_transform.translation().x();
+        header.origin_translation[1] = origin_transform.translation().y();
+        header.origin_translation[2] = origin_transform.translation().z();
+        const Eigen::Quaterniond origin_rotation(origin_transform.rotation());
+        header.origin_rotation[0] = origin_rotation.x();
+        header.origin_rotation[1] = origin_rotation.y();
+        header.origin_rotation[2] = origin_rotation.z();
+        header.origin_rotation[3] = origin_rotation.w();
+        // The frame is truncated to what fits, keeping the terminating null
+        strncpy(header.frame, frame.c_str(), sizeof(header.frame) - 1);
+        return header;
+    }
+
+    // Writes the header, the padding up to header.data_offset and header.data_bytes of data
+    bool WriteBinaryMapFile(const std::string& filepath, const BinaryMapHeader& header, const void* data);
+
+    // Read-only mapping of a binary map file. The cells are read straight from the page cache, so
+    // opening is constant time regardless of the size of the map, and pages are only read from
+    // disk when they are touched.
+    class MappedBinaryMap
+    {
+    protected:
+
+        int fd_;
+        void* mapping_;
+        size_t mapping_bytes_;
+        const BinaryMapHeader* header_;
+        const uint8_t* data_;
+
+        bool CheckHeader(const uint64_t file_bytes, const uint32_t expected_contents, const uint32_t expected_cell_bytes) const;
+
+    public:
+
+        MappedBinaryMap() : fd_(-1), mapping_(NULL), mapping_bytes_(0), header_(NULL), data_(NULL) {}
+
+        ~MappedBinaryMap()
+        {
+            Close();
+        }
+
+        MappedBinaryMap(const MappedBinaryMap&) = delete;
+        MappedBinaryMap& operator=(const MappedBinaryMap&) = delete;
+
+        // Maps the file and validates its header against the expected contents and cell size
+        bool Open(const std::string& filepath, const uint32_t expected_contents, const uint32_t expected_cell_bytes);
+
+        void Close();
+
+        // Hint that the whole array is about to be read, so the kernel reads ahead aggressively
+        void WillReadAll() const;
+
+        inline bool IsOpen() const
+        {
+            return (header_ != NULL);
+        }
+
+        inline const BinaryMapHeader& GetHeader() const
+        {
+            return *header_;
+        }
+
+        inline const void* GetData() const
+        {
+            return data_;
+        }
+
+        inline std::string GetFrame() const
+        {
+            return std::string(header_->frame, strnlen(header_->frame, sizeof(header_->frame)));
+        }
+
+        inline Eigen::Affine3d GetOriginTransform() const
+        {
+            const Eigen::Translation3d origin_translation(header_->origin_translation[0], header_->origin_translation[1], header_->origin_translation[2]);
+            const Eigen::Quaterniond origin_rotation(header_->origin_rotation[3], header_->origin_rotation[0], header_->origin_rotation[1], header_->origin_rotation[2]);
+            return origin_translation * origin_rotation;
+        }
+
+        inline int64_t GetNumXCells() const
+        {
+            return header_->num_x_cells;
+        }
+
+        inline int64_t GetNumYCells() const
+        {
+            return header_->num_y_cells;
+        }
+
+        inline int64_t GetNumZCells() const
+        {
+            return header_->num_z_cells;
+        }
+
+        inline bool IndexInBounds(const int64_t x_index, const int64_t y_index, const int64_t z_index) const
+        {
+            return (x_index >= 0 && y_index >= 0 && z_index >= 0 && x_index < header_->num_x_cells && y_index < header_->num_y_cells && z_index < header_->num_z_cells);
+        }
+
+        // In-place lookups, T must be the cell type the file was opened with
+        template<typename T>
+        inline const T* GetCells() const
+        {
+            return reinterpret_cast<const T*>(data_);
+        }
+
+        template<typename T>
+        inline std::pair<const T&, bool> GetImmutable(const int64_t x_index, const int64_t y_index, const int64_t z_index) const
+        {
+            if (IndexInBounds(x_index, y_index, z_index))
+            {
+                const int64_t data_index = (x_index * header_->num_y_cells + y_index) * header_->num_z_cells + z_index;
+                return std::pair<const T&, bool>(GetCells<T>()[data_index], true);
+            }
+            else
+            {
+                return std::pair<const T&, bool>(*reinterpret_cast<const T*>(header_->oob_value), false);
+            }
+        }
+    };
+}
+
+#endif // BINARY_MAP_FILE_HPP
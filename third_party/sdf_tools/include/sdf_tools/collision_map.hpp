@@ -3,6 +3,8 @@
 #include <vector>
 #include <string>
 #include <functional>
+#include <algorithm>
+#include <cmath>
 #include <unordered_map>
 #include <sstream>
 #include <iostream>
@@ -12,6 +14,7 @@
 #include <arc_utilities/arc_helpers.hpp>
 #include <arc_utilities/voxel_grid.hpp>
 #include <sdf_tools/sdf.hpp>
+#include <sdf_tools/binary_map_file.hpp>
 #include <sdf_tools/CollisionMap.h>
 
 #include <eigen3/Eigen/Dense>
@@ -56,7 +59,20 @@ namespace sdf_tools
             return loaded;
         }
     }
+}
 
+namespace arc_helpers
+{
+    // Both fields of a COLLISION_CELL are 4-byte words
+    template<>
+    struct ByteSwapWordSize<sdf_tools::COLLISION_CELL>
+    {
+        static const size_t value = 4u;
+    };
+}
+
+namespace sdf_tools
+{
     class CollisionMapGrid
     {
     protected:
@@ -126,7 +142,9 @@ namespace sdf_tools
 
         typedef VoxelGrid::VoxelGrid<bucket_cell> DistanceField;
 
-        inline DistanceField BuildDistanceField(const std::vector<VoxelGrid::GRID_INDEX>& points) const
+        // Distances are propagated up to distance_square_limit (in cells squared) when it is not
+        // negative, cells further from the points keep an infinite distance
+        inline DistanceField BuildDistanceField(const std::vector<VoxelGrid::GRID_INDEX>& points, const long distance_square_limit=-1) const
         {
             // Make the DistanceField container
             bucket_cell default_cell;
@@ -134,6 +152,10 @@ namespace sdf_tools
             DistanceField distance_field(collision_field_.GetOriginTransform(), GetResolution(), collision_field_.GetXSize(), collision_field_.GetYSize(), collision_field_.GetZSize(), default_cell);
             // Compute maximum distance square
             long max_distance_square = (distance_field.GetNumXCells() * distance_field.GetNumXCells()) + (distance_field.GetNumYCells() * distance_field.GetNumYCells()) + (distance_field.GetNumZCells() * distance_field.GetNumZCells());
+            if (distance_square_limit >= 0 && distance_square_limit < max_distance_square)
+            {
+                max_distance_square = distance_square_limit;
+            }
             // Make bucket queue
             std::vector<std::vector<bucket_cell>> bucket_queue(max_distance_square + 1);
             bucket_queue[0].reserve(points.size());
@@ -311,7 +333,31 @@ namespace sdf_tools
 
         std::vector<COLLISION_CELL> UnpackBinaryRepresentation(std::vector<uint8_t>& packed);
 
-        int64_t MarkConnectedComponent(int64_t x_index, int64_t y_index, int64_t z_index, uint32_t connected_component);
+        static inline uint32_t FindComponentRoot(std::vector<uint32_t>& parents, uint32_t index)
+        {
+            while (parents[index] != index)
+            {
+                // Path halving
+                parents[index] = parents[parents[index]];
+                index = parents[index];
+            }
+            return index;
+        }
+
+        static inline void UnionComponents(std::vector<uint32_t>& parents, const uint32_t first_index, const uint32_t second_index)
+        {
+            const uint32_t first_root = FindComponentRoot(parents, first_index);
+            const uint32_t second_root = FindComponentRoot(parents, second_index);
+            // The root of a set is always its lowest index, i.e. its first cell in sweep order
+            if (first_root < second_root)
+            {
+                parents[second_root] = first_root;
+            }
+            else if (second_root < first_root)
+            {
+                parents[first_root] = second_root;
+            }
+        }
 
     public:
 
@@ -435,7 +481,7 @@ namespace sdf_tools
 
         inline double GetResolution() const
         {
-            return collision_field_.GetCellSizes()[0];
+            return collision_field_.GetCellXSize();
         }
 
         inline COLLISION_CELL GetDefaultValue() const
@@ -473,6 +519,12 @@ namespace sdf_tools
             return collision_field_.GetInverseOriginTransform();
         }
 
+        // Cells laid out x major, as VoxelGrid stores them
+        inline const std::vector<COLLISION_CELL>& GetRawData() const
+        {
+            return collision_field_.GetRawData();
+        }
+
         inline std::string GetFrame() const
         {
             return frame_;
@@ -522,6 +574,12 @@ namespace sdf_tools
 
         bool LoadFromFile(const std::string &filepath);
 
+        // Versioned binary format (see binary_map_file.hpp): the raw cells, without packing,
+        // compression or message serialization, so loading is a single copy out of the page cache
+        bool SaveToBinaryFile(const std::string& filepath) const;
+
+        bool LoadFromBinaryFile(const std::string& filepath);
+
         sdf_tools::CollisionMap GetMessageRepresentation();
 
         bool LoadFromMessageRepresentation(sdf_tools::CollisionMap& message);
@@ -595,16 +653,16 @@ namespace sdf_tools
             return std::pair<SignedDistanceField, std::pair<double, double>>(new_sdf, extrema);
         }
 
+        // The distance field has no out of bounds distance, oob_value is ignored
         inline DistanceField ExtractDistanceField(const float oob_value) const
         {
-            // Make the SDF
-            SignedDistanceField new_sdf(collision_field_.GetOriginTransform(), frame_, GetResolution(), collision_field_.GetXSize(), collision_field_.GetYSize(), collision_field_.GetZSize(), oob_value);
+            UNUSED(oob_value);
             std::vector<VoxelGrid::GRID_INDEX> filled;
-            for (int64_t x_index = 0; x_index < new_sdf.GetNumXCells(); x_index++)
+            for (int64_t x_index = 0; x_index < GetNumXCells(); x_index++)
             {
-                for (int64_t y_index = 0; y_index < new_sdf.GetNumYCells(); y_index++)
+                for (int64_t y_index = 0; y_index < GetNumYCells(); y_index++)
                 {
-                    for (int64_t z_index = 0; z_index < new_sdf.GetNumZCells(); z_index++)
+                    for (int64_t z_index = 0; z_index < GetNumZCells(); z_index++)
                     {
                         VoxelGrid::GRID_INDEX current_index(x_index, y_index, z_index);
                         if (Get(x_index, y_index, z_index).first.occupancy > 0.5)
@@ -621,6 +679,57 @@ namespace sdf_tools
             return filled_distance_field;
         }
 
+        // Distance field that is only propagated up to max_distance from the filled cells, cells
+        // further away keep an infinite distance. The nearest filled cell of a free cell always has
+        // a free face neighbor, so only those filled cells seed the propagation and the others are
+        // set to 0 afterwards: the cost grows with the surface of the obstacles and the cutoff, not
+        // with the volume of the grid.
+        inline DistanceField ExtractTruncatedDistanceField(const double max_distance) const
+        {
+            std::vector<VoxelGrid::GRID_INDEX> surface;
+            std::vector<VoxelGrid::GRID_INDEX> interior;
+            const int64_t num_cells[3] = {GetNumXCells(), GetNumYCells(), GetNumZCells()};
+            for (int64_t x_index = 0; x_index < num_cells[0]; x_index++)
+            {
+                for (int64_t y_index = 0; y_index < num_cells[1]; y_index++)
+                {
+                    for (int64_t z_index = 0; z_index < num_cells[2]; z_index++)
+                    {
+                        if (Get(x_index, y_index, z_index).first.occupancy <= 0.5)
+                        {
+                            continue;
+                        }
+                        // Cells outside the grid have no distance to propagate to
+                        const bool exposed = (x_index > 0 && Get(x_index - 1, y_index, z_index).first.occupancy <= 0.5)
+                                             || (x_index < num_cells[0] - 1 && Get(x_index + 1, y_index, z_index).first.occupancy <= 0.5)
+                                             || (y_index > 0 && Get(x_index, y_index - 1, z_index).first.occupancy <= 0.5)
+                                             || (y_index < num_cells[1] - 1 && Get(x_index, y_index + 1, z_index).first.occupancy <= 0.5)
+                                             || (z_index > 0 && Get(x_index, y_index, z_index - 1).first.occupancy <= 0.5)
+                                             || (z_index < num_cells[2] - 1 && Get(x_index, y_index, z_index + 1).first.occupancy <= 0.5);
+                        if (exposed)
+                        {
+                            surface.push_back(VoxelGrid::GRID_INDEX(x_index, y_index, z_index));
+                        }
+                        else
+                        {
+                            interior.push_back(VoxelGrid::GRID_INDEX(x_index, y_index, z_index));
+                        }
+                    }
+                }
+            }
+            const double max_cells = std::max(0.0, max_distance) / GetResolution();
+            DistanceField distance_field = BuildDistanceField(surface, (long)std::ceil(max_cells * max_cells));
+            for (size_t index = 0; index < interior.size(); index++)
+            {
+                bucket_cell& cell = distance_field.GetMutable(interior[index]).first;
+                cell.closest_point[0] = cell.location[0] = interior[index].x;
+                cell.closest_point[1] = cell.location[1] = interior[index].y;
+                cell.closest_point[2] = cell.location[2] = interior[index].z;
+                cell.distance_square = 0.0;
+            }
+            return distance_field;
+        }
+
         void RestMap()
         {
             // Reset components first
@@ -0,0 +1,202 @@
+#include <stdlib.h>
+#include <stdint.h>
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include <Eigen/Geometry>
+#include <sdf_tools/collision_map.hpp>
+#include <sdf_tools/CollisionMapDelta.h>
+
+#ifndef COLLISION_MAP_DELTA_HPP
+#define COLLISION_MAP_DELTA_HPP
+
+namespace sdf_tools
+{
+    // Occupancy bitmap of a grid split into cubic chunks, each chunk stored as its own run of
+    // words so that chunks can be compared, encoded and replaced independently
+    class ChunkedOccupancy
+    {
+    protected:
+
+        Eigen::Vector3d origin_;
+        double cell_size_;
+        double inv_cell_size_;
+        int64_t num_cells_[3];
+        int64_t chunk_size_;
+        int64_t num_chunks_[3];
+        int64_t words_per_chunk_;
+        std::vector<uint64_t> bits_;
+        bool initialized_;
+
+    public:
+
+        ChunkedOccupancy() : cell_size_(0.0), inv_cell_size_(0.0), num_cells_{0, 0, 0}, chunk_size_(0), num_chunks_{0, 0, 0}, words_per_chunk_(0), initialized_(false) {}
+
+        // Runs of a chunk are stored as uint16, so a chunk holds at most 40^3 cells
+        bool Initialize(const Eigen::Vector3d& origin, const double cell_size, const int64_t num_x_cells, const int64_t num_y_cells, const int64_t num_z_cells, const int64_t chunk_size);
+
+        bool SameLayout(const sdf_tools::CollisionMapDelta& delta) const;
+
+        void Clear();
+
+        inline bool IsInitialized() const
+        {
+            return initialized_;
+        }
+
+        inline const Eigen::Vector3d& GetOrigin() const
+        {
+            return origin_;
+        }
+
+        inline double GetResolution() const
+        {
+            return cell_size_;
+        }
+
+        inline int64_t GetNumCells(const int axis) const
+        {
+            return num_cells_[axis];
+        }
+
+        inline int64_t GetChunkSize() const
+        {
+            return chunk_size_;
+        }
+
+        inline int64_t GetNumChunks() const
+        {
+            return num_chunks_[0] * num_chunks_[1] * num_chunks_[2];
+        }
+
+        inline int64_t GetWordsPerChunk() const
+        {
+            return words_per_chunk_;
+        }
+
+        // Truncates like VoxelGrid::LocationToGridIndex, so a location lands in the same cell of
+        // a CollisionMapGrid with this origin and cell size
+        inline bool LocationToCell(const Eigen::Vector3d& location, int64_t& x_index, int64_t& y_index, int64_t& z_index) const
+        {
+            x_index = (int64_t)((location.x() - origin_.x()) * inv_cell_size_);
+            y_index = (int64_t)((location.y() - origin_.y()) * inv_cell_size_);
+            z_index = (int64_t)((location.z() - origin_.z()) * inv_cell_size_);
+            return (x_index >= 0 && y_index >= 0 && z_index >= 0 && x_index < num_cells_[0] && y_index < num_cells_[1] && z_index < num_cells_[2]);
+        }
+
+        // Chunk of a cell, and bit of the cell inside its chunk
+        inline int64_t GetChunkId(const int64_t x_index, const int64_t y_index, const int64_t z_index) const
+        {
+            return ((x_index / chunk_size_) * num_chunks_[1] + (y_index / chunk_size_)) * num_chunks_[2] + (z_index / chunk_size_);
+        }
+
+        inline int64_t GetChunkBit(const int64_t x_index, const int64_t y_index, const int64_t z_index) const
+        {
+            return ((x_index % chunk_size_) * chunk_size_ + (y_index % chunk_size_)) * chunk_size_ + (z_index % chunk_size_);
+        }
+
+        // First cell of a chunk, and one past its last cell clamped to the grid
+        inline void GetChunkCellRange(const int64_t chunk_id, Eigen::Vector3i& lo, Eigen::Vector3i& hi) const
+        {
+            const int64_t chunk_z = chunk_id % num_chunks_[2];
+            const int64_t chunk_y = (chunk_id / num_chunks_[2]) % num_chunks_[1];
+            const int64_t chunk_x = chunk_id / (num_chunks_[1] * num_chunks_[2]);
+            lo = Eigen::Vector3i(chunk_x * chunk_size_, chunk_y * chunk_size_, chunk_z * chunk_size_);
+            hi = Eigen::Vector3i(std::min(num_cells_[0], (chunk_x + 1) * chunk_size_), std::min(num_cells_[1], (chunk_y + 1) * chunk_size_), std::min(num_cells_[2], (chunk_z + 1) * chunk_size_));
+        }
+
+        inline uint64_t* GetChunkWords(const int64_t chunk_id)
+        {
+            return &bits_[chunk_id * words_per_chunk_];
+        }
+
+        inline const uint64_t* GetChunkWords(const int64_t chunk_id) const
+        {
+            return &bits_[chunk_id * words_per_chunk_];
+        }
+
+        inline bool IsOccupied(const int64_t x_index, const int64_t y_index, const int64_t z_index) const
+        {
+            const uint64_t* words = GetChunkWords(GetChunkId(x_index, y_index, z_index));
+            const int64_t bit = GetChunkBit(x_index, y_index, z_index);
+            return (words[bit >> 6] >> (bit & 63)) & 1;
+        }
+
+        inline void SetOccupied(const int64_t x_index, const int64_t y_index, const int64_t z_index)
+        {
+            uint64_t* words = GetChunkWords(GetChunkId(x_index, y_index, z_index));
+            const int64_t bit = GetChunkBit(x_index, y_index, z_index);
+            words[bit >> 6] |= (uint64_t)1 << (bit & 63);
+        }
+
+        // Run-length coding of the cells of one chunk, see CollisionMapDelta.msg
+        void EncodeChunk(const int64_t chunk_id, std::vector<uint16_t>& runs) const;
+
+        bool DecodeChunk(const uint16_t* runs, const size_t num_runs, uint64_t* words) const;
+    };
+
+    // Producer end of a delta stream: the occupied cells of each frame are marked, and the frame
+    // is published as the chunks that differ from the previous one
+    class CollisionMapDeltaEncoder
+    {
+    protected:
+
+        ChunkedOccupancy published_;
+        ChunkedOccupancy current_;
+        std::vector<int64_t> published_chunks_;
+        std::vector<int64_t> current_chunks_;
+        std::vector<uint8_t> current_chunk_marked_;
+        uint64_t sequence_;
+
+    public:
+
+        CollisionMapDeltaEncoder() : sequence_(0) {}
+
+        bool Initialize(const Eigen::Vector3d& origin, const double cell_size, const double x_size, const double y_size, const double z_size, const int64_t chunk_size);
+
+        void BeginFrame();
+
+        // Returns false for a location outside the grid
+        bool MarkOccupied(const Eigen::Vector3d& location);
+
+        // Changed chunks since the previous frame, or every non-empty chunk for a keyframe
+        sdf_tools::CollisionMapDelta EndFrame(const bool keyframe);
+    };
+
+    // Consumer end of a delta stream: keeps the occupancy the stream describes
+    class CollisionMapDeltaDecoder
+    {
+    protected:
+
+        ChunkedOccupancy occupancy_;
+        std::vector<uint8_t> chunk_occupied_;
+        std::vector<uint64_t> scratch_words_;
+        uint64_t next_sequence_;
+        bool synchronized_;
+
+    public:
+
+        CollisionMapDeltaDecoder() : next_sequence_(0), synchronized_(false) {}
+
+        // Applies the delta and lists the chunks whose occupancy changed. The layout is taken from
+        // the first keyframe. Returns false, leaving the occupancy as it was, for a delta that does
+        // not follow the previous one or does not match the layout: the stream resynchronizes on
+        // the next keyframe.
+        bool Apply(const sdf_tools::CollisionMapDelta& delta, std::vector<int64_t>& changed_chunks);
+
+        inline const ChunkedOccupancy& GetOccupancy() const
+        {
+            return occupancy_;
+        }
+
+        // Writes the chunks, dilated by a box of half-size radius_xy, radius_xy, radius_z cells, into
+        // a grid with the same cell size whose cells line up with the stream's. Only the cells within
+        // the dilation radius of a chunk are rewritten, so the grid stays the dilation of the whole
+        // occupancy as long as every changed chunk is passed. Defined for CollisionMapGrid and
+        // DynamicSpatialHashedCollisionMapGrid.
+        template<typename CollisionMap>
+        bool DilateChunksInto(const std::vector<int64_t>& chunks, const int64_t radius_xy, const int64_t radius_z, CollisionMap& grid, const COLLISION_CELL& occupied_cell, const COLLISION_CELL& free_cell) const;
+    };
+}
+
+#endif // COLLISION_MAP_DELTA_HPP
@@ -0,0 +1,150 @@
+#include <stdlib.h>
+#include <stdint.h>
+#include <vector>
+#include <cmath>
+#include <Eigen/Geometry>
+#include <sdf_tools/collision_map.hpp>
+
+#ifndef COMPACT_DISTANCE_FIELD_HPP
+#define COMPACT_DISTANCE_FIELD_HPP
+
+namespace sdf_tools
+{
+    // Unsigned distance field of a CollisionMapGrid holding only the squared distance, in cells, of
+    // each cell to its nearest filled cell, as 2 bytes per cell instead of the 40 of a bucket_cell.
+    // It is computed by the same bucket queue propagation as CollisionMapGrid::BuildDistanceField,
+    // whose state (the nearest filled cell found so far, the direction it was reached from and the
+    // queues) lives in buffers kept between builds, so rebuilding a field of the same size allocates
+    // nothing.
+    class CompactDistanceField
+    {
+    protected:
+
+        struct NeighborStep
+        {
+            int8_t dx;
+            int8_t dy;
+            int8_t dz;
+            uint8_t direction;
+        };
+
+        Eigen::Affine3d origin_transform_;
+        Eigen::Affine3d inverse_origin_transform_;
+        double resolution_;
+        double inv_resolution_;
+        int64_t num_cells_[3];
+        int64_t stride1_;
+        int64_t stride2_;
+        // Squared distance of each cell, x major as in VoxelGrid
+        std::vector<uint16_t> distance_square_;
+        // Propagation state, only meaningful for cells reached by the last build
+        std::vector<uint16_t> closest_point_;
+        std::vector<uint8_t> update_direction_;
+        std::vector<std::vector<uint32_t>> bucket_queue_;
+        // Neighbors to update from a seed (0) and from a cell reached from a direction (1), as in
+        // CollisionMapGrid::MakeNeighborhoods
+        std::vector<NeighborStep> neighborhoods_[2][27];
+
+        static inline uint8_t GetDirectionNumber(const int dx, const int dy, const int dz)
+        {
+            return (uint8_t)(((dx + 1) * 9) + ((dy + 1) * 3) + (dz + 1));
+        }
+
+        void MakeNeighborhoods();
+
+        // Sizes the buffers for a grid, keeping them if it has the same number of cells
+        void Resize(const CollisionMapGrid& map);
+
+    public:
+
+        EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+        // Squared distance of cells further than the limit of the last build, or further than
+        // sqrt(MAX_DISTANCE_SQUARE) cells from any filled cell
+        static const uint16_t FAR_DISTANCE_SQUARE;
+        static const uint16_t MAX_DISTANCE_SQUARE;
+
+        CompactDistanceField();
+
+        // Propagates distances from the filled cells (occupancy > 0.5) of map up to max_distance, or
+        // as far as they can be stored when max_distance is not positive. Only the filled cells with
+        // a free face neighbor are propagated from, as in ExtractTruncatedDistanceField.
+        void Build(const CollisionMapGrid& map, const double max_distance);
+
+        inline double GetResolution() const
+        {
+            return resolution_;
+        }
+
+        inline const Eigen::Affine3d& GetOriginTransform() const
+        {
+            return origin_transform_;
+        }
+
+        inline int64_t GetNumXCells() const
+        {
+            return num_cells_[0];
+        }
+
+        inline int64_t GetNumYCells() const
+        {
+            return num_cells_[1];
+        }
+
+        inline int64_t GetNumZCells() const
+        {
+            return num_cells_[2];
+        }
+
+        // Bytes of the field, and of the buffers kept for the next build
+        inline size_t GetMemoryUsage() const
+        {
+            return distance_square_.capacity() * sizeof(uint16_t);
+        }
+
+        size_t GetScratchMemoryUsage() const;
+
+        inline bool Inside(const int64_t x_index, const int64_t y_index, const int64_t z_index) const
+        {
+            return (x_index >= 0 && y_index >= 0 && z_index >= 0 && x_index < num_cells_[0] && y_index < num_cells_[1] && z_index < num_cells_[2]);
+        }
+
+        // FAR_DISTANCE_SQUARE outside the grid
+        inline uint16_t GetDistanceSquare(const int64_t x_index, const int64_t y_index, const int64_t z_index) const
+        {
+            if (!Inside(x_index, y_index, z_index))
+            {
+                return FAR_DISTANCE_SQUARE;
+            }
+            return distance_square_[(x_index * stride1_) + (y_index * stride2_) + z_index];
+        }
+
+        // Distance in meters, INFINITY for far cells and outside the grid
+        inline double GetDistance(const int64_t x_index, const int64_t y_index, const int64_t z_index) const
+        {
+            const uint16_t distance_square = GetDistanceSquare(x_index, y_index, z_index);
+            if (distance_square == FAR_DISTANCE_SQUARE)
+            {
+                return INFINITY;
+            }
+            return std::sqrt((double)distance_square) * resolution_;
+        }
+
+        inline double GetDistance(const Eigen::Vector3d& location) const
+        {
+            const Eigen::Vector3d location_in_grid = inverse_origin_transform_ * location;
+            if (location_in_grid.x() < 0.0 || location_in_grid.y() < 0.0 || location_in_grid.z() < 0.0)
+            {
+                return INFINITY;
+            }
+            return GetDistance((int64_t)(location_in_grid.x() * inv_resolution_), (int64_t)(location_in_grid.y() * inv_resolution_), (int64_t)(location_in_grid.z() * inv_resolution_));
+        }
+
+        inline const std::vector<uint16_t>& GetRawData() const
+        {
+            return distance_square_;
+        }
+    };
+}
+
+#endif // COMPACT_DISTANCE_FIELD_HPP
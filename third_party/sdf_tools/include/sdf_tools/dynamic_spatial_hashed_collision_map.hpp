@@ -3,7 +3,6 @@
 #include <vector>
 #include <string>
 #include <functional>
-#include <unordered_map>
 #include <sstream>
 #include <iostream>
 #include <stdexcept>
@@ -52,6 +51,11 @@ namespace sdf_tools
             return collision_field_.GetImmutable(x, y, z);
         }
 
+        inline std::pair<COLLISION_CELL, VoxelGrid::FOUND_STATUS> Get(const int64_t x_index, const int64_t y_index, const int64_t z_index) const
+        {
+            return collision_field_.GetImmutableByIndex(x_index, y_index, z_index);
+        }
+
         inline std::pair<COLLISION_CELL, VoxelGrid::FOUND_STATUS> Get(const Eigen::Vector3d& location) const
         {
             return collision_field_.GetImmutable(location);
@@ -77,11 +81,98 @@ namespace sdf_tools
             return collision_field_.SetChunkValue(location, value);
         }
 
+        // Cells set to the default value where there is no chunk yet are left to the default,
+        // so clearing free space does not allocate
+        inline VoxelGrid::SET_STATUS Set(const int64_t x_index, const int64_t y_index, const int64_t z_index, const COLLISION_CELL& value)
+        {
+            const COLLISION_CELL default_value = collision_field_.GetDefaultValue();
+            if (value.occupancy == default_value.occupancy && value.component == default_value.component && collision_field_.GetImmutableByIndex(x_index, y_index, z_index).second == VoxelGrid::NOT_FOUND)
+            {
+                return VoxelGrid::NOT_SET;
+            }
+            components_valid_ = false;
+            return collision_field_.SetCellValueByIndex(x_index, y_index, z_index, value);
+        }
+
+        inline VoxelGrid::SET_STATUS Set3d(const Eigen::Vector3d& location, const COLLISION_CELL& value)
+        {
+            int64_t x_index = 0;
+            int64_t y_index = 0;
+            int64_t z_index = 0;
+            collision_field_.LocationToGridIndex(location, x_index, y_index, z_index);
+            return Set(x_index, y_index, z_index, value);
+        }
+
+        // Drops every chunk, so the whole map is back to the default value
+        inline void RestMap()
+        {
+            components_valid_ = false;
+            collision_field_.ClearChunks();
+        }
+
+        // Sets the chunks written cell by cell back to the default value, see
+        // DynamicSpatialHashedVoxelGrid::ResetCellChunks
+        inline void ResetCellChunks()
+        {
+            components_valid_ = false;
+            collision_field_.ResetCellChunks();
+        }
+
+        inline double GetResolution() const
+        {
+            return collision_field_.GetCellSizes()[0];
+        }
+
+        inline Eigen::Vector3i LocationToGridIndex(const Eigen::Vector3d& location) const
+        {
+            int64_t x_index = 0;
+            int64_t y_index = 0;
+            int64_t z_index = 0;
+            collision_field_.LocationToGridIndex(location, x_index, y_index, z_index);
+            return Eigen::Vector3i((int)x_index, (int)y_index, (int)z_index);
+        }
+
+        inline Eigen::Vector3d GridIndexToLocation(const Eigen::Vector3i& index) const
+        {
+            return collision_field_.GridIndexToLocation(index(0), index(1), index(2));
+        }
+
         inline Eigen::Affine3d GetOriginTransform() const
         {
             return collision_field_.GetOriginTransform();
         }
 
+        inline uint64_t GetEpoch() const
+        {
+            return collision_field_.GetEpoch();
+        }
+
+        inline uint64_t AdvanceEpoch()
+        {
+            return collision_field_.AdvanceEpoch();
+        }
+
+        // Brings a copy of source taken at the end of epoch since up to date, see
+        // DynamicSpatialHashedVoxelGrid::UpdateFrom
+        inline void UpdateFrom(const DynamicSpatialHashedCollisionMapGrid& source, const uint64_t since)
+        {
+            collision_field_.UpdateFrom(source.collision_field_, since);
+            number_of_components_ = source.number_of_components_;
+            frame_ = source.frame_;
+            initialized_ = source.initialized_;
+            components_valid_ = source.components_valid_;
+        }
+
+        inline size_t GetNumChunks() const
+        {
+            return collision_field_.GetNumChunks();
+        }
+
+        inline size_t GetMemoryUsage() const
+        {
+            return collision_field_.GetMemoryUsage();
+        }
+
         std::vector<visualization_msgs::Marker> ExportForDisplay(const std_msgs::ColorRGBA& collision_color, const std_msgs::ColorRGBA& free_color, const std_msgs::ColorRGBA& unknown_color) const;
     };
 
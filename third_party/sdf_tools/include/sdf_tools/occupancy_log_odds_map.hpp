@@ -0,0 +1,183 @@
+#include <stdlib.h>
+#include <stdint.h>
+#include <vector>
+#include <cmath>
+#include <Eigen/Geometry>
+#include <arc_utilities/dynamic_spatial_hashed_voxel_grid.hpp>
+#include <sdf_tools/collision_map.hpp>
+#include <sdf_tools/dynamic_spatial_hashed_collision_map.hpp>
+
+#ifndef OCCUPANCY_LOG_ODDS_MAP_HPP
+#define OCCUPANCY_LOG_ODDS_MAP_HPP
+
+namespace sdf_tools
+{
+    // Persistent occupancy probability of cells, kept as clamped log-odds in a spatially hashed
+    // grid. Each point cloud is integrated by casting a ray from the sensor origin to every point:
+    // the cells a ray crosses are observed free, the cell it ends in is observed occupied. The cost
+    // of an update is proportional to the length of the rays cast, not to the size of the map.
+    // Cells never observed hold 0, i.e. probability 0.5, and count as free.
+    class OccupancyLogOddsMap
+    {
+    protected:
+
+        VoxelGrid::DynamicSpatialHashedVoxelGrid<float> log_odds_;
+        Eigen::Affine3d inverse_origin_transform_;
+        double cell_size_;
+        double inv_cell_size_;
+        int64_t chunk_size_;
+        float hit_;
+        float miss_;
+        float min_;
+        float max_;
+        float occupied_;
+        int num_threads_;
+        bool initialized_;
+        // End of each ray of a cloud in cells of the grid frame, whether it ends on an obstacle, and
+        // the box of cells holding the rays
+        std::vector<Eigen::Vector3d> ray_ends_;
+        std::vector<uint8_t> ray_hits_;
+        int64_t ray_box_lo_[3];
+        int64_t ray_box_size_[3];
+        // Cells crossed and cells hit by the rays of one thread, then of the whole cloud. A thread
+        // marks the cells of the box it has listed, so that rays from one origin, which cross the
+        // same cells near it over and over, list each cell once.
+        std::vector<std::vector<uint64_t>> thread_visited_;
+        std::vector<std::vector<uint64_t>> thread_free_keys_;
+        std::vector<std::vector<uint64_t>> thread_hit_keys_;
+        std::vector<uint64_t> free_keys_;
+        std::vector<uint64_t> hit_keys_;
+        std::vector<uint64_t> scratch_keys_;
+        std::vector<uint64_t> changed_chunk_keys_;
+
+        // Cells are packed 21 bits per axis for sorting, which bounds the map to 2^20 cells on
+        // either side of its origin
+        static const int64_t KEY_OFFSET = (int64_t)1 << 20;
+        static const uint64_t KEY_MASK = ((uint64_t)1 << 21) - 1;
+        // Largest ray box marked, 32 MB of bits per thread
+        static const int64_t MAX_VISITED_CELLS = (int64_t)1 << 28;
+
+        static inline bool KeyInRange(const int64_t x_index, const int64_t y_index, const int64_t z_index)
+        {
+            return (x_index > -KEY_OFFSET && y_index > -KEY_OFFSET && z_index > -KEY_OFFSET && x_index < KEY_OFFSET && y_index < KEY_OFFSET && z_index < KEY_OFFSET);
+        }
+
+        static inline uint64_t PackKey(const int64_t x_index, const int64_t y_index, const int64_t z_index)
+        {
+            return ((uint64_t)(x_index + KEY_OFFSET) << 42) | ((uint64_t)(y_index + KEY_OFFSET) << 21) | (uint64_t)(z_index + KEY_OFFSET);
+        }
+
+        static inline void UnpackKey(const uint64_t key, int64_t& x_index, int64_t& y_index, int64_t& z_index)
+        {
+            x_index = (int64_t)((key >> 42) & KEY_MASK) - KEY_OFFSET;
+            y_index = (int64_t)((key >> 21) & KEY_MASK) - KEY_OFFSET;
+            z_index = (int64_t)(key & KEY_MASK) - KEY_OFFSET;
+        }
+
+        inline int64_t GetChunkCoordinate(const int64_t index) const
+        {
+            return (index >= 0) ? (index / chunk_size_) : -((-index + chunk_size_ - 1) / chunk_size_);
+        }
+
+        // Marks a cell of the ray box, returns false if it already was
+        inline bool MarkVisited(std::vector<uint64_t>& visited, const int64_t x_index, const int64_t y_index, const int64_t z_index) const
+        {
+            if (visited.empty())
+            {
+                return true;
+            }
+            const int64_t bit = ((x_index - ray_box_lo_[0]) * ray_box_size_[1] + (y_index - ray_box_lo_[1])) * ray_box_size_[2] + (z_index - ray_box_lo_[2]);
+            const uint64_t mask = (uint64_t)1 << (bit & 63);
+            if (visited[bit >> 6] & mask)
+            {
+                return false;
+            }
+            visited[bit >> 6] |= mask;
+            return true;
+        }
+
+        // Walks the cells from the one holding start to the one holding end, both in cells of the
+        // grid frame, with a 3D DDA. Every cell but the last is crossed.
+        void CastRay(const Eigen::Vector3d& start, const Eigen::Vector3d& end, const bool hit, std::vector<uint64_t>& visited, std::vector<uint64_t>& free_keys, std::vector<uint64_t>& hit_keys) const;
+
+        void CastRays(const Eigen::Vector3d& start, const size_t first_ray, const size_t end_ray, std::vector<uint64_t>& visited, std::vector<uint64_t>& free_keys, std::vector<uint64_t>& hit_keys) const;
+
+        // Merges the sorted keys of each thread into one sorted list without duplicates
+        void MergeThreadKeys(std::vector<std::vector<uint64_t>>& thread_keys, std::vector<uint64_t>& keys) const;
+
+        void UpdateCell(const uint64_t key, const float delta);
+
+        // Occupancy of the cells from lo to one before hi, x major, skipping chunks never observed
+        // and chunks holding one value
+        void GetOccupancyBox(const int64_t lo[3], const int64_t hi[3], std::vector<uint8_t>& occupancy) const;
+
+    public:
+
+        EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+        OccupancyLogOddsMap() : cell_size_(0.0), inv_cell_size_(0.0), chunk_size_(0), hit_(0.0f), miss_(0.0f), min_(0.0f), max_(0.0f), occupied_(0.0f), num_threads_(1), initialized_(false), ray_box_lo_{0, 0, 0}, ray_box_size_{0, 0, 0} {}
+
+        // hit and miss are added to the log-odds of a cell observed occupied or free, which is then
+        // clamped to [min, max]; a cell is occupied above occupied. Rays are cast on num_threads
+        // threads.
+        OccupancyLogOddsMap(const Eigen::Affine3d& origin_transform, const double resolution, const int64_t chunk_size, const float hit, const float miss, const float min, const float max, const float occupied, const int num_threads);
+
+        inline bool IsInitialized() const
+        {
+            return initialized_;
+        }
+
+        inline double GetResolution() const
+        {
+            return cell_size_;
+        }
+
+        inline Eigen::Affine3d GetOriginTransform() const
+        {
+            return log_odds_.GetOriginTransform();
+        }
+
+        inline size_t GetMemoryUsage() const
+        {
+            return log_odds_.GetMemoryUsage();
+        }
+
+        inline float GetLogOdds(const int64_t x_index, const int64_t y_index, const int64_t z_index) const
+        {
+            return log_odds_.GetImmutableByIndex(x_index, y_index, z_index).first;
+        }
+
+        inline bool IsOccupied(const int64_t x_index, const int64_t y_index, const int64_t z_index) const
+        {
+            return GetLogOdds(x_index, y_index, z_index) > occupied_;
+        }
+
+        inline bool IsOccupied(const Eigen::Vector3d& location) const
+        {
+            int64_t x_index = 0;
+            int64_t y_index = 0;
+            int64_t z_index = 0;
+            log_odds_.LocationToGridIndex(location, x_index, y_index, z_index);
+            return IsOccupied(x_index, y_index, z_index);
+        }
+
+        // Forgets every observation
+        void Clear();
+
+        // Integrates a cloud seen from origin. Each cell is updated at most once per cloud, and a
+        // cell hit by any ray counts as occupied even if other rays cross it. Rays longer than
+        // max_range are cut there and only clear free space. Lists the chunks, as chunk coordinates,
+        // holding a cell that became occupied or free.
+        void InsertPointCloud(const Eigen::Vector3d& origin, const std::vector<Eigen::Vector3d>& points, const double max_range, std::vector<Eigen::Vector3i>& changed_chunks);
+
+        // Centers of the occupied cells between lower and upper. Chunks never observed are skipped.
+        void GetOccupiedCells(const Eigen::Vector3d& lower, const Eigen::Vector3d& upper, std::vector<Eigen::Vector3d>& centers) const;
+
+        // Writes the chunks, dilated by a box of half-size radius_xy, radius_xy, radius_z cells, into
+        // a grid with the same cell size whose cells line up with the map's, as
+        // CollisionMapDeltaDecoder::DilateChunksInto does for a delta stream
+        bool DilateChunksInto(const std::vector<Eigen::Vector3i>& chunks, const int64_t radius_xy, const int64_t radius_z, DynamicSpatialHashedCollisionMapGrid& grid, const COLLISION_CELL& occupied_cell, const COLLISION_CELL& free_cell) const;
+    };
+}
+
+#endif // OCCUPANCY_LOG_ODDS_MAP_HPP
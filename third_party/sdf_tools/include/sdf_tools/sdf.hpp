@@ -5,10 +5,13 @@
 #include <sstream>
 #include <iostream>
 #include <stdexcept>
+#include <algorithm>
+#include <cmath>
 #include <Eigen/Geometry>
 #include <visualization_msgs/Marker.h>
 #include <arc_utilities/eigen_helpers.hpp>
 #include <arc_utilities/voxel_grid.hpp>
+#include <sdf_tools/binary_map_file.hpp>
 #include <sdf_tools/SDF.h>
 
 #ifndef SDF_HPP
@@ -81,6 +84,13 @@ namespace sdf_tools
          */
         void FollowGradientsToLocalMaximaUnsafe(VoxelGrid::VoxelGrid<Eigen::Vector3d>& watershed_map, const int64_t x_index, const int64_t y_index, const int64_t z_index) const;
 
+        // Locations interpolated per block by the batched queries, sized so that the arrays of a
+        // block stay in L1
+        static const int INTERPOLATION_BLOCK_SIZE = 256;
+
+        // Batched interpolation, gradients are skipped if NULL
+        size_t InterpolateLocations(const Eigen::Matrix3Xd& locations, Eigen::VectorXd& distances, Eigen::Matrix3Xd* gradients) const;
+
     public:
 
         EIGEN_MAKE_ALIGNED_OPERATOR_NEW
@@ -274,7 +284,7 @@ namespace sdf_tools
 
         inline double GetResolution() const
         {
-            return distance_field_.GetCellSizes()[0];
+            return distance_field_.GetCellXSize();
         }
 
         inline float GetOOBValue() const
@@ -422,16 +432,60 @@ namespace sdf_tools
             }
         }
 
+        // Trilinear interpolation of the distances at the centers of the 8 cells around a location
+        // given in cells of the grid frame, counted from the center of the first cell, and its
+        // gradient in the grid frame per cell. Coordinates are clamped to the centers of the outer
+        // cells, where the gradient is that of the interpolation between the outer cells.
+        inline double InterpolateCellCoordinates(const double x_cell, const double y_cell, const double z_cell, Eigen::Vector3d& gradient) const
+        {
+            const int64_t num_cells[3] = {GetNumXCells(), GetNumYCells(), GetNumZCells()};
+            const double cell_coordinates[3] = {x_cell, y_cell, z_cell};
+            int64_t low_index[3];
+            double fraction[3];
+            for (int axis = 0; axis < 3; axis++)
+            {
+                const double clamped = std::min(std::max(cell_coordinates[axis], 0.0), (double)(num_cells[axis] - 1));
+                low_index[axis] = std::min((int64_t)clamped, std::max(num_cells[axis] - 2, (int64_t)0));
+                fraction[axis] = clamped - (double)low_index[axis];
+            }
+            // A single cell along an axis is its own upper neighbor
+            const int64_t x_step = (num_cells[0] > 1) ? num_cells[1] * num_cells[2] : 0;
+            const int64_t y_step = (num_cells[1] > 1) ? num_cells[2] : 0;
+            const int64_t z_step = (num_cells[2] > 1) ? 1 : 0;
+            const float* low_cell = &distance_field_.GetRawData()[(low_index[0] * num_cells[1] * num_cells[2]) + (low_index[1] * num_cells[2]) + low_index[2]];
+            const double c000 = low_cell[0];
+            const double c001 = low_cell[z_step];
+            const double c010 = low_cell[y_step];
+            const double c011 = low_cell[y_step + z_step];
+            const double c100 = low_cell[x_step];
+            const double c101 = low_cell[x_step + z_step];
+            const double c110 = low_cell[x_step + y_step];
+            const double c111 = low_cell[x_step + y_step + z_step];
+            // Interpolate along z, then y, then x
+            const double c00 = c000 + (c001 - c000) * fraction[2];
+            const double c01 = c010 + (c011 - c010) * fraction[2];
+            const double c10 = c100 + (c101 - c100) * fraction[2];
+            const double c11 = c110 + (c111 - c110) * fraction[2];
+            const double c0 = c00 + (c01 - c00) * fraction[1];
+            const double c1 = c10 + (c11 - c10) * fraction[1];
+            const double dz0 = (c001 - c000) + ((c011 - c010) - (c001 - c000)) * fraction[1];
+            const double dz1 = (c101 - c100) + ((c111 - c110) - (c101 - c100)) * fraction[1];
+            gradient.x() = c1 - c0;
+            gradient.y() = (c01 - c00) + ((c11 - c10) - (c01 - c00)) * fraction[0];
+            gradient.z() = dz0 + (dz1 - dz0) * fraction[0];
+            return c0 + (c1 - c0) * fraction[0];
+        }
+
         inline double EstimateDistanceInternal(const double x, const double y, const double z, const int64_t x_idx, const int64_t y_idx, const int64_t z_idx) const
         {
-            const std::vector<double> cell_center = GridIndexToLocation(x_idx, y_idx, z_idx);
-            const Eigen::Vector3d cell_center_to_location_vector(x - cell_center[0], y - cell_center[1], z - cell_center[2]);
+            const Eigen::Vector3d cell_center = GetOriginTransform() * (Eigen::Vector3d((double)x_idx + 0.5, (double)y_idx + 0.5, (double)z_idx + 0.5) * GetResolution());
+            const Eigen::Vector3d cell_center_to_location_vector = Eigen::Vector3d(x, y, z) - cell_center;
             const double nominal_sdf_distance = (double)distance_field_.GetImmutable(x_idx, y_idx, z_idx).first;
 
             // Determine vector from "entry surface" to center of voxel
             // TODO: Needs special handling if there's no gradient to work with
-            const std::vector<double> raw_gradient = GetGradient(x_idx, y_idx, z_idx, true);
-            const Eigen::Vector3d gradient = EigenHelpers::StdVectorDoubleToEigenVector3d(raw_gradient);
+            Eigen::Vector3d gradient;
+            GetGradient(x_idx, y_idx, z_idx, true, gradient);
             const Eigen::Vector3d direction_to_boundary = (nominal_sdf_distance >= 0.0) ? -gradient : gradient;
             const std::pair<Eigen::Vector3d, double> entry_surface_information = GetPrimaryEntrySurfaceVector(direction_to_boundary, cell_center_to_location_vector);
             const Eigen::Vector3d& entry_surface_vector = entry_surface_information.first;
@@ -472,10 +526,12 @@ namespace sdf_tools
 
         inline std::pair<double, bool> EstimateDistance3d(const Eigen::Vector3d& location) const
         {
-            const std::vector<int64_t> indices = LocationToGridIndex3d(location);
-            if (indices.size() == 3)
+            int64_t x_index = 0;
+            int64_t y_index = 0;
+            int64_t z_index = 0;
+            if (LocationToGridIndex3d(location, x_index, y_index, z_index))
             {
-                return std::make_pair(EstimateDistanceInternal(location.x(), location.y(), location.z(), indices[0], indices[1], indices[2]), true);
+                return std::make_pair(EstimateDistanceInternal(location.x(), location.y(), location.z(), x_index, y_index, z_index), true);
             }
             else
             {
@@ -503,10 +559,10 @@ namespace sdf_tools
 
         inline std::vector<double> GetGradient3d(const Eigen::Vector3d& location, const bool enable_edge_gradients=false) const
         {
-            const std::vector<int64_t> indices = LocationToGridIndex3d(location);
-            if (indices.size() == 3)
+            Eigen::Vector3d gradient;
+            if (GetGradient3d(location, enable_edge_gradients, gradient))
             {
-                return GetGradient(indices[0], indices[1], indices[2], enable_edge_gradients);
+                return std::vector<double>{gradient.x(), gradient.y(), gradient.z()};
             }
             else
             {
@@ -514,6 +570,22 @@ namespace sdf_tools
             }
         }
 
+        // Same as GetGradient3d without allocating, returns false where there is no gradient
+        inline bool GetGradient3d(const Eigen::Vector3d& location, const bool enable_edge_gradients, Eigen::Vector3d& gradient) const
+        {
+            int64_t x_index = 0;
+            int64_t y_index = 0;
+            int64_t z_index = 0;
+            if (LocationToGridIndex3d(location, x_index, y_index, z_index))
+            {
+                return GetGradient(x_index, y_index, z_index, enable_edge_gradients, gradient);
+            }
+            else
+            {
+                return false;
+            }
+        }
+
         inline std::vector<double> GetGradient4d(const Eigen::Vector4d& location, const bool enable_edge_gradients=false) const
         {
             const std::vector<int64_t> indices = LocationToGridIndex4d(location);
@@ -533,6 +605,20 @@ namespace sdf_tools
         }
 
         inline std::vector<double> GetGradient(const int64_t x_index, const int64_t y_index, const int64_t z_index, const bool enable_edge_gradients=false) const
+        {
+            Eigen::Vector3d gradient;
+            if (GetGradient(x_index, y_index, z_index, enable_edge_gradients, gradient))
+            {
+                return std::vector<double>{gradient.x(), gradient.y(), gradient.z()};
+            }
+            else
+            {
+                return std::vector<double>();
+            }
+        }
+
+        // Same as GetGradient without allocating, returns false where there is no gradient
+        inline bool GetGradient(const int64_t x_index, const int64_t y_index, const int64_t z_index, const bool enable_edge_gradients, Eigen::Vector3d& gradient) const
         {
             // Make sure the index is inside bounds
             if ((x_index >= 0) && (y_index >= 0) && (z_index >= 0) && (x_index < GetNumXCells()) && (y_index < GetNumYCells()) && (z_index < GetNumZCells()))
@@ -544,7 +630,8 @@ namespace sdf_tools
                     double gx = (Get(x_index + 1, y_index, z_index) - Get(x_index - 1, y_index, z_index)) * inv_twice_resolution;
                     double gy = (Get(x_index, y_index + 1, z_index) - Get(x_index, y_index - 1, z_index)) * inv_twice_resolution;
                     double gz = (Get(x_index, y_index, z_index + 1) - Get(x_index, y_index, z_index - 1)) * inv_twice_resolution;
-                    return std::vector<double>{gx, gy, gz};
+                    gradient = Eigen::Vector3d(gx, gy, gz);
+                    return true;
                 }
                 // If we're on the edge, handle it specially
                 else if (enable_edge_gradients)
@@ -590,21 +677,64 @@ namespace sdf_tools
                         gz = (high_z_value - low_z_value) * inv_z_increment;
                     }
                     // Assemble and return the computed gradient
-                    return std::vector<double>{gx, gy, gz};
+                    gradient = Eigen::Vector3d(gx, gy, gz);
+                    return true;
                 }
                 // Edge gradients disabled, return no gradient
                 else
                 {
-                    return std::vector<double>();
+                    return false;
                 }
             }
             // If we're out of bounds, return no gradient
             else
             {
-                return std::vector<double>();
+                return false;
             }
         }
 
+        /*
+         * Queries of the field interpolated between the cell centers, which is continuous and has a
+         * gradient everywhere inside the grid. They do not allocate, unlike the std::vector
+         * returning queries above.
+         */
+
+        // Distance of the trilinear interpolation, and whether the location is inside the grid. The
+        // OOB value is returned outside the grid.
+        inline std::pair<double, bool> GetInterpolatedDistance3d(const Eigen::Vector3d& location) const
+        {
+            double distance = 0.0;
+            Eigen::Vector3d gradient;
+            const bool inside = GetInterpolatedDistanceAndGradient3d(location, distance, gradient);
+            return std::make_pair(distance, inside);
+        }
+
+        // Distance and gradient of the trilinear interpolation, the gradient being in the frame of
+        // location. Returns false outside the grid, with the OOB value and a zero gradient.
+        inline bool GetInterpolatedDistanceAndGradient3d(const Eigen::Vector3d& location, double& distance, Eigen::Vector3d& gradient) const
+        {
+            const double inv_resolution = 1.0 / GetResolution();
+            const Eigen::Vector3d cell_coordinates = (GetInverseOriginTransform() * location) * inv_resolution;
+            if (cell_coordinates.x() < 0.0 || cell_coordinates.y() < 0.0 || cell_coordinates.z() < 0.0 || cell_coordinates.x() >= (double)GetNumXCells() || cell_coordinates.y() >= (double)GetNumYCells() || cell_coordinates.z() >= (double)GetNumZCells())
+            {
+                distance = (double)GetOOBValue();
+                gradient.setZero();
+                return false;
+            }
+            Eigen::Vector3d cell_gradient;
+            distance = InterpolateCellCoordinates(cell_coordinates.x() - 0.5, cell_coordinates.y() - 0.5, cell_coordinates.z() - 0.5, cell_gradient);
+            gradient = GetOriginTransform().linear() * (cell_gradient * inv_resolution);
+            return true;
+        }
+
+        // GetInterpolatedDistanceAndGradient3d of each column of locations, in blocks whose
+        // interpolation runs as vectorized loops over arrays of the block. distances and gradients
+        // are only reallocated when the number of locations changes. Returns the number of locations
+        // inside the grid.
+        size_t GetInterpolatedDistancesAndGradients(const Eigen::Matrix3Xd& locations, Eigen::VectorXd& distances, Eigen::Matrix3Xd& gradients) const;
+
+        size_t GetInterpolatedDistances(const Eigen::Matrix3Xd& locations, Eigen::VectorXd& distances) const;
+
         inline Eigen::Vector3d ProjectOutOfCollision(const double x, const double y, const double z, const double stepsize_multiplier = 1.0 / 10.0) const
         {
             const Eigen::Vector4d result = ProjectOutOfCollision4d(Eigen::Vector4d(x, y, z, 1.0), stepsize_multiplier);
@@ -675,6 +805,11 @@ namespace sdf_tools
             return distance_field_.LocationToGridIndex3d(location);
         }
 
+        inline bool LocationToGridIndex3d(const Eigen::Vector3d& location, int64_t& x_index, int64_t& y_index, int64_t& z_index) const
+        {
+            return distance_field_.LocationToGridIndex3d(location, x_index, y_index, z_index);
+        }
+
         inline std::vector<int64_t> LocationToGridIndex4d(const Eigen::Vector4d& location) const
         {
             return distance_field_.LocationToGridIndex4d(location);
@@ -704,6 +839,11 @@ namespace sdf_tools
 
         bool LoadFromFile(const std::string& filepath);
 
+        // Same binary format as CollisionMapGrid, with float cells
+        bool SaveToBinaryFile(const std::string& filepath) const;
+
+        bool LoadFromBinaryFile(const std::string& filepath);
+
         sdf_tools::SDF GetMessageRepresentation();
 
         bool LoadFromMessageRepresentation(sdf_tools::SDF& message);
@@ -118,7 +118,20 @@ namespace sdf_tools
             return loaded;
         }
     }
+}
+
+namespace arc_helpers
+{
+    // All the fields of a TAGGED_OBJECT_COLLISION_CELL are 4-byte words
+    template<>
+    struct ByteSwapWordSize<sdf_tools::TAGGED_OBJECT_COLLISION_CELL>
+    {
+        static const size_t value = 4u;
+    };
+}
 
+namespace sdf_tools
+{
     class TaggedObjectCollisionMapGrid
     {
     protected:
@@ -478,7 +491,24 @@ namespace sdf_tools
             return marked_cells;
         }
 
-        std::vector<VoxelGrid::GRID_INDEX> CheckIfConvex(const VoxelGrid::GRID_INDEX& candidate_index, std::unordered_map<VoxelGrid::GRID_INDEX, int8_t>& explored_indices, const VoxelGrid::VoxelGrid<std::vector<uint32_t>>& region_grid, const uint32_t current_convex_region) const;
+        inline int64_t GetOccupancyBitIndex(const int64_t x_index, const int64_t y_index, const int64_t z_index) const
+        {
+            return (((x_index * GetNumYCells()) + y_index) * GetNumZCells()) + z_index;
+        }
+
+        static inline bool GetOccupancyBit(const std::vector<uint64_t>& bits, const int64_t bit_index)
+        {
+            return ((bits[(size_t)(bit_index >> 6)] >> (bit_index & 63)) & 1) == 1;
+        }
+
+        static inline void SetOccupancyBit(std::vector<uint64_t>& bits, const int64_t bit_index)
+        {
+            bits[(size_t)(bit_index >> 6)] |= (uint64_t)1 << (bit_index & 63);
+        }
+
+        bool IsLineOfSightFree(const std::vector<uint64_t>& occupancy_bits, const VoxelGrid::GRID_INDEX& start_index, const VoxelGrid::GRID_INDEX& end_index) const;
+
+        std::vector<VoxelGrid::GRID_INDEX> GrowConvexRegion(const VoxelGrid::GRID_INDEX& start_index, const std::vector<uint64_t>& occupancy_bits, const double max_check_radius, std::vector<int8_t>& explored_indices) const;
 
     public:
 
@@ -1446,9 +1476,11 @@ namespace sdf_tools
             return std::pair<SignedDistanceField, std::pair<double, double>>(new_sdf, extrema);
         }
 
-        VoxelGrid::VoxelGrid<std::vector<uint32_t>> ComputeConvexRegions(const double max_check_radius) const;
+        // Free cells grouped into regions in which every cell sees every other one, each region
+        // within max_check_radius of its seed. Regions can overlap.
+        std::vector<std::vector<VoxelGrid::GRID_INDEX>> ComputeConvexSegments(const double max_check_radius, const uint32_t num_threads = 0) const;
 
-        void GrowConvexRegion(const VoxelGrid::GRID_INDEX& start_index, VoxelGrid::VoxelGrid<std::vector<uint32_t>>& region_grid, const double max_check_radius, const uint32_t current_convex_region) const;
+        VoxelGrid::VoxelGrid<std::vector<uint32_t>> ComputeConvexRegions(const double max_check_radius) const;
 
         EigenHelpers::VectorVector3d GenerateRayPrimitiveVectors(const uint32_t number_of_rays, const double cone_angle) const
         {
@@ -0,0 +1,121 @@
+#include <stdlib.h>
+#include <stdint.h>
+#include <atomic>
+#include <sdf_tools/dynamic_spatial_hashed_collision_map.hpp>
+
+#ifndef VERSIONED_COLLISION_MAP_HPP
+#define VERSIONED_COLLISION_MAP_HPP
+
+namespace sdf_tools
+{
+    // Published versions of a DynamicSpatialHashedCollisionMapGrid, for readers running on other
+    // threads than the one writer. The writer changes its own copy of the map and publishes it from
+    // time to time; a reader pins the last published version and reads it while the writer goes on.
+    // Neither side takes a lock or waits for the other. Versions are kept in NUM_BUFFERS copies of the
+    // map, and publishing brings a copy nobody reads up to date by copying the chunks changed since
+    // the version it holds.
+    class VersionedCollisionMap
+    {
+    public:
+
+        // One buffer holds the last version, the others can be held by readers or be written
+        static const int NUM_BUFFERS = 3;
+
+    protected:
+
+        struct MAP_BUFFER
+        {
+            DynamicSpatialHashedCollisionMapGrid map;
+            uint64_t version;
+            std::atomic<int> readers;
+
+            MAP_BUFFER() : version(0), readers(0) {}
+        };
+
+        DynamicSpatialHashedCollisionMapGrid writable_;
+        MAP_BUFFER buffers_[NUM_BUFFERS];
+        std::atomic<int> current_buffer_;
+
+    public:
+
+        // A published version pinned by a reader: it stays readable and unchanged as long as the
+        // snapshot exists
+        class Snapshot
+        {
+        protected:
+
+            friend class VersionedCollisionMap;
+
+            MAP_BUFFER* buffer_;
+
+            explicit Snapshot(MAP_BUFFER* buffer) : buffer_(buffer) {}
+
+        public:
+
+            Snapshot(Snapshot&& other) : buffer_(other.buffer_)
+            {
+                other.buffer_ = NULL;
+            }
+
+            Snapshot(const Snapshot& other) = delete;
+
+            Snapshot& operator=(const Snapshot& other) = delete;
+
+            ~Snapshot()
+            {
+                if (buffer_ != NULL)
+                {
+                    buffer_->readers.fetch_sub(1);
+                }
+            }
+
+            inline const DynamicSpatialHashedCollisionMapGrid& GetMap() const
+            {
+                return buffer_->map;
+            }
+
+            inline uint64_t GetVersion() const
+            {
+                return buffer_->version;
+            }
+        };
+
+        // The map is published as version map.GetEpoch()
+        explicit VersionedCollisionMap(const DynamicSpatialHashedCollisionMapGrid& map);
+
+        VersionedCollisionMap(const VersionedCollisionMap& other) = delete;
+
+        VersionedCollisionMap& operator=(const VersionedCollisionMap& other) = delete;
+
+        // The writer's map. Only the writer thread may use it.
+        inline DynamicSpatialHashedCollisionMapGrid& GetWritable()
+        {
+            return writable_;
+        }
+
+        // Publishes the writer's map as its current epoch and starts the next one. Writer thread only.
+        // Returns false, leaving the changes for the next call, if readers still hold every buffer
+        // but the current one.
+        bool Publish();
+
+        // Pins the last published version. Any thread.
+        inline Snapshot Pin()
+        {
+            while (true)
+            {
+                const int current = current_buffer_.load();
+                MAP_BUFFER& buffer = buffers_[current];
+                buffer.readers.fetch_add(1);
+                // Publish only writes a buffer that is not current and has no readers, so if the
+                // buffer is still current once counted, it is ours until the count drops
+                if (current_buffer_.load() == current)
+                {
+                    return Snapshot(&buffer);
+                }
+                buffer.readers.fetch_sub(1);
+            }
+        }
+    };
+}
+
+#endif // VERSIONED_COLLISION_MAP_HPP
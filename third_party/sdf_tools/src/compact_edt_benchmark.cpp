@@ -0,0 +1,94 @@
+/* Distance field of b_traj_node's local map as the planner reads it: CompactDistanceField, rebuilt
+   into the same buffers on every replan, against the bucket_cell fields of ExtractDistanceField and
+   ExtractTruncatedDistanceField. The local map is the 16 x 16 x 8 m box of simulation.launch plus
+   its buffer, filled with the inflated trees of random_forest_sensing at the given density (trees
+   per 100 m^2).
+
+   Every cell is checked to get the same distance from the compact field as from the bucket_cell
+   field built with the same cutoff (0 for the exact field), where that distance is below the
+   cutoff, and to be at least the cutoff elsewhere.
+
+   Usage: ./compact_edt_benchmark [cutoff] [density] [reps] */
+
+#include <stdio.h>
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <sdf_tools/collision_map.hpp>
+#include <sdf_tools/compact_distance_field.hpp>
+
+const double resolution = 0.2;
+const double x_size = 18.0, y_size = 18.0, z_size = 10.0;
+const sdf_tools::COLLISION_CELL free_cell(0.0), obst_cell(1.0);
+
+double elapsed(const std::chrono::steady_clock::time_point& start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char** argv)
+{
+    const double cutoff = (argc > 1) ? std::stod(argv[1]) : 1.0;
+    const double density = (argc > 2) ? std::stod(argv[2]) : 2.0;
+    const int reps = (argc > 3) ? std::stoi(argv[3]) : 5;
+
+    const Eigen::Affine3d origin_transform(Eigen::Translation3d(0.0, 0.0, 0.0));
+    sdf_tools::CollisionMapGrid map(origin_transform, "world", resolution, x_size, y_size, z_size, free_cell);
+    std::mt19937 gen(0);
+    std::uniform_real_distribution<double> rand_x(0.0, x_size), rand_y(0.0, y_size), rand_w(0.3, 0.8);
+    const int tree_num = (int)(density * x_size * y_size / 100.0);
+    for (int i = 0; i < tree_num; i++)
+    {
+        const double x = rand_x(gen), y = rand_y(gen), w = rand_w(gen);
+        const int widNum = std::ceil(w / resolution);
+        for (int r = -widNum / 2 - 1; r < widNum / 2 + 1; r++)
+            for (int s = -widNum / 2 - 1; s < widNum / 2 + 1; s++)
+                for (double z = 0.0; z < z_size; z += resolution)
+                    map.Set(x + r * resolution, y + s * resolution, z, obst_cell);
+    }
+
+    sdf_tools::CompactDistanceField compact;
+    compact.Build(map, cutoff);
+    double bucket_time = 0.0, compact_time = 0.0;
+    for (int r = 0; r < reps; r++)
+    {
+        auto start = std::chrono::steady_clock::now();
+        auto bucket = (cutoff > 0.0) ? map.ExtractTruncatedDistanceField(cutoff) : map.ExtractDistanceField(INFINITY);
+        bucket_time += elapsed(start);
+        start = std::chrono::steady_clock::now();
+        compact.Build(map, cutoff);
+        compact_time += elapsed(start);
+    }
+
+    auto bucket = (cutoff > 0.0) ? map.ExtractTruncatedDistanceField(cutoff) : map.ExtractDistanceField(INFINITY);
+    const size_t bucket_bytes = bucket.GetRawData().size() * sizeof(bucket.GetRawData()[0]);
+    const double limit = (cutoff > 0.0) ? cutoff : INFINITY;
+    int64_t num_cells = 0, near_cells = 0, wrong_distance = 0;
+    for (int64_t x = 0; x < map.GetNumXCells(); x++)
+        for (int64_t y = 0; y < map.GetNumYCells(); y++)
+            for (int64_t z = 0; z < map.GetNumZCells(); z++)
+            {
+                const double bucket_distance = sqrt(bucket.GetImmutable(x, y, z).first.distance_square) * resolution;
+                const double compact_distance = compact.GetDistance(x, y, z);
+                num_cells++;
+                if (bucket_distance <= limit)
+                {
+                    near_cells++;
+                    wrong_distance += (compact_distance != bucket_distance) ? 1 : 0;
+                }
+                else
+                {
+                    wrong_distance += (compact_distance < limit) ? 1 : 0;
+                }
+            }
+
+    std::cout << std::fixed << std::setprecision(3)
+              << num_cells << " cells, " << tree_num << " trees, " << near_cells << " cells within " << limit << " m of an obstacle\n"
+              << "\tbucket_cell field:  " << bucket_time * 1e3 / reps << " ms, " << bucket_bytes / 1e6 << " MB\n"
+              << "\tcompact field:      " << compact_time * 1e3 / reps << " ms, " << compact.GetMemoryUsage() / 1e6 << " MB, " << compact.GetScratchMemoryUsage() / 1e6 << " MB of buffers\n"
+              << "\tcells with a different distance: " << wrong_distance << std::endl;
+    return (wrong_distance == 0) ? 0 : 1;
+}
@@ -0,0 +1,144 @@
+/* Global map of b_traj_node as a dense CollisionMapGrid against a DynamicSpatialHashedCollisionMapGrid:
+   memory, time to reset and refill the map as rcvPointCloudCallBack does, and lookup time by cell
+   index, both at random cells and in the box scans of polyhedronGenerator.
+
+   The obstacles are trees as in random_forest_sensing, on the 50 x 50 x 5 m map of
+   simulation.launch, and only those in the explored part of the map (a strip along x, of the given
+   fractions of the map) are set, as if the robot had sensed that far. Every cell of the map is
+   checked to read the same from both grids. Chunks span the whole height of the map by default, as
+   in b_traj_node, so that no z cells are padded.
+
+   Usage: ./hashed_map_benchmark [chunk size] [lookups] [chunk size along z] */
+
+#include <stdio.h>
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <sdf_tools/collision_map.hpp>
+#include <sdf_tools/dynamic_spatial_hashed_collision_map.hpp>
+
+const double resolution = 0.2;
+const double x_size = 50.0, y_size = 50.0, z_size = 5.0;
+const int tree_num = 520;
+const sdf_tools::COLLISION_CELL free_cell(0.0), obst_cell(1.0);
+
+double elapsed(const std::chrono::steady_clock::time_point& start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Inflated obstacle points of the trees whose trunk lies in the first explored fraction of the map along x
+std::vector<Eigen::Vector3d> generateForest(const double explored)
+{
+    std::mt19937 gen(0);
+    std::uniform_real_distribution<double> rand_x(-x_size / 2.0, x_size / 2.0), rand_y(-y_size / 2.0, y_size / 2.0), rand_w(0.3, 0.8);
+    std::vector<Eigen::Vector3d> points;
+    for (int i = 0; i < tree_num; i++)
+    {
+        const double x = rand_x(gen), y = rand_y(gen), w = rand_w(gen);
+        if (x > -x_size / 2.0 + explored * x_size)
+            continue;
+        const int widNum = std::ceil(w / resolution);
+        for (int r = -widNum / 2; r < widNum / 2; r++)
+            for (int s = -widNum / 2; s < widNum / 2; s++)
+                for (double z = 0.0; z < z_size; z += resolution)
+                    for (int dx = -1; dx <= 1; dx++)
+                        for (int dy = -1; dy <= 1; dy++)
+                            points.push_back(Eigen::Vector3d(x + (r + dx) * resolution, y + (s + dy) * resolution, z));
+    }
+    return points;
+}
+
+template<typename Map>
+double fill(Map& map, const std::vector<Eigen::Vector3d>& points, const int reps)
+{
+    const auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < reps; r++)
+    {
+        map.RestMap();
+        for (size_t i = 0; i < points.size(); i++)
+            map.Set3d(points[i], obst_cell);
+    }
+    return elapsed(start) / reps;
+}
+
+// Returns ns per lookup, count of occupied cells read in occupied
+template<typename Map>
+double randomLookups(const Map& map, const std::vector<Eigen::Vector3i>& cells, int64_t& occupied)
+{
+    occupied = 0;
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < cells.size(); i++)
+        occupied += map.Get((int64_t)cells[i](0), (int64_t)cells[i](1), (int64_t)cells[i](2)).first.occupancy > 0.5;
+    return elapsed(start) * 1e9 / cells.size();
+}
+
+// Scans of boxes of 15 x 15 x 15 cells, as gatherObstacles does around a segment
+template<typename Map>
+double boxLookups(const Map& map, const std::vector<Eigen::Vector3i>& corners, int64_t& occupied)
+{
+    occupied = 0;
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < corners.size(); i++)
+        for (int64_t x = corners[i](0); x < corners[i](0) + 15; x++)
+            for (int64_t y = corners[i](1); y < corners[i](1) + 15; y++)
+                for (int64_t z = corners[i](2); z < corners[i](2) + 15; z++)
+                    occupied += map.Get(x, y, z).first.occupancy > 0.5;
+    return elapsed(start) * 1e9 / (corners.size() * 15 * 15 * 15);
+}
+
+int main(int argc, char** argv)
+{
+    const int chunk_size = (argc > 1) ? std::stoi(argv[1]) : 8;
+    const int lookups = (argc > 2) ? std::stoi(argv[2]) : 10000000;
+
+    const Eigen::Affine3d origin_transform(Eigen::Translation3d(-x_size / 2.0, -y_size / 2.0, 0.0));
+    sdf_tools::CollisionMapGrid dense(origin_transform, "world", resolution, x_size, y_size, z_size, free_cell);
+    const int64_t nx = dense.GetNumXCells(), ny = dense.GetNumYCells(), nz = dense.GetNumZCells();
+    const int z_chunk_size = (argc > 3) ? std::stoi(argv[3]) : (int)nz;
+    sdf_tools::DynamicSpatialHashedCollisionMapGrid hashed(origin_transform, "world", resolution, chunk_size, chunk_size, z_chunk_size, free_cell);
+
+    std::mt19937 gen(1);
+    std::uniform_int_distribution<int> rand_x(0, nx - 1), rand_y(0, ny - 1), rand_z(0, nz - 1);
+    std::uniform_int_distribution<int> rand_box_x(0, nx - 15), rand_box_y(0, ny - 15), rand_box_z(0, nz - 15);
+    std::vector<Eigen::Vector3i> cells(lookups), corners(lookups / 3375);
+    for (size_t i = 0; i < cells.size(); i++)
+        cells[i] = Eigen::Vector3i(rand_x(gen), rand_y(gen), rand_z(gen));
+    for (size_t i = 0; i < corners.size(); i++)
+        corners[i] = Eigen::Vector3i(rand_box_x(gen), rand_box_y(gen), rand_box_z(gen));
+
+    std::cout << std::fixed << std::setprecision(2) << nx << " x " << ny << " x " << nz << " cells, chunks of " << chunk_size << " x " << chunk_size << " x " << z_chunk_size << " cells\n";
+    bool ok = true;
+    const double fractions[3] = {0.1, 0.5, 1.0};
+    for (int f = 0; f < 3; f++)
+    {
+        const std::vector<Eigen::Vector3d> points = generateForest(fractions[f]);
+        const double t_fill_dense = fill(dense, points, 3);
+        const double t_fill_hashed = fill(hashed, points, 3);
+
+        bool same = true;
+        for (int64_t x = 0; x < nx && same; x++)
+            for (int64_t y = 0; y < ny && same; y++)
+                for (int64_t z = 0; z < nz && same; z++)
+                    same = (dense.Get(x, y, z).first.occupancy == hashed.Get(x, y, z).first.occupancy);
+        ok = ok && same;
+
+        int64_t dense_occupied = 0, hashed_occupied = 0, dense_box_occupied = 0, hashed_box_occupied = 0;
+        const double t_random_dense = randomLookups(dense, cells, dense_occupied);
+        const double t_random_hashed = randomLookups(hashed, cells, hashed_occupied);
+        const double t_box_dense = boxLookups(dense, corners, dense_box_occupied);
+        const double t_box_hashed = boxLookups(hashed, corners, hashed_box_occupied);
+        ok = ok && (dense_occupied == hashed_occupied) && (dense_box_occupied == hashed_box_occupied);
+
+        std::cout << "explored " << fractions[f] * 100.0 << "% of the map, " << points.size() << " obstacle points\n"
+                  << "\tmemory:        dense " << nx * ny * nz * sizeof(sdf_tools::COLLISION_CELL) / 1048576.0 << " MB, hashed " << hashed.GetMemoryUsage() / 1048576.0 << " MB in " << hashed.GetNumChunks() << " chunks\n"
+                  << "\treset + fill:  dense " << t_fill_dense * 1e3 << " ms, hashed " << t_fill_hashed * 1e3 << " ms\n"
+                  << "\trandom Get:    dense " << t_random_dense << " ns, hashed " << t_random_hashed << " ns\n"
+                  << "\tbox scan Get:  dense " << t_box_dense << " ns, hashed " << t_box_hashed << " ns\n"
+                  << "\tsame cells:    " << ((same && dense_occupied == hashed_occupied && dense_box_occupied == hashed_box_occupied) ? "yes" : "NO") << '\n';
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,225 @@
+/* OccupancyLogOddsMap fed the clouds of random_forest_sensing: the trees of the 50 x 50 x 5 m map of
+   simulation.launch within the sensing radius of a robot flying along x. Each cloud is ray cast from
+   the robot into the log-odds map, and the chunks whose occupancy changed are dilated into the
+   global map as b_traj_node does. For comparison, the same cloud is written into a reset map the way
+   rcvPointCloudCallBack did before.
+
+   Checks, each reported as OK or FAILED:
+   - casting on any number of threads gives the same map as casting on one
+   - trees sensed earlier stay in the map once out of range
+   - a tree that is removed is cleared by the rays that now cross it
+   - the incrementally dilated global map equals the dilation of the final occupancy
+
+   Usage: ./log_odds_map_benchmark [scans] [threads] */
+
+#include <stdio.h>
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <sdf_tools/dynamic_spatial_hashed_collision_map.hpp>
+#include <sdf_tools/occupancy_log_odds_map.hpp>
+
+const double resolution = 0.2;
+const double x_size = 50.0, y_size = 50.0, z_size = 5.0;
+const double sensing_range = 10.0, max_ray_range = 12.0;
+const int tree_num = 520;
+const int64_t chunk_size = 16, radius_xy = 1, radius_z = 1;
+const sdf_tools::COLLISION_CELL free_cell(0.0), obst_cell(1.0);
+
+double elapsed(const std::chrono::steady_clock::time_point& start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+struct TREE
+{
+    double x, y, w;
+};
+
+std::vector<TREE> generateTrees()
+{
+    std::mt19937 gen(0);
+    std::uniform_real_distribution<double> rand_x(-x_size / 2.0, x_size / 2.0), rand_y(-y_size / 2.0, y_size / 2.0), rand_w(0.3, 0.8);
+    std::vector<TREE> trees;
+    for (int i = 0; i < tree_num; i++)
+    {
+        TREE tree;
+        tree.x = rand_x(gen);
+        tree.y = rand_y(gen);
+        tree.w = rand_w(gen);
+        trees.push_back(tree);
+    }
+    return trees;
+}
+
+// Points of the trees within the sensing radius, as random_forest_sensing publishes them
+std::vector<Eigen::Vector3d> senseCloud(const std::vector<TREE>& trees, const Eigen::Vector3d& origin)
+{
+    std::vector<Eigen::Vector3d> points;
+    for (size_t i = 0; i < trees.size(); i++)
+    {
+        const int widNum = std::ceil(trees[i].w / resolution);
+        for (int r = -widNum / 2; r < widNum / 2; r++)
+            for (int s = -widNum / 2; s < widNum / 2; s++)
+                for (double z = 0.0; z < z_size; z += resolution)
+                {
+                    const Eigen::Vector3d point(trees[i].x + r * resolution, trees[i].y + s * resolution, z);
+                    if ((point - origin).norm() <= sensing_range)
+                        points.push_back(point);
+                }
+    }
+    return points;
+}
+
+Eigen::Vector3d scanOrigin(const int scan, const int scans)
+{
+    return Eigen::Vector3d(-x_size / 2.0 + 5.0 + (x_size - 10.0) * scan / std::max(1, scans - 1), 0.0, 1.5);
+}
+
+void report(const std::string& check, const bool ok)
+{
+    std::cout << "\t" << std::left << std::setw(46) << check << (ok ? "OK" : "FAILED") << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+    const int scans = (argc > 1) ? std::stoi(argv[1]) : 100;
+    const int num_threads = (argc > 2) ? std::stoi(argv[2]) : 4;
+
+    const Eigen::Affine3d origin_transform(Eigen::Translation3d(-x_size / 2.0, -y_size / 2.0, 0.0));
+    std::vector<TREE> trees = generateTrees();
+    std::vector<std::vector<Eigen::Vector3d>> clouds;
+    size_t num_points = 0;
+    for (int scan = 0; scan < scans; scan++)
+    {
+        clouds.push_back(senseCloud(trees, scanOrigin(scan, scans)));
+        num_points += clouds.back().size();
+    }
+
+    sdf_tools::OccupancyLogOddsMap single(origin_transform, resolution, chunk_size, 0.85f, -0.4f, -2.0f, 3.5f, 0.0f, 1);
+    sdf_tools::OccupancyLogOddsMap threaded(origin_transform, resolution, chunk_size, 0.85f, -0.4f, -2.0f, 3.5f, 0.0f, num_threads);
+    sdf_tools::DynamicSpatialHashedCollisionMapGrid global_map(origin_transform, "world", resolution, chunk_size, chunk_size, chunk_size, free_cell);
+    sdf_tools::DynamicSpatialHashedCollisionMapGrid reset_map(origin_transform, "world", resolution, chunk_size, chunk_size, chunk_size, free_cell);
+    std::vector<Eigen::Vector3i> changed_chunks, threaded_changed_chunks;
+    double single_time = 0.0, threaded_time = 0.0, dilate_time = 0.0, reset_time = 0.0;
+    size_t num_changed = 0;
+    bool same_changes = true;
+    for (int scan = 0; scan < scans; scan++)
+    {
+        const Eigen::Vector3d origin = scanOrigin(scan, scans);
+        auto start = std::chrono::steady_clock::now();
+        single.InsertPointCloud(origin, clouds[scan], max_ray_range, changed_chunks);
+        single_time += elapsed(start);
+        start = std::chrono::steady_clock::now();
+        threaded.InsertPointCloud(origin, clouds[scan], max_ray_range, threaded_changed_chunks);
+        threaded_time += elapsed(start);
+        same_changes = same_changes && (changed_chunks == threaded_changed_chunks);
+        num_changed += changed_chunks.size();
+        start = std::chrono::steady_clock::now();
+        threaded.DilateChunksInto(threaded_changed_chunks, radius_xy, radius_z, global_map, obst_cell, free_cell);
+        dilate_time += elapsed(start);
+        start = std::chrono::steady_clock::now();
+        reset_map.RestMap();
+        for (size_t idx = 0; idx < clouds[scan].size(); idx++)
+            for (int64_t dx = -radius_xy; dx <= radius_xy; dx++)
+                for (int64_t dy = -radius_xy; dy <= radius_xy; dy++)
+                    for (int64_t dz = -radius_z; dz <= radius_z; dz++)
+                        reset_map.Set3d(clouds[scan][idx] + Eigen::Vector3d(dx, dy, dz) * resolution, obst_cell);
+        reset_time += elapsed(start);
+    }
+
+    std::cout << std::fixed << std::setprecision(3)
+              << scans << " scans, " << num_points / scans << " points per scan, " << num_threads << " threads\n"
+              << "\tray casting, 1 thread:     " << single_time * 1e3 / scans << " ms per scan\n"
+              << "\tray casting, " << num_threads << " threads:    " << threaded_time * 1e3 / scans << " ms per scan\n"
+              << "\tdilation into global map:  " << dilate_time * 1e3 / scans << " ms per scan, " << (double)num_changed / scans << " chunks\n"
+              << "\treset and rewrite:         " << reset_time * 1e3 / scans << " ms per scan\n"
+              << "\tlog-odds map:              " << threaded.GetMemoryUsage() / 1e6 << " MB\n";
+
+    // Whole map, every tree the robot passed, as cells
+    const Eigen::Vector3d lower(-x_size / 2.0, -y_size / 2.0, 0.0), upper(x_size / 2.0 - 1e-6, y_size / 2.0 - 1e-6, z_size - 1e-6);
+    std::vector<Eigen::Vector3d> single_cells, threaded_cells;
+    single.GetOccupiedCells(lower, upper, single_cells);
+    threaded.GetOccupiedCells(lower, upper, threaded_cells);
+    bool same = same_changes && (single_cells.size() == threaded_cells.size());
+    for (size_t idx = 0; same && idx < single_cells.size(); idx++)
+        same = (single_cells[idx] - threaded_cells[idx]).norm() < 1e-9;
+    report("threads give the map of one thread", same);
+
+    // The first cloud was seen from far behind the last origin
+    size_t kept = 0;
+    for (size_t idx = 0; idx < clouds[0].size(); idx++)
+        kept += threaded.IsOccupied(clouds[0][idx]) ? 1 : 0;
+    report("trees out of range persist (" + std::to_string(kept) + "/" + std::to_string(clouds[0].size()) + ")", kept * 10 >= clouds[0].size() * 9);
+
+    // The tree closest to the last origin, but not around it, is taken out, and the robot looks
+    // through where it stood at a wall behind it
+    const Eigen::Vector3d last_origin = scanOrigin(scans - 1, scans);
+    size_t closest = trees.size();
+    double closest_distance = sensing_range;
+    for (size_t i = 0; i < trees.size(); i++)
+    {
+        const double distance = std::hypot(trees[i].x - last_origin.x(), trees[i].y - last_origin.y());
+        if (distance > 2.0 && distance < closest_distance)
+        {
+            closest = i;
+            closest_distance = distance;
+        }
+    }
+    if (closest == trees.size())
+    {
+        std::cout << "No tree in range of the last origin" << std::endl;
+        return 1;
+    }
+    const TREE removed = trees[closest];
+    std::vector<TREE> removed_tree(1, removed);
+    const std::vector<Eigen::Vector3d> removed_points = senseCloud(removed_tree, last_origin);
+    trees.erase(trees.begin() + closest);
+    // A wall behind the tree, seen from the last origin
+    std::vector<Eigen::Vector3d> wall;
+    const Eigen::Vector3d away = Eigen::Vector3d(removed.x - last_origin.x(), removed.y - last_origin.y(), 0.0).normalized();
+    const Eigen::Vector3d side(-away.y(), away.x(), 0.0);
+    const Eigen::Vector3d wall_center = Eigen::Vector3d(removed.x, removed.y, 0.0) + away * 2.0;
+    for (double s = -2.0; s <= 2.0; s += resolution / 2.0)
+        for (double z = 0.0; z < z_size; z += resolution / 2.0)
+            wall.push_back(wall_center + side * s + Eigen::Vector3d(0.0, 0.0, z));
+    for (int scan = 0; scan < 10; scan++)
+    {
+        std::vector<Eigen::Vector3d> cloud = senseCloud(trees, last_origin);
+        cloud.insert(cloud.end(), wall.begin(), wall.end());
+        threaded.InsertPointCloud(last_origin, cloud, max_ray_range, changed_chunks);
+        threaded.DilateChunksInto(changed_chunks, radius_xy, radius_z, global_map, obst_cell, free_cell);
+    }
+    // Cells of the trunk on the way to the wall only, the others were never crossed
+    size_t cleared = 0, crossed = 0;
+    const double wall_distance = away.dot(wall_center - last_origin);
+    for (size_t idx = 0; idx < removed_points.size(); idx++)
+    {
+        const Eigen::Vector3d& point = removed_points[idx];
+        const Eigen::Vector3d on_wall = last_origin + (point - last_origin) * (wall_distance / away.dot(point - last_origin));
+        if (std::fabs(side.dot(on_wall - wall_center)) > 1.7 || on_wall.z() < 0.3 || on_wall.z() > z_size - 0.3)
+            continue;
+        crossed++;
+        cleared += threaded.IsOccupied(point) ? 0 : 1;
+    }
+    report("removed tree cleared (" + std::to_string(cleared) + "/" + std::to_string(crossed) + ")", crossed > 0 && cleared * 10 >= crossed * 9);
+
+    // Dilating the whole final occupancy from scratch gives the incrementally kept global map
+    sdf_tools::DynamicSpatialHashedCollisionMapGrid full_map(origin_transform, "world", resolution, chunk_size, chunk_size, chunk_size, free_cell);
+    std::vector<Eigen::Vector3i> all_chunks;
+    for (int x = -2; x < (int)(x_size / resolution) / chunk_size + 2; x++)
+        for (int y = -2; y < (int)(y_size / resolution) / chunk_size + 2; y++)
+            for (int z = -2; z < (int)(z_size / resolution) / chunk_size + 2; z++)
+                all_chunks.push_back(Eigen::Vector3i(x, y, z));
+    threaded.DilateChunksInto(all_chunks, radius_xy, radius_z, full_map, obst_cell, free_cell);
+    size_t mismatched = 0;
+    for (int64_t x = -chunk_size; x < (int64_t)(x_size / resolution) + chunk_size; x++)
+        for (int64_t y = -chunk_size; y < (int64_t)(y_size / resolution) + chunk_size; y++)
+            for (int64_t z = -chunk_size; z < (int64_t)(z_size / resolution) + chunk_size; z++)
+                mismatched += (global_map.Get(x, y, z).first.occupancy != full_map.Get(x, y, z).first.occupancy) ? 1 : 0;
+    report("incremental dilation matches (" + std::to_string(mismatched) + " cells differ)", mismatched == 0);
+    return 0;
+}
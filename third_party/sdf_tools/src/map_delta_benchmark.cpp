@@ -0,0 +1,283 @@
+/* Map traffic and planner ingest time at 10 Hz: the full sensed cloud (sensor_msgs/PointCloud2 of
+   pcl::PointXYZ, unpacked and inflated point by point into the global and local maps after a
+   reset, as b_traj_node does) against the chunked delta stream (CollisionMapDeltaDecoder::Apply,
+   DilateChunksInto on the changed chunks, then the local map rebuilt from the occupied cells).
+
+   The forest and the sensing follow random_forest_sensing with the parameters of
+   simulation.launch, and the robot flies across the map at 2 m/s. Every few ticks the global map
+   built from the deltas is checked against a brute-force inflation of the sensed cells.
+
+   Usage: ./map_delta_benchmark [ticks] [chunk size] [keyframe period] */
+
+#include <stdio.h>
+#include <string.h>
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <sdf_tools/collision_map.hpp>
+#include <sdf_tools/collision_map_delta.hpp>
+
+struct PointXYZ
+{
+    float x, y, z, padding;
+};
+
+const double resolution = 0.2;
+const double x_size = 50.0, y_size = 50.0, z_size = 5.0;
+const double x_local_size = 20.0, y_local_size = 16.0, z_local_size = 8.0, buffer_size = 4.0;
+const double sensing_range = 15.0;
+const int margin_cells = 1, margin_z_cells = 1;
+const sdf_tools::COLLISION_CELL free_cell(0.0), obst_cell(1.0);
+
+double elapsed(const std::chrono::steady_clock::time_point& start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+std::vector<PointXYZ> generateForest()
+{
+    std::mt19937 eng(0);
+    std::uniform_real_distribution<double> rand_x(-x_size / 2.0, x_size / 2.0), rand_y(-y_size / 2.0, y_size / 2.0);
+    std::uniform_real_distribution<double> rand_w(0.3, 1.6), rand_h(1.0, 6.0);
+    std::vector<PointXYZ> cloud;
+    for (int i = 0; i < 520; i++)
+    {
+        double x = rand_x(eng), y = rand_y(eng);
+        const double w = rand_w(eng);
+        if (sqrt(pow(x + 20.0, 2) + pow(y + 20.0, 2)) < 2.0)
+            continue;
+        x = floor(x / resolution) * resolution + resolution / 2.0;
+        y = floor(y / resolution) * resolution + resolution / 2.0;
+        const int widNum = ceil(w / resolution);
+        for (int r = -widNum / 2.0; r < widNum / 2.0; r++)
+            for (int s = -widNum / 2.0; s < widNum / 2.0; s++)
+            {
+                const int heiNum = ceil(rand_h(eng) / resolution);
+                for (int t = 0; t < heiNum; t++)
+                    cloud.push_back(PointXYZ{(float)(x + (r + 0.5) * resolution), (float)(y + (s + 0.5) * resolution), (float)((t + 0.5) * resolution), 0.0f});
+            }
+    }
+    return cloud;
+}
+
+// b_traj_node's pointInflate, leading 20 default points included
+std::vector<PointXYZ> pointInflate(const PointXYZ& pt)
+{
+    std::vector<PointXYZ> infPts(20);
+    for (int x = -margin_cells; x <= margin_cells; x++)
+        for (int y = -margin_cells; y <= margin_cells; y++)
+            for (int z = -margin_z_cells; z <= margin_z_cells; z++)
+                infPts.push_back(PointXYZ{(float)(pt.x + x * resolution), (float)(pt.y + y * resolution), (float)(pt.z + z * resolution), 0.0f});
+    return infPts;
+}
+
+bool isInLocalMap(const PointXYZ& pt, const Eigen::Vector3d& start)
+{
+    return fabs(pt.x - start(0)) <= x_local_size / 2.0 && fabs(pt.y - start(1)) <= y_local_size / 2.0 && fabs(pt.z - start(2)) <= z_local_size / 2.0;
+}
+
+sdf_tools::CollisionMapGrid* newLocalMap(const Eigen::Vector3d& start)
+{
+    const Eigen::Vector3d local_origin((int)((start(0) - x_local_size / 2.0) / resolution + 0.5) * resolution,
+                                       (int)((start(1) - y_local_size / 2.0) / resolution + 0.5) * resolution,
+                                       (int)((start(2) - z_local_size / 2.0) / resolution + 0.5) * resolution);
+    const Eigen::Affine3d transform = Eigen::Translation3d(local_origin) * Eigen::Quaterniond::Identity();
+    return new sdf_tools::CollisionMapGrid(transform, "world", resolution, x_local_size + buffer_size, y_local_size + buffer_size, z_local_size + buffer_size, free_cell);
+}
+
+// Serialized size of a CollisionMapDelta with frame_id "world"
+size_t deltaBytes(const sdf_tools::CollisionMapDelta& delta)
+{
+    return (4 + 8 + 4 + 5) + 8 + 1 + 24 + 8 + 16 + (4 + 4 * delta.chunk_ids.size()) + (4 + 4 * delta.run_starts.size()) + (4 + 2 * delta.runs.size());
+}
+
+// Serialized size of a PointCloud2 of pcl::PointXYZ with frame_id "world"
+size_t cloudBytes(const size_t num_points)
+{
+    return (4 + 8 + 4 + 5) + 4 + 4 + (4 + 3 * (4 + 1 + 4 + 1 + 4)) + 1 + 4 + 4 + (4 + 16 * num_points) + 1;
+}
+
+int64_t countDifferences(const sdf_tools::CollisionMapGrid& grid, const sdf_tools::CollisionMapGrid& reference)
+{
+    int64_t differences = 0;
+    for (int64_t x = 0; x < grid.GetNumXCells(); x++)
+        for (int64_t y = 0; y < grid.GetNumYCells(); y++)
+            for (int64_t z = 0; z < grid.GetNumZCells(); z++)
+                differences += (grid.Get(x, y, z).first.occupancy != reference.Get(x, y, z).first.occupancy);
+    return differences;
+}
+
+int main(int argc, char** argv)
+{
+    const int ticks = (argc > 1) ? std::stoi(argv[1]) : 400;
+    const int chunk_size = (argc > 2) ? std::stoi(argv[2]) : 16;
+    const int keyframe_period = (argc > 3) ? std::stoi(argv[3]) : 50;
+
+    const std::vector<PointXYZ> forest = generateForest();
+    const Eigen::Vector3d map_origin(-x_size / 2.0, -y_size / 2.0, 0.0);
+    const Eigen::Affine3d origin_transform = Eigen::Translation3d(map_origin) * Eigen::Quaterniond::Identity();
+    sdf_tools::CollisionMapGrid cloud_map(origin_transform, "world", resolution, x_size, y_size, z_size, free_cell);
+    sdf_tools::CollisionMapGrid delta_map(origin_transform, "world", resolution, x_size, y_size, z_size, free_cell);
+    sdf_tools::CollisionMapGrid* cloud_local_map = newLocalMap(Eigen::Vector3d::Zero());
+    sdf_tools::CollisionMapGrid* delta_local_map = newLocalMap(Eigen::Vector3d::Zero());
+
+    sdf_tools::CollisionMapDeltaEncoder encoder;
+    sdf_tools::CollisionMapDeltaDecoder decoder;
+    if (!encoder.Initialize(map_origin, resolution, x_size, y_size, z_size, chunk_size))
+        return 1;
+    std::vector<int64_t> changed_chunks;
+
+    double cloud_bytes = 0.0, delta_bytes = 0.0, cloud_time = 0.0, delta_time = 0.0, encode_time = 0.0, apply_time = 0.0, max_cloud_time = 0.0, max_delta_time = 0.0;
+    int64_t local_differences = 0, checks = 0;
+    bool ok = true;
+    std::vector<uint8_t> cloud_message;
+    for (int tick = 0; tick < ticks; tick++)
+    {
+        // Across the diagonal and back at 0.2 m per tick
+        const int leg = tick % 566;
+        const double s = (leg < 283) ? leg / 283.0 : (566 - leg) / 283.0;
+        const Eigen::Vector3d start(-20.0 + 40.0 * s, -20.0 + 40.0 * s, 0.5);
+
+        std::vector<PointXYZ> sensed;
+        for (size_t idx = 0; idx < forest.size(); idx++)
+        {
+            const PointXYZ& pt = forest[idx];
+            if ((Eigen::Vector3d(pt.x, pt.y, pt.z) - start).squaredNorm() <= sensing_range * sensing_range)
+                sensed.push_back(pt);
+        }
+
+        // Full cloud: the packed points go over the wire, the planner unpacks and inflates them
+        cloud_message.resize(sensed.size() * sizeof(PointXYZ));
+        memcpy(cloud_message.data(), sensed.data(), cloud_message.size());
+        cloud_bytes += cloudBytes(sensed.size());
+        auto begin = std::chrono::steady_clock::now();
+        {
+            std::vector<PointXYZ> cloud(cloud_message.size() / sizeof(PointXYZ));
+            memcpy(cloud.data(), cloud_message.data(), cloud_message.size());
+            cloud_map.RestMap();
+            delete cloud_local_map;
+            cloud_local_map = newLocalMap(start);
+            std::vector<PointXYZ> cloud_inflation, cloud_local;
+            for (size_t idx = 0; idx < cloud.size(); idx++)
+            {
+                if (!isInLocalMap(cloud[idx], start))
+                    continue;
+                cloud_local.push_back(cloud[idx]);
+                const std::vector<PointXYZ> inflatePts = pointInflate(cloud[idx]);
+                for (size_t i = 0; i < inflatePts.size(); i++)
+                {
+                    const Eigen::Vector3d addPt(inflatePts[i].x, inflatePts[i].y, inflatePts[i].z);
+                    cloud_local_map->Set3d(addPt, obst_cell);
+                    cloud_map.Set3d(addPt, obst_cell);
+                    cloud_inflation.push_back(inflatePts[i]);
+                }
+            }
+        }
+        const double cloud_tick = elapsed(begin);
+
+        // Delta stream
+        begin = std::chrono::steady_clock::now();
+        encoder.BeginFrame();
+        for (size_t idx = 0; idx < sensed.size(); idx++)
+            encoder.MarkOccupied(Eigen::Vector3d(sensed[idx].x, sensed[idx].y, sensed[idx].z));
+        const sdf_tools::CollisionMapDelta delta = encoder.EndFrame(tick % keyframe_period == 0);
+        encode_time += elapsed(begin);
+        delta_bytes += deltaBytes(delta);
+        begin = std::chrono::steady_clock::now();
+        {
+            if (!decoder.Apply(delta, changed_chunks) || !decoder.DilateChunksInto(changed_chunks, margin_cells, margin_z_cells, delta_map, obst_cell, free_cell))
+            {
+                std::cerr << "Delta " << delta.sequence << " rejected" << std::endl;
+                return 1;
+            }
+            apply_time += elapsed(begin);
+            delete delta_local_map;
+            delta_local_map = newLocalMap(start);
+            const sdf_tools::ChunkedOccupancy& occupancy = decoder.GetOccupancy();
+            const Eigen::Vector3d& occ_origin = occupancy.GetOrigin();
+            const double half_size[3] = {x_local_size / 2.0, y_local_size / 2.0, z_local_size / 2.0};
+            int64_t lo[3], hi[3];
+            for (int i = 0; i < 3; i++)
+            {
+                lo[i] = std::max((int64_t)0, (int64_t)floor((start(i) - half_size[i] - occ_origin(i)) / resolution));
+                hi[i] = std::min(occupancy.GetNumCells(i), (int64_t)ceil((start(i) + half_size[i] - occ_origin(i)) / resolution) + 1);
+            }
+            std::vector<PointXYZ> cloud_inflation, cloud_local;
+            for (int64_t i = lo[0]; i < hi[0]; i++)
+                for (int64_t j = lo[1]; j < hi[1]; j++)
+                    for (int64_t k = lo[2]; k < hi[2]; k++)
+                    {
+                        if (!occupancy.IsOccupied(i, j, k))
+                            continue;
+                        const PointXYZ pt{(float)((i + 0.5) * resolution + occ_origin(0)), (float)((j + 0.5) * resolution + occ_origin(1)), (float)((k + 0.5) * resolution + occ_origin(2)), 0.0f};
+                        if (!isInLocalMap(pt, start))
+                            continue;
+                        cloud_local.push_back(pt);
+                        const std::vector<PointXYZ> inflatePts = pointInflate(pt);
+                        for (size_t n = 0; n < inflatePts.size(); n++)
+                        {
+                            delta_local_map->Set3d(Eigen::Vector3d(inflatePts[n].x, inflatePts[n].y, inflatePts[n].z), obst_cell);
+                            cloud_inflation.push_back(inflatePts[n]);
+                        }
+                    }
+        }
+        const double delta_tick = elapsed(begin);
+        cloud_time += cloud_tick;
+        delta_time += delta_tick;
+        max_cloud_time = std::max(max_cloud_time, cloud_tick);
+        max_delta_time = std::max(max_delta_time, delta_tick);
+
+        // The local maps differ only where a point sits on a cell boundary
+        local_differences += countDifferences(*delta_local_map, *cloud_local_map);
+        if (tick % 25 == 24 || tick == ticks - 1)
+        {
+            sdf_tools::CollisionMapGrid reference(origin_transform, "world", resolution, x_size, y_size, z_size, free_cell);
+            const sdf_tools::ChunkedOccupancy& occupancy = decoder.GetOccupancy();
+            int64_t sensed_cells = 0;
+            for (int64_t x = 0; x < occupancy.GetNumCells(0); x++)
+                for (int64_t y = 0; y < occupancy.GetNumCells(1); y++)
+                    for (int64_t z = 0; z < occupancy.GetNumCells(2); z++)
+                    {
+                        if (!occupancy.IsOccupied(x, y, z))
+                            continue;
+                        sensed_cells++;
+                        for (int dx = -margin_cells; dx <= margin_cells; dx++)
+                            for (int dy = -margin_cells; dy <= margin_cells; dy++)
+                                for (int dz = -margin_z_cells; dz <= margin_z_cells; dz++)
+                                    if (reference.Inside(Eigen::Vector3i(x + dx, y + dy, z + dz)))
+                                        reference.Set(x + dx, y + dy, z + dz, obst_cell);
+                    }
+            sdf_tools::ChunkedOccupancy expected;
+            expected.Initialize(map_origin, resolution, occupancy.GetNumCells(0), occupancy.GetNumCells(1), occupancy.GetNumCells(2), chunk_size);
+            for (size_t idx = 0; idx < sensed.size(); idx++)
+            {
+                int64_t x, y, z;
+                if (expected.LocationToCell(Eigen::Vector3d(sensed[idx].x, sensed[idx].y, sensed[idx].z), x, y, z))
+                    expected.SetOccupied(x, y, z);
+            }
+            int64_t occupancy_differences = 0;
+            for (int64_t x = 0; x < occupancy.GetNumCells(0); x++)
+                for (int64_t y = 0; y < occupancy.GetNumCells(1); y++)
+                    for (int64_t z = 0; z < occupancy.GetNumCells(2); z++)
+                        occupancy_differences += (occupancy.IsOccupied(x, y, z) != expected.IsOccupied(x, y, z));
+            const int64_t map_differences = countDifferences(delta_map, reference);
+            ok = ok && (occupancy_differences == 0) && (map_differences == 0);
+            checks++;
+            if (occupancy_differences != 0 || map_differences != 0)
+                std::cout << "tick " << tick << ": " << occupancy_differences << " occupancy and " << map_differences << " map cells differ (" << sensed_cells << " sensed)" << std::endl;
+        }
+    }
+
+    std::cout << std::fixed << std::setprecision(1)
+              << ticks << " ticks at 10 Hz, " << forest.size() << " points in the forest, chunks of " << chunk_size << "^3 cells, keyframe every " << keyframe_period << " ticks\n"
+              << "\tfull cloud:   " << cloud_bytes / ticks / 1024.0 << " KB/tick (" << cloud_bytes * 10.0 / ticks / 1024.0 << " KB/s), ingest " << std::setprecision(2) << cloud_time / ticks * 1e3 << " ms/tick (max " << max_cloud_time * 1e3 << " ms)\n" << std::setprecision(1)
+              << "\tdelta stream: " << delta_bytes / ticks / 1024.0 << " KB/tick (" << delta_bytes * 10.0 / ticks / 1024.0 << " KB/s), ingest " << std::setprecision(2) << delta_time / ticks * 1e3 << " ms/tick (max " << max_delta_time * 1e3 << " ms), of which " << apply_time / ticks * 1e3 << " ms/tick applying and inflating the delta into the global map; encode " << encode_time / ticks * 1e3 << " ms/tick\n"
+              << "\tlocal map cells differing from the full-cloud path (points on cell boundaries, rounded by cell there): " << (double)local_differences / ticks << " per tick\n"
+              << "\tdelta map equal to the inflated sensed cells in " << checks << " checks: " << (ok ? "yes" : "NO") << std::endl;
+    delete cloud_local_map;
+    delete delta_local_map;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,131 @@
+/* Load time of a prior CollisionMapGrid: the ROS message file (LoadFromFile: deserialize, unzip,
+   unpack cell by cell), the binary map file (LoadFromBinaryFile: map and copy) and the binary
+   map file used in place through MappedBinaryMap. The default size is 465^3, about 100M voxels,
+   which needs roughly 3 GB of memory for the message path.
+
+   The files are read back right after being written, so this measures the warm page cache; drop
+   the caches between the save and the loads (echo 3 > /proc/sys/vm/drop_caches) for cold numbers.
+
+   Usage: ./map_load_benchmark [cells per side] [file prefix] */
+
+#include <stdio.h>
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <random>
+#include <chrono>
+#include <sdf_tools/collision_map.hpp>
+#include <sdf_tools/binary_map_file.hpp>
+
+template <class F> double timeIt(F f)
+{
+    auto start = std::chrono::steady_clock::now();
+    f();
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double>(end - start).count();
+}
+
+bool sameCells(const sdf_tools::CollisionMapGrid& grid, const sdf_tools::MappedBinaryMap& mapped)
+{
+    if (grid.GetNumXCells() != mapped.GetNumXCells() || grid.GetNumYCells() != mapped.GetNumYCells() || grid.GetNumZCells() != mapped.GetNumZCells())
+    {
+        return false;
+    }
+    for (int64_t x = 0; x < grid.GetNumXCells(); x++)
+        for (int64_t y = 0; y < grid.GetNumYCells(); y++)
+            for (int64_t z = 0; z < grid.GetNumZCells(); z++)
+            {
+                const sdf_tools::COLLISION_CELL loaded = grid.Get(x, y, z).first;
+                const sdf_tools::COLLISION_CELL& stored = mapped.GetImmutable<sdf_tools::COLLISION_CELL>(x, y, z).first;
+                if (loaded.occupancy != stored.occupancy || loaded.component != stored.component)
+                    return false;
+            }
+    return true;
+}
+
+long fileBytes(const std::string& filepath)
+{
+    FILE* file = fopen(filepath.c_str(), "rb");
+    if (file == NULL)
+    {
+        return -1;
+    }
+    fseek(file, 0, SEEK_END);
+    const long bytes = ftell(file);
+    fclose(file);
+    return bytes;
+}
+
+int main(int argc, char** argv)
+{
+    const int64_t n = (argc > 1) ? std::stol(argv[1]) : 465;
+    const std::string prefix = (argc > 2) ? argv[2] : "/tmp/map_load_benchmark";
+    const std::string message_file = prefix + ".msg";
+    const std::string binary_file = prefix + ".map";
+    // Exact in binary, so that the cell counts survive the size round trip of the message
+    const double resolution = 0.125;
+
+    // Random boxes of obstacles, as in a building-scale prior map
+    {
+        Eigen::Affine3d origin_transform = Eigen::Translation3d(-0.5 * n * resolution, -0.5 * n * resolution, 0.0) * Eigen::Quaterniond::Identity();
+        sdf_tools::CollisionMapGrid grid(origin_transform, "world", resolution, n * resolution, n * resolution, n * resolution, sdf_tools::COLLISION_CELL(0.0), sdf_tools::COLLISION_CELL(1.0));
+        std::mt19937 gen(0);
+        std::uniform_int_distribution<int64_t> corner(0, n - 1), extent(1, std::max<int64_t>(n / 20, 1));
+        for (int64_t box = 0; box < n; box++)
+        {
+            const int64_t x0 = corner(gen), y0 = corner(gen), z0 = corner(gen);
+            const int64_t x1 = std::min(n, x0 + extent(gen)), y1 = std::min(n, y0 + extent(gen)), z1 = std::min(n, z0 + extent(gen));
+            for (int64_t x = x0; x < x1; x++)
+                for (int64_t y = y0; y < y1; y++)
+                    for (int64_t z = z0; z < z1; z++)
+                        grid.Set(x, y, z, sdf_tools::COLLISION_CELL(1.0));
+        }
+
+        const double t_save_message = timeIt([&]() { grid.SaveToFile(message_file); });
+        const double t_save_binary = timeIt([&]() { grid.SaveToBinaryFile(binary_file); });
+        std::cout << std::fixed << std::setprecision(3)
+                  << "CollisionMapGrid " << n << "^3 = " << n * n * n << " voxels\n"
+                  << "\tsave message file: " << t_save_message << " s, " << fileBytes(message_file) / 1048576.0 << " MB\n"
+                  << "\tsave binary file:  " << t_save_binary << " s, " << fileBytes(binary_file) / 1048576.0 << " MB\n";
+    }
+
+    sdf_tools::MappedBinaryMap reference;
+    if (!reference.Open(binary_file, sdf_tools::BINARY_MAP_COLLISION_MAP, sizeof(sdf_tools::COLLISION_CELL)))
+    {
+        return 1;
+    }
+
+    bool message_ok = false;
+    {
+        sdf_tools::CollisionMapGrid grid;
+        const double t_load = timeIt([&]() { message_ok = grid.LoadFromFile(message_file); });
+        message_ok = message_ok && sameCells(grid, reference);
+        std::cout << "\tLoadFromFile:       " << t_load << " s" << (message_ok ? "" : " (MISMATCH)") << '\n';
+    }
+
+    bool binary_ok = false;
+    {
+        sdf_tools::CollisionMapGrid grid;
+        const double t_load = timeIt([&]() { binary_ok = grid.LoadFromBinaryFile(binary_file); });
+        binary_ok = binary_ok && sameCells(grid, reference);
+        std::cout << "\tLoadFromBinaryFile: " << t_load << " s" << (binary_ok ? "" : " (MISMATCH)") << '\n';
+    }
+
+    // In place: open, then 1M random lookups that fault in only the pages they touch
+    {
+        sdf_tools::MappedBinaryMap mapped;
+        const double t_open = timeIt([&]() { mapped.Open(binary_file, sdf_tools::BINARY_MAP_COLLISION_MAP, sizeof(sdf_tools::COLLISION_CELL)); });
+        std::mt19937 gen(1);
+        std::uniform_int_distribution<int64_t> index(0, n - 1);
+        int64_t occupied = 0;
+        const double t_lookup = timeIt([&]() {
+            for (int lookup = 0; lookup < 1000000; lookup++)
+                occupied += (mapped.GetImmutable<sdf_tools::COLLISION_CELL>(index(gen), index(gen), index(gen)).first.occupancy > 0.5);
+        });
+        std::cout << "\tMappedBinaryMap:    " << t_open * 1e6 << " us to open, " << t_lookup << " s for 1M random lookups (" << occupied << " occupied)\n";
+    }
+
+    remove(message_file.c_str());
+    remove(binary_file.c_str());
+    return (message_ok && binary_ok) ? 0 : 1;
+}
@@ -0,0 +1,154 @@
+/* Distance and gradient queries of a SignedDistanceField, as a trajectory checker would make them
+   along sampled trajectory points: the nearest cell Get3d and GetGradient3d, which allocate
+   std::vectors, the interpolated single point query and the batched one. EstimateDistance3d is left
+   out, it asserts on some locations inside obstacles. The field is that of b_traj_node's
+   local map filled with the inflated trees of random_forest_sensing, rotated about z so that the
+   grid frame differs from the query frame.
+
+   Checked:
+     - the batched query gives the single point results
+     - the interpolated distance is the cell value at every cell center
+     - the gradient matches central differences of the interpolated distance, away from the planes
+       through the cell centers where the interpolation has kinks
+     - locations outside the grid return the OOB value and a zero gradient
+
+   Usage: ./sdf_query_benchmark [points] [density] [reps] */
+
+#include <stdio.h>
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <sdf_tools/collision_map.hpp>
+#include <sdf_tools/sdf.hpp>
+
+const double resolution = 0.2;
+const double x_size = 18.0, y_size = 18.0, z_size = 10.0;
+const sdf_tools::COLLISION_CELL free_cell(0.0), obst_cell(1.0);
+
+double elapsed(const std::chrono::steady_clock::time_point& start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char** argv)
+{
+    const int num_points = (argc > 1) ? std::stoi(argv[1]) : 10000;
+    const double density = (argc > 2) ? std::stod(argv[2]) : 2.0;
+    const int reps = (argc > 3) ? std::stoi(argv[3]) : 20;
+
+    const Eigen::Affine3d origin_transform = Eigen::Translation3d(-9.0, -9.0, 0.0) * Eigen::AngleAxisd(0.3, Eigen::Vector3d::UnitZ());
+    sdf_tools::CollisionMapGrid map(origin_transform, "world", resolution, x_size, y_size, z_size, free_cell);
+    std::mt19937 gen(0);
+    std::uniform_real_distribution<double> rand_x(0.0, x_size), rand_y(0.0, y_size), rand_w(0.3, 0.8);
+    const int tree_num = (int)(density * x_size * y_size / 100.0);
+    for (int i = 0; i < tree_num; i++)
+    {
+        const double x = rand_x(gen), y = rand_y(gen), w = rand_w(gen);
+        const int widNum = std::ceil(w / resolution);
+        for (int r = -widNum / 2 - 1; r < widNum / 2 + 1; r++)
+            for (int s = -widNum / 2 - 1; s < widNum / 2 + 1; s++)
+            {
+                const int64_t x_index = (int64_t)(x / resolution) + r, y_index = (int64_t)(y / resolution) + s;
+                if (x_index < 0 || y_index < 0 || x_index >= map.GetNumXCells() || y_index >= map.GetNumYCells())
+                    continue;
+                for (int64_t z = 0; z < map.GetNumZCells(); z++)
+                    map.Set(x_index, y_index, z, obst_cell);
+            }
+    }
+    const sdf_tools::SignedDistanceField sdf = map.ExtractSignedDistanceField(INFINITY).first;
+
+    // Points inside the grid, in the world frame
+    Eigen::Matrix3Xd locations(3, num_points);
+    std::uniform_real_distribution<double> rand_z(0.0, z_size);
+    for (int i = 0; i < num_points; i++)
+        locations.col(i) = origin_transform * Eigen::Vector3d(rand_x(gen), rand_y(gen), rand_z(gen));
+
+    double vector_time = 0.0, single_time = 0.0, batch_time = 0.0, checksum = 0.0;
+    Eigen::VectorXd distances;
+    Eigen::Matrix3Xd gradients;
+    for (int r = 0; r < reps; r++)
+    {
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < num_points; i++)
+        {
+            checksum += sdf.Get3d(locations.col(i));
+            const std::vector<double> gradient = sdf.GetGradient3d(locations.col(i), true);
+            checksum += gradient[0];
+        }
+        vector_time += elapsed(start);
+        start = std::chrono::steady_clock::now();
+        for (int i = 0; i < num_points; i++)
+        {
+            double distance = 0.0;
+            Eigen::Vector3d gradient;
+            sdf.GetInterpolatedDistanceAndGradient3d(locations.col(i), distance, gradient);
+            checksum += distance + gradient.x();
+        }
+        single_time += elapsed(start);
+        start = std::chrono::steady_clock::now();
+        sdf.GetInterpolatedDistancesAndGradients(locations, distances, gradients);
+        checksum += distances.sum() + gradients.row(0).sum();
+        batch_time += elapsed(start);
+    }
+
+    // Batched against single point queries
+    int64_t batch_mismatches = 0;
+    for (int i = 0; i < num_points; i++)
+    {
+        double distance = 0.0;
+        Eigen::Vector3d gradient;
+        sdf.GetInterpolatedDistanceAndGradient3d(locations.col(i), distance, gradient);
+        if (std::abs(distance - distances(i)) > 1e-9 || (gradient - gradients.col(i)).norm() > 1e-9)
+            batch_mismatches++;
+    }
+    // Cell centers
+    int64_t center_mismatches = 0;
+    for (int64_t x = 0; x < sdf.GetNumXCells(); x++)
+        for (int64_t y = 0; y < sdf.GetNumYCells(); y++)
+            for (int64_t z = 0; z < sdf.GetNumZCells(); z++)
+            {
+                const std::vector<double> center = sdf.GridIndexToLocation(x, y, z);
+                const std::pair<double, bool> interpolated = sdf.GetInterpolatedDistance3d(Eigen::Vector3d(center[0], center[1], center[2]));
+                if (!interpolated.second || std::abs(interpolated.first - sdf.Get(x, y, z)) > 1e-5)
+                    center_mismatches++;
+            }
+    // Gradients against central differences
+    const double step = resolution * 1e-4;
+    int64_t checked_gradients = 0, gradient_mismatches = 0;
+    for (int i = 0; i < num_points; i++)
+    {
+        const Eigen::Vector3d in_grid = origin_transform.inverse() * locations.col(i);
+        const Eigen::Vector3d offset = in_grid / resolution - Eigen::Vector3d::Constant(0.5);
+        const Eigen::Vector3d to_plane = offset - offset.array().round().matrix();
+        if (to_plane.cwiseAbs().minCoeff() < 0.01 || offset.minCoeff() < 0.0 || (offset.array() > Eigen::Array3d(sdf.GetNumXCells() - 1, sdf.GetNumYCells() - 1, sdf.GetNumZCells() - 1)).any())
+            continue;
+        checked_gradients++;
+        Eigen::Vector3d numeric;
+        for (int axis = 0; axis < 3; axis++)
+        {
+            const Eigen::Vector3d delta = Eigen::Vector3d::Unit(axis) * step;
+            numeric(axis) = (sdf.GetInterpolatedDistance3d(locations.col(i) + delta).first - sdf.GetInterpolatedDistance3d(locations.col(i) - delta).first) / (2.0 * step);
+        }
+        if ((numeric - gradients.col(i)).norm() > 1e-4 * std::max(1.0, numeric.norm()))
+            gradient_mismatches++;
+    }
+    // Outside the grid
+    Eigen::Matrix3Xd outside(3, 2);
+    outside.col(0) = origin_transform * Eigen::Vector3d(-0.01, 1.0, 1.0);
+    outside.col(1) = origin_transform * Eigen::Vector3d(1.0, 1.0, z_size + 0.01);
+    const size_t num_inside = sdf.GetInterpolatedDistancesAndGradients(outside, distances, gradients);
+    const bool outside_ok = (num_inside == 0 && distances(0) == sdf.GetOOBValue() && distances(1) == sdf.GetOOBValue() && gradients.isZero() && !sdf.GetInterpolatedDistance3d(outside.col(0)).second);
+
+    const double queries = (double)num_points * reps;
+    std::cout << std::fixed << std::setprecision(1)
+              << num_points << " points, " << tree_num << " trees, checksum " << checksum << "\n"
+              << "\tstd::vector queries:   " << vector_time * 1e9 / queries << " ns per point\n"
+              << "\tinterpolated single:   " << single_time * 1e9 / queries << " ns per point\n"
+              << "\tinterpolated batch:    " << batch_time * 1e9 / queries << " ns per point\n"
+              << "\tbatch mismatches: " << batch_mismatches << ", cell center mismatches: " << center_mismatches
+              << ", gradient mismatches: " << gradient_mismatches << " of " << checked_gradients << ", outside " << (outside_ok ? "OK" : "WRONG") << std::endl;
+    return (batch_mismatches == 0 && center_mismatches == 0 && gradient_mismatches == 0 && outside_ok) ? 0 : 1;
+}
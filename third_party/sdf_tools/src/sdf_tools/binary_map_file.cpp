@@ -0,0 +1,147 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <vector>
+#include <string>
+#include <iostream>
+#include <limits>
+#include <sdf_tools/binary_map_file.hpp>
+
+using namespace sdf_tools;
+
+bool sdf_tools::WriteBinaryMapFile(const std::string& filepath, const BinaryMapHeader& header, const void* data)
+{
+    FILE* output_file = fopen(filepath.c_str(), "wb");
+    if (output_file == NULL)
+    {
+        std::cerr << "Unable to open " << filepath << " for writing" << std::endl;
+        return false;
+    }
+    const std::vector<uint8_t> padding(header.data_offset - sizeof(header), 0x00);
+    bool success = (fwrite(&header, sizeof(header), 1, output_file) == 1);
+    success = success && (padding.empty() || fwrite(padding.data(), padding.size(), 1, output_file) == 1);
+    success = success && (header.data_bytes == 0 || fwrite(data, header.data_bytes, 1, output_file) == 1);
+    success = (fclose(output_file) == 0) && success;
+    if (!success)
+    {
+        std::cerr << "Failed to write " << filepath << std::endl;
+    }
+    return success;
+}
+
+bool MappedBinaryMap::CheckHeader(const uint64_t file_bytes, const uint32_t expected_contents, const uint32_t expected_cell_bytes) const
+{
+    if (memcmp(header_->magic, BINARY_MAP_MAGIC, sizeof(BINARY_MAP_MAGIC)) != 0)
+    {
+        std::cerr << "Not a binary map file" << std::endl;
+        return false;
+    }
+    if (header_->byte_order != BINARY_MAP_BYTE_ORDER)
+    {
+        std::cerr << "Binary map file was written on a host of different endianness" << std::endl;
+        return false;
+    }
+    if (header_->version != BINARY_MAP_VERSION)
+    {
+        std::cerr << "Unsupported binary map file version " << header_->version << " (expected " << BINARY_MAP_VERSION << ")" << std::endl;
+        return false;
+    }
+    if (header_->contents != expected_contents || header_->cell_bytes != expected_cell_bytes)
+    {
+        std::cerr << "Binary map file holds contents " << header_->contents << " with " << header_->cell_bytes << "-byte cells, expected contents " << expected_contents << " with " << expected_cell_bytes << "-byte cells" << std::endl;
+        return false;
+    }
+    if (header_->num_x_cells <= 0 || header_->num_y_cells <= 0 || header_->num_z_cells <= 0)
+    {
+        std::cerr << "Binary map file has invalid dimensions" << std::endl;
+        return false;
+    }
+    // Cell count and byte size, guarding against overflow from a corrupt header
+    const uint64_t max_cells = std::numeric_limits<int64_t>::max() / header_->cell_bytes;
+    const uint64_t num_x = (uint64_t)header_->num_x_cells;
+    const uint64_t num_y = (uint64_t)header_->num_y_cells;
+    const uint64_t num_z = (uint64_t)header_->num_z_cells;
+    if (num_y > max_cells / num_x || num_z > max_cells / (num_x * num_y))
+    {
+        std::cerr << "Binary map file has invalid dimensions" << std::endl;
+        return false;
+    }
+    const uint64_t expected_data_bytes = num_x * num_y * num_z * header_->cell_bytes;
+    if (header_->data_bytes != expected_data_bytes || header_->data_offset < sizeof(BinaryMapHeader) || (header_->data_offset % BINARY_MAP_DATA_ALIGNMENT) != 0)
+    {
+        std::cerr << "Binary map file has an invalid data layout" << std::endl;
+        return false;
+    }
+    if (header_->data_offset > file_bytes || header_->data_bytes > file_bytes - header_->data_offset)
+    {
+        std::cerr << "Binary map file is truncated - expected " << header_->data_offset + header_->data_bytes << " bytes, got " << file_bytes << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool MappedBinaryMap::Open(const std::string& filepath, const uint32_t expected_contents, const uint32_t expected_cell_bytes)
+{
+    Close();
+    fd_ = open(filepath.c_str(), O_RDONLY);
+    if (fd_ < 0)
+    {
+        std::cerr << "Unable to open " << filepath << std::endl;
+        return false;
+    }
+    struct stat file_stat;
+    if (fstat(fd_, &file_stat) != 0 || (uint64_t)file_stat.st_size < sizeof(BinaryMapHeader))
+    {
+        std::cerr << "Binary map file " << filepath << " is too small to hold a header" << std::endl;
+        Close();
+        return false;
+    }
+    mapping_bytes_ = (size_t)file_stat.st_size;
+    // Private read-only mapping: nothing is read until the pages are touched
+    mapping_ = mmap(NULL, mapping_bytes_, PROT_READ, MAP_PRIVATE, fd_, 0);
+    if (mapping_ == MAP_FAILED)
+    {
+        std::cerr << "Unable to map " << filepath << std::endl;
+        mapping_ = NULL;
+        Close();
+        return false;
+    }
+    header_ = reinterpret_cast<const BinaryMapHeader*>(mapping_);
+    if (!CheckHeader(mapping_bytes_, expected_contents, expected_cell_bytes))
+    {
+        Close();
+        return false;
+    }
+    data_ = reinterpret_cast<const uint8_t*>(mapping_) + header_->data_offset;
+    return true;
+}
+
+void MappedBinaryMap::Close()
+{
+    if (mapping_ != NULL)
+    {
+        munmap(mapping_, mapping_bytes_);
+    }
+    if (fd_ >= 0)
+    {
+        close(fd_);
+    }
+    fd_ = -1;
+    mapping_ = NULL;
+    mapping_bytes_ = 0;
+    header_ = NULL;
+    data_ = NULL;
+}
+
+void MappedBinaryMap::WillReadAll() const
+{
+    if (mapping_ != NULL)
+    {
+        madvise(mapping_, mapping_bytes_, MADV_SEQUENTIAL);
+        madvise(mapping_, mapping_bytes_, MADV_WILLNEED);
+    }
+}
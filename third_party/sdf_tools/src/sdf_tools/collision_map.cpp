@@ -1,11 +1,13 @@
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include <vector>
 #include <string>
 #include <sstream>
 #include <iostream>
 #include <fstream>
 #include <stdexcept>
+#include <limits>
 #include <zlib.h>
 #include <ros/ros.h>
 #include <list>
@@ -65,38 +67,74 @@ bool CollisionMapGrid::LoadFromFile(const std::string& filepath)
     }
 }
 
+bool CollisionMapGrid::SaveToBinaryFile(const std::string& filepath) const
+{
+    BinaryMapHeader header = MakeBinaryMapHeader(BINARY_MAP_COLLISION_MAP, sizeof(COLLISION_CELL), collision_field_.GetNumXCells(), collision_field_.GetNumYCells(), collision_field_.GetNumZCells(), GetResolution(), collision_field_.GetOriginTransform(), frame_);
+    const COLLISION_CELL default_value = collision_field_.GetDefaultValue();
+    const COLLISION_CELL oob_value = collision_field_.GetOOBValue();
+    memcpy(header.default_value, &default_value, sizeof(COLLISION_CELL));
+    memcpy(header.oob_value, &oob_value, sizeof(COLLISION_CELL));
+    header.number_of_components = number_of_components_;
+    header.components_valid = components_valid_;
+    header.initialized = initialized_;
+    return WriteBinaryMapFile(filepath, header, collision_field_.GetRawData().data());
+}
+
+bool CollisionMapGrid::LoadFromBinaryFile(const std::string& filepath)
+{
+    MappedBinaryMap mapped;
+    if (!mapped.Open(filepath, BINARY_MAP_COLLISION_MAP, sizeof(COLLISION_CELL)))
+    {
+        return false;
+    }
+    mapped.WillReadAll();
+    const BinaryMapHeader& header = mapped.GetHeader();
+    COLLISION_CELL default_value;
+    COLLISION_CELL oob_value;
+    memcpy(&default_value, header.default_value, sizeof(COLLISION_CELL));
+    memcpy(&oob_value, header.oob_value, sizeof(COLLISION_CELL));
+    try
+    {
+        // Build the grid with the stored cell counts, then copy the cells straight out of the mapping
+        VoxelGrid::VoxelGrid<COLLISION_CELL> new_field(mapped.GetOriginTransform(), header.cell_size, header.num_x_cells, header.num_y_cells, header.num_z_cells, default_value, oob_value);
+        memcpy(new_field.GetMutableRawData().data(), mapped.GetData(), header.data_bytes);
+        collision_field_ = std::move(new_field);
+    }
+    catch (...)
+    {
+        std::cerr << "Unable to build the CollisionMapGrid stored in " << filepath << std::endl;
+        return false;
+    }
+    frame_ = mapped.GetFrame();
+    number_of_components_ = header.number_of_components;
+    components_valid_ = (header.components_valid != 0);
+    initialized_ = (header.initialized != 0);
+    return true;
+}
+
 std::vector<uint8_t> CollisionMapGrid::PackBinaryRepresentation(std::vector<COLLISION_CELL>& raw)
 {
-    std::vector<uint8_t> packed(raw.size() * 8);
-    for (size_t field_idx = 0, binary_index = 0; field_idx < raw.size(); field_idx++, binary_index+=8)
+    // The cells are stored in host byte order, as CollisionCellToBinary writes them
+    std::vector<uint8_t> packed(raw.size() * sizeof(COLLISION_CELL));
+    if (!raw.empty())
     {
-        COLLISION_CELL raw_cell = raw[field_idx];
-        std::vector<uint8_t> packed_cell = CollisionCellToBinary(raw_cell);
-        packed[binary_index] = packed_cell[0];
-        packed[binary_index + 1] = packed_cell[1];
-        packed[binary_index + 2] = packed_cell[2];
-        packed[binary_index + 3] = packed_cell[3];
-        packed[binary_index + 4] = packed_cell[4];
-        packed[binary_index + 5] = packed_cell[5];
-        packed[binary_index + 6] = packed_cell[6];
-        packed[binary_index + 7] = packed_cell[7];
+        memcpy(&packed.front(), raw.data(), packed.size());
     }
     return packed;
 }
 
 std::vector<COLLISION_CELL> CollisionMapGrid::UnpackBinaryRepresentation(std::vector<uint8_t>& packed)
 {
-    if ((packed.size() % 8) != 0)
+    if ((packed.size() % sizeof(COLLISION_CELL)) != 0)
     {
-        std::cerr << "Invalid binary representation - length is not a multiple of 8" << std::endl;
+        std::cerr << "Invalid binary representation - length is not a multiple of " << sizeof(COLLISION_CELL) << std::endl;
         return std::vector<COLLISION_CELL>();
     }
-    uint64_t data_size = packed.size() / 8;
+    uint64_t data_size = packed.size() / sizeof(COLLISION_CELL);
     std::vector<COLLISION_CELL> unpacked(data_size);
-    for (size_t field_idx = 0, binary_index = 0; field_idx < unpacked.size(); field_idx++, binary_index+=8)
+    if (!unpacked.empty())
     {
-        std::vector<uint8_t> binary_block{packed[binary_index], packed[binary_index + 1], packed[binary_index + 2], packed[binary_index + 3], packed[binary_index + 4], packed[binary_index + 5], packed[binary_index + 6], packed[binary_index + 7]};
-        unpacked[field_idx] = CollisionCellFromBinary(binary_block);
+        memcpy(unpacked.data(), &packed.front(), packed.size());
     }
     return unpacked;
 }
@@ -293,156 +331,60 @@ uint32_t CollisionMapGrid::UpdateConnectedComponents()
         return number_of_components_;
     }
     components_valid_ = false;
-    // Reset components first
-    for (int64_t x_index = 0; x_index < collision_field_.GetNumXCells(); x_index++)
+    // Two-pass labeling over the raw voxel array (x-major, z fastest)
+    // Voxels are connected if they share a face and have the same occupancy
+    std::vector<COLLISION_CELL>& cells = collision_field_.GetMutableRawData();
+    const int64_t num_x_cells = collision_field_.GetNumXCells();
+    const int64_t num_y_cells = collision_field_.GetNumYCells();
+    const int64_t num_z_cells = collision_field_.GetNumZCells();
+    const int64_t x_stride = num_y_cells * num_z_cells;
+    const int64_t y_stride = num_z_cells;
+    assert((int64_t)cells.size() <= (int64_t)std::numeric_limits<uint32_t>::max());
+    std::vector<uint32_t> parents(cells.size());
+    // First pass - merge every voxel with its -x, -y and -z neighbors, which have already been visited
+    uint32_t data_index = 0;
+    for (int64_t x_index = 0; x_index < num_x_cells; x_index++)
     {
-        for (int64_t y_index = 0; y_index < collision_field_.GetNumYCells(); y_index++)
+        for (int64_t y_index = 0; y_index < num_y_cells; y_index++)
         {
-            for (int64_t z_index = 0; z_index < collision_field_.GetNumZCells(); z_index++)
+            for (int64_t z_index = 0; z_index < num_z_cells; z_index++, data_index++)
             {
-                COLLISION_CELL current = collision_field_.GetImmutable(x_index, y_index, z_index).first;
-                current.component = 0;
-                collision_field_.SetValue(x_index, y_index, z_index, current);
-            }
-        }
-    }
-    // Mark the components
-    int64_t total_cells = collision_field_.GetNumXCells() * collision_field_.GetNumYCells() * collision_field_.GetNumZCells();
-    int64_t marked_cells = 0;
-    uint32_t connected_components = 0;
-    // Sweep through the grid
-    for (int64_t x_index = 0; x_index < collision_field_.GetNumXCells(); x_index++)
-    {
-        for (int64_t y_index = 0; y_index < collision_field_.GetNumYCells(); y_index++)
-        {
-            for (int64_t z_index = 0; z_index < collision_field_.GetNumZCells(); z_index++)
-            {
-                // Check if the cell has already been marked, if so, ignore
-                if (collision_field_.GetImmutable(x_index, y_index, z_index).first.component > 0)
+                parents[data_index] = data_index;
+                const float occupancy = cells[data_index].occupancy;
+                if (z_index > 0 && cells[data_index - 1].occupancy == occupancy)
                 {
-                    continue;
+                    UnionComponents(parents, data_index, data_index - 1);
                 }
-                // Start marking a new connected component
-                connected_components++;
-                int64_t cells_marked = MarkConnectedComponent(x_index, y_index, z_index, connected_components);
-                marked_cells += cells_marked;
-                // Short-circuit if we've marked everything
-                if (marked_cells == total_cells)
+                if (y_index > 0 && cells[data_index - y_stride].occupancy == occupancy)
                 {
-                    number_of_components_ = connected_components;
-                    components_valid_ = true;
-                    return connected_components;
+                    UnionComponents(parents, data_index, data_index - y_stride);
+                }
+                if (x_index > 0 && cells[data_index - x_stride].occupancy == occupancy)
+                {
+                    UnionComponents(parents, data_index, data_index - x_stride);
                 }
             }
         }
     }
-    number_of_components_ = connected_components;
-    components_valid_ = true;
-    return connected_components;
-}
-
-int64_t CollisionMapGrid::MarkConnectedComponent(int64_t x_index, int64_t y_index, int64_t z_index, uint32_t connected_component)
-{
-    // Make the working queue
-    std::list<VoxelGrid::GRID_INDEX> working_queue;
-    // Make a hash table to store queued indices (so we don't repeat work)
-    // Let's provide an hint at the size of hashmap we'll need, since this will reduce the need to resize & rehash
-    // We're going to assume that connected components, in general, will take ~1/16 of the grid in size
-    // which means, with 2 cells/hash bucket, we'll initialize to grid size/32
-#ifdef ENABLE_UNORDERED_MAP_SIZE_HINTS
-    size_t queued_hashtable_size_hint = collision_field_.GetRawData().size() / 32;
-    std::unordered_map<VoxelGrid::GRID_INDEX, int8_t> queued_hashtable(queued_hashtable_size_hint);
-#else
-    std::unordered_map<VoxelGrid::GRID_INDEX, int8_t> queued_hashtable;
-#endif
-    // Add the starting index
-    VoxelGrid::GRID_INDEX start_index(x_index, y_index, z_index);
-    // Enqueue it
-    working_queue.push_back(start_index);
-    queued_hashtable[start_index] = 1;
-    // Work
-    int64_t marked_cells = 0;
-    while (working_queue.size() > 0)
+    // Second pass - number the components in the order their first voxel appears in the sweep,
+    // which is the numbering a flood fill started from each unmarked voxel in turn gives
+    uint32_t connected_components = 0;
+    for (data_index = 0; data_index < (uint32_t)cells.size(); data_index++)
     {
-        // Get an item off the queue to work with
-        VoxelGrid::GRID_INDEX current_index = working_queue.front();
-        working_queue.pop_front();
-        // Get the current value
-        COLLISION_CELL current_value = collision_field_.GetImmutable(current_index.x, current_index.y, current_index.z).first;
-        // Mark the connected component
-        current_value.component = connected_component;
-        // Update the grid
-        collision_field_.SetValue(current_index.x, current_index.y, current_index.z, current_value);
-        // Go through the possible neighbors and enqueue as needed
-        // Since there are only six cases (voxels must share a face to be considered connected), we handle each explicitly
-        // Case 1
-        std::pair<COLLISION_CELL, bool> xm1_neighbor = collision_field_.GetImmutable(current_index.x - 1, current_index.y, current_index.z);
-        if (xm1_neighbor.second && (current_value.occupancy == xm1_neighbor.first.occupancy))
+        const uint32_t root = FindComponentRoot(parents, data_index);
+        if (root == data_index)
         {
-            VoxelGrid::GRID_INDEX neighbor_index(current_index.x - 1, current_index.y, current_index.z);
-            if (queued_hashtable[neighbor_index] <= 0)
-            {
-                queued_hashtable[neighbor_index] = 1;
-                working_queue.push_back(neighbor_index);
-            }
-        }
-        // Case 2
-        std::pair<COLLISION_CELL, bool> ym1_neighbor = collision_field_.GetImmutable(current_index.x, current_index.y - 1, current_index.z);
-        if (ym1_neighbor.second && (current_value.occupancy == ym1_neighbor.first.occupancy))
-        {
-            VoxelGrid::GRID_INDEX neighbor_index(current_index.x, current_index.y - 1, current_index.z);
-            if (queued_hashtable[neighbor_index] <= 0)
-            {
-                queued_hashtable[neighbor_index] = 1;
-                working_queue.push_back(neighbor_index);
-            }
-        }
-        // Case 3
-        std::pair<COLLISION_CELL, bool> zm1_neighbor = collision_field_.GetImmutable(current_index.x, current_index.y, current_index.z - 1);
-        if (zm1_neighbor.second && (current_value.occupancy == zm1_neighbor.first.occupancy))
-        {
-            VoxelGrid::GRID_INDEX neighbor_index(current_index.x, current_index.y, current_index.z - 1);
-            if (queued_hashtable[neighbor_index] <= 0)
-            {
-                queued_hashtable[neighbor_index] = 1;
-                working_queue.push_back(neighbor_index);
-            }
-        }
-        // Case 4
-        std::pair<COLLISION_CELL, bool> xp1_neighbor = collision_field_.GetImmutable(current_index.x + 1, current_index.y, current_index.z);
-        if (xp1_neighbor.second && (current_value.occupancy == xp1_neighbor.first.occupancy))
-        {
-            VoxelGrid::GRID_INDEX neighbor_index(current_index.x + 1, current_index.y, current_index.z);
-            if (queued_hashtable[neighbor_index] <= 0)
-            {
-                queued_hashtable[neighbor_index] = 1;
-                working_queue.push_back(neighbor_index);
-            }
-        }
-        // Case 5
-        std::pair<COLLISION_CELL, bool> yp1_neighbor = collision_field_.GetImmutable(current_index.x, current_index.y + 1, current_index.z);
-        if (yp1_neighbor.second && (current_value.occupancy == yp1_neighbor.first.occupancy))
-        {
-            VoxelGrid::GRID_INDEX neighbor_index(current_index.x, current_index.y + 1, current_index.z);
-            if (queued_hashtable[neighbor_index] <= 0)
-            {
-                queued_hashtable[neighbor_index] = 1;
-                working_queue.push_back(neighbor_index);
-            }
+            connected_components++;
+            cells[data_index].component = connected_components;
         }
-        // Case 6
-        std::pair<COLLISION_CELL, bool> zp1_neighbor = collision_field_.GetImmutable(current_index.x, current_index.y, current_index.z + 1);
-        if (zp1_neighbor.second && (current_value.occupancy == zp1_neighbor.first.occupancy))
+        else
         {
-            VoxelGrid::GRID_INDEX neighbor_index(current_index.x, current_index.y, current_index.z + 1);
-            if (queued_hashtable[neighbor_index] <= 0)
-            {
-                queued_hashtable[neighbor_index] = 1;
-                working_queue.push_back(neighbor_index);
-            }
+            cells[data_index].component = cells[root].component;
         }
     }
-    return marked_cells;
+    number_of_components_ = connected_components;
+    components_valid_ = true;
+    return connected_components;
 }
 
 std::map<uint32_t, std::pair<int32_t, int32_t>> CollisionMapGrid::ComputeComponentTopology(bool ignore_empty_components, bool recompute_connected_components, bool verbose)
@@ -0,0 +1,417 @@
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <sdf_tools/collision_map_delta.hpp>
+#include <sdf_tools/dynamic_spatial_hashed_collision_map.hpp>
+
+using namespace sdf_tools;
+
+// Position of the first bit at or after from that is set (or clear), limit if there is none
+inline int64_t FindNextBit(const uint64_t* words, const int64_t from, const int64_t limit, const bool set)
+{
+    int64_t word_index = from >> 6;
+    uint64_t word = (set ? words[word_index] : ~words[word_index]) & (~(uint64_t)0 << (from & 63));
+    while (word == 0)
+    {
+        word_index++;
+        if ((word_index << 6) >= limit)
+        {
+            return limit;
+        }
+        word = set ? words[word_index] : ~words[word_index];
+    }
+    return std::min(limit, (word_index << 6) + __builtin_ctzll(word));
+}
+
+inline void SetBitRange(uint64_t* words, const int64_t begin, const int64_t end)
+{
+    for (int64_t bit = begin; bit < end;)
+    {
+        const int64_t word_end = std::min(end, (bit | 63) + 1);
+        const int64_t count = word_end - bit;
+        const uint64_t mask = (count == 64) ? ~(uint64_t)0 : (((uint64_t)1 << count) - 1) << (bit & 63);
+        words[bit >> 6] |= mask;
+        bit = word_end;
+    }
+}
+
+bool ChunkedOccupancy::Initialize(const Eigen::Vector3d& origin, const double cell_size, const int64_t num_x_cells, const int64_t num_y_cells, const int64_t num_z_cells, const int64_t chunk_size)
+{
+    if (cell_size <= 0.0 || num_x_cells <= 0 || num_y_cells <= 0 || num_z_cells <= 0 || chunk_size <= 0 || chunk_size * chunk_size * chunk_size > 65535)
+    {
+        std::cerr << "Invalid chunked occupancy layout" << std::endl;
+        return false;
+    }
+    origin_ = origin;
+    cell_size_ = cell_size;
+    inv_cell_size_ = 1.0 / cell_size;
+    num_cells_[0] = num_x_cells;
+    num_cells_[1] = num_y_cells;
+    num_cells_[2] = num_z_cells;
+    chunk_size_ = chunk_size;
+    for (int axis = 0; axis < 3; axis++)
+    {
+        num_chunks_[axis] = (num_cells_[axis] + chunk_size_ - 1) / chunk_size_;
+    }
+    words_per_chunk_ = (chunk_size_ * chunk_size_ * chunk_size_ + 63) / 64;
+    bits_.assign(GetNumChunks() * words_per_chunk_, 0);
+    initialized_ = true;
+    return true;
+}
+
+bool ChunkedOccupancy::SameLayout(const sdf_tools::CollisionMapDelta& delta) const
+{
+    return (initialized_
+            && delta.origin.x == origin_.x() && delta.origin.y == origin_.y() && delta.origin.z == origin_.z()
+            && delta.cell_size == cell_size_
+            && (int64_t)delta.num_x_cells == num_cells_[0] && (int64_t)delta.num_y_cells == num_cells_[1] && (int64_t)delta.num_z_cells == num_cells_[2]
+            && (int64_t)delta.chunk_size == chunk_size_);
+}
+
+void ChunkedOccupancy::Clear()
+{
+    std::fill(bits_.begin(), bits_.end(), 0);
+}
+
+void ChunkedOccupancy::EncodeChunk(const int64_t chunk_id, std::vector<uint16_t>& runs) const
+{
+    const uint64_t* words = GetChunkWords(chunk_id);
+    const int64_t num_bits = chunk_size_ * chunk_size_ * chunk_size_;
+    int64_t position = 0;
+    while (position < num_bits)
+    {
+        const int64_t occupied_begin = FindNextBit(words, position, num_bits, true);
+        if (occupied_begin == num_bits)
+        {
+            break;
+        }
+        const int64_t occupied_end = FindNextBit(words, occupied_begin, num_bits, false);
+        runs.push_back((uint16_t)(occupied_begin - position));
+        runs.push_back((uint16_t)(occupied_end - occupied_begin));
+        position = occupied_end;
+    }
+}
+
+bool ChunkedOccupancy::DecodeChunk(const uint16_t* runs, const size_t num_runs, uint64_t* words) const
+{
+    const int64_t num_bits = chunk_size_ * chunk_size_ * chunk_size_;
+    std::fill(words, words + words_per_chunk_, 0);
+    int64_t position = 0;
+    for (size_t run = 0; run < num_runs; run++)
+    {
+        const int64_t run_end = position + runs[run];
+        if (run_end > num_bits)
+        {
+            return false;
+        }
+        if (run & 1)
+        {
+            SetBitRange(words, position, run_end);
+        }
+        position = run_end;
+    }
+    return true;
+}
+
+bool CollisionMapDeltaEncoder::Initialize(const Eigen::Vector3d& origin, const double cell_size, const double x_size, const double y_size, const double z_size, const int64_t chunk_size)
+{
+    // Same cell counts as a CollisionMapGrid of this size
+    const int64_t num_x_cells = (int64_t)std::ceil(std::fabs(x_size) / cell_size);
+    const int64_t num_y_cells = (int64_t)std::ceil(std::fabs(y_size) / cell_size);
+    const int64_t num_z_cells = (int64_t)std::ceil(std::fabs(z_size) / cell_size);
+    if (!published_.Initialize(origin, cell_size, num_x_cells, num_y_cells, num_z_cells, chunk_size) || !current_.Initialize(origin, cell_size, num_x_cells, num_y_cells, num_z_cells, chunk_size))
+    {
+        return false;
+    }
+    published_chunks_.clear();
+    current_chunks_.clear();
+    current_chunk_marked_.assign(current_.GetNumChunks(), 0);
+    sequence_ = 0;
+    return true;
+}
+
+void CollisionMapDeltaEncoder::BeginFrame()
+{
+    // Drop the marks of a frame that was never ended
+    for (size_t idx = 0; idx < current_chunks_.size(); idx++)
+    {
+        uint64_t* words = current_.GetChunkWords(current_chunks_[idx]);
+        std::fill(words, words + current_.GetWordsPerChunk(), 0);
+        current_chunk_marked_[current_chunks_[idx]] = 0;
+    }
+    current_chunks_.clear();
+}
+
+bool CollisionMapDeltaEncoder::MarkOccupied(const Eigen::Vector3d& location)
+{
+    int64_t x_index = 0;
+    int64_t y_index = 0;
+    int64_t z_index = 0;
+    if (!current_.LocationToCell(location, x_index, y_index, z_index))
+    {
+        return false;
+    }
+    const int64_t chunk_id = current_.GetChunkId(x_index, y_index, z_index);
+    if (current_chunk_marked_[chunk_id] == 0)
+    {
+        current_chunk_marked_[chunk_id] = 1;
+        current_chunks_.push_back(chunk_id);
+    }
+    current_.SetOccupied(x_index, y_index, z_index);
+    return true;
+}
+
+sdf_tools::CollisionMapDelta CollisionMapDeltaEncoder::EndFrame(const bool keyframe)
+{
+    sdf_tools::CollisionMapDelta delta;
+    delta.sequence = sequence_;
+    delta.keyframe = keyframe;
+    delta.origin.x = current_.GetOrigin().x();
+    delta.origin.y = current_.GetOrigin().y();
+    delta.origin.z = current_.GetOrigin().z();
+    delta.cell_size = current_.GetResolution();
+    delta.num_x_cells = (uint32_t)current_.GetNumCells(0);
+    delta.num_y_cells = (uint32_t)current_.GetNumCells(1);
+    delta.num_z_cells = (uint32_t)current_.GetNumCells(2);
+    delta.chunk_size = (uint32_t)current_.GetChunkSize();
+    const int64_t words_per_chunk = current_.GetWordsPerChunk();
+    // Chunks occupied in this frame, when they differ from what was published
+    for (size_t idx = 0; idx < current_chunks_.size(); idx++)
+    {
+        const int64_t chunk_id = current_chunks_[idx];
+        if (keyframe || memcmp(current_.GetChunkWords(chunk_id), published_.GetChunkWords(chunk_id), words_per_chunk * sizeof(uint64_t)) != 0)
+        {
+            delta.chunk_ids.push_back((uint32_t)chunk_id);
+            delta.run_starts.push_back((uint32_t)delta.runs.size());
+            current_.EncodeChunk(chunk_id, delta.runs);
+        }
+    }
+    // Chunks that became free, which a keyframe leaves out
+    for (size_t idx = 0; idx < published_chunks_.size(); idx++)
+    {
+        const int64_t chunk_id = published_chunks_[idx];
+        if (current_chunk_marked_[chunk_id] == 0 && !keyframe)
+        {
+            delta.chunk_ids.push_back((uint32_t)chunk_id);
+            delta.run_starts.push_back((uint32_t)delta.runs.size());
+        }
+        uint64_t* words = published_.GetChunkWords(chunk_id);
+        std::fill(words, words + words_per_chunk, 0);
+    }
+    // This frame becomes the published state
+    for (size_t idx = 0; idx < current_chunks_.size(); idx++)
+    {
+        const int64_t chunk_id = current_chunks_[idx];
+        uint64_t* current_words = current_.GetChunkWords(chunk_id);
+        memcpy(published_.GetChunkWords(chunk_id), current_words, words_per_chunk * sizeof(uint64_t));
+        std::fill(current_words, current_words + words_per_chunk, 0);
+        current_chunk_marked_[chunk_id] = 0;
+    }
+    published_chunks_.swap(current_chunks_);
+    current_chunks_.clear();
+    sequence_++;
+    return delta;
+}
+
+bool CollisionMapDeltaDecoder::Apply(const sdf_tools::CollisionMapDelta& delta, std::vector<int64_t>& changed_chunks)
+{
+    changed_chunks.clear();
+    if (!occupancy_.SameLayout(delta))
+    {
+        if (!delta.keyframe)
+        {
+            synchronized_ = false;
+            return false;
+        }
+        const Eigen::Vector3d origin(delta.origin.x, delta.origin.y, delta.origin.z);
+        if (!occupancy_.Initialize(origin, delta.cell_size, delta.num_x_cells, delta.num_y_cells, delta.num_z_cells, delta.chunk_size))
+        {
+            synchronized_ = false;
+            return false;
+        }
+        chunk_occupied_.assign(occupancy_.GetNumChunks(), 0);
+    }
+    if (!delta.keyframe && (!synchronized_ || delta.sequence != next_sequence_))
+    {
+        synchronized_ = false;
+        return false;
+    }
+    // Decode everything before touching the occupancy, so that a malformed delta changes nothing
+    const size_t num_listed = delta.chunk_ids.size();
+    if (delta.run_starts.size() != num_listed)
+    {
+        synchronized_ = false;
+        return false;
+    }
+    const int64_t words_per_chunk = occupancy_.GetWordsPerChunk();
+    scratch_words_.resize(num_listed * words_per_chunk);
+    for (size_t idx = 0; idx < num_listed; idx++)
+    {
+        const size_t runs_begin = delta.run_starts[idx];
+        const size_t runs_end = (idx + 1 < num_listed) ? delta.run_starts[idx + 1] : delta.runs.size();
+        if ((int64_t)delta.chunk_ids[idx] >= occupancy_.GetNumChunks() || runs_begin > runs_end || runs_end > delta.runs.size()
+            || !occupancy_.DecodeChunk(delta.runs.data() + runs_begin, runs_end - runs_begin, &scratch_words_[idx * words_per_chunk]))
+        {
+            synchronized_ = false;
+            return false;
+        }
+    }
+    // A keyframe frees every chunk it does not list
+    if (delta.keyframe)
+    {
+        for (size_t idx = 0; idx < num_listed; idx++)
+        {
+            chunk_occupied_[delta.chunk_ids[idx]] |= 2;
+        }
+        for (int64_t chunk_id = 0; chunk_id < occupancy_.GetNumChunks(); chunk_id++)
+        {
+            if (chunk_occupied_[chunk_id] == 1)
+            {
+                uint64_t* words = occupancy_.GetChunkWords(chunk_id);
+                std::fill(words, words + words_per_chunk, 0);
+                chunk_occupied_[chunk_id] = 0;
+                changed_chunks.push_back(chunk_id);
+            }
+            chunk_occupied_[chunk_id] &= 1;
+        }
+    }
+    for (size_t idx = 0; idx < num_listed; idx++)
+    {
+        const int64_t chunk_id = delta.chunk_ids[idx];
+        const uint64_t* decoded_words = &scratch_words_[idx * words_per_chunk];
+        uint64_t* words = occupancy_.GetChunkWords(chunk_id);
+        if (memcmp(words, decoded_words, words_per_chunk * sizeof(uint64_t)) != 0)
+        {
+            memcpy(words, decoded_words, words_per_chunk * sizeof(uint64_t));
+            changed_chunks.push_back(chunk_id);
+        }
+        chunk_occupied_[chunk_id] = (std::find_if(decoded_words, decoded_words + words_per_chunk, [] (const uint64_t word) { return word != 0; }) != decoded_words + words_per_chunk) ? 1 : 0;
+    }
+    next_sequence_ = delta.sequence + 1;
+    synchronized_ = true;
+    return true;
+}
+
+// Cells of the grid that can be written, first and one past the last on each axis
+inline void GetGridCellRange(const CollisionMapGrid& grid, int64_t grid_lo[3], int64_t grid_hi[3])
+{
+    grid_lo[0] = 0;
+    grid_lo[1] = 0;
+    grid_lo[2] = 0;
+    grid_hi[0] = grid.GetNumXCells();
+    grid_hi[1] = grid.GetNumYCells();
+    grid_hi[2] = grid.GetNumZCells();
+}
+
+// A hashed grid has no bounds, only the extent of the stream limits what is written
+inline void GetGridCellRange(const DynamicSpatialHashedCollisionMapGrid& grid, int64_t grid_lo[3], int64_t grid_hi[3])
+{
+    (void)grid;
+    for (int axis = 0; axis < 3; axis++)
+    {
+        grid_lo[axis] = std::numeric_limits<int32_t>::min();
+        grid_hi[axis] = std::numeric_limits<int32_t>::max();
+    }
+}
+
+template<typename CollisionMap>
+bool CollisionMapDeltaDecoder::DilateChunksInto(const std::vector<int64_t>& chunks, const int64_t radius_xy, const int64_t radius_z, CollisionMap& grid, const COLLISION_CELL& occupied_cell, const COLLISION_CELL& free_cell) const
+{
+    if (!occupancy_.IsInitialized())
+    {
+        return false;
+    }
+    // Offset from the cells of the stream to the cells of the grid
+    const Eigen::Affine3d& grid_transform = grid.GetOriginTransform();
+    const Eigen::Vector3d offset = (occupancy_.GetOrigin() - grid_transform.translation()) / occupancy_.GetResolution();
+    const Eigen::Vector3d rounded_offset(std::round(offset.x()), std::round(offset.y()), std::round(offset.z()));
+    if (std::fabs(grid.GetResolution() - occupancy_.GetResolution()) > 1e-9 || !grid_transform.linear().isIdentity(1e-9) || (offset - rounded_offset).cwiseAbs().maxCoeff() > 1e-6)
+    {
+        std::cerr << "Grid does not line up with the cells of the delta stream" << std::endl;
+        return false;
+    }
+    const int64_t radius[3] = {radius_xy, radius_xy, radius_z};
+    const int64_t num_cells[3] = {occupancy_.GetNumCells(0), occupancy_.GetNumCells(1), occupancy_.GetNumCells(2)};
+    const int64_t grid_offset[3] = {(int64_t)rounded_offset.x(), (int64_t)rounded_offset.y(), (int64_t)rounded_offset.z()};
+    int64_t grid_lo[3], grid_hi[3];
+    GetGridCellRange(grid, grid_lo, grid_hi);
+    // Box dilation, one axis at a time, of the cells around each chunk
+    std::vector<uint8_t> source, dilated_z, dilated_zy;
+    for (size_t idx = 0; idx < chunks.size(); idx++)
+    {
+        Eigen::Vector3i chunk_lo, chunk_hi;
+        occupancy_.GetChunkCellRange(chunks[idx], chunk_lo, chunk_hi);
+        int64_t out_lo[3], out_hi[3], in_lo[3], in_hi[3], out_size[3], in_size[3];
+        for (int axis = 0; axis < 3; axis++)
+        {
+            // Cells rewritten are those of the grid around the chunk that the stream covers
+            out_lo[axis] = std::max(std::max((int64_t)0, grid_lo[axis] - grid_offset[axis]), chunk_lo(axis) - radius[axis]);
+            out_hi[axis] = std::min(std::min(num_cells[axis], grid_hi[axis] - grid_offset[axis]), chunk_hi(axis) + radius[axis]);
+            in_lo[axis] = std::max((int64_t)0, out_lo[axis] - radius[axis]);
+            in_hi[axis] = std::min(num_cells[axis], out_hi[axis] + radius[axis]);
+            out_size[axis] = out_hi[axis] - out_lo[axis];
+            in_size[axis] = in_hi[axis] - in_lo[axis];
+        }
+        if (out_hi[0] <= out_lo[0] || out_hi[1] <= out_lo[1] || out_hi[2] <= out_lo[2])
+        {
+            continue;
+        }
+        source.assign(in_size[0] * in_size[1] * in_size[2], 0);
+        for (int64_t x = 0; x < in_size[0]; x++)
+            for (int64_t y = 0; y < in_size[1]; y++)
+                for (int64_t z = 0; z < in_size[2]; z++)
+                    source[(x * in_size[1] + y) * in_size[2] + z] = occupancy_.IsOccupied(in_lo[0] + x, in_lo[1] + y, in_lo[2] + z);
+        dilated_z.assign(in_size[0] * in_size[1] * out_size[2], 0);
+        for (int64_t x = 0; x < in_size[0]; x++)
+            for (int64_t y = 0; y < in_size[1]; y++)
+                for (int64_t z = 0; z < out_size[2]; z++)
+                {
+                    const int64_t center = out_lo[2] + z - in_lo[2];
+                    const int64_t lo = std::max((int64_t)0, center - radius[2]);
+                    const int64_t hi = std::min(in_size[2] - 1, center + radius[2]);
+                    const uint8_t* row = &source[(x * in_size[1] + y) * in_size[2]];
+                    uint8_t value = 0;
+                    for (int64_t k = lo; k <= hi && value == 0; k++)
+                        value = row[k];
+                    dilated_z[(x * in_size[1] + y) * out_size[2] + z] = value;
+                }
+        dilated_zy.assign(in_size[0] * out_size[1] * out_size[2], 0);
+        for (int64_t x = 0; x < in_size[0]; x++)
+            for (int64_t y = 0; y < out_size[1]; y++)
+            {
+                const int64_t center = out_lo[1] + y - in_lo[1];
+                const int64_t lo = std::max((int64_t)0, center - radius[1]);
+                const int64_t hi = std::min(in_size[1] - 1, center + radius[1]);
+                uint8_t* out_row = &dilated_zy[(x * out_size[1] + y) * out_size[2]];
+                for (int64_t j = lo; j <= hi; j++)
+                {
+                    const uint8_t* in_row = &dilated_z[(x * in_size[1] + j) * out_size[2]];
+                    for (int64_t z = 0; z < out_size[2]; z++)
+                        out_row[z] |= in_row[z];
+                }
+            }
+        for (int64_t x = 0; x < out_size[0]; x++)
+        {
+            const int64_t center = out_lo[0] + x - in_lo[0];
+            const int64_t lo = std::max((int64_t)0, center - radius[0]);
+            const int64_t hi = std::min(in_size[0] - 1, center + radius[0]);
+            for (int64_t y = 0; y < out_size[1]; y++)
+                for (int64_t z = 0; z < out_size[2]; z++)
+                {
+                    uint8_t value = 0;
+                    for (int64_t i = lo; i <= hi && value == 0; i++)
+                        value = dilated_zy[(i * out_size[1] + y) * out_size[2] + z];
+                    grid.Set(out_lo[0] + x + grid_offset[0], out_lo[1] + y + grid_offset[1], out_lo[2] + z + grid_offset[2], value ? occupied_cell : free_cell);
+                }
+        }
+    }
+    return true;
+}
+
+template bool CollisionMapDeltaDecoder::DilateChunksInto<CollisionMapGrid>(const std::vector<int64_t>& chunks, const int64_t radius_xy, const int64_t radius_z, CollisionMapGrid& grid, const COLLISION_CELL& occupied_cell, const COLLISION_CELL& free_cell) const;
+
+template bool CollisionMapDeltaDecoder::DilateChunksInto<DynamicSpatialHashedCollisionMapGrid>(const std::vector<int64_t>& chunks, const int64_t radius_xy, const int64_t radius_z, DynamicSpatialHashedCollisionMapGrid& grid, const COLLISION_CELL& occupied_cell, const COLLISION_CELL& free_cell) const;
@@ -0,0 +1,200 @@
+#include <stdlib.h>
+#include <stdint.h>
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+#include <cmath>
+#include <sdf_tools/compact_distance_field.hpp>
+
+using namespace sdf_tools;
+
+const uint16_t CompactDistanceField::FAR_DISTANCE_SQUARE = 65535u;
+const uint16_t CompactDistanceField::MAX_DISTANCE_SQUARE = 65534u;
+
+CompactDistanceField::CompactDistanceField() : origin_transform_(Eigen::Affine3d::Identity()), inverse_origin_transform_(Eigen::Affine3d::Identity()), resolution_(0.0), inv_resolution_(0.0), num_cells_{0, 0, 0}, stride1_(0), stride2_(0)
+{
+    MakeNeighborhoods();
+}
+
+void CompactDistanceField::MakeNeighborhoods()
+{
+    for (int n = 0; n < 2; n++)
+    {
+        for (int dx = -1; dx <= 1; dx++)
+        {
+            for (int dy = -1; dy <= 1; dy++)
+            {
+                for (int dz = -1; dz <= 1; dz++)
+                {
+                    std::vector<NeighborStep>& neighborhood = neighborhoods_[n][GetDirectionNumber(dx, dy, dz)];
+                    neighborhood.clear();
+                    for (int tdx = -1; tdx <= 1; tdx++)
+                    {
+                        for (int tdy = -1; tdy <= 1; tdy++)
+                        {
+                            for (int tdz = -1; tdz <= 1; tdz++)
+                            {
+                                if (tdx == 0 && tdy == 0 && tdz == 0)
+                                {
+                                    continue;
+                                }
+                                // Past the seeds, only the face neighbors away from where the cell
+                                // was reached from
+                                if (n >= 1 && ((abs(tdx) + abs(tdy) + abs(tdz)) != 1 || (dx * tdx) < 0 || (dy * tdy) < 0 || (dz * tdz) < 0))
+                                {
+                                    continue;
+                                }
+                                NeighborStep step;
+                                step.dx = (int8_t)tdx;
+                                step.dy = (int8_t)tdy;
+                                step.dz = (int8_t)tdz;
+                                step.direction = GetDirectionNumber(tdx, tdy, tdz);
+                                neighborhood.push_back(step);
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+void CompactDistanceField::Resize(const CollisionMapGrid& map)
+{
+    if (!map.IsInitialized())
+    {
+        throw std::invalid_argument("Collision map is not initialized");
+    }
+    const int64_t num_cells[3] = {map.GetNumXCells(), map.GetNumYCells(), map.GetNumZCells()};
+    // Closest points are stored as 16 bit cell indices, and cells are queued as 32 bit offsets
+    if (num_cells[0] > 65535 || num_cells[1] > 65535 || num_cells[2] > 65535 || (num_cells[0] * num_cells[1] * num_cells[2]) > (int64_t)UINT32_MAX)
+    {
+        throw std::invalid_argument("Collision map is too large for a compact distance field");
+    }
+    origin_transform_ = map.GetOriginTransform();
+    inverse_origin_transform_ = map.GetInverseOriginTransform();
+    resolution_ = map.GetResolution();
+    inv_resolution_ = 1.0 / resolution_;
+    num_cells_[0] = num_cells[0];
+    num_cells_[1] = num_cells[1];
+    num_cells_[2] = num_cells[2];
+    stride1_ = num_cells_[1] * num_cells_[2];
+    stride2_ = num_cells_[2];
+    // resize keeps the capacity of a previous, larger grid
+    const size_t total_cells = (size_t)(num_cells_[0] * num_cells_[1] * num_cells_[2]);
+    distance_square_.resize(total_cells);
+    closest_point_.resize(total_cells * 3);
+    update_direction_.resize(total_cells);
+}
+
+size_t CompactDistanceField::GetScratchMemoryUsage() const
+{
+    size_t bytes = closest_point_.capacity() * sizeof(uint16_t) + update_direction_.capacity() * sizeof(uint8_t) + bucket_queue_.capacity() * sizeof(std::vector<uint32_t>);
+    for (size_t idx = 0; idx < bucket_queue_.size(); idx++)
+    {
+        bytes += bucket_queue_[idx].capacity() * sizeof(uint32_t);
+    }
+    return bytes;
+}
+
+void CompactDistanceField::Build(const CollisionMapGrid& map, const double max_distance)
+{
+    Resize(map);
+    const std::vector<COLLISION_CELL>& cells = map.GetRawData();
+    // Squared distance to propagate up to, in cells
+    int64_t max_distance_square = (num_cells_[0] * num_cells_[0]) + (num_cells_[1] * num_cells_[1]) + (num_cells_[2] * num_cells_[2]);
+    if (max_distance > 0.0)
+    {
+        const double max_cells = max_distance * inv_resolution_;
+        max_distance_square = std::min(max_distance_square, (int64_t)std::ceil(max_cells * max_cells));
+    }
+    max_distance_square = std::min(max_distance_square, (int64_t)MAX_DISTANCE_SQUARE);
+    if ((int64_t)bucket_queue_.size() < max_distance_square + 1)
+    {
+        bucket_queue_.resize(max_distance_square + 1);
+    }
+    std::fill(distance_square_.begin(), distance_square_.end(), FAR_DISTANCE_SQUARE);
+    // Filled cells are at distance 0, those with a free face neighbor seed the propagation
+    const uint8_t initial_update_direction = GetDirectionNumber(0, 0, 0);
+    int64_t index = 0;
+    for (int64_t x_index = 0; x_index < num_cells_[0]; x_index++)
+    {
+        for (int64_t y_index = 0; y_index < num_cells_[1]; y_index++)
+        {
+            for (int64_t z_index = 0; z_index < num_cells_[2]; z_index++, index++)
+            {
+                if (cells[index].occupancy <= 0.5)
+                {
+                    continue;
+                }
+                distance_square_[index] = 0;
+                const bool exposed = (x_index > 0 && cells[index - stride1_].occupancy <= 0.5)
+                                     || (x_index < num_cells_[0] - 1 && cells[index + stride1_].occupancy <= 0.5)
+                                     || (y_index > 0 && cells[index - stride2_].occupancy <= 0.5)
+                                     || (y_index < num_cells_[1] - 1 && cells[index + stride2_].occupancy <= 0.5)
+                                     || (z_index > 0 && cells[index - 1].occupancy <= 0.5)
+                                     || (z_index < num_cells_[2] - 1 && cells[index + 1].occupancy <= 0.5);
+                if (exposed)
+                {
+                    closest_point_[(index * 3)] = (uint16_t)x_index;
+                    closest_point_[(index * 3) + 1] = (uint16_t)y_index;
+                    closest_point_[(index * 3) + 2] = (uint16_t)z_index;
+                    update_direction_[index] = initial_update_direction;
+                    bucket_queue_[0].push_back((uint32_t)index);
+                }
+            }
+        }
+    }
+    // Process the bucket queue. A cell is queued again each time its distance improves, only the
+    // entry in the bucket of its current distance is propagated from.
+    for (int64_t bq_idx = 0; bq_idx <= max_distance_square; bq_idx++)
+    {
+        std::vector<uint32_t>& queue = bucket_queue_[bq_idx];
+        const int D = (bq_idx > 1) ? 1 : (int)bq_idx;
+        // Cells may be queued into the bucket being processed
+        for (size_t queue_idx = 0; queue_idx < queue.size(); queue_idx++)
+        {
+            const int64_t cell_index = queue[queue_idx];
+            if (distance_square_[cell_index] != bq_idx)
+            {
+                continue;
+            }
+            const int64_t x = cell_index / stride1_;
+            const int64_t y = (cell_index % stride1_) / stride2_;
+            const int64_t z = cell_index % stride2_;
+            const int64_t closest_x = closest_point_[(cell_index * 3)];
+            const int64_t closest_y = closest_point_[(cell_index * 3) + 1];
+            const int64_t closest_z = closest_point_[(cell_index * 3) + 2];
+            const std::vector<NeighborStep>& neighborhood = neighborhoods_[D][update_direction_[cell_index]];
+            for (size_t nh_idx = 0; nh_idx < neighborhood.size(); nh_idx++)
+            {
+                const NeighborStep& step = neighborhood[nh_idx];
+                const int64_t nx = x + step.dx;
+                const int64_t ny = y + step.dy;
+                const int64_t nz = z + step.dz;
+                if (nx < 0 || ny < 0 || nz < 0 || nx >= num_cells_[0] || ny >= num_cells_[1] || nz >= num_cells_[2])
+                {
+                    continue;
+                }
+                const int64_t new_distance_square = ((nx - closest_x) * (nx - closest_x)) + ((ny - closest_y) * (ny - closest_y)) + ((nz - closest_z) * (nz - closest_z));
+                const int64_t neighbor_index = cell_index + (step.dx * stride1_) + (step.dy * stride2_) + step.dz;
+                if (new_distance_square > max_distance_square || new_distance_square >= distance_square_[neighbor_index])
+                {
+                    continue;
+                }
+                distance_square_[neighbor_index] = (uint16_t)new_distance_square;
+                closest_point_[(neighbor_index * 3)] = (uint16_t)closest_x;
+                closest_point_[(neighbor_index * 3) + 1] = (uint16_t)closest_y;
+                closest_point_[(neighbor_index * 3) + 2] = (uint16_t)closest_z;
+                update_direction_[neighbor_index] = step.direction;
+                // A cell improved below the current bucket is not propagated from again, as in
+                // CollisionMapGrid::BuildDistanceField, and must not stay queued for the next build
+                if (new_distance_square >= bq_idx)
+                {
+                    bucket_queue_[new_distance_square].push_back((uint32_t)neighbor_index);
+                }
+            }
+        }
+        queue.clear();
+    }
+}
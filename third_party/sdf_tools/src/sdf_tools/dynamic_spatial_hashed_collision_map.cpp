@@ -3,7 +3,6 @@
 #include <vector>
 #include <string>
 #include <functional>
-#include <unordered_map>
 #include <sstream>
 #include <iostream>
 #include <stdexcept>
@@ -23,6 +22,7 @@ DynamicSpatialHashedCollisionMapGrid::DynamicSpatialHashedCollisionMapGrid(std::
     VoxelGrid::DynamicSpatialHashedVoxelGrid<COLLISION_CELL> new_field(resolution, chunk_x_size, chunk_y_size, chunk_z_size, OOB_value);
     collision_field_ = new_field;
     number_of_components_ = 0;
+    initialized_ = true;
     components_valid_ = false;
 }
 
@@ -32,6 +32,7 @@ DynamicSpatialHashedCollisionMapGrid::DynamicSpatialHashedCollisionMapGrid(Eigen
     VoxelGrid::DynamicSpatialHashedVoxelGrid<COLLISION_CELL> new_field(origin_transform, resolution, chunk_x_size, chunk_y_size, chunk_z_size, OOB_value);
     collision_field_ = new_field;
     number_of_components_ = 0;
+    initialized_ = true;
     components_valid_ = false;
 }
 
@@ -75,11 +76,10 @@ std::vector<visualization_msgs::Marker> DynamicSpatialHashedCollisionMapGrid::Ex
     cells_display_rep.scale.z = cell_sizes[2];
     // Now, go through the chunks and add everything to the message
     const Eigen::Affine3d& grid_transform = GetOriginTransform();
-    const std::unordered_map<VoxelGrid::CHUNK_REGION, VoxelGrid::DynamicSpatialHashedVoxelGridChunk<COLLISION_CELL>>& raw_chunks = collision_field_.GetInternalChunks();
-    std::unordered_map<VoxelGrid::CHUNK_REGION, VoxelGrid::DynamicSpatialHashedVoxelGridChunk<COLLISION_CELL>>::const_iterator raw_chunks_itr;
-    for (raw_chunks_itr = raw_chunks.begin(); raw_chunks_itr != raw_chunks.end(); ++raw_chunks_itr)
+    const std::vector<VoxelGrid::DynamicSpatialHashedVoxelGridChunk<COLLISION_CELL>>& raw_chunks = collision_field_.GetInternalChunks();
+    for (size_t chunk_index = 0; chunk_index < raw_chunks.size(); chunk_index++)
     {
-        const VoxelGrid::DynamicSpatialHashedVoxelGridChunk<COLLISION_CELL>& current_chunk = raw_chunks_itr->second;
+        const VoxelGrid::DynamicSpatialHashedVoxelGridChunk<COLLISION_CELL>& current_chunk = raw_chunks[chunk_index];
         if (current_chunk.IsChunkInitialized())
         {
             const COLLISION_CELL& current_cell = current_chunk.GetChunkImmutable();
@@ -0,0 +1,389 @@
+#include <stdlib.h>
+#include <stdint.h>
+#include <vector>
+#include <iostream>
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
+#include <limits>
+#include <thread>
+#include <cmath>
+#include <sdf_tools/occupancy_log_odds_map.hpp>
+
+using namespace sdf_tools;
+
+const int64_t OccupancyLogOddsMap::KEY_OFFSET;
+const uint64_t OccupancyLogOddsMap::KEY_MASK;
+const int64_t OccupancyLogOddsMap::MAX_VISITED_CELLS;
+
+inline void SortUniqueKeys(std::vector<uint64_t>& keys)
+{
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+}
+
+OccupancyLogOddsMap::OccupancyLogOddsMap(const Eigen::Affine3d& origin_transform, const double resolution, const int64_t chunk_size, const float hit, const float miss, const float min, const float max, const float occupied, const int num_threads) : log_odds_(origin_transform, resolution, chunk_size, chunk_size, chunk_size, 0.0f)
+{
+    if (min > 0.0f || max < 0.0f || occupied < min || occupied >= max)
+    {
+        throw std::invalid_argument("Log-odds bounds must hold 0 and the occupied threshold");
+    }
+    inverse_origin_transform_ = origin_transform.inverse();
+    cell_size_ = resolution;
+    inv_cell_size_ = 1.0 / resolution;
+    chunk_size_ = chunk_size;
+    hit_ = hit;
+    miss_ = miss;
+    min_ = min;
+    max_ = max;
+    occupied_ = occupied;
+    num_threads_ = std::max(1, num_threads);
+    thread_visited_.resize(num_threads_);
+    thread_free_keys_.resize(num_threads_);
+    thread_hit_keys_.resize(num_threads_);
+    initialized_ = true;
+}
+
+void OccupancyLogOddsMap::Clear()
+{
+    log_odds_.ClearChunks();
+}
+
+void OccupancyLogOddsMap::CastRay(const Eigen::Vector3d& start, const Eigen::Vector3d& end, const bool hit, std::vector<uint64_t>& visited, std::vector<uint64_t>& free_keys, std::vector<uint64_t>& hit_keys) const
+{
+    int64_t index[3] = {(int64_t)std::floor(start.x()), (int64_t)std::floor(start.y()), (int64_t)std::floor(start.z())};
+    const int64_t end_index[3] = {(int64_t)std::floor(end.x()), (int64_t)std::floor(end.y()), (int64_t)std::floor(end.z())};
+    // Parameter along the ray of the next cell boundary on each axis, and between two boundaries
+    int64_t step[3];
+    double t_max[3];
+    double t_delta[3];
+    for (int axis = 0; axis < 3; axis++)
+    {
+        const double direction = end(axis) - start(axis);
+        if (direction > 0.0)
+        {
+            step[axis] = 1;
+            t_delta[axis] = 1.0 / direction;
+            t_max[axis] = ((double)(index[axis] + 1) - start(axis)) * t_delta[axis];
+        }
+        else if (direction < 0.0)
+        {
+            step[axis] = -1;
+            t_delta[axis] = -1.0 / direction;
+            t_max[axis] = (start(axis) - (double)index[axis]) * t_delta[axis];
+        }
+        else
+        {
+            step[axis] = 0;
+            t_delta[axis] = std::numeric_limits<double>::infinity();
+            t_max[axis] = std::numeric_limits<double>::infinity();
+        }
+    }
+    // Only axes that have not reached the end cell are stepped, so rounding cannot overshoot it
+    while (index[0] != end_index[0] || index[1] != end_index[1] || index[2] != end_index[2])
+    {
+        if (MarkVisited(visited, index[0], index[1], index[2]))
+        {
+            free_keys.push_back(PackKey(index[0], index[1], index[2]));
+        }
+        int axis = -1;
+        for (int candidate = 0; candidate < 3; candidate++)
+        {
+            if (index[candidate] != end_index[candidate] && (axis < 0 || t_max[candidate] < t_max[axis]))
+            {
+                axis = candidate;
+            }
+        }
+        index[axis] += step[axis];
+        t_max[axis] += t_delta[axis];
+    }
+    if (hit)
+    {
+        hit_keys.push_back(PackKey(end_index[0], end_index[1], end_index[2]));
+    }
+    else if (MarkVisited(visited, end_index[0], end_index[1], end_index[2]))
+    {
+        free_keys.push_back(PackKey(end_index[0], end_index[1], end_index[2]));
+    }
+}
+
+void OccupancyLogOddsMap::CastRays(const Eigen::Vector3d& start, const size_t first_ray, const size_t end_ray, std::vector<uint64_t>& visited, std::vector<uint64_t>& free_keys, std::vector<uint64_t>& hit_keys) const
+{
+    free_keys.clear();
+    hit_keys.clear();
+    std::fill(visited.begin(), visited.end(), 0);
+    for (size_t idx = first_ray; idx < end_ray; idx++)
+    {
+        CastRay(start, ray_ends_[idx], ray_hits_[idx] != 0, visited, free_keys, hit_keys);
+    }
+    SortUniqueKeys(free_keys);
+    SortUniqueKeys(hit_keys);
+}
+
+void OccupancyLogOddsMap::MergeThreadKeys(std::vector<std::vector<uint64_t>>& thread_keys, std::vector<uint64_t>& keys) const
+{
+    keys.clear();
+    for (size_t thread = 0; thread < thread_keys.size(); thread++)
+    {
+        const size_t merged = keys.size();
+        keys.insert(keys.end(), thread_keys[thread].begin(), thread_keys[thread].end());
+        std::inplace_merge(keys.begin(), keys.begin() + merged, keys.end());
+    }
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+}
+
+void OccupancyLogOddsMap::UpdateCell(const uint64_t key, const float delta)
+{
+    int64_t x_index = 0;
+    int64_t y_index = 0;
+    int64_t z_index = 0;
+    UnpackKey(key, x_index, y_index, z_index);
+    const float old_value = log_odds_.GetImmutableByIndex(x_index, y_index, z_index).first;
+    const float new_value = std::min(max_, std::max(min_, old_value + delta));
+    // A clamped cell is left alone, so that free space seen again does not rewrite its chunk
+    if (new_value == old_value)
+    {
+        return;
+    }
+    log_odds_.SetCellValueByIndex(x_index, y_index, z_index, new_value);
+    if ((old_value > occupied_) != (new_value > occupied_))
+    {
+        // Keys come sorted, so cells of one chunk mostly follow each other
+        const uint64_t chunk_key = PackKey(GetChunkCoordinate(x_index), GetChunkCoordinate(y_index), GetChunkCoordinate(z_index));
+        if (changed_chunk_keys_.empty() || changed_chunk_keys_.back() != chunk_key)
+        {
+            changed_chunk_keys_.push_back(chunk_key);
+        }
+    }
+}
+
+void OccupancyLogOddsMap::InsertPointCloud(const Eigen::Vector3d& origin, const std::vector<Eigen::Vector3d>& points, const double max_range, std::vector<Eigen::Vector3i>& changed_chunks)
+{
+    changed_chunks.clear();
+    if (!initialized_)
+    {
+        return;
+    }
+    // Ends of the rays, cut at max_range, and the box of cells they cross. Points past the cells
+    // the map can hold are dropped.
+    const Eigen::Vector3d start = (inverse_origin_transform_ * origin) * inv_cell_size_;
+    if (!KeyInRange((int64_t)std::floor(start.x()), (int64_t)std::floor(start.y()), (int64_t)std::floor(start.z())))
+    {
+        std::cerr << "Sensor origin is past the cells the map can hold" << std::endl;
+        return;
+    }
+    Eigen::Vector3d box_lo = start;
+    Eigen::Vector3d box_hi = start;
+    ray_ends_.clear();
+    ray_hits_.clear();
+    for (size_t idx = 0; idx < points.size(); idx++)
+    {
+        const Eigen::Vector3d& point = points[idx];
+        if (!std::isfinite(point.x()) || !std::isfinite(point.y()) || !std::isfinite(point.z()))
+        {
+            continue;
+        }
+        const double range = (point - origin).norm();
+        const bool hit = (max_range <= 0.0 || range <= max_range);
+        const Eigen::Vector3d end = (inverse_origin_transform_ * (hit ? point : Eigen::Vector3d(origin + (point - origin) * (max_range / range)))) * inv_cell_size_;
+        if (!KeyInRange((int64_t)std::floor(end.x()), (int64_t)std::floor(end.y()), (int64_t)std::floor(end.z())))
+        {
+            continue;
+        }
+        ray_ends_.push_back(end);
+        ray_hits_.push_back(hit ? 1 : 0);
+        box_lo = box_lo.cwiseMin(ray_ends_.back());
+        box_hi = box_hi.cwiseMax(ray_ends_.back());
+    }
+    for (int axis = 0; axis < 3; axis++)
+    {
+        ray_box_lo_[axis] = (int64_t)std::floor(box_lo(axis));
+        ray_box_size_[axis] = (int64_t)std::floor(box_hi(axis)) - ray_box_lo_[axis] + 1;
+    }
+    // Without max_range the box may be huge, the keys are then only deduplicated by sorting
+    const int64_t box_cells = ray_box_size_[0] * ray_box_size_[1] * ray_box_size_[2];
+    const size_t visited_words = (box_cells <= MAX_VISITED_CELLS) ? (size_t)((box_cells + 63) >> 6) : 0;
+    // The rays are split in contiguous ranges, the calling thread casting the first one
+    const size_t num_threads = std::min((size_t)num_threads_, std::max((size_t)1, ray_ends_.size()));
+    const size_t per_thread = (ray_ends_.size() + num_threads - 1) / num_threads;
+    for (size_t thread = 0; thread < num_threads; thread++)
+    {
+        thread_visited_[thread].resize(visited_words);
+    }
+    std::vector<std::thread> workers;
+    for (size_t thread = 1; thread < num_threads; thread++)
+    {
+        const size_t first_ray = std::min(ray_ends_.size(), thread * per_thread);
+        const size_t end_ray = std::min(ray_ends_.size(), first_ray + per_thread);
+        workers.push_back(std::thread(&OccupancyLogOddsMap::CastRays, this, std::cref(start), first_ray, end_ray, std::ref(thread_visited_[thread]), std::ref(thread_free_keys_[thread]), std::ref(thread_hit_keys_[thread])));
+    }
+    CastRays(start, 0, std::min(ray_ends_.size(), per_thread), thread_visited_[0], thread_free_keys_[0], thread_hit_keys_[0]);
+    for (size_t thread = 0; thread < workers.size(); thread++)
+    {
+        workers[thread].join();
+    }
+    for (size_t thread = num_threads; thread < thread_free_keys_.size(); thread++)
+    {
+        thread_free_keys_[thread].clear();
+        thread_hit_keys_[thread].clear();
+    }
+    MergeThreadKeys(thread_hit_keys_, hit_keys_);
+    MergeThreadKeys(thread_free_keys_, scratch_keys_);
+    free_keys_.clear();
+    std::set_difference(scratch_keys_.begin(), scratch_keys_.end(), hit_keys_.begin(), hit_keys_.end(), std::back_inserter(free_keys_));
+    // Applied on this thread: writing a cell may add a chunk to the grid
+    changed_chunk_keys_.clear();
+    for (size_t idx = 0; idx < free_keys_.size(); idx++)
+    {
+        UpdateCell(free_keys_[idx], miss_);
+    }
+    for (size_t idx = 0; idx < hit_keys_.size(); idx++)
+    {
+        UpdateCell(hit_keys_[idx], hit_);
+    }
+    SortUniqueKeys(changed_chunk_keys_);
+    changed_chunks.reserve(changed_chunk_keys_.size());
+    for (size_t idx = 0; idx < changed_chunk_keys_.size(); idx++)
+    {
+        int64_t x_chunk = 0;
+        int64_t y_chunk = 0;
+        int64_t z_chunk = 0;
+        UnpackKey(changed_chunk_keys_[idx], x_chunk, y_chunk, z_chunk);
+        changed_chunks.push_back(Eigen::Vector3i((int)x_chunk, (int)y_chunk, (int)z_chunk));
+    }
+}
+
+void OccupancyLogOddsMap::GetOccupancyBox(const int64_t lo[3], const int64_t hi[3], std::vector<uint8_t>& occupancy) const
+{
+    const int64_t size[3] = {hi[0] - lo[0], hi[1] - lo[1], hi[2] - lo[2]};
+    occupancy.assign(size[0] * size[1] * size[2], 0);
+    if (size[0] <= 0 || size[1] <= 0 || size[2] <= 0)
+    {
+        return;
+    }
+    int64_t chunk_lo[3], chunk_hi[3];
+    for (int axis = 0; axis < 3; axis++)
+    {
+        chunk_lo[axis] = GetChunkCoordinate(lo[axis]);
+        chunk_hi[axis] = GetChunkCoordinate(hi[axis] - 1);
+    }
+    for (int64_t x_chunk = chunk_lo[0]; x_chunk <= chunk_hi[0]; x_chunk++)
+        for (int64_t y_chunk = chunk_lo[1]; y_chunk <= chunk_hi[1]; y_chunk++)
+            for (int64_t z_chunk = chunk_lo[2]; z_chunk <= chunk_hi[2]; z_chunk++)
+            {
+                // Part of the chunk inside the box
+                const int64_t chunk[3] = {x_chunk, y_chunk, z_chunk};
+                int64_t cell_lo[3], cell_hi[3];
+                for (int axis = 0; axis < 3; axis++)
+                {
+                    cell_lo[axis] = std::max(lo[axis], chunk[axis] * chunk_size_);
+                    cell_hi[axis] = std::min(hi[axis], (chunk[axis] + 1) * chunk_size_);
+                }
+                const std::pair<const float&, VoxelGrid::FOUND_STATUS> probe = log_odds_.GetImmutableByIndex(cell_lo[0], cell_lo[1], cell_lo[2]);
+                if (probe.second == VoxelGrid::NOT_FOUND || (probe.second == VoxelGrid::FOUND_IN_CHUNK && probe.first <= occupied_))
+                {
+                    continue;
+                }
+                const bool whole_chunk = (probe.second == VoxelGrid::FOUND_IN_CHUNK);
+                for (int64_t x = cell_lo[0]; x < cell_hi[0]; x++)
+                    for (int64_t y = cell_lo[1]; y < cell_hi[1]; y++)
+                    {
+                        uint8_t* row = &occupancy[((x - lo[0]) * size[1] + (y - lo[1])) * size[2]];
+                        for (int64_t z = cell_lo[2]; z < cell_hi[2]; z++)
+                            row[z - lo[2]] = whole_chunk ? 1 : (IsOccupied(x, y, z) ? 1 : 0);
+                    }
+            }
+}
+
+void OccupancyLogOddsMap::GetOccupiedCells(const Eigen::Vector3d& lower, const Eigen::Vector3d& upper, std::vector<Eigen::Vector3d>& centers) const
+{
+    centers.clear();
+    if (!initialized_)
+    {
+        return;
+    }
+    int64_t lo[3], hi[3];
+    log_odds_.LocationToGridIndex(lower, lo[0], lo[1], lo[2]);
+    log_odds_.LocationToGridIndex(upper, hi[0], hi[1], hi[2]);
+    for (int axis = 0; axis < 3; axis++)
+    {
+        hi[axis]++;
+    }
+    std::vector<uint8_t> occupancy;
+    GetOccupancyBox(lo, hi, occupancy);
+    const int64_t size[3] = {hi[0] - lo[0], hi[1] - lo[1], hi[2] - lo[2]};
+    for (int64_t x = 0; x < size[0]; x++)
+        for (int64_t y = 0; y < size[1]; y++)
+            for (int64_t z = 0; z < size[2]; z++)
+                if (occupancy[(x * size[1] + y) * size[2] + z])
+                    centers.push_back(log_odds_.GridIndexToLocation(lo[0] + x, lo[1] + y, lo[2] + z));
+}
+
+bool OccupancyLogOddsMap::DilateChunksInto(const std::vector<Eigen::Vector3i>& chunks, const int64_t radius_xy, const int64_t radius_z, DynamicSpatialHashedCollisionMapGrid& grid, const COLLISION_CELL& occupied_cell, const COLLISION_CELL& free_cell) const
+{
+    if (!initialized_)
+    {
+        return false;
+    }
+    // Offset from the cells of the map to the cells of the grid
+    const Eigen::Affine3d& grid_transform = grid.GetOriginTransform();
+    const Eigen::Affine3d map_transform = log_odds_.GetOriginTransform();
+    const Eigen::Vector3d offset = (map_transform.translation() - grid_transform.translation()) * inv_cell_size_;
+    const Eigen::Vector3d rounded_offset(std::round(offset.x()), std::round(offset.y()), std::round(offset.z()));
+    if (std::fabs(grid.GetResolution() - cell_size_) > 1e-9 || !grid_transform.linear().isIdentity(1e-9) || !map_transform.linear().isIdentity(1e-9) || (offset - rounded_offset).cwiseAbs().maxCoeff() > 1e-6)
+    {
+        std::cerr << "Grid does not line up with the cells of the occupancy map" << std::endl;
+        return false;
+    }
+    const int64_t radius[3] = {radius_xy, radius_xy, radius_z};
+    const int64_t grid_offset[3] = {(int64_t)rounded_offset.x(), (int64_t)rounded_offset.y(), (int64_t)rounded_offset.z()};
+    // Box dilation, one axis at a time, of the cells around each chunk
+    std::vector<uint8_t> source, dilated_z, dilated_zy;
+    for (size_t idx = 0; idx < chunks.size(); idx++)
+    {
+        int64_t out_lo[3], out_hi[3], in_lo[3], in_hi[3], out_size[3], in_size[3];
+        for (int axis = 0; axis < 3; axis++)
+        {
+            out_lo[axis] = chunks[idx](axis) * chunk_size_ - radius[axis];
+            out_hi[axis] = (chunks[idx](axis) + 1) * chunk_size_ + radius[axis];
+            in_lo[axis] = out_lo[axis] - radius[axis];
+            in_hi[axis] = out_hi[axis] + radius[axis];
+            out_size[axis] = out_hi[axis] - out_lo[axis];
+            in_size[axis] = in_hi[axis] - in_lo[axis];
+        }
+        GetOccupancyBox(in_lo, in_hi, source);
+        dilated_z.assign(in_size[0] * in_size[1] * out_size[2], 0);
+        for (int64_t x = 0; x < in_size[0]; x++)
+            for (int64_t y = 0; y < in_size[1]; y++)
+                for (int64_t z = 0; z < out_size[2]; z++)
+                {
+                    const uint8_t* row = &source[(x * in_size[1] + y) * in_size[2] + z];
+                    uint8_t value = 0;
+                    for (int64_t k = 0; k <= 2 * radius[2] && value == 0; k++)
+                        value = row[k];
+                    dilated_z[(x * in_size[1] + y) * out_size[2] + z] = value;
+                }
+        dilated_zy.assign(in_size[0] * out_size[1] * out_size[2], 0);
+        for (int64_t x = 0; x < in_size[0]; x++)
+            for (int64_t y = 0; y < out_size[1]; y++)
+            {
+                uint8_t* out_row = &dilated_zy[(x * out_size[1] + y) * out_size[2]];
+                for (int64_t j = y; j <= y + 2 * radius[1]; j++)
+                {
+                    const uint8_t* in_row = &dilated_z[(x * in_size[1] + j) * out_size[2]];
+                    for (int64_t z = 0; z < out_size[2]; z++)
+                        out_row[z] |= in_row[z];
+                }
+            }
+        for (int64_t x = 0; x < out_size[0]; x++)
+            for (int64_t y = 0; y < out_size[1]; y++)
+                for (int64_t z = 0; z < out_size[2]; z++)
+                {
+                    uint8_t value = 0;
+                    for (int64_t i = x; i <= x + 2 * radius[0] && value == 0; i++)
+                        value = dilated_zy[(i * out_size[1] + y) * out_size[2] + z];
+                    grid.Set(out_lo[0] + x + grid_offset[0], out_lo[1] + y + grid_offset[1], out_lo[2] + z + grid_offset[2], value ? occupied_cell : free_cell);
+                }
+    }
+    return true;
+}
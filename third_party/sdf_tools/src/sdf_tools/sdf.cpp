@@ -1,5 +1,6 @@
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include <vector>
 #include <string>
 #include <sstream>
@@ -7,6 +8,7 @@
 #include <fstream>
 #include <stdexcept>
 #include <unordered_map>
+#include <algorithm>
 #include <zlib.h>
 #include <ros/ros.h>
 #include <arc_utilities/eigen_helpers_conversions.hpp>
@@ -16,35 +18,39 @@
 
 using namespace sdf_tools;
 
+const int SignedDistanceField::INTERPOLATION_BLOCK_SIZE;
+
 std::vector<uint8_t> SignedDistanceField::GetInternalBinaryRepresentation(const std::vector<float>& field_data)
 {
-    std::vector<uint8_t> raw_binary_data(field_data.size() * 4);
-    for (size_t field_index = 0, binary_index = 0; field_index < field_data.size(); field_index++, binary_index+=4)
+    // The floats are stored most-significant byte first, as FloatToBinary writes them
+    std::vector<uint8_t> raw_binary_data(field_data.size() * sizeof(float));
+    if (!field_data.empty())
     {
-        // Convert the float at the current index into 4 bytes and store them
-        float field_value = field_data[field_index];
-        std::vector<uint8_t> binary_value = FloatToBinary(field_value);
-        raw_binary_data[binary_index] = binary_value[0];
-        raw_binary_data[binary_index + 1] = binary_value[1];
-        raw_binary_data[binary_index + 2] = binary_value[2];
-        raw_binary_data[binary_index + 3] = binary_value[3];
+        memcpy(&raw_binary_data.front(), field_data.data(), raw_binary_data.size());
+        if (!arc_helpers::IsBigEndianHost())
+        {
+            arc_helpers::SwapBytesInWords(&raw_binary_data.front(), raw_binary_data.size(), sizeof(float));
+        }
     }
     return raw_binary_data;
 }
 
 std::vector<float> SignedDistanceField::UnpackFieldFromBinaryRepresentation(std::vector<uint8_t>& binary)
 {
-    if ((binary.size() % 4) != 0)
+    if ((binary.size() % sizeof(float)) != 0)
     {
         std::cerr << "Invalid binary representation - length is not a multiple of 4" << std::endl;
         return std::vector<float>();
     }
-    uint64_t data_size = binary.size() / 4;
+    uint64_t data_size = binary.size() / sizeof(float);
     std::vector<float> field_data(data_size);
-    for (size_t field_index = 0, binary_index = 0; field_index < field_data.size(); field_index++, binary_index+=4)
+    if (!field_data.empty())
     {
-        std::vector<uint8_t> binary_block{binary[binary_index], binary[binary_index + 1], binary[binary_index + 2], binary[binary_index + 3]};
-        field_data[field_index] = FloatFromBinary(binary_block);
+        memcpy(field_data.data(), &binary.front(), binary.size());
+        if (!arc_helpers::IsBigEndianHost())
+        {
+            arc_helpers::SwapItemBytes<float>(field_data.data(), data_size);
+        }
     }
     return field_data;
 }
@@ -97,6 +103,48 @@ bool SignedDistanceField::LoadFromFile(const std::string &filepath)
     }
 }
 
+bool SignedDistanceField::SaveToBinaryFile(const std::string& filepath) const
+{
+    BinaryMapHeader header = MakeBinaryMapHeader(BINARY_MAP_SIGNED_DISTANCE_FIELD, sizeof(float), distance_field_.GetNumXCells(), distance_field_.GetNumYCells(), distance_field_.GetNumZCells(), GetResolution(), distance_field_.GetOriginTransform(), frame_);
+    const float default_value = distance_field_.GetDefaultValue();
+    const float oob_value = distance_field_.GetOOBValue();
+    memcpy(header.default_value, &default_value, sizeof(float));
+    memcpy(header.oob_value, &oob_value, sizeof(float));
+    header.initialized = initialized_;
+    header.locked = locked_;
+    return WriteBinaryMapFile(filepath, header, distance_field_.GetRawData().data());
+}
+
+bool SignedDistanceField::LoadFromBinaryFile(const std::string& filepath)
+{
+    MappedBinaryMap mapped;
+    if (!mapped.Open(filepath, BINARY_MAP_SIGNED_DISTANCE_FIELD, sizeof(float)))
+    {
+        return false;
+    }
+    mapped.WillReadAll();
+    const BinaryMapHeader& header = mapped.GetHeader();
+    float default_value = 0.0;
+    float oob_value = 0.0;
+    memcpy(&default_value, header.default_value, sizeof(float));
+    memcpy(&oob_value, header.oob_value, sizeof(float));
+    try
+    {
+        VoxelGrid::VoxelGrid<float> new_field(mapped.GetOriginTransform(), header.cell_size, header.num_x_cells, header.num_y_cells, header.num_z_cells, default_value, oob_value);
+        memcpy(new_field.GetMutableRawData().data(), mapped.GetData(), header.data_bytes);
+        distance_field_ = std::move(new_field);
+    }
+    catch (...)
+    {
+        std::cerr << "Unable to build the SDF stored in " << filepath << std::endl;
+        return false;
+    }
+    frame_ = mapped.GetFrame();
+    initialized_ = (header.initialized != 0);
+    locked_ = (header.locked != 0);
+    return true;
+}
+
 sdf_tools::SDF SignedDistanceField::GetMessageRepresentation()
 {
     sdf_tools::SDF message_rep;
@@ -437,3 +485,121 @@ VoxelGrid::VoxelGrid<Eigen::Vector3d> SignedDistanceField::ComputeLocalMaximaMap
     }
     return watershed_map;
 }
+
+size_t SignedDistanceField::InterpolateLocations(const Eigen::Matrix3Xd& locations, Eigen::VectorXd& distances, Eigen::Matrix3Xd* gradients) const
+{
+    const int64_t num_locations = locations.cols();
+    distances.resize(num_locations);
+    if (gradients != NULL)
+    {
+        gradients->resize(3, num_locations);
+    }
+    const int64_t num_cells[3] = {GetNumXCells(), GetNumYCells(), GetNumZCells()};
+    // A single cell along an axis is its own upper neighbor
+    const int64_t x_step = (num_cells[0] > 1) ? num_cells[1] * num_cells[2] : 0;
+    const int64_t y_step = (num_cells[1] > 1) ? num_cells[2] : 0;
+    const int64_t z_step = (num_cells[2] > 1) ? 1 : 0;
+    const float* data = distance_field_.GetRawData().data();
+    const double inv_resolution = 1.0 / GetResolution();
+    const double oob_value = (double)GetOOBValue();
+    // Locations to cells of the grid frame, and gradients per cell back to the frame of locations
+    const Eigen::Matrix3d to_cells = GetInverseOriginTransform().linear() * inv_resolution;
+    const Eigen::Vector3d to_cells_offset = GetInverseOriginTransform().translation() * inv_resolution;
+    const Eigen::Matrix3d from_cells = GetOriginTransform().linear() * inv_resolution;
+    // Arrays of the block, one row per value so that the interpolation loop reads and writes
+    // contiguous memory
+    Eigen::Matrix<double, 3, Eigen::Dynamic, Eigen::ColMajor, 3, INTERPOLATION_BLOCK_SIZE> cell_coordinates;
+    Eigen::Matrix<double, 8, INTERPOLATION_BLOCK_SIZE, Eigen::RowMajor> corners;
+    Eigen::Matrix<double, 3, INTERPOLATION_BLOCK_SIZE, Eigen::RowMajor> fraction;
+    Eigen::Matrix<double, 3, INTERPOLATION_BLOCK_SIZE, Eigen::RowMajor> cell_gradients;
+    double block_distances[INTERPOLATION_BLOCK_SIZE];
+    uint8_t inside[INTERPOLATION_BLOCK_SIZE];
+    size_t num_inside = 0;
+    for (int64_t first = 0; first < num_locations; first += INTERPOLATION_BLOCK_SIZE)
+    {
+        const int64_t count = std::min((int64_t)INTERPOLATION_BLOCK_SIZE, num_locations - first);
+        cell_coordinates.noalias() = to_cells * locations.middleCols(first, count);
+        cell_coordinates.colwise() += to_cells_offset;
+        // Gather the corners of each location, the only scalar loop
+        for (int64_t idx = 0; idx < count; idx++)
+        {
+            inside[idx] = (cell_coordinates(0, idx) >= 0.0 && cell_coordinates(1, idx) >= 0.0 && cell_coordinates(2, idx) >= 0.0 && cell_coordinates(0, idx) < (double)num_cells[0] && cell_coordinates(1, idx) < (double)num_cells[1] && cell_coordinates(2, idx) < (double)num_cells[2]) ? 1 : 0;
+            if (!inside[idx])
+            {
+                corners.col(idx).setZero();
+                fraction.col(idx).setZero();
+                continue;
+            }
+            num_inside++;
+            int64_t low_index[3];
+            for (int axis = 0; axis < 3; axis++)
+            {
+                const double clamped = std::min(std::max(cell_coordinates(axis, idx) - 0.5, 0.0), (double)(num_cells[axis] - 1));
+                low_index[axis] = std::min((int64_t)clamped, std::max(num_cells[axis] - 2, (int64_t)0));
+                fraction(axis, idx) = clamped - (double)low_index[axis];
+            }
+            const float* low_cell = data + (low_index[0] * num_cells[1] * num_cells[2]) + (low_index[1] * num_cells[2]) + low_index[2];
+            corners(0, idx) = low_cell[0];
+            corners(1, idx) = low_cell[z_step];
+            corners(2, idx) = low_cell[y_step];
+            corners(3, idx) = low_cell[y_step + z_step];
+            corners(4, idx) = low_cell[x_step];
+            corners(5, idx) = low_cell[x_step + z_step];
+            corners(6, idx) = low_cell[x_step + y_step];
+            corners(7, idx) = low_cell[x_step + y_step + z_step];
+        }
+        // Interpolate as InterpolateCellCoordinates does, branch free so that it is vectorized
+        for (int64_t idx = 0; idx < count; idx++)
+        {
+            const double fx = fraction(0, idx);
+            const double fy = fraction(1, idx);
+            const double fz = fraction(2, idx);
+            const double c000 = corners(0, idx);
+            const double c001 = corners(1, idx);
+            const double c010 = corners(2, idx);
+            const double c011 = corners(3, idx);
+            const double c100 = corners(4, idx);
+            const double c101 = corners(5, idx);
+            const double c110 = corners(6, idx);
+            const double c111 = corners(7, idx);
+            const double c00 = c000 + (c001 - c000) * fz;
+            const double c01 = c010 + (c011 - c010) * fz;
+            const double c10 = c100 + (c101 - c100) * fz;
+            const double c11 = c110 + (c111 - c110) * fz;
+            const double c0 = c00 + (c01 - c00) * fy;
+            const double c1 = c10 + (c11 - c10) * fy;
+            const double dz0 = (c001 - c000) + ((c011 - c010) - (c001 - c000)) * fy;
+            const double dz1 = (c101 - c100) + ((c111 - c110) - (c101 - c100)) * fy;
+            cell_gradients(0, idx) = c1 - c0;
+            cell_gradients(1, idx) = (c01 - c00) + ((c11 - c10) - (c01 - c00)) * fx;
+            cell_gradients(2, idx) = dz0 + (dz1 - dz0) * fx;
+            block_distances[idx] = c0 + (c1 - c0) * fx;
+        }
+        for (int64_t idx = 0; idx < count; idx++)
+        {
+            distances(first + idx) = inside[idx] ? block_distances[idx] : oob_value;
+        }
+        if (gradients != NULL)
+        {
+            gradients->middleCols(first, count).noalias() = from_cells * cell_gradients.leftCols(count);
+            for (int64_t idx = 0; idx < count; idx++)
+            {
+                if (!inside[idx])
+                {
+                    gradients->col(first + idx).setZero();
+                }
+            }
+        }
+    }
+    return num_inside;
+}
+
+size_t SignedDistanceField::GetInterpolatedDistancesAndGradients(const Eigen::Matrix3Xd& locations, Eigen::VectorXd& distances, Eigen::Matrix3Xd& gradients) const
+{
+    return InterpolateLocations(locations, distances, &gradients);
+}
+
+size_t SignedDistanceField::GetInterpolatedDistances(const Eigen::Matrix3Xd& locations, Eigen::VectorXd& distances) const
+{
+    return InterpolateLocations(locations, distances, NULL);
+}
@@ -10,6 +10,8 @@
 #include <ros/ros.h>
 #include <list>
 #include <unordered_map>
+#include <thread>
+#include <algorithm>
 #include <sdf_tools/tagged_object_collision_map.hpp>
 #include <arc_utilities/zlib_helpers.hpp>
 #include <arc_utilities/eigen_helpers.hpp>
@@ -69,12 +71,11 @@ bool TaggedObjectCollisionMapGrid::LoadFromFile(const std::string& filepath)
 
 std::vector<uint8_t> TaggedObjectCollisionMapGrid::PackBinaryRepresentation(const std::vector<TAGGED_OBJECT_COLLISION_CELL>& raw) const
 {
+    // The cells are stored in host byte order, as TaggedObjectCollisionCellToBinary writes them
     std::vector<uint8_t> packed(raw.size() * sizeof(TAGGED_OBJECT_COLLISION_CELL));
-    for (size_t field_idx = 0, binary_index = 0; field_idx < raw.size(); field_idx++, binary_index+=sizeof(TAGGED_OBJECT_COLLISION_CELL))
+    if (!raw.empty())
     {
-        const TAGGED_OBJECT_COLLISION_CELL& raw_cell = raw[field_idx];
-        std::vector<uint8_t> packed_cell = TaggedObjectCollisionCellToBinary(raw_cell);
-        memcpy(&packed[binary_index], &packed_cell.front(), sizeof(TAGGED_OBJECT_COLLISION_CELL));
+        memcpy(&packed.front(), raw.data(), packed.size());
     }
     return packed;
 }
@@ -88,11 +89,9 @@ std::vector<TAGGED_OBJECT_COLLISION_CELL> TaggedObjectCollisionMapGrid::UnpackBi
     }
     uint64_t data_size = packed.size() / sizeof(TAGGED_OBJECT_COLLISION_CELL);
     std::vector<TAGGED_OBJECT_COLLISION_CELL> unpacked(data_size);
-    for (size_t field_idx = 0, binary_index = 0; field_idx < unpacked.size(); field_idx++, binary_index+=sizeof(TAGGED_OBJECT_COLLISION_CELL))
+    if (!unpacked.empty())
     {
-        std::vector<uint8_t> binary_block(sizeof(TAGGED_OBJECT_COLLISION_CELL));
-        memcpy(&binary_block.front(), &packed[binary_index], sizeof(TAGGED_OBJECT_COLLISION_CELL));
-        unpacked[field_idx] = TaggedObjectCollisionCellFromBinary(binary_block);
+        memcpy(unpacked.data(), &packed.front(), packed.size());
     }
     return unpacked;
 }
@@ -604,172 +603,210 @@ visualization_msgs::Marker TaggedObjectCollisionMapGrid::ExportSurfaceForDisplay
     return display_rep;
 }
 
-VoxelGrid::VoxelGrid<std::vector<uint32_t>> TaggedObjectCollisionMapGrid::ComputeConvexRegions(const double max_check_radius) const
+std::vector<std::vector<VoxelGrid::GRID_INDEX>> TaggedObjectCollisionMapGrid::ComputeConvexSegments(const double max_check_radius, const uint32_t num_threads) const
 {
-    VoxelGrid::VoxelGrid<std::vector<uint32_t>> convex_region_grid(GetOriginTransform(), GetResolution(), GetXSize(), GetYSize(), GetZSize(), std::vector<uint32_t>());
-    uint32_t current_convex_region = 0;
+    // Occupancy bitmap in the data order of the grid, the line-of-sight checks only touch this
+    const int64_t num_cells = GetNumXCells() * GetNumYCells() * GetNumZCells();
+    std::vector<uint64_t> occupancy_bits((size_t)((num_cells + 63) / 64), 0);
     for (int64_t x_index = 0; x_index < GetNumXCells(); x_index++)
     {
         for (int64_t y_index = 0; y_index < GetNumYCells(); y_index++)
         {
             for (int64_t z_index = 0; z_index < GetNumZCells(); z_index++)
             {
-                // Check if cell is empty
-                if (GetImmutable(x_index, y_index, z_index).first.occupancy < 0.5)
+                if (GetImmutable(x_index, y_index, z_index).first.occupancy >= 0.5)
                 {
-                    // Check if we've already marked it once
-                    const std::vector<uint32_t>& current_cell_regions = convex_region_grid.GetImmutable(x_index, y_index, z_index).first;
-                    if (current_cell_regions.empty())
-                    {
-                        current_convex_region++;
-                        std::cout << "Marking convex region " << current_convex_region << std::endl;
-                        GrowConvexRegion(VoxelGrid::GRID_INDEX(x_index, y_index, z_index), convex_region_grid, max_check_radius, current_convex_region);
-                    }
+                    SetOccupancyBit(occupancy_bits, GetOccupancyBitIndex(x_index, y_index, z_index));
                 }
             }
         }
     }
-    std::cout << "Marked " << current_convex_region << " convex regions" << std::endl;
-    return convex_region_grid;
-}
-
-std::vector<VoxelGrid::GRID_INDEX> TaggedObjectCollisionMapGrid::CheckIfConvex(const VoxelGrid::GRID_INDEX& candidate_index, std::unordered_map<VoxelGrid::GRID_INDEX, int8_t>& explored_indices, const VoxelGrid::VoxelGrid<std::vector<uint32_t>>& region_grid, const uint32_t current_convex_region) const
-{
-    std::vector<VoxelGrid::GRID_INDEX> convex_indices;
-    for (auto indices_itr = explored_indices.begin(); indices_itr != explored_indices.end(); ++indices_itr)
+    // Seed in parallel over slabs of x. Each thread sweeps its slab and grows a region from every free cell
+    // that none of its own regions cover yet (regions may extend past the slab, and may overlap)
+    uint32_t num_slabs = (num_threads > 0) ? num_threads : std::max(std::thread::hardware_concurrency(), 1u);
+    num_slabs = (uint32_t)std::max(std::min((int64_t)num_slabs, GetNumXCells()), (int64_t)1);
+    std::vector<std::vector<std::vector<VoxelGrid::GRID_INDEX>>> slab_regions(num_slabs);
+    auto seed_slab = [&] (const uint32_t slab)
     {
-        const VoxelGrid::GRID_INDEX& other_index = indices_itr->first;
-        const int8_t& other_status = indices_itr->second;
-        // We only care about indices that are already part of the convex set
-        if (other_status == 1)
+        const int64_t x_begin = (GetNumXCells() * slab) / num_slabs;
+        const int64_t x_end = (GetNumXCells() * (slab + 1)) / num_slabs;
+        std::vector<uint64_t> covered_bits(occupancy_bits.size(), 0);
+        std::vector<int8_t> explored_indices;
+        for (int64_t x_index = x_begin; x_index < x_end; x_index++)
         {
-            // Walk from first index to second index. If any intervening cells are filled, return false
-            const Eigen::Vector3d start_location = EigenHelpers::StdVectorDoubleToEigenVector3d(GridIndexToLocation(other_index.x, other_index.y, other_index.z));
-            const Eigen::Vector3d end_location = EigenHelpers::StdVectorDoubleToEigenVector3d(GridIndexToLocation(candidate_index.x, candidate_index.y, candidate_index.z));
-            double distance = (end_location - start_location).norm();
-            uint32_t num_steps = (uint32_t)ceil(distance / (GetResolution() * 0.5));
-            for (uint32_t step_num = 0; step_num <= num_steps; step_num++)
+            for (int64_t y_index = 0; y_index < GetNumYCells(); y_index++)
             {
-                const double ratio = (double)step_num / (double)num_steps;
-                const Eigen::Vector3d interpolated_location = EigenHelpers::Interpolate(start_location, end_location, ratio);
-                std::vector<int64_t> raw_interpolated_index = region_grid.LocationToGridIndex3d(interpolated_location);
-                assert(raw_interpolated_index.size() == 3);
-                VoxelGrid::GRID_INDEX interpolated_index(raw_interpolated_index[0], raw_interpolated_index[1], raw_interpolated_index[2]);
-                // Grab the cell at that location
-                const TAGGED_OBJECT_COLLISION_CELL& intermediate_cell = GetImmutable(interpolated_index).first;
-                // Check for collision
-                if (intermediate_cell.occupancy >= 0.5)
-                {
-                    return convex_indices;
-                }
-                // Check if we've already explored it
-                if (explored_indices[interpolated_index] == 1)
+                for (int64_t z_index = 0; z_index < GetNumZCells(); z_index++)
                 {
-                    // Great
-                    ;
-                }
-                else if (explored_indices[interpolated_index] == -1)
-                {
-                    // We've already skipped it deliberately
-                    return convex_indices;
-                }
-                else
-                {
-                    if (interpolated_index == candidate_index)
+                    const int64_t bit_index = GetOccupancyBitIndex(x_index, y_index, z_index);
+                    if (GetOccupancyBit(occupancy_bits, bit_index) || GetOccupancyBit(covered_bits, bit_index))
                     {
-                        // Great
-                        ;
+                        continue;
                     }
-                    else
+                    std::vector<VoxelGrid::GRID_INDEX> region = GrowConvexRegion(VoxelGrid::GRID_INDEX(x_index, y_index, z_index), occupancy_bits, max_check_radius, explored_indices);
+                    for (size_t idx = 0; idx < region.size(); idx++)
                     {
-                        // We have no idea, let's see if it is convex with our already-explored indices
-                        // Temporarily, we mark ourselves as successful
-                        explored_indices[candidate_index] = 1;
-                        // Call ourselves with the intermediate location
-                        std::vector<VoxelGrid::GRID_INDEX> intermediate_convex_indices = CheckIfConvex(interpolated_index, explored_indices, region_grid, current_convex_region);
-                        // Unmark ourselves since we don't really know
-                        explored_indices[candidate_index] = 0;
-                        // Save the intermediate index for addition
-                        convex_indices.insert(convex_indices.end(), intermediate_convex_indices.begin(), intermediate_convex_indices.end());
-                        // Check if the intermediate index is convex
-                        auto is_convex = std::find(convex_indices.begin(), convex_indices.end(), interpolated_index);
-                        if (is_convex == convex_indices.end())
-                        {
-                            // If not, we're done
-                            return convex_indices;
-                        }
+                        SetOccupancyBit(covered_bits, GetOccupancyBitIndex(region[idx].x, region[idx].y, region[idx].z));
                     }
+                    slab_regions[slab].push_back(std::move(region));
                 }
             }
         }
+    };
+    std::vector<std::thread> workers;
+    for (uint32_t slab = 1; slab < num_slabs; slab++)
+    {
+        workers.push_back(std::thread(seed_slab, slab));
     }
-    // If all indices were reachable, we are part of the convex set
-    convex_indices.push_back(candidate_index);
-    explored_indices[candidate_index] = 1;
-    return convex_indices;
+    seed_slab(0);
+    for (size_t idx = 0; idx < workers.size(); idx++)
+    {
+        workers[idx].join();
+    }
+    // Regions are numbered slab by slab, in the order they were seeded
+    std::vector<std::vector<VoxelGrid::GRID_INDEX>> convex_segments;
+    for (uint32_t slab = 0; slab < num_slabs; slab++)
+    {
+        std::move(slab_regions[slab].begin(), slab_regions[slab].end(), std::back_inserter(convex_segments));
+    }
+    return convex_segments;
+}
+
+VoxelGrid::VoxelGrid<std::vector<uint32_t>> TaggedObjectCollisionMapGrid::ComputeConvexRegions(const double max_check_radius) const
+{
+    VoxelGrid::VoxelGrid<std::vector<uint32_t>> convex_region_grid(GetOriginTransform(), GetResolution(), GetXSize(), GetYSize(), GetZSize(), std::vector<uint32_t>());
+    const std::vector<std::vector<VoxelGrid::GRID_INDEX>> convex_segments = ComputeConvexSegments(max_check_radius);
+    for (size_t segment = 0; segment < convex_segments.size(); segment++)
+    {
+        for (size_t idx = 0; idx < convex_segments[segment].size(); idx++)
+        {
+            convex_region_grid.GetMutable(convex_segments[segment][idx]).first.push_back((uint32_t)(segment + 1));
+        }
+    }
+    return convex_region_grid;
 }
 
-void TaggedObjectCollisionMapGrid::GrowConvexRegion(const VoxelGrid::GRID_INDEX& start_index, VoxelGrid::VoxelGrid<std::vector<uint32_t>>& region_grid, const double max_check_radius, const uint32_t current_convex_region) const
+bool TaggedObjectCollisionMapGrid::IsLineOfSightFree(const std::vector<uint64_t>& occupancy_bits, const VoxelGrid::GRID_INDEX& start_index, const VoxelGrid::GRID_INDEX& end_index) const
 {
-    // Mark the region of the start index
-    region_grid.GetMutable(start_index).first.push_back(current_convex_region);
-    std::cout << "Added " << PrettyPrint::PrettyPrint(start_index) << " to region " << current_convex_region << std::endl;
-    const Eigen::Vector3d start_location = EigenHelpers::StdVectorDoubleToEigenVector3d(GridIndexToLocation(start_index.x, start_index.y, start_index.z));
-    std::list<VoxelGrid::GRID_INDEX> working_queue;
-    std::unordered_map<VoxelGrid::GRID_INDEX, int8_t> queued_hashtable;
-    working_queue.push_back(start_index);
-    queued_hashtable[start_index] = 1;
-    while (working_queue.size() > 0)
+    // 3D DDA between the cell centers. Along axis i the segment crosses its k-th cell boundary at
+    // t = (2k + 1) / (2 n_i), so the next axis to step is found by comparing these fractions exactly.
+    // Where the segment goes through an edge or a corner, every cell around it is checked
+    const int64_t n[3] = {std::abs(end_index.x - start_index.x), std::abs(end_index.y - start_index.y), std::abs(end_index.z - start_index.z)};
+    const int64_t step[3] = {(end_index.x > start_index.x) ? 1 : -1, (end_index.y > start_index.y) ? 1 : -1, (end_index.z > start_index.z) ? 1 : -1};
+    int64_t k[3] = {0, 0, 0};
+    int64_t current[3] = {start_index.x, start_index.y, start_index.z};
+    while (k[0] < n[0] || k[1] < n[1] || k[2] < n[2])
     {
-        // Get the top of the working queue
-        VoxelGrid::GRID_INDEX current_index = working_queue.front();
-        // Remove from the queue
-        working_queue.pop_front();
-        // See if we can add the neighbors
-        std::vector<VoxelGrid::GRID_INDEX> potential_neighbors(6);
-        potential_neighbors[0] = VoxelGrid::GRID_INDEX(current_index.x - 1, current_index.y, current_index.z);
-        potential_neighbors[1] = VoxelGrid::GRID_INDEX(current_index.x + 1, current_index.y, current_index.z);
-        potential_neighbors[2] = VoxelGrid::GRID_INDEX(current_index.x, current_index.y - 1, current_index.z);
-        potential_neighbors[3] = VoxelGrid::GRID_INDEX(current_index.x, current_index.y + 1, current_index.z);
-        potential_neighbors[4] = VoxelGrid::GRID_INDEX(current_index.x, current_index.y, current_index.z - 1);
-        potential_neighbors[5] = VoxelGrid::GRID_INDEX(current_index.x, current_index.y, current_index.z + 1);
-        for (size_t idx = 0; idx < potential_neighbors.size(); idx++)
+        // Axes whose next boundary comes first, several at an edge or a corner
+        int axis = -1;
+        int mask = 0;
+        for (int candidate_axis = 0; candidate_axis < 3; candidate_axis++)
+        {
+            if (k[candidate_axis] == n[candidate_axis])
+            {
+                continue;
+            }
+            if (axis < 0 || ((2 * k[candidate_axis] + 1) * n[axis]) < ((2 * k[axis] + 1) * n[candidate_axis]))
+            {
+                axis = candidate_axis;
+                mask = 1 << candidate_axis;
+            }
+            else if (((2 * k[candidate_axis] + 1) * n[axis]) == ((2 * k[axis] + 1) * n[candidate_axis]))
+            {
+                mask |= 1 << candidate_axis;
+            }
+        }
+        // Every cell reached by stepping a non-empty subset of those axes
+        for (int sub = mask; sub > 0; sub = (sub - 1) & mask)
+        {
+            const int64_t x_index = current[0] + (((sub & 1) != 0) ? step[0] : 0);
+            const int64_t y_index = current[1] + (((sub & 2) != 0) ? step[1] : 0);
+            const int64_t z_index = current[2] + (((sub & 4) != 0) ? step[2] : 0);
+            if (GetOccupancyBit(occupancy_bits, GetOccupancyBitIndex(x_index, y_index, z_index)))
+            {
+                return false;
+            }
+        }
+        for (int step_axis = 0; step_axis < 3; step_axis++)
+        {
+            if ((mask >> step_axis) & 1)
+            {
+                current[step_axis] += step[step_axis];
+                k[step_axis]++;
+            }
+        }
+    }
+    return true;
+}
+
+std::vector<VoxelGrid::GRID_INDEX> TaggedObjectCollisionMapGrid::GrowConvexRegion(const VoxelGrid::GRID_INDEX& start_index, const std::vector<uint64_t>& occupancy_bits, const double max_check_radius, std::vector<int8_t>& explored_indices) const
+{
+    // The region stays within the check radius of the start, so explored cells are tracked in the box around it
+    // (1 = in the region, -1 = rejected, which is final since the region only grows)
+    const int64_t max_num_cells = std::max(GetNumXCells(), std::max(GetNumYCells(), GetNumZCells()));
+    const int64_t radius_cells = (int64_t)std::min(std::ceil(max_check_radius / GetResolution()), (double)max_num_cells);
+    const int64_t min_x = std::max(start_index.x - radius_cells, (int64_t)0);
+    const int64_t min_y = std::max(start_index.y - radius_cells, (int64_t)0);
+    const int64_t min_z = std::max(start_index.z - radius_cells, (int64_t)0);
+    const int64_t box_y = std::min(start_index.y + radius_cells, GetNumYCells() - 1) - min_y + 1;
+    const int64_t box_z = std::min(start_index.z + radius_cells, GetNumZCells() - 1) - min_z + 1;
+    const int64_t box_x = std::min(start_index.x + radius_cells, GetNumXCells() - 1) - min_x + 1;
+    explored_indices.assign((size_t)(box_x * box_y * box_z), 0);
+    const double max_distance_squared = (max_check_radius * max_check_radius) / (GetResolution() * GetResolution());
+    // Breadth-first growth, the region itself is the queue
+    std::vector<VoxelGrid::GRID_INDEX> region;
+    region.push_back(start_index);
+    explored_indices[(size_t)((((start_index.x - min_x) * box_y) + (start_index.y - min_y)) * box_z + (start_index.z - min_z))] = 1;
+    for (size_t next = 0; next < region.size(); next++)
+    {
+        const VoxelGrid::GRID_INDEX current_index = region[next];
+        const VoxelGrid::GRID_INDEX potential_neighbors[6] = {VoxelGrid::GRID_INDEX(current_index.x - 1, current_index.y, current_index.z),
+                                                              VoxelGrid::GRID_INDEX(current_index.x + 1, current_index.y, current_index.z),
+                                                              VoxelGrid::GRID_INDEX(current_index.x, current_index.y - 1, current_index.z),
+                                                              VoxelGrid::GRID_INDEX(current_index.x, current_index.y + 1, current_index.z),
+                                                              VoxelGrid::GRID_INDEX(current_index.x, current_index.y, current_index.z - 1),
+                                                              VoxelGrid::GRID_INDEX(current_index.x, current_index.y, current_index.z + 1)};
+        for (size_t idx = 0; idx < 6; idx++)
         {
             const VoxelGrid::GRID_INDEX& candidate_neighbor = potential_neighbors[idx];
-            // Make sure the candidate neighbor is in range
-            if ((candidate_neighbor.x >= 0) && (candidate_neighbor.y >= 0) && (candidate_neighbor.z >= 0) && (candidate_neighbor.x < GetNumXCells()) && (candidate_neighbor.y < GetNumYCells()) && (candidate_neighbor.z < GetNumZCells()))
+            const int64_t local_x = candidate_neighbor.x - min_x;
+            const int64_t local_y = candidate_neighbor.y - min_y;
+            const int64_t local_z = candidate_neighbor.z - min_z;
+            if (local_x < 0 || local_y < 0 || local_z < 0 || local_x >= box_x || local_y >= box_y || local_z >= box_z)
             {
-                // Make sure it's within the check radius
-                const Eigen::Vector3d current_location = EigenHelpers::StdVectorDoubleToEigenVector3d(GridIndexToLocation(candidate_neighbor.x, candidate_neighbor.y, candidate_neighbor.z));
-                double distance = (current_location - start_location).norm();
-                if (distance <= max_check_radius)
-                {
-                    // Make sure the candidate neighbor is empty
-                    if (GetImmutable(candidate_neighbor).first.occupancy < 0.5)
-                    {
-                        // Make sure we haven't already checked
-                        if (queued_hashtable[candidate_neighbor] == 0)
-                        {
-                            // Now, let's check if the current index forms a convex set with the indices marked already
-                            std::vector<VoxelGrid::GRID_INDEX> convex_indices = CheckIfConvex(candidate_neighbor, queued_hashtable, region_grid, current_convex_region);
-                            // Set this to false. If it really is convex, this will get changed in the next loop
-                            queued_hashtable[candidate_neighbor] = -1;
-                            // Add the new convex indices
-                            for (size_t cdx = 0; cdx < convex_indices.size(); cdx++)
-                            {
-                                const VoxelGrid::GRID_INDEX& convex_index = convex_indices[cdx];
-                                // Add to the queue
-                                working_queue.push_back(convex_index);
-                                queued_hashtable[convex_index] = 1;
-                                // Mark it
-                                region_grid.GetMutable(convex_index).first.push_back(current_convex_region);
-                                std::cout << "Added " << PrettyPrint::PrettyPrint(convex_index) << " to region " << current_convex_region << std::endl;
-                            }
-                        }
-                    }
-                }
+                continue;
+            }
+            int8_t& status = explored_indices[(size_t)(((local_x * box_y) + local_y) * box_z + local_z)];
+            if (status != 0)
+            {
+                continue;
+            }
+            status = -1;
+            // Make sure it's within the check radius and empty
+            const int64_t dx = candidate_neighbor.x - start_index.x;
+            const int64_t dy = candidate_neighbor.y - start_index.y;
+            const int64_t dz = candidate_neighbor.z - start_index.z;
+            if ((double)((dx * dx) + (dy * dy) + (dz * dz)) > max_distance_squared)
+            {
+                continue;
+            }
+            if (GetOccupancyBit(occupancy_bits, GetOccupancyBitIndex(candidate_neighbor.x, candidate_neighbor.y, candidate_neighbor.z)))
+            {
+                continue;
+            }
+            // The candidate joins if it can see every cell of the region
+            bool convex = true;
+            for (size_t member = 0; member < region.size() && convex; member++)
+            {
+                convex = IsLineOfSightFree(occupancy_bits, region[member], candidate_neighbor);
+            }
+            if (convex)
+            {
+                status = 1;
+                region.push_back(candidate_neighbor);
             }
         }
     }
+    return region;
 }
 
@@ -0,0 +1,43 @@
+#include <stdlib.h>
+#include <stdint.h>
+#include <atomic>
+#include <sdf_tools/dynamic_spatial_hashed_collision_map.hpp>
+#include <sdf_tools/versioned_collision_map.hpp>
+
+using namespace sdf_tools;
+
+const int VersionedCollisionMap::NUM_BUFFERS;
+
+VersionedCollisionMap::VersionedCollisionMap(const DynamicSpatialHashedCollisionMapGrid& map) : writable_(map), current_buffer_(0)
+{
+    buffers_[0].map = writable_;
+    buffers_[0].version = writable_.GetEpoch();
+    writable_.AdvanceEpoch();
+}
+
+bool VersionedCollisionMap::Publish()
+{
+    // A buffer that is not current can only gain readers that back off at once, so one found
+    // without readers stays ours until it is made current
+    const int current = current_buffer_.load();
+    int target = -1;
+    for (int offset = 1; offset < NUM_BUFFERS; offset++)
+    {
+        const int buffer = (current + offset) % NUM_BUFFERS;
+        if (buffers_[buffer].readers.load() == 0)
+        {
+            target = buffer;
+            break;
+        }
+    }
+    if (target < 0)
+    {
+        return false;
+    }
+    MAP_BUFFER& buffer = buffers_[target];
+    buffer.map.UpdateFrom(writable_, buffer.version);
+    buffer.version = writable_.GetEpoch();
+    writable_.AdvanceEpoch();
+    current_buffer_.store(target);
+    return true;
+}
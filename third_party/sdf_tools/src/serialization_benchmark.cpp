@@ -0,0 +1,80 @@
+/* Round-trip throughput of VoxelGrid::Serialize/Deserialize for COLLISION_CELL and float grids:
+   the per-cell path (the value serializers, called through a std::function for every cell)
+   against the block path of trivially copyable cells, which takes no value serializer. Both
+   round trips must give back the cells of the grid.
+
+   Usage: ./serialization_benchmark [cells per side] [repetitions] */
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <random>
+#include <chrono>
+#include <arc_utilities/arc_helpers.hpp>
+#include <arc_utilities/voxel_grid.hpp>
+#include <sdf_tools/collision_map.hpp>
+
+template <class F> double timeIt(F f, unsigned int reps)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (unsigned int r = 0; r < reps; ++r)
+        f();
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double>(end - start).count();
+}
+
+template<typename T>
+bool benchmark(const std::string& name, const VoxelGrid::VoxelGrid<T>& grid, const unsigned int reps)
+{
+    const std::function<uint64_t(const T&, std::vector<uint8_t>&)> cell_serializer = arc_helpers::SerializeFixedSizePOD<T>;
+    const std::function<std::pair<T, uint64_t>(const std::vector<uint8_t>&, const uint64_t)> cell_deserializer = arc_helpers::DeserializeFixedSizePOD<T>;
+
+    std::vector<uint8_t> cell_buffer, block_buffer;
+    VoxelGrid::VoxelGrid<T> cell_grid, block_grid;
+    const double t_cell = timeIt([&]() {
+        cell_buffer.clear();
+        VoxelGrid::VoxelGrid<T>::Serialize(grid, cell_buffer, cell_serializer);
+        cell_grid = VoxelGrid::VoxelGrid<T>::Deserialize(cell_buffer, 0, cell_deserializer).first;
+    }, reps);
+    const double t_block = timeIt([&]() {
+        block_buffer.clear();
+        VoxelGrid::VoxelGrid<T>::Serialize(grid, block_buffer);
+        block_grid = VoxelGrid::VoxelGrid<T>::Deserialize(block_buffer, 0).first;
+    }, reps);
+
+    const std::vector<T>& cells = grid.GetRawData();
+    const bool ok = (cell_grid.GetRawData().size() == cells.size()) && (block_grid.GetRawData().size() == cells.size())
+                    && memcmp(cell_grid.GetRawData().data(), cells.data(), cells.size() * sizeof(T)) == 0
+                    && memcmp(block_grid.GetRawData().data(), cells.data(), cells.size() * sizeof(T)) == 0;
+    const double megabytes = double(block_buffer.size()) * reps / 1048576.0;
+    std::cout << std::fixed << std::setprecision(1)
+              << name << ": " << cells.size() << " cells, " << block_buffer.size() / 1048576.0 << " MB, " << reps << " round trips\n"
+              << "\tper cell: " << megabytes / t_cell << " MB/s\n"
+              << "\tblock:    " << megabytes / t_block << " MB/s\n"
+              << "\tround trips match the grid: " << (ok ? "yes" : "NO") << '\n';
+    return ok;
+}
+
+int main(int argc, char** argv)
+{
+    const int64_t n = (argc > 1) ? std::stol(argv[1]) : 200;
+    const unsigned int reps = (argc > 2) ? std::stoul(argv[2]) : 3;
+
+    std::mt19937 gen(0);
+    std::uniform_real_distribution<float> distance(-1.0f, 5.0f);
+    std::bernoulli_distribution occupied(0.1);
+
+    VoxelGrid::VoxelGrid<sdf_tools::COLLISION_CELL> collision_grid(1.0, n, n, n, sdf_tools::COLLISION_CELL(0.0));
+    VoxelGrid::VoxelGrid<float> distance_grid(1.0, n, n, n, 0.0f);
+    for (int64_t x = 0; x < n; x++)
+        for (int64_t y = 0; y < n; y++)
+            for (int64_t z = 0; z < n; z++)
+            {
+                collision_grid.SetValue(x, y, z, sdf_tools::COLLISION_CELL(occupied(gen) ? 1.0f : 0.0f, (uint32_t)(x + y)));
+                distance_grid.SetValue(x, y, z, distance(gen));
+            }
+
+    const bool collision_ok = benchmark("VoxelGrid<COLLISION_CELL>", collision_grid, reps);
+    const bool distance_ok = benchmark("VoxelGrid<float>", distance_grid, reps);
+    return (collision_ok && distance_ok) ? 0 : 1;
+}
@@ -0,0 +1,106 @@
+/* Distance field of b_traj_node's local map for the FM* velocity field: the exact field of
+   ExtractDistanceField against ExtractTruncatedDistanceField cut at the distance where velMapping
+   saturates. The local map is the 16 x 16 x 8 m box of simulation.launch plus its buffer, filled
+   with the inflated trees of random_forest_sensing at the given density (trees per 100 m^2).
+
+   Every cell is checked to get the same speed from both fields: the truncated distance must equal
+   the exact one below the cutoff, and be at least the cutoff elsewhere.
+
+   Usage: ./truncated_edt_benchmark [cutoff] [density] [reps] */
+
+#include <stdio.h>
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <sdf_tools/collision_map.hpp>
+
+const double resolution = 0.2;
+const double x_size = 18.0, y_size = 18.0, z_size = 10.0;
+const sdf_tools::COLLISION_CELL free_cell(0.0), obst_cell(1.0);
+
+double elapsed(const std::chrono::steady_clock::time_point& start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// As in b_traj_node
+double velMapping(double d, double max_v)
+{
+    double vel;
+
+    if( d <= 0.25)
+        vel = 2.0 * d * d;
+    else if(d > 0.25 && d <= 0.75)
+        vel = 1.5 * d - 0.25;
+    else if(d > 0.75 && d <= 1.0)
+        vel = - 2.0 * (d - 1.0) * (d - 1.0) + 1;
+    else
+        vel = 1.0;
+
+    return vel * max_v;
+}
+
+int main(int argc, char** argv)
+{
+    const double cutoff = (argc > 1) ? std::stod(argv[1]) : 1.0;
+    const double density = (argc > 2) ? std::stod(argv[2]) : 2.0;
+    const int reps = (argc > 3) ? std::stoi(argv[3]) : 5;
+
+    const Eigen::Affine3d origin_transform(Eigen::Translation3d(0.0, 0.0, 0.0));
+    sdf_tools::CollisionMapGrid map(origin_transform, "world", resolution, x_size, y_size, z_size, free_cell);
+    std::mt19937 gen(0);
+    std::uniform_real_distribution<double> rand_x(0.0, x_size), rand_y(0.0, y_size), rand_w(0.3, 0.8);
+    const int tree_num = (int)(density * x_size * y_size / 100.0);
+    for (int i = 0; i < tree_num; i++)
+    {
+        const double x = rand_x(gen), y = rand_y(gen), w = rand_w(gen);
+        const int widNum = std::ceil(w / resolution);
+        for (int r = -widNum / 2 - 1; r < widNum / 2 + 1; r++)
+            for (int s = -widNum / 2 - 1; s < widNum / 2 + 1; s++)
+                for (double z = 0.0; z < z_size; z += resolution)
+                    map.Set(x + r * resolution, y + s * resolution, z, obst_cell);
+    }
+
+    double full_time = 0.0, truncated_time = 0.0;
+    for (int r = 0; r < reps; r++)
+    {
+        auto start = std::chrono::steady_clock::now();
+        auto full = map.ExtractDistanceField(INFINITY);
+        full_time += elapsed(start);
+        start = std::chrono::steady_clock::now();
+        auto truncated = map.ExtractTruncatedDistanceField(cutoff);
+        truncated_time += elapsed(start);
+    }
+
+    auto full = map.ExtractDistanceField(INFINITY);
+    auto truncated = map.ExtractTruncatedDistanceField(cutoff);
+    int64_t num_cells = 0, near_cells = 0, wrong_distance = 0, wrong_speed = 0;
+    for (int64_t x = 0; x < map.GetNumXCells(); x++)
+        for (int64_t y = 0; y < map.GetNumYCells(); y++)
+            for (int64_t z = 0; z < map.GetNumZCells(); z++)
+            {
+                const double full_distance = sqrt(full.GetImmutable(x, y, z).first.distance_square) * resolution;
+                const double truncated_distance = sqrt(truncated.GetImmutable(x, y, z).first.distance_square) * resolution;
+                num_cells++;
+                if (full_distance <= cutoff)
+                {
+                    near_cells++;
+                    wrong_distance += (truncated_distance != full_distance) ? 1 : 0;
+                }
+                else
+                {
+                    wrong_distance += (truncated_distance < cutoff) ? 1 : 0;
+                }
+                wrong_speed += (velMapping(full_distance, 1.0) != velMapping(truncated_distance, 1.0)) ? 1 : 0;
+            }
+
+    std::cout << std::fixed << std::setprecision(3)
+              << num_cells << " cells, " << tree_num << " trees, " << near_cells << " cells within " << cutoff << " m of an obstacle\n"
+              << "\texact field:      " << full_time * 1e3 / reps << " ms\n"
+              << "\ttruncated field:  " << truncated_time * 1e3 / reps << " ms\n"
+              << "\tcells with a different distance: " << wrong_distance << ", with a different speed: " << wrong_speed << std::endl;
+    return (wrong_distance == 0 && wrong_speed == 0) ? 0 : 1;
+}
@@ -0,0 +1,154 @@
+/* VersionedCollisionMap with one writer and several reader threads, as map ingestion and planning
+   would run on separate cores. The writer rewrites a number of random chunks per tick, as a delta
+   from the map server does, stamps the tick into every cell of a fixed box, and publishes. Each
+   reader pins the last version, checks that the box holds one stamp that never goes back, and reads
+   random cells. A reader seeing two stamps in the box would be reading a version being written.
+
+   Publishing only copies the chunks changed since the version a buffer holds; the time of a full
+   copy of the map (UpdateFrom from scratch) is given for comparison.
+
+   Usage: ./versioned_map_benchmark [ticks] [readers] [chunks per tick] */
+
+#include <stdio.h>
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <sdf_tools/dynamic_spatial_hashed_collision_map.hpp>
+#include <sdf_tools/versioned_collision_map.hpp>
+
+const double resolution = 0.2;
+const int64_t x_cells = 250, y_cells = 250, z_cells = 25, chunk_size = 16;
+const int64_t box_cells = 24;
+
+double elapsed(const std::chrono::steady_clock::time_point& start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+struct ReaderStats
+{
+    int64_t pins = 0;
+    int64_t torn = 0;
+    int64_t backwards = 0;
+    int64_t lookups = 0;
+    double pin_time = 0.0;
+};
+
+void reader(sdf_tools::VersionedCollisionMap& versions, const std::atomic<bool>& done, const int seed, ReaderStats& stats)
+{
+    std::mt19937 gen(seed);
+    std::uniform_int_distribution<int64_t> rand_x(0, x_cells - 1), rand_y(0, y_cells - 1), rand_z(0, z_cells - 1);
+    float last_stamp = -1.0f;
+    int64_t occupied = 0;
+    while (!done.load())
+    {
+        const auto start = std::chrono::steady_clock::now();
+        sdf_tools::VersionedCollisionMap::Snapshot snapshot = versions.Pin();
+        stats.pin_time += elapsed(start);
+        stats.pins++;
+        const sdf_tools::DynamicSpatialHashedCollisionMapGrid& map = snapshot.GetMap();
+        const float stamp = map.Get((int64_t)0, (int64_t)0, (int64_t)0).first.occupancy;
+        for (int64_t x = 0; x < box_cells; x++)
+            for (int64_t y = 0; y < box_cells; y++)
+                for (int64_t z = 0; z < box_cells; z++)
+                    if (map.Get(x, y, z).first.occupancy != stamp)
+                        stats.torn++;
+        if (stamp < last_stamp)
+            stats.backwards++;
+        last_stamp = stamp;
+        for (int i = 0; i < 100000; i++)
+            occupied += map.Get(rand_x(gen), rand_y(gen), rand_z(gen)).first.occupancy > 0.5;
+        stats.lookups += 100000;
+    }
+    if (occupied < 0)
+        std::cout << occupied;
+}
+
+int main(int argc, char** argv)
+{
+    const int ticks = (argc > 1) ? std::stoi(argv[1]) : 500;
+    const int num_readers = (argc > 2) ? std::stoi(argv[2]) : 3;
+    const int chunks_per_tick = (argc > 3) ? std::stoi(argv[3]) : 20;
+
+    std::mt19937 gen(0);
+    std::bernoulli_distribution occupied(0.1);
+    sdf_tools::DynamicSpatialHashedCollisionMapGrid map("world", resolution, chunk_size, chunk_size, chunk_size, sdf_tools::COLLISION_CELL(0.0));
+    for (int64_t x = 0; x < x_cells; x++)
+        for (int64_t y = 0; y < y_cells; y++)
+            for (int64_t z = 0; z < z_cells; z++)
+                if (occupied(gen))
+                    map.Set(x, y, z, sdf_tools::COLLISION_CELL(1.0));
+    for (int64_t x = 0; x < box_cells; x++)
+        for (int64_t y = 0; y < box_cells; y++)
+            for (int64_t z = 0; z < box_cells; z++)
+                map.Set(x, y, z, sdf_tools::COLLISION_CELL(0.0f, 1u));
+    sdf_tools::VersionedCollisionMap versions(map);
+
+    std::atomic<bool> done(false);
+    std::vector<ReaderStats> stats(num_readers);
+    std::vector<std::thread> readers;
+    for (int r = 0; r < num_readers; r++)
+        readers.push_back(std::thread(reader, std::ref(versions), std::cref(done), r + 1, std::ref(stats[r])));
+
+    std::uniform_int_distribution<int64_t> rand_chunk_x(0, x_cells / chunk_size - 1), rand_chunk_y(0, y_cells / chunk_size - 1), rand_chunk_z(0, z_cells / chunk_size - 1);
+    double write_time = 0.0, publish_time = 0.0;
+    int failed = 0;
+    const auto run_start = std::chrono::steady_clock::now();
+    for (int tick = 1; tick <= ticks; tick++)
+    {
+        sdf_tools::DynamicSpatialHashedCollisionMapGrid& writable = versions.GetWritable();
+        const auto write_start = std::chrono::steady_clock::now();
+        for (int c = 0; c < chunks_per_tick; c++)
+        {
+            const int64_t cx = rand_chunk_x(gen) * chunk_size, cy = rand_chunk_y(gen) * chunk_size, cz = rand_chunk_z(gen) * chunk_size;
+            for (int64_t x = cx; x < cx + chunk_size; x++)
+                for (int64_t y = cy; y < cy + chunk_size; y++)
+                    for (int64_t z = cz; z < cz + chunk_size; z++)
+                        if (x >= box_cells || y >= box_cells || z >= box_cells)
+                            writable.Set(x, y, z, sdf_tools::COLLISION_CELL(occupied(gen) ? 1.0f : 0.0f, 1u));
+        }
+        for (int64_t x = 0; x < box_cells; x++)
+            for (int64_t y = 0; y < box_cells; y++)
+                for (int64_t z = 0; z < box_cells; z++)
+                    writable.Set(x, y, z, sdf_tools::COLLISION_CELL((float)tick, 1u));
+        write_time += elapsed(write_start);
+        const auto publish_start = std::chrono::steady_clock::now();
+        failed += versions.Publish() ? 0 : 1;
+        publish_time += elapsed(publish_start);
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+    const double run_time = elapsed(run_start);
+    done.store(true);
+    for (size_t r = 0; r < readers.size(); r++)
+        readers[r].join();
+
+    sdf_tools::DynamicSpatialHashedCollisionMapGrid full_copy;
+    const auto copy_start = std::chrono::steady_clock::now();
+    for (int r = 0; r < 20; r++)
+        full_copy.UpdateFrom(versions.GetWritable(), 0);
+    const double copy_time = elapsed(copy_start) / 20;
+
+    ReaderStats total;
+    for (size_t r = 0; r < stats.size(); r++)
+    {
+        total.pins += stats[r].pins;
+        total.torn += stats[r].torn;
+        total.backwards += stats[r].backwards;
+        total.lookups += stats[r].lookups;
+        total.pin_time += stats[r].pin_time;
+    }
+    std::cout << std::fixed << std::setprecision(3)
+              << ticks << " ticks of " << chunks_per_tick << " chunks, " << num_readers << " readers, " << versions.GetWritable().GetNumChunks() << " chunks in the map\n"
+              << "\twrite:            " << write_time * 1e3 / ticks << " ms per tick\n"
+              << "\tpublish:          " << publish_time * 1e3 / ticks << " ms per tick, " << failed << " skipped\n"
+              << "\tfull copy:        " << copy_time * 1e3 << " ms\n"
+              << "\tpin:              " << total.pin_time * 1e9 / total.pins << " ns, " << total.pins << " pins\n"
+              << "\treader lookups:   " << total.lookups / run_time / 1e6 << " M/s\n"
+              << "\ttorn reads:       " << total.torn << ", stamps going back: " << total.backwards << '\n';
+    return (total.torn == 0 && total.backwards == 0) ? 0 : 1;
+}